@@ -0,0 +1,64 @@
+# ======================================================================
+#  SuperBoot build configuration — which features go into the image
+# ======================================================================
+#
+#  Firmware reads and relocates the whole image before it runs, from
+#  USB sticks that can manage well under 1 MB/s, so leaving out what a
+#  deployment never uses shortens every boot.  Select features here or
+#  on the command line:
+#
+#    make FEATURES="grub ext4 xfs"          # GRUB on ext4/XFS only
+#    make FEATURES="grub ext4 xfs" size-report
+#
+#  The Makefile generates build/gen/sb_features.h from the selection:
+#  one SB_FEATURE_<NAME> macro (1 or 0) per feature, plus the parser
+#  and filesystem driver registries used by config.c and vfs.c.
+#
+#  Config parsers:     grub systemd_boot limine
+#  Filesystem drivers: ext4 btrfs xfs ntfs  (FAT and anything with a
+#                      firmware driver are always readable)
+#  Block layer:        nvme      queued reads through NVMe PassThru
+#                                for the built-in drivers
+#                      sfs       SimpleFileSystem on partitions the
+#                                built-in drivers mount, so firmware
+#                                and chain-loaded images can read them
+#  TUI / tools:        gop       graphical renderer and built-in font;
+#                                without it the menu uses text mode
+#                      explorer  file browser and viewer ([f], and the
+#                                fallback when nothing is bootable)
+#                      deploy    install to the internal ESP ([d])
+
+FEATURES ?= grub systemd_boot limine ext4 btrfs xfs ntfs nvme sfs gop \
+            explorer deploy
+
+# ---- Feature table ----------------------------------------------------
+#
+#  FEATURE_<name>_SRCS    sources compiled only when <name> is selected
+#  FEATURE_<name>_PARSER  ConfigParser it adds to the parser registry
+#  FEATURE_<name>_FS      VfsDriver it adds to the built-in driver table
+
+ALL_FEATURES := grub systemd_boot limine ext4 btrfs xfs ntfs nvme sfs \
+                gop explorer deploy
+
+FEATURE_grub_SRCS           := config/grub.c
+FEATURE_grub_PARSER         := sb_parser_grub
+FEATURE_systemd_boot_SRCS   := config/systemd_boot.c
+FEATURE_systemd_boot_PARSER := sb_parser_systemd_boot
+FEATURE_limine_SRCS         := config/limine.c
+FEATURE_limine_PARSER       := sb_parser_limine
+
+FEATURE_ext4_SRCS           := fs/ext4.c
+FEATURE_ext4_FS             := sb_vfs_ext4
+FEATURE_btrfs_SRCS          := fs/btrfs.c
+FEATURE_btrfs_FS            := sb_vfs_btrfs
+FEATURE_xfs_SRCS            := fs/xfs.c
+FEATURE_xfs_FS              := sb_vfs_xfs
+FEATURE_ntfs_SRCS           := fs/ntfs.c
+FEATURE_ntfs_FS             := sb_vfs_ntfs
+
+FEATURE_nvme_SRCS           := fs/nvme.c
+FEATURE_sfs_SRCS            := fs/sfs.c
+
+FEATURE_gop_SRCS            := tui/gop.c tui/font.c
+FEATURE_explorer_SRCS       := tui/explorer.c
+FEATURE_deploy_SRCS         := deploy/deploy.c deploy/nvram.c
@@ -18,16 +18,9 @@ sb_chainload_efi(SuperBootContext *ctx, const BootTarget *target)
 
     SB_LOG(L"Chain-loading: %s", target->efi_path);
 
-    /* Read the .efi binary via VFS. */
-    status = sb_vfs_read_file(target->device_handle,
-                              target->efi_path, &buf, &size);
-    SB_CHECK(status, L"Failed to read EFI binary");
-
-    /* Build a device path for the target.  We need the disk device
-     * path + the file path appended. */
+    /* Build a device path for the target: the disk device path with
+     * the file path appended. */
     EFI_DEVICE_PATH_PROTOCOL *dev_path = NULL;
-
-    /* Get the device's existing device path. */
     EFI_DEVICE_PATH_PROTOCOL *disk_path;
     status = ctx->boot_services->HandleProtocol(
                  target->device_handle,
@@ -38,7 +31,25 @@ sb_chainload_efi(SuperBootContext *ctx, const BootTarget *target)
                                   (CHAR16 *)target->efi_path);
     }
 
-    /* Load the image from the memory buffer. */
+    /* Where the partition has a SimpleFileSystem (the firmware's, or
+     * the one the VFS publishes for its built-in drivers) the firmware
+     * reads the image itself; otherwise read it through the VFS and
+     * load it from memory. */
+    EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *sfs;
+    if (!dev_path ||
+        EFI_ERROR(ctx->boot_services->HandleProtocol(
+                      target->device_handle,
+                      &gEfiSimpleFileSystemProtocolGuid, (void **)&sfs))) {
+        status = sb_vfs_read_file(target->device_handle,
+                                  target->efi_path, &buf, &size);
+        if (EFI_ERROR(status)) {
+            if (dev_path)
+                FreePool(dev_path);
+            SB_LOG(L"Failed to read EFI binary: %r", status);
+            return status;
+        }
+    }
+
     EFI_HANDLE child_handle = NULL;
     status = ctx->boot_services->LoadImage(
                  FALSE,
@@ -46,19 +57,22 @@ sb_chainload_efi(SuperBootContext *ctx, const BootTarget *target)
                  dev_path,
                  buf, size,
                  &child_handle);
+    if (dev_path)
+        FreePool(dev_path);
+    sb_free(buf);
     if (EFI_ERROR(status)) {
         SB_LOG(L"LoadImage failed: %r", status);
-        FreePool(buf);
         return status;
     }
 
-    FreePool(buf);
+    sb_vfs_shutdown();
 
     /* Start the loaded image.  This transfers control and may not
      * return (e.g., Windows Boot Manager). */
     UINTN exit_data_size = 0;
     CHAR16 *exit_data = NULL;
 
+    sb_control_mark(L"handoff");
     status = ctx->boot_services->StartImage(
                  child_handle, &exit_data_size, &exit_data);
     if (EFI_ERROR(status))
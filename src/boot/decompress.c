@@ -0,0 +1,533 @@
+/*
+ * decompress.c — Load kernel images, decompressing on the fly
+ *
+ * The file is read front to back in KERNEL_CHUNK pieces.  Every piece
+ * is hashed (for measured boot) as it arrives, and the compressed
+ * stream inside it is handed to the decoder, which writes straight
+ * into the page allocation the kernel will run from.  Nothing holds
+ * the whole compressed image at once.
+ *
+ * With the worker pool running, the decoder runs on an AP while the
+ * BSP keeps reading: the two meet in a ring of KERNEL_RING chunks, so
+ * disk I/O and hashing overlap with decompression.  Without APs the
+ * decoder's refill() simply reads the next chunk itself.
+ *
+ * Output size comes from the container where it is recorded (gzip
+ * ISIZE, zstd frame content size, the zboot size trailer); otherwise
+ * it is estimated and the unused tail of the allocation stays unused.
+ */
+
+#include "decompress.h"
+#include "../fs/vfs.h"
+
+#define KERNEL_CHUNK   (256 * 1024)
+#define KERNEL_RING    4
+
+/* First guess at the output size of zstd streams that do not record
+ * it; doubled (and the file read again) while it proves too small. */
+#define KERNEL_RATIO_ESTIMATE  5
+
+/* How long the BSP waits for an AP to pick up the decoder before it
+ * gives up and decompresses on its own. */
+#define KERNEL_START_TIMEOUT_US  (1000 * 1000)
+
+/* ------------------------------------------------------------------ */
+/*  Format detection                                                   */
+/* ------------------------------------------------------------------ */
+
+static UINT32
+get_le32(const UINT8 *p)
+{
+    return (UINT32)p[0] | (UINT32)p[1] << 8 |
+           (UINT32)p[2] << 16 | (UINT32)p[3] << 24;
+}
+
+static SbImageFormat
+detect_stream(const UINT8 *p, UINTN len)
+{
+    if (len >= 2 && p[0] == 0x1F && p[1] == 0x8B)
+        return SB_IMAGE_GZIP;
+    if (len >= 4 && get_le32(p) == 0xFD2FB528)
+        return SB_IMAGE_ZSTD;
+    return SB_IMAGE_RAW;
+}
+
+/*
+ * EFI zboot (drivers/firmware/efi/libstub/zboot-header.S): "MZ", then
+ * "zimg" at 4, payload offset and size at 8 and 12, and the
+ * compression name at 24.  zstd payloads are followed by a 4-byte
+ * decompressed size; gzip carries its own in ISIZE.
+ */
+static BOOLEAN
+detect_zboot(const UINT8 *p, UINTN len, UINT64 file_size,
+             UINT64 *start, UINT64 *end, SbImageFormat *codec)
+{
+    if (len < 32 || p[0] != 'M' || p[1] != 'Z' ||
+        p[4] != 'z' || p[5] != 'i' || p[6] != 'm' || p[7] != 'g')
+        return FALSE;
+
+    UINT64 off  = get_le32(p + 8);
+    UINT64 size = get_le32(p + 12);
+    if (off + size > file_size)
+        return FALSE;
+
+    const CHAR8 *name = (const CHAR8 *)p + 24;
+    if (sb_strncmp8(name, "gzip", 5) == 0)
+        *codec = SB_IMAGE_GZIP;
+    else if (sb_strncmp8(name, "zstd", 5) == 0)
+        *codec = SB_IMAGE_ZSTD;
+    else
+        return FALSE;
+
+    *start = off;
+    *end   = off + size;
+    return TRUE;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Reader                                                             */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    SbInStream        in;           /* first: refill() casts back     */
+    SbVfsFile        *file;
+    SbSha256         *hash;
+    UINT64            size;         /* file size                      */
+    UINT64            pos;          /* next file offset to read       */
+    UINT64            start, end;   /* compressed stream in the file  */
+    EFI_STATUS        read_status;
+
+    UINT8            *chunk[KERNEL_RING + 1];   /* last: hash-only    */
+    const UINT8      *data[KERNEL_RING];
+    UINTN             len[KERNEL_RING];
+
+    /* Ring state, shared with the decoder when it runs on an AP. */
+    volatile UINTN    produced;
+    volatile UINTN    consumed;
+    volatile UINTN    eof;
+    volatile UINTN    started;
+    volatile UINTN    finished;
+    volatile UINTN    abort;
+    BOOLEAN           holding;      /* decoder owns data[consumed]    */
+    BOOLEAN           threaded;     /* decoder ran on an AP           */
+
+    /* Decoder job. */
+    SbImageFormat     codec;
+    void             *work;
+    UINT8            *out;
+    UINTN             cap;
+    UINTN             out_len;
+    EFI_STATUS        status;
+} KernelReader;
+
+/*
+ * Read the next chunk of the file into `buf`, hash it, and return the
+ * part of it that belongs to the compressed stream (possibly empty).
+ */
+static EFI_STATUS
+read_chunk(KernelReader *r, UINT8 *buf, const UINT8 **data, UINTN *len)
+{
+    UINT64 at = r->pos;
+    UINTN  n  = KERNEL_CHUNK;
+
+    EFI_STATUS s = sb_vfs_read_at(r->file, at, buf, &n);
+    if (EFI_ERROR(s))
+        return s;
+    if (n == 0)
+        return EFI_END_OF_FILE;
+    if (r->hash)
+        sb_sha256_update(r->hash, buf, n);
+    r->pos += n;
+
+    UINT64 lo = at > r->start ? at : r->start;
+    UINT64 hi = r->pos < r->end ? r->pos : r->end;
+    *data = buf + (lo - at);
+    *len  = hi > lo ? (UINTN)(hi - lo) : 0;
+    return EFI_SUCCESS;
+}
+
+/* Read the rest of the file for the hash only. */
+static EFI_STATUS
+read_rest(KernelReader *r)
+{
+    while (r->pos < r->size) {
+        const UINT8 *data;
+        UINTN len;
+        EFI_STATUS s = read_chunk(r, r->chunk[KERNEL_RING], &data, &len);
+        if (EFI_ERROR(s))
+            return s;
+    }
+    return EFI_SUCCESS;
+}
+
+/* refill() on the BSP: read the next chunk in place. */
+static BOOLEAN
+refill_sync(SbInStream *in)
+{
+    KernelReader *r = (KernelReader *)in;
+
+    while (r->pos < r->end) {
+        const UINT8 *data;
+        UINTN len;
+        r->read_status = read_chunk(r, r->chunk[0], &data, &len);
+        if (EFI_ERROR(r->read_status))
+            return FALSE;
+        if (len) {
+            in->next = data;
+            in->end  = data + len;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/* refill() on an AP: release the chunk just used, wait for the next. */
+static BOOLEAN
+refill_ring(SbInStream *in)
+{
+    KernelReader *r = (KernelReader *)in;
+
+    if (r->holding) {
+        __atomic_store_n(&r->consumed, r->consumed + 1, __ATOMIC_SEQ_CST);
+        r->holding = FALSE;
+    }
+
+    for (;;) {
+        /* eof first: it is set after the last chunk is published. */
+        UINTN eof  = __atomic_load_n(&r->eof, __ATOMIC_SEQ_CST);
+        UINTN prod = __atomic_load_n(&r->produced, __ATOMIC_SEQ_CST);
+
+        if (prod > r->consumed) {
+            UINTN slot = r->consumed % KERNEL_RING;
+            in->next   = r->data[slot];
+            in->end    = r->data[slot] + r->len[slot];
+            r->holding = TRUE;
+            return TRUE;
+        }
+        if (eof)
+            return FALSE;
+        __builtin_ia32_pause();
+    }
+}
+
+static void
+decode(KernelReader *r)
+{
+    if (r->codec == SB_IMAGE_GZIP)
+        r->status = sb_gunzip(r->work, &r->in, r->out, r->cap, &r->out_len);
+    else
+        r->status = sb_unzstd(r->work, &r->in, r->out, r->cap, &r->out_len);
+}
+
+static void
+decode_job(void *arg)
+{
+    KernelReader *r = arg;
+
+    __atomic_store_n(&r->started, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&r->abort, __ATOMIC_SEQ_CST))
+        r->status = EFI_ABORTED;
+    else
+        decode(r);
+    __atomic_store_n(&r->finished, 1, __ATOMIC_SEQ_CST);
+}
+
+/*
+ * BSP side of the ring: keep it full until the stream has been read or
+ * the decoder stops.  Returns EFI_TIMEOUT if no AP ever started the
+ * decoder.
+ */
+static EFI_STATUS
+produce(KernelReader *r)
+{
+    UINT64 t0 = sb_time_us();
+
+    while (r->pos < r->end) {
+        /* Wait for a free slot, or for the decoder to stop early. */
+        while (r->produced - __atomic_load_n(&r->consumed, __ATOMIC_SEQ_CST)
+               >= KERNEL_RING) {
+            if (__atomic_load_n(&r->finished, __ATOMIC_SEQ_CST))
+                goto done;
+            if (!__atomic_load_n(&r->started, __ATOMIC_SEQ_CST) &&
+                sb_time_us() - t0 > KERNEL_START_TIMEOUT_US) {
+                __atomic_store_n(&r->abort, 1, __ATOMIC_SEQ_CST);
+                __atomic_store_n(&r->eof, 1, __ATOMIC_SEQ_CST);
+                return EFI_TIMEOUT;
+            }
+            __builtin_ia32_pause();
+        }
+        if (__atomic_load_n(&r->finished, __ATOMIC_SEQ_CST))
+            break;
+
+        UINTN slot = r->produced % KERNEL_RING;
+        r->read_status = read_chunk(r, r->chunk[slot],
+                                    &r->data[slot], &r->len[slot]);
+        if (EFI_ERROR(r->read_status))
+            break;
+        if (r->len[slot])
+            __atomic_store_n(&r->produced, r->produced + 1,
+                             __ATOMIC_SEQ_CST);
+    }
+
+done:
+    __atomic_store_n(&r->eof, 1, __ATOMIC_SEQ_CST);
+    return EFI_SUCCESS;
+}
+
+/*
+ * Decompress the stream, on an AP if the pool is running.  The first
+ * chunk (already read for detection) is in chunk[0]; `first`/`first_len`
+ * is its share of the stream.
+ */
+static EFI_STATUS
+run_decoder(KernelReader *r, const UINT8 *first, UINTN first_len,
+            BOOLEAN use_pool)
+{
+    r->produced = r->consumed = 0;
+    r->eof = r->started = r->finished = r->abort = 0;
+    r->holding = FALSE;
+    r->threaded = FALSE;
+
+    if (use_pool && !EFI_ERROR(sb_workers_start()) &&
+        sb_workers_count() > 1) {
+        r->data[0] = first;
+        r->len[0]  = first_len;
+        r->produced = first_len ? 1 : 0;
+        r->in.next = r->in.end = NULL;
+        r->in.refill = refill_ring;
+
+        SbJob job = { decode_job, r };
+        sb_workers_submit(&job, 1);
+        EFI_STATUS s = produce(r);
+        sb_workers_wait();
+        sb_workers_stop();
+        r->threaded = s != EFI_TIMEOUT;
+        return s;
+    }
+
+    r->in.next   = first;
+    r->in.end    = first + first_len;
+    r->in.refill = refill_sync;
+    decode(r);
+    return EFI_SUCCESS;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Public API                                                         */
+/* ------------------------------------------------------------------ */
+
+static EFI_STATUS
+alloc_image(SbKernelImage *img, UINTN size)
+{
+    img->pages = (size + 4095) / 4096;
+    if (img->pages == 0)
+        img->pages = 1;
+    EFI_STATUS s = sb_page_alloc(SB_MEM_BOOT, AllocateAnyPages,
+                                 img->pages, &img->addr);
+    if (EFI_ERROR(s)) {
+        img->pages = 0;
+        return s;
+    }
+    img->buf = (void *)(UINTN)img->addr;
+    return EFI_SUCCESS;
+}
+
+void
+sb_kernel_free(SbKernelImage *img)
+{
+    if (img->pages)
+        sb_page_free(img->addr, img->pages);
+    img->buf   = NULL;
+    img->addr  = 0;
+    img->pages = 0;
+}
+
+/* Raw image: read it straight into its pages. */
+static EFI_STATUS
+read_raw(KernelReader *r, SbKernelImage *img)
+{
+    EFI_STATUS s = alloc_image(img, (UINTN)r->size);
+    if (EFI_ERROR(s))
+        return s;
+
+    UINT8 *dst = img->buf;
+    sb_memcpy(dst, r->chunk[0], (UINTN)r->pos);
+    while (r->pos < r->size) {
+        const UINT8 *data;
+        UINTN len;
+        s = read_chunk(r, dst + r->pos, &data, &len);
+        if (EFI_ERROR(s))
+            return s;
+    }
+    img->size = (UINTN)r->size;
+    return EFI_SUCCESS;
+}
+
+/* Decompressed size, or 0 if the container does not say. */
+static UINT64
+output_size(KernelReader *r, BOOLEAN zboot, const UINT8 *first,
+            UINTN first_len)
+{
+    UINT8 tail[4];
+    UINTN n = sizeof(tail);
+
+    if (r->codec == SB_IMAGE_ZSTD) {
+        UINT64 fcs = sb_unzstd_content_size(first, first_len);
+        if (fcs || !zboot)
+            return fcs;
+        /* zboot: size trailer after the payload. */
+        if (EFI_ERROR(sb_vfs_read_at(r->file, r->end, tail, &n)) || n != 4)
+            return 0;
+        return get_le32(tail);
+    }
+
+    /* gzip: ISIZE, the last four bytes of the (last) member. */
+    if (r->end - r->start < 18 ||
+        EFI_ERROR(sb_vfs_read_at(r->file, r->end - 4, tail, &n)) || n != 4)
+        return 0;
+    return get_le32(tail);
+}
+
+EFI_STATUS
+sb_kernel_read(SuperBootContext *ctx, EFI_HANDLE device,
+               const CHAR16 *path, SbSha256 *hash, SbKernelImage *img)
+{
+    SetMem(img, sizeof(*img), 0);
+
+    KernelReader *r = sb_zalloc(SB_MEM_BOOT, sizeof(*r));
+    if (!r)
+        return EFI_OUT_OF_RESOURCES;
+
+    EFI_STATUS status = sb_vfs_open(device, path, &r->file);
+    if (EFI_ERROR(status))
+        goto out;
+
+    r->hash = hash;
+    r->size = sb_vfs_file_size(r->file);
+    r->end  = r->size;
+
+    for (UINTN i = 0; i <= KERNEL_RING; i++) {
+        r->chunk[i] = sb_malloc(SB_MEM_BOOT, KERNEL_CHUNK);
+        if (!r->chunk[i]) {
+            status = EFI_OUT_OF_RESOURCES;
+            goto out;
+        }
+    }
+
+    /* Keep the hash state: a fallback from the AP path re-reads the
+     * file from the start. */
+    SbSha256 hash0;
+    if (hash)
+        hash0 = *hash;
+
+    /* First chunk: identify the format. */
+    const UINT8 *first;
+    UINTN first_len;
+    status = read_chunk(r, r->chunk[0], &first, &first_len);
+    if (EFI_ERROR(status))
+        goto out;
+
+    BOOLEAN zboot = detect_zboot(r->chunk[0], (UINTN)r->pos, r->size,
+                                 &r->start, &r->end, &r->codec);
+    if (zboot) {
+        img->format = SB_IMAGE_ZBOOT;
+        if (r->start >= r->pos) {
+            SB_LOG(L"zboot payload outside the first %u KiB",
+                   KERNEL_CHUNK / 1024);
+            status = EFI_UNSUPPORTED;
+            goto out;
+        }
+        first     = r->chunk[0] + r->start;
+        first_len = (UINTN)((r->pos < r->end ? r->pos : r->end) - r->start);
+    } else {
+        r->codec = img->format = detect_stream(first, first_len);
+    }
+
+    if (img->format == SB_IMAGE_RAW) {
+        status = read_raw(r, img);
+        goto out;
+    }
+
+    UINT64 out_size = output_size(r, zboot, first, first_len);
+    BOOLEAN estimated = out_size == 0;
+    if (estimated)
+        out_size = (r->end - r->start) * KERNEL_RATIO_ESTIMATE;
+
+    UINTN work_size = r->codec == SB_IMAGE_GZIP ? sb_gunzip_workspace()
+                                                : sb_unzstd_workspace();
+    r->work = sb_malloc(SB_MEM_BOOT, work_size);
+    if (!r->work) {
+        status = EFI_OUT_OF_RESOURCES;
+        goto out;
+    }
+
+    UINT64 t0 = sb_time_us();
+    BOOLEAN use_pool = TRUE;
+    for (;;) {
+        status = alloc_image(img, (UINTN)out_size);
+        if (EFI_ERROR(status))
+            goto out;
+        r->out = img->buf;
+        r->cap = img->pages * 4096;
+
+        status = run_decoder(r, first, first_len, use_pool);
+        if (status == EFI_TIMEOUT) {
+            SB_DBG(ctx, L"Decoder never started on an AP; "
+                        L"decompressing on the BSP");
+            use_pool = FALSE;
+        } else if (estimated && r->status == EFI_BUFFER_TOO_SMALL &&
+                   !EFI_ERROR(r->read_status)) {
+            out_size *= 2;
+        } else {
+            break;
+        }
+
+        /* Start over: new buffer, file and hash from the beginning. */
+        sb_kernel_free(img);
+        if (hash)
+            *hash = hash0;
+        r->pos = 0;
+        status = read_chunk(r, r->chunk[0], &first, &first_len);
+        if (EFI_ERROR(status))
+            goto out;
+    }
+
+    if (EFI_ERROR(r->read_status)) {
+        status = r->read_status;
+        goto out;
+    }
+    status = r->status;
+    if (EFI_ERROR(status)) {
+        SB_LOG(L"Decompressing %s: %r", path, status);
+        goto out;
+    }
+    status = read_rest(r);
+    if (EFI_ERROR(status))
+        goto out;
+
+    img->size = r->out_len;
+
+    UINT64 us = sb_time_us() - t0;
+    SB_DBG(ctx, L"%s: %s %lu -> %lu bytes in %lu us (%lu MiB/s)%s",
+           path, r->codec == SB_IMAGE_GZIP ? L"gzip" : L"zstd",
+           r->end - r->start, (UINT64)img->size, us,
+           us ? (UINT64)img->size * 1000000 / us / (1024 * 1024) : 0,
+           r->threaded ? L", on an AP" : L"");
+
+    /* zboot wraps whatever the architecture boots; we only boot x86. */
+    if (zboot && (img->size < 0x206 ||
+                  get_le32((UINT8 *)img->buf + 0x202) != 0x53726448)) {
+        SB_LOG(L"zboot payload in %s is not an x86 bzImage", path);
+        status = EFI_UNSUPPORTED;
+    }
+
+out:
+    if (EFI_ERROR(status))
+        sb_kernel_free(img);
+    for (UINTN i = 0; i <= KERNEL_RING; i++)
+        sb_free(r->chunk[i]);
+    sb_free(r->work);
+    sb_vfs_close(r->file);
+    sb_free(r);
+    return status;
+}
@@ -0,0 +1,89 @@
+/*
+ * decompress.h — Compressed kernel images
+ *
+ * Distributions increasingly ship kernels that are not a bare bzImage:
+ * a gzip- or zstd-compressed image, or an EFI zboot image (a small PE
+ * wrapper around a compressed payload).  The decoders here are
+ * freestanding: they make no firmware calls and allocate nothing, so
+ * they can run on an application processor and build on the host for
+ * benchmarking (tools/decomp-bench.c).
+ */
+
+#ifndef SUPERBOOT_DECOMPRESS_H
+#define SUPERBOOT_DECOMPRESS_H
+
+#include "../superboot.h"
+
+/* ------------------------------------------------------------------ */
+/*  Input streams                                                      */
+/*                                                                     */
+/*  Decoders consume [next, end) and call refill() when it runs dry.  */
+/*  refill() makes more input available and returns FALSE at the end  */
+/*  of the input (or if reading it failed).                            */
+/* ------------------------------------------------------------------ */
+
+typedef struct SbInStream SbInStream;
+
+struct SbInStream {
+    const UINT8 *next;
+    const UINT8 *end;
+    BOOLEAN    (*refill)(SbInStream *in);
+};
+
+/* ------------------------------------------------------------------ */
+/*  Decoders                                                           */
+/*                                                                     */
+/*  Each needs a caller-allocated workspace of *_workspace() bytes     */
+/*  (tables and block buffers: too large for an AP stack).  Output     */
+/*  goes to a flat buffer, which also serves as the history window.    */
+/*                                                                     */
+/*  Returns EFI_SUCCESS, EFI_BUFFER_TOO_SMALL if the output exceeds    */
+/*  `cap`, EFI_END_OF_FILE on truncated input, EFI_CRC_ERROR on a      */
+/*  checksum mismatch, EFI_COMPROMISED_DATA on malformed input, or     */
+/*  EFI_UNSUPPORTED for valid features we do not implement.           */
+/* ------------------------------------------------------------------ */
+
+/* inflate.c — gzip (RFC 1952) members holding deflate (RFC 1951). */
+UINTN      sb_gunzip_workspace(void);
+EFI_STATUS sb_gunzip(void *work, SbInStream *in,
+                     UINT8 *out, UINTN cap, UINTN *out_len);
+
+/* unzstd.c — Zstandard frames (RFC 8878), no dictionaries. */
+UINTN      sb_unzstd_workspace(void);
+EFI_STATUS sb_unzstd(void *work, SbInStream *in,
+                     UINT8 *out, UINTN cap, UINTN *out_len);
+
+/* Decompressed size declared in a zstd frame header, or 0. */
+UINT64     sb_unzstd_content_size(const UINT8 *hdr, UINTN len);
+
+/* ------------------------------------------------------------------ */
+/*  Kernel images (decompress.c)                                       */
+/* ------------------------------------------------------------------ */
+
+typedef enum {
+    SB_IMAGE_RAW = 0,       /* anything else: loaded as-is          */
+    SB_IMAGE_GZIP,
+    SB_IMAGE_ZSTD,
+    SB_IMAGE_ZBOOT,         /* EFI zboot around gzip or zstd        */
+} SbImageFormat;
+
+typedef struct {
+    void                 *buf;      /* image in memory (== addr)     */
+    UINTN                 size;     /* bytes of image                */
+    EFI_PHYSICAL_ADDRESS  addr;
+    UINTN                 pages;    /* sb_page_alloc() pages at addr */
+    SbImageFormat         format;
+} SbKernelImage;
+
+/*
+ * sb_kernel_read() — load a kernel image into pages, decompressing it
+ * while it is read if it is compressed.  If `hash` is non-NULL the
+ * file as stored (compressed) is fed to it.  Release the image with
+ * sb_kernel_free().
+ */
+EFI_STATUS sb_kernel_read(SuperBootContext *ctx, EFI_HANDLE device,
+                          const CHAR16 *path, SbSha256 *hash,
+                          SbKernelImage *img);
+void       sb_kernel_free(SbKernelImage *img);
+
+#endif /* SUPERBOOT_DECOMPRESS_H */
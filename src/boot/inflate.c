@@ -0,0 +1,672 @@
+/*
+ * inflate.c — gzip / deflate decoder
+ *
+ * A streaming inflate (RFC 1951) inside gzip members (RFC 1952), built
+ * for decompressing kernels straight into their load buffer:
+ *
+ *   - output is one flat buffer, which doubles as the history window,
+ *     so there is no 32 KiB window to maintain and no copy out of it
+ *   - input arrives in chunks through SbInStream; the bit reader keeps
+ *     up to 64 bits of look-ahead and refills eight bytes at a time
+ *     while at least eight remain in the chunk
+ *   - Huffman codes decode through a 10-bit primary table with small
+ *     second-level tables for longer codes (one lookup for nearly all
+ *     symbols)
+ *   - matches copy eight bytes at a time when they do not overlap
+ *     within a word
+ *
+ * CRC-32 (slice-by-8) runs over each block's output right after it is
+ * produced, while it is still in cache.
+ */
+
+#include "decompress.h"
+
+/* ------------------------------------------------------------------ */
+/*  Tables                                                             */
+/* ------------------------------------------------------------------ */
+
+#define PRIMARY_BITS   10
+#define PRIMARY_MASK   ((1U << PRIMARY_BITS) - 1)
+#define MAX_CODE_BITS  15
+
+/* Primary table plus worst-case second-level tables: one per long
+ * code's prefix, each 2^(15 - 10) entries. */
+#define LIT_TABLE   ((1U << PRIMARY_BITS) + 288 * 32)
+#define DIST_TABLE  ((1U << PRIMARY_BITS) + 32 * 32)
+
+/*
+ * Table entry: bits 0-7 are the code length to consume (0 = invalid
+ * code), bit 8 marks a link to a second-level table, bits 16-31 hold
+ * the symbol or the second-level table's offset.
+ */
+#define ENTRY_SUB   0x100U
+
+typedef struct {
+    UINT32 lit[LIT_TABLE];
+    UINT32 dist[DIST_TABLE];
+    UINT32 lit_sub_mask;
+    UINT32 dist_sub_mask;
+    UINT8  lens[288 + 32];
+    UINT32 crc[8][256];
+} Inflate;
+
+static const UINT16 len_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const UINT8 len_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const UINT16 dist_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+    8193, 12289, 16385, 24577
+};
+static const UINT8 dist_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+static const UINT8 clen_order[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+/*
+ * Build a decoding table for `n` code lengths.  Over-subscribed sets
+ * are rejected; incomplete ones are allowed (a single distance code is
+ * legal) and leave unused entries invalid.
+ */
+static BOOLEAN
+build_table(UINT32 *table, UINT32 *sub_mask, const UINT8 *lens, UINTN n)
+{
+    UINT16 count[MAX_CODE_BITS + 1];
+    UINT16 next[MAX_CODE_BITS + 1];
+    UINTN  max_len = 0;
+
+    for (UINTN i = 0; i <= MAX_CODE_BITS; i++)
+        count[i] = 0;
+    for (UINTN i = 0; i < n; i++) {
+        count[lens[i]]++;
+        if (lens[i] > max_len)
+            max_len = lens[i];
+    }
+    count[0] = 0;
+
+    INT32 left = 1;
+    for (UINTN len = 1; len <= MAX_CODE_BITS; len++) {
+        left = (left << 1) - count[len];
+        if (left < 0)
+            return FALSE;
+    }
+
+    UINT32 code = 0;
+    for (UINTN len = 1; len <= MAX_CODE_BITS; len++) {
+        code = (code + count[len - 1]) << 1;
+        next[len] = (UINT16)code;
+    }
+
+    for (UINTN i = 0; i <= PRIMARY_MASK; i++)
+        table[i] = 0;
+
+    UINT32 sub_bits = max_len > PRIMARY_BITS ? max_len - PRIMARY_BITS : 0;
+    UINT32 sub_free = 1U << PRIMARY_BITS;
+
+    for (UINTN sym = 0; sym < n; sym++) {
+        UINT32 len = lens[sym];
+        if (len == 0)
+            continue;
+
+        /* Deflate sends codes MSB first; the bit reader is LSB first. */
+        UINT32 c = next[len]++, rev = 0;
+        for (UINT32 i = 0; i < len; i++, c >>= 1)
+            rev = (rev << 1) | (c & 1);
+
+        if (len <= PRIMARY_BITS) {
+            for (UINT32 k = rev; k <= PRIMARY_MASK; k += 1U << len)
+                table[k] = ((UINT32)sym << 16) | len;
+            continue;
+        }
+
+        UINT32 prefix = rev & PRIMARY_MASK;
+        if (!(table[prefix] & ENTRY_SUB)) {
+            table[prefix] = (sub_free << 16) | ENTRY_SUB | PRIMARY_BITS;
+            for (UINT32 k = 0; k < (1U << sub_bits); k++)
+                table[sub_free + k] = 0;
+            sub_free += 1U << sub_bits;
+        }
+        UINT32 base = table[prefix] >> 16;
+        UINT32 step = 1U << (len - PRIMARY_BITS);
+        for (UINT32 k = rev >> PRIMARY_BITS; k < (1U << sub_bits); k += step)
+            table[base + k] = ((UINT32)sym << 16) | (len - PRIMARY_BITS);
+    }
+
+    *sub_mask = (1U << sub_bits) - 1;
+    return TRUE;
+}
+
+/* ------------------------------------------------------------------ */
+/*  CRC-32 (IEEE 802.3), slice-by-8                                    */
+/* ------------------------------------------------------------------ */
+
+static void
+crc_init(UINT32 t[8][256])
+{
+    for (UINT32 i = 0; i < 256; i++) {
+        UINT32 c = i;
+        for (UINT32 k = 0; k < 8; k++)
+            c = (c & 1) ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+        t[0][i] = c;
+    }
+    for (UINT32 i = 0; i < 256; i++)
+        for (UINT32 s = 1; s < 8; s++)
+            t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xFF];
+}
+
+static UINT32
+crc_update(UINT32 t[8][256], UINT32 crc, const UINT8 *p, UINTN n)
+{
+    crc = ~crc;
+    for (; n >= 8; n -= 8, p += 8) {
+        UINT32 a, b;
+        __builtin_memcpy(&a, p, 4);
+        __builtin_memcpy(&b, p + 4, 4);
+        a ^= crc;
+        crc = t[7][a & 0xFF] ^ t[6][(a >> 8) & 0xFF] ^
+              t[5][(a >> 16) & 0xFF] ^ t[4][a >> 24] ^
+              t[3][b & 0xFF] ^ t[2][(b >> 8) & 0xFF] ^
+              t[1][(b >> 16) & 0xFF] ^ t[0][b >> 24];
+    }
+    while (n--)
+        crc = t[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Bit reader                                                         */
+/*                                                                     */
+/*  Past the end of the input the reader supplies zero bytes and      */
+/*  counts them in `overrun`, so decoding never stalls mid-symbol; a   */
+/*  stream that actually consumes them is truncated.                   */
+/*                                                                     */
+/*  The eight-byte refill leaves bits of the next unread byte above    */
+/*  `cnt`; refilling from the same byte ORs in the same values.  Code  */
+/*  that takes bytes from the input directly must clear them first.    */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    UINT64       bits;
+    UINT32       cnt;
+    UINT32       overrun;
+    const UINT8 *next;
+    const UINT8 *end;
+    SbInStream  *in;
+    BOOLEAN      eof;
+} BitIn;
+
+/* Top up to more than 56 bits, a byte at a time. */
+static void
+br_fill(BitIn *b)
+{
+    while (b->cnt <= 56) {
+        if (b->next == b->end && !b->eof) {
+            b->in->next = b->next;
+            if (b->in->refill(b->in)) {
+                b->next = b->in->next;
+                b->end  = b->in->end;
+            } else {
+                b->eof = TRUE;
+            }
+        }
+        if (b->next == b->end) {
+            b->overrun++;
+            b->cnt += 8;
+            continue;
+        }
+        b->bits |= (UINT64)*b->next++ << b->cnt;
+        b->cnt  += 8;
+    }
+}
+
+static inline UINT32
+br_bits(BitIn *b, UINT32 n)
+{
+    if (b->cnt < n)
+        br_fill(b);
+    UINT32 v = (UINT32)(b->bits & ((1ULL << n) - 1));
+    b->bits >>= n;
+    b->cnt   -= n;
+    return v;
+}
+
+/* Real (not zero-padding) bits still buffered. */
+static inline UINT32
+br_real(const BitIn *b)
+{
+    return b->cnt - 8 * b->overrun;
+}
+
+/* Next whole byte; the reader must be byte-aligned. */
+static BOOLEAN
+br_byte(BitIn *b, UINT8 *v)
+{
+    if (br_real(b) >= 8) {
+        *v = (UINT8)b->bits;
+        b->bits >>= 8;
+        b->cnt   -= 8;
+        return TRUE;
+    }
+    if (b->cnt > 0)
+        return FALSE;   /* only padding left: the input has ended */
+    b->bits = 0;
+    if (b->next == b->end) {
+        if (b->eof)
+            return FALSE;
+        b->in->next = b->next;
+        if (!b->in->refill(b->in)) {
+            b->eof = TRUE;
+            return FALSE;
+        }
+        b->next = b->in->next;
+        b->end  = b->in->end;
+    }
+    *v = *b->next++;
+    return TRUE;
+}
+
+static inline void
+br_align(BitIn *b)
+{
+    UINT32 n = b->cnt & 7;
+    b->bits >>= n;
+    b->cnt   -= n;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Blocks                                                             */
+/* ------------------------------------------------------------------ */
+
+static EFI_STATUS
+stored_block(BitIn *b, UINT8 **opp, UINT8 *oend)
+{
+    UINT8 h[4];
+
+    br_align(b);
+    for (UINTN i = 0; i < 4; i++) {
+        if (!br_byte(b, &h[i]))
+            return EFI_END_OF_FILE;
+    }
+    UINT16 len  = (UINT16)(h[0] | (h[1] << 8));
+    UINT16 nlen = (UINT16)(h[2] | (h[3] << 8));
+    if ((len ^ nlen) != 0xFFFF)
+        return EFI_COMPROMISED_DATA;
+
+    UINT8 *op = *opp;
+    if ((UINTN)(oend - op) < len)
+        return EFI_BUFFER_TOO_SMALL;
+
+    /* Drain the look-ahead, then copy straight from the input. */
+    while (len && br_real(b) >= 8) {
+        *op++ = (UINT8)b->bits;
+        b->bits >>= 8;
+        b->cnt   -= 8;
+        len--;
+    }
+    if (len)
+        b->bits = 0;
+    while (len) {
+        if (b->next == b->end) {
+            b->in->next = b->next;
+            if (b->eof || !b->in->refill(b->in)) {
+                b->eof = TRUE;
+                return EFI_END_OF_FILE;
+            }
+            b->next = b->in->next;
+            b->end  = b->in->end;
+        }
+        UINTN n = (UINTN)(b->end - b->next);
+        if (n > len)
+            n = len;
+        __builtin_memcpy(op, b->next, n);
+        op      += n;
+        b->next += n;
+        len     -= (UINT16)n;
+    }
+
+    *opp = op;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS
+dynamic_tables(Inflate *w, BitIn *b)
+{
+    UINT32 hlit  = br_bits(b, 5) + 257;
+    UINT32 hdist = br_bits(b, 5) + 1;
+    UINT32 hclen = br_bits(b, 4) + 4;
+    if (hlit > 286 || hdist > 30)
+        return EFI_COMPROMISED_DATA;
+
+    /* Code-length code: decoded through the distance table's space. */
+    UINT8 clens[19];
+    for (UINTN i = 0; i < 19; i++)
+        clens[i] = 0;
+    for (UINTN i = 0; i < hclen; i++)
+        clens[clen_order[i]] = (UINT8)br_bits(b, 3);
+
+    UINT32 clen_mask;
+    if (!build_table(w->dist, &clen_mask, clens, 19))
+        return EFI_COMPROMISED_DATA;
+
+    UINT32 n = 0;
+    while (n < hlit + hdist) {
+        if (b->cnt < 16)
+            br_fill(b);
+        UINT32 e = w->dist[b->bits & PRIMARY_MASK];
+        UINT32 len = e & 0xFF;
+        if (len == 0)
+            return EFI_COMPROMISED_DATA;
+        b->bits >>= len;
+        b->cnt   -= len;
+
+        UINT32 sym = e >> 16, rep, val = 0;
+        if (sym < 16) {
+            w->lens[n++] = (UINT8)sym;
+            continue;
+        } else if (sym == 16) {
+            if (n == 0)
+                return EFI_COMPROMISED_DATA;
+            val = w->lens[n - 1];
+            rep = 3 + br_bits(b, 2);
+        } else if (sym == 17) {
+            rep = 3 + br_bits(b, 3);
+        } else {
+            rep = 11 + br_bits(b, 7);
+        }
+        if (n + rep > hlit + hdist)
+            return EFI_COMPROMISED_DATA;
+        while (rep--)
+            w->lens[n++] = (UINT8)val;
+    }
+
+    if (w->lens[256] == 0)
+        return EFI_COMPROMISED_DATA;    /* no end-of-block code */
+    if (!build_table(w->lit, &w->lit_sub_mask, w->lens, hlit) ||
+        !build_table(w->dist, &w->dist_sub_mask, w->lens + hlit, hdist))
+        return EFI_COMPROMISED_DATA;
+    return EFI_SUCCESS;
+}
+
+static void
+fixed_tables(Inflate *w)
+{
+    UINTN i = 0;
+    for (; i < 144; i++) w->lens[i] = 8;
+    for (; i < 256; i++) w->lens[i] = 9;
+    for (; i < 280; i++) w->lens[i] = 7;
+    for (; i < 288; i++) w->lens[i] = 8;
+    build_table(w->lit, &w->lit_sub_mask, w->lens, 288);
+
+    for (i = 0; i < 30; i++)
+        w->lens[i] = 5;
+    build_table(w->dist, &w->dist_sub_mask, w->lens, 30);
+}
+
+/*
+ * Decode one Huffman-coded block.  The hot loop keeps the bit reader
+ * in locals and writes it back only around slow refills.
+ */
+static EFI_STATUS
+huffman_block(Inflate *w, BitIn *b, UINT8 *out, UINT8 **opp, UINT8 *oend)
+{
+    UINT64       bits = b->bits;
+    UINT32       cnt  = b->cnt;
+    const UINT8 *next = b->next;
+    const UINT8 *end  = b->end;
+    UINT8       *op   = *opp;
+    EFI_STATUS   status = EFI_SUCCESS;
+
+    const UINT32 *lit  = w->lit,  lit_sub  = w->lit_sub_mask;
+    const UINT32 *dist = w->dist, dist_sub = w->dist_sub_mask;
+
+#define SAVE()  do { b->bits = bits; b->cnt = cnt; b->next = next; } while (0)
+#define LOAD()  do { bits = b->bits; cnt = b->cnt; \
+                     next = b->next; end = b->end; } while (0)
+
+    for (;;) {
+        /* One refill covers the longest symbol: 15 + 5 + 15 + 13 bits. */
+        if (cnt < 48) {
+            if (end - next >= 8) {
+                UINT64 v;
+                __builtin_memcpy(&v, next, 8);
+                bits |= v << cnt;
+                next += (63 - cnt) >> 3;
+                cnt  |= 56;
+            } else {
+                SAVE();
+                br_fill(b);
+                LOAD();
+                if (b->overrun > 8) {
+                    status = EFI_END_OF_FILE;
+                    break;
+                }
+            }
+        }
+
+        UINT32 e = lit[bits & PRIMARY_MASK];
+        if (e & ENTRY_SUB) {
+            bits >>= PRIMARY_BITS;
+            cnt   -= PRIMARY_BITS;
+            e = lit[(e >> 16) + (bits & lit_sub)];
+        }
+        UINT32 n = e & 0xFF;
+        if (n == 0) {
+            status = EFI_COMPROMISED_DATA;
+            break;
+        }
+        bits >>= n;
+        cnt   -= n;
+
+        UINT32 sym = e >> 16;
+        if (sym < 256) {
+            if (op == oend) {
+                status = EFI_BUFFER_TOO_SMALL;
+                break;
+            }
+            *op++ = (UINT8)sym;
+            continue;
+        }
+        if (sym == 256)
+            break;
+
+        sym -= 257;
+        if (sym >= 29) {
+            status = EFI_COMPROMISED_DATA;
+            break;
+        }
+        UINT32 len = len_base[sym] +
+                     (UINT32)(bits & ((1U << len_extra[sym]) - 1));
+        bits >>= len_extra[sym];
+        cnt   -= len_extra[sym];
+
+        e = dist[bits & PRIMARY_MASK];
+        if (e & ENTRY_SUB) {
+            bits >>= PRIMARY_BITS;
+            cnt   -= PRIMARY_BITS;
+            e = dist[(e >> 16) + (bits & dist_sub)];
+        }
+        n = e & 0xFF;
+        sym = e >> 16;
+        if (n == 0 || sym >= 30) {
+            status = EFI_COMPROMISED_DATA;
+            break;
+        }
+        bits >>= n;
+        cnt   -= n;
+        UINT32 d = dist_base[sym] +
+                   (UINT32)(bits & ((1U << dist_extra[sym]) - 1));
+        bits >>= dist_extra[sym];
+        cnt   -= dist_extra[sym];
+
+        if (d > (UINTN)(op - out)) {
+            status = EFI_COMPROMISED_DATA;
+            break;
+        }
+        if (len > (UINTN)(oend - op)) {
+            status = EFI_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        const UINT8 *from = op - d;
+        UINT8 *stop = op + len;
+        if (d >= 8 && (UINTN)(oend - stop) >= 8) {
+            do {
+                UINT64 v;
+                __builtin_memcpy(&v, from, 8);
+                __builtin_memcpy(op, &v, 8);
+                op += 8;
+                from += 8;
+            } while (op < stop);
+            op = stop;
+        } else {
+            while (op < stop)
+                *op++ = *from++;
+        }
+    }
+
+#undef SAVE
+#undef LOAD
+
+    b->bits = bits;
+    b->cnt  = cnt;
+    b->next = next;
+    *opp = op;
+    return status;
+}
+
+/* ------------------------------------------------------------------ */
+/*  gzip members                                                       */
+/* ------------------------------------------------------------------ */
+
+#define GZ_FHCRC     0x02
+#define GZ_FEXTRA    0x04
+#define GZ_FNAME     0x08
+#define GZ_FCOMMENT  0x10
+
+static EFI_STATUS
+gzip_header(BitIn *b)
+{
+    UINT8 h[10], c;
+
+    for (UINTN i = 0; i < 10; i++) {
+        if (!br_byte(b, &h[i]))
+            return EFI_END_OF_FILE;
+    }
+    if (h[0] != 0x1F || h[1] != 0x8B)
+        return EFI_COMPROMISED_DATA;
+    if (h[2] != 8)
+        return EFI_UNSUPPORTED;     /* only deflate is defined */
+
+    UINT8 flags = h[3];
+    if (flags & GZ_FEXTRA) {
+        UINT8 lo, hi;
+        if (!br_byte(b, &lo) || !br_byte(b, &hi))
+            return EFI_END_OF_FILE;
+        for (UINTN n = lo | (hi << 8); n; n--) {
+            if (!br_byte(b, &c))
+                return EFI_END_OF_FILE;
+        }
+    }
+    if (flags & GZ_FNAME) {
+        do {
+            if (!br_byte(b, &c))
+                return EFI_END_OF_FILE;
+        } while (c);
+    }
+    if (flags & GZ_FCOMMENT) {
+        do {
+            if (!br_byte(b, &c))
+                return EFI_END_OF_FILE;
+        } while (c);
+    }
+    if (flags & GZ_FHCRC) {
+        if (!br_byte(b, &c) || !br_byte(b, &c))
+            return EFI_END_OF_FILE;
+    }
+    return EFI_SUCCESS;
+}
+
+UINTN
+sb_gunzip_workspace(void)
+{
+    return sizeof(Inflate);
+}
+
+EFI_STATUS
+sb_gunzip(void *work, SbInStream *in, UINT8 *out, UINTN cap, UINTN *out_len)
+{
+    Inflate *w = work;
+    UINT8 *op = out, *oend = out + cap;
+    BitIn b = { .in = in, .next = in->next, .end = in->end };
+    EFI_STATUS status;
+
+    crc_init(w->crc);
+    *out_len = 0;
+
+    /* One or more members, back to back. */
+    do {
+        status = gzip_header(&b);
+        if (EFI_ERROR(status))
+            return status;
+
+        UINT8 *member = op;
+        UINT32 crc = 0;
+        UINT32 last;
+        do {
+            UINT8 *block = op;
+            last = br_bits(&b, 1);
+            switch (br_bits(&b, 2)) {
+            case 0:
+                status = stored_block(&b, &op, oend);
+                break;
+            case 1:
+                fixed_tables(w);
+                status = huffman_block(w, &b, out, &op, oend);
+                break;
+            case 2:
+                status = dynamic_tables(w, &b);
+                if (!EFI_ERROR(status))
+                    status = huffman_block(w, &b, out, &op, oend);
+                break;
+            default:
+                status = EFI_COMPROMISED_DATA;
+                break;
+            }
+            if (EFI_ERROR(status))
+                return status;
+            crc = crc_update(w->crc, crc, block, (UINTN)(op - block));
+        } while (!last);
+
+        /* Trailer: CRC-32 and size mod 2^32, little-endian. */
+        UINT8 t[8];
+        br_align(&b);
+        for (UINTN i = 0; i < 8; i++) {
+            if (!br_byte(&b, &t[i]))
+                return EFI_END_OF_FILE;
+        }
+        UINT32 want_crc  = t[0] | t[1] << 8 | t[2] << 16 | (UINT32)t[3] << 24;
+        UINT32 want_size = t[4] | t[5] << 8 | t[6] << 16 | (UINT32)t[7] << 24;
+        if (crc != want_crc || (UINT32)(op - member) != want_size)
+            return EFI_CRC_ERROR;
+
+        *out_len = (UINTN)(op - out);
+
+        /* Another member only if a gzip magic follows; anything else
+         * (padding) ends the stream, as it does for gzip(1). */
+        if (br_real(&b) < 16) {
+            br_fill(&b);
+            if (br_real(&b) < 16)
+                break;
+        }
+    } while ((b.bits & 0xFFFF) == 0x8B1F);
+
+    return EFI_SUCCESS;
+}
@@ -16,9 +16,19 @@
  *
  * Both paths handle initrd concatenation (multiple initrds loaded
  * contiguously in memory, sizes summed).
+ *
+ * When a TPM is present, the kernel and each initrd are hashed as they
+ * are read and measured into PCR 9, and the command line into PCR 8,
+ * before anything is executed (see measure.c).
+ *
+ * The kernel may be stored gzip- or zstd-compressed, bare or inside an
+ * EFI zboot wrapper; decompress.c unpacks it while reading it, and the
+ * measurement covers the file as stored.
  */
 
 #include "loader.h"
+#include "measure.h"
+#include "decompress.h"
 #include "../fs/vfs.h"
 
 /* ------------------------------------------------------------------ */
@@ -77,12 +87,37 @@ sb_efi_memmap_to_e820(EFI_MEMORY_DESCRIPTOR *mmap,
     return count;
 }
 
+/* ------------------------------------------------------------------ */
+/*  Read a boot image, measuring it if a TPM is available              */
+/* ------------------------------------------------------------------ */
+
+static EFI_STATUS
+read_image(const BootTarget *target, const CHAR16 *path, BOOLEAN measure,
+           void **buf, UINTN *size)
+{
+    if (!measure)
+        return sb_vfs_read_file(target->device_handle, path, buf, size);
+
+    SbSha256 hash;
+    sb_sha256_init(&hash);
+    EFI_STATUS status = sb_vfs_read_file_hashed(target->device_handle,
+                                                path, &hash, buf, size);
+    if (EFI_ERROR(status))
+        return status;
+
+    EFI_STATUS s = sb_measure_file(SB_PCR_IMAGES, path, &hash);
+    if (EFI_ERROR(s))
+        SB_LOG(L"WARN: Failed to measure %s: %r", path, s);
+    return EFI_SUCCESS;
+}
+
 /* ------------------------------------------------------------------ */
 /*  Load initrd(s) into a contiguous memory region                     */
 /* ------------------------------------------------------------------ */
 
 static EFI_STATUS
 load_initrds(SuperBootContext *ctx, const BootTarget *target,
+             BOOLEAN measure,
              EFI_PHYSICAL_ADDRESS *initrd_addr, UINTN *initrd_total)
 {
     *initrd_addr  = 0;
@@ -95,15 +130,19 @@ load_initrds(SuperBootContext *ctx, const BootTarget *target,
      * First pass: determine total size by reading all initrds.
      * We keep the buffers around to avoid double-reading.
      */
-    void  *bufs[SB_MAX_INITRDS] = {0};
-    UINTN  sizes[SB_MAX_INITRDS] = {0};
-    UINTN  total = 0;
+    void  **bufs  = sb_zalloc(SB_MEM_BOOT, target->initrd_count * sizeof(*bufs));
+    UINTN  *sizes = sb_zalloc(SB_MEM_BOOT, target->initrd_count * sizeof(*sizes));
+    UINTN   total = 0;
+    EFI_STATUS status = EFI_SUCCESS;
+
+    if (!bufs || !sizes) {
+        status = EFI_OUT_OF_RESOURCES;
+        goto cleanup;
+    }
 
     for (UINT32 i = 0; i < target->initrd_count; i++) {
-        EFI_STATUS s = sb_vfs_read_file(
-            target->device_handle,
-            target->initrd_paths[i],
-            &bufs[i], &sizes[i]);
+        EFI_STATUS s = read_image(target, target->initrd_paths[i], measure,
+                                  &bufs[i], &sizes[i]);
         if (EFI_ERROR(s)) {
             SB_LOG(L"WARN: Failed to load initrd %s: %r",
                    target->initrd_paths[i], s);
@@ -113,19 +152,16 @@ load_initrds(SuperBootContext *ctx, const BootTarget *target,
     }
 
     if (total == 0)
-        return EFI_SUCCESS;
+        goto cleanup;
 
     /* Allocate a single contiguous region for all initrds.
      * Place it below 4 GiB for compatibility with 32-bit fields. */
     UINTN pages = (total + 4095) / 4096;
     EFI_PHYSICAL_ADDRESS addr = 0xFFFFFFFF; /* Below 4 GiB. */
-    EFI_STATUS status = ctx->boot_services->AllocatePages(
-                            AllocateMaxAddress, EfiLoaderData,
-                            pages, &addr);
+    status = sb_page_alloc(SB_MEM_BOOT, AllocateMaxAddress, pages, &addr);
     if (EFI_ERROR(status)) {
         /* Try anywhere. */
-        status = ctx->boot_services->AllocatePages(
-                     AllocateAnyPages, EfiLoaderData, pages, &addr);
+        status = sb_page_alloc(SB_MEM_BOOT, AllocateAnyPages, pages, &addr);
         if (EFI_ERROR(status))
             goto cleanup;
     }
@@ -134,7 +170,7 @@ load_initrds(SuperBootContext *ctx, const BootTarget *target,
     UINT8 *dest = (UINT8 *)(UINTN)addr;
     for (UINT32 i = 0; i < target->initrd_count; i++) {
         if (bufs[i]) {
-            CopyMem(dest, bufs[i], sizes[i]);
+            sb_memcpy(dest, bufs[i], sizes[i]);
             dest += sizes[i];
         }
     }
@@ -143,10 +179,10 @@ load_initrds(SuperBootContext *ctx, const BootTarget *target,
     *initrd_total = total;
 
 cleanup:
-    for (UINT32 i = 0; i < target->initrd_count; i++) {
-        if (bufs[i])
-            FreePool(bufs[i]);
-    }
+    for (UINT32 i = 0; bufs && i < target->initrd_count; i++)
+        sb_free(bufs[i]);
+    sb_free(bufs);
+    sb_free(sizes);
     return status;
 }
 
@@ -175,7 +211,7 @@ boot_efi_handover(SuperBootContext *ctx, const BootTarget *target,
     UINTN setup_size = (setup_sects + 1) * 512;
 
     /* Allocate boot_params (zero page). */
-    LinuxBootParams *bp = AllocateZeroPool(sizeof(LinuxBootParams));
+    LinuxBootParams *bp = sb_zalloc(SB_MEM_BOOT, sizeof(LinuxBootParams));
     if (!bp)
         return EFI_OUT_OF_RESOURCES;
 
@@ -189,7 +225,7 @@ boot_efi_handover(SuperBootContext *ctx, const BootTarget *target,
 
     /* Command line. */
     UINTN cmdline_len = sb_strlen8(target->cmdline);
-    CHAR8 *cmdline = AllocatePool(cmdline_len + 1);
+    CHAR8 *cmdline = sb_malloc(SB_MEM_BOOT, cmdline_len + 1);
     if (cmdline) {
         CopyMem(cmdline, (void *)target->cmdline, cmdline_len + 1);
         bp->hdr.cmd_line_ptr = (UINT32)(UINTN)cmdline;
@@ -206,11 +242,14 @@ boot_efi_handover(SuperBootContext *ctx, const BootTarget *target,
         kernel_base + hdr->handover_offset + 512);
 
     SB_LOG(L"Jumping to kernel via EFI handover at %p", handover);
+    sb_control_mark(L"handoff");
 
     /* The handover protocol does NOT return. */
     handover(ctx->image_handle, ctx->system_table, bp);
 
     /* Should never reach here. */
+    sb_free(cmdline);
+    sb_free(bp);
     return EFI_LOAD_ERROR;
 }
 
@@ -233,8 +272,11 @@ boot_legacy_bzimage(SuperBootContext *ctx, const BootTarget *target,
     UINTN setup_size = (setup_sects + 1) * 512;
     UINTN kernel_raw_size = kernel_size - setup_size;
 
+    CHAR8 *cmdline = NULL;
+    EFI_MEMORY_DESCRIPTOR *mmap = NULL;
+
     /* Allocate boot_params. */
-    LinuxBootParams *bp = AllocateZeroPool(sizeof(LinuxBootParams));
+    LinuxBootParams *bp = sb_zalloc(SB_MEM_BOOT, sizeof(LinuxBootParams));
     if (!bp)
         return EFI_OUT_OF_RESOURCES;
 
@@ -249,30 +291,30 @@ boot_legacy_bzimage(SuperBootContext *ctx, const BootTarget *target,
         kernel_addr = 0x100000; /* 1 MiB default. */
 
     UINTN kernel_pages = (kernel_raw_size + 4095) / 4096;
-    EFI_STATUS status = ctx->boot_services->AllocatePages(
-                            AllocateAddress, EfiLoaderData,
-                            kernel_pages, &kernel_addr);
+    EFI_STATUS status = sb_page_alloc(SB_MEM_BOOT, AllocateAddress,
+                                      kernel_pages, &kernel_addr);
     if (EFI_ERROR(status)) {
         /* If preferred address is taken, try anywhere (relocatable). */
-        if (hdr->relocatable_kernel) {
-            status = ctx->boot_services->AllocatePages(
-                         AllocateAnyPages, EfiLoaderData,
-                         kernel_pages, &kernel_addr);
-            if (EFI_ERROR(status))
-                return status;
-        } else {
+        if (!hdr->relocatable_kernel) {
+            sb_free(bp);
+            return status;
+        }
+        status = sb_page_alloc(SB_MEM_BOOT, AllocateAnyPages,
+                               kernel_pages, &kernel_addr);
+        if (EFI_ERROR(status)) {
+            sb_free(bp);
             return status;
         }
     }
 
-    CopyMem((void *)(UINTN)kernel_addr,
-            (UINT8 *)kernel_buf + setup_size, kernel_raw_size);
+    sb_memcpy((void *)(UINTN)kernel_addr,
+              (UINT8 *)kernel_buf + setup_size, kernel_raw_size);
 
     bp->hdr.code32_start = (UINT32)kernel_addr;
 
     /* Command line. */
     UINTN cmdline_len = sb_strlen8(target->cmdline);
-    CHAR8 *cmdline = AllocatePool(cmdline_len + 1);
+    cmdline = sb_malloc(SB_MEM_BOOT, cmdline_len + 1);
     if (cmdline) {
         CopyMem(cmdline, (void *)target->cmdline, cmdline_len + 1);
         bp->hdr.cmd_line_ptr = (UINT32)(UINTN)cmdline;
@@ -293,9 +335,10 @@ boot_legacy_bzimage(SuperBootContext *ctx, const BootTarget *target,
      * GetMemoryMap + ExitBootServices must be called in a tight loop
      * because any intervening allocation invalidates the map key.
      */
+    sb_control_mark(L"handoff");
+
     UINTN  mmap_size = 0, map_key, desc_size;
     UINT32 desc_version;
-    EFI_MEMORY_DESCRIPTOR *mmap = NULL;
 
     /* First call: get required buffer size. */
     ctx->boot_services->GetMemoryMap(
@@ -303,14 +346,16 @@ boot_legacy_bzimage(SuperBootContext *ctx, const BootTarget *target,
 
     /* Add slack for the allocation itself. */
     mmap_size += desc_size * 4;
-    mmap = AllocatePool(mmap_size);
-    if (!mmap)
-        return EFI_OUT_OF_RESOURCES;
+    mmap = sb_malloc(SB_MEM_BOOT, mmap_size);
+    if (!mmap) {
+        status = EFI_OUT_OF_RESOURCES;
+        goto fail;
+    }
 
     status = ctx->boot_services->GetMemoryMap(
                  &mmap_size, mmap, &map_key, &desc_size, &desc_version);
     if (EFI_ERROR(status))
-        return status;
+        goto fail;
 
     /* Convert EFI memory map to E820 for the kernel. */
     E820Entry e820[128];
@@ -337,7 +382,7 @@ boot_legacy_bzimage(SuperBootContext *ctx, const BootTarget *target,
             status = ctx->boot_services->ExitBootServices(
                          ctx->image_handle, map_key);
         if (EFI_ERROR(status))
-            return status;
+            goto fail;
     }
 
     /* === POINT OF NO RETURN ===
@@ -349,6 +394,15 @@ boot_legacy_bzimage(SuperBootContext *ctx, const BootTarget *target,
 
     /* Never reached. */
     return EFI_LOAD_ERROR;
+
+fail:
+    /* Boot services are still up: give back what we took so the
+     * explorer fallback starts from a clean slate. */
+    sb_free(mmap);
+    sb_free(cmdline);
+    sb_free(bp);
+    sb_page_free(kernel_addr, kernel_pages);
+    return status;
 }
 
 /* ------------------------------------------------------------------ */
@@ -359,20 +413,35 @@ EFI_STATUS
 sb_boot_linux(SuperBootContext *ctx, const BootTarget *target)
 {
     EFI_STATUS status;
-    void  *kernel_buf  = NULL;
-    UINTN  kernel_size = 0;
+    SbKernelImage kernel;
+    SbSha256 hash;
+    BOOLEAN measure = sb_measure_available(ctx);
 
-    /* Load the kernel image into memory. */
+    /* Load the kernel image into memory, decompressing if need be. */
     SB_LOG(L"Loading kernel: %s", target->kernel_path);
-    status = sb_vfs_read_file(target->device_handle,
-                              target->kernel_path,
-                              &kernel_buf, &kernel_size);
+    if (measure)
+        sb_sha256_init(&hash);
+    status = sb_kernel_read(ctx, target->device_handle, target->kernel_path,
+                            measure ? &hash : NULL, &kernel);
     SB_CHECK(status, L"Failed to load kernel");
 
+    if (measure) {
+        EFI_STATUS s = sb_measure_file(SB_PCR_IMAGES, target->kernel_path,
+                                       &hash);
+        if (EFI_ERROR(s))
+            SB_LOG(L"WARN: Failed to measure %s: %r",
+                   target->kernel_path, s);
+    }
+
+    void  *kernel_buf  = kernel.buf;
+    UINTN  kernel_size = kernel.size;
+    if (kernel.format != SB_IMAGE_RAW)
+        SB_LOG(L"Kernel decompressed to %u bytes", kernel_size);
+
     /* Validate the setup header. */
     if (kernel_size < 0x260) {
         SB_LOG(L"Kernel image too small (%u bytes)", kernel_size);
-        FreePool(kernel_buf);
+        sb_kernel_free(&kernel);
         return EFI_INVALID_PARAMETER;
     }
 
@@ -382,7 +451,7 @@ sb_boot_linux(SuperBootContext *ctx, const BootTarget *target)
     if (hdr->header != LINUX_BOOT_HDR_MAGIC) {
         SB_LOG(L"Invalid kernel magic (expected HdrS, got 0x%08x)",
                hdr->header);
-        FreePool(kernel_buf);
+        sb_kernel_free(&kernel);
         return EFI_INVALID_PARAMETER;
     }
 
@@ -392,7 +461,7 @@ sb_boot_linux(SuperBootContext *ctx, const BootTarget *target)
     /* Load initrds. */
     EFI_PHYSICAL_ADDRESS initrd_addr = 0;
     UINTN initrd_size = 0;
-    status = load_initrds(ctx, target, &initrd_addr, &initrd_size);
+    status = load_initrds(ctx, target, measure, &initrd_addr, &initrd_size);
     if (EFI_ERROR(status))
         SB_LOG(L"WARN: initrd load failed: %r (continuing without)", status);
 
@@ -401,6 +470,19 @@ sb_boot_linux(SuperBootContext *ctx, const BootTarget *target)
 
     SB_LOG(L"Cmdline: %a", target->cmdline);
 
+    if (measure) {
+        EFI_STATUS s = sb_measure_string(SB_PCR_CMDLINE, target->cmdline);
+        if (EFI_ERROR(s))
+            SB_LOG(L"WARN: Failed to measure cmdline: %r", s);
+        sb_measure_report(ctx);
+    }
+
+    /* Everything is in memory: release built-in mounts (and write the
+     * I/O trace, if one is being recorded) before handing off. */
+    sb_vfs_shutdown();
+    if (ctx->verbose)
+        sb_mem_summary();
+
     /* Prefer EFI handover if available (keeps boot services alive
      * so the kernel's EFI stub can use them). */
     if (hdr->version >= 0x020B && hdr->handover_offset != 0) {
@@ -408,12 +490,22 @@ sb_boot_linux(SuperBootContext *ctx, const BootTarget *target)
         status = boot_efi_handover(ctx, target, kernel_buf, kernel_size,
                                    initrd_addr, initrd_size);
         /* If handover fails, fall through to legacy path. */
-        if (status != EFI_UNSUPPORTED)
+        if (status != EFI_UNSUPPORTED) {
+            if (initrd_size > 0)
+                sb_page_free(initrd_addr, (initrd_size + 4095) / 4096);
+            sb_kernel_free(&kernel);
             return status;
+        }
     }
 
     /* Fallback: legacy bzImage boot. */
     SB_LOG(L"Using legacy bzImage boot protocol");
-    return boot_legacy_bzimage(ctx, target, kernel_buf, kernel_size,
-                               initrd_addr, initrd_size);
+    status = boot_legacy_bzimage(ctx, target, kernel_buf, kernel_size,
+                                 initrd_addr, initrd_size);
+
+    /* Only failures return here. */
+    if (initrd_size > 0)
+        sb_page_free(initrd_addr, (initrd_size + 4095) / 4096);
+    sb_kernel_free(&kernel);
+    return status;
 }
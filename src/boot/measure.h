@@ -0,0 +1,126 @@
+/*
+ * measure.h — TPM 2.0 measured boot (EFI_TCG2_PROTOCOL)
+ *
+ * gnu-efi does not ship the TCG2 protocol, so the parts we use are
+ * declared here from the TCG "EFI Protocol Specification" (rev 00.13),
+ * with SB_ prefixes to stay clear of any future gnu-efi definitions.
+ *
+ * The PCRs are the ones GRUB uses, but the values are not GRUB's:
+ *
+ *   PCR 8   kernel command line          (EV_IPL, H(cmdline))
+ *   PCR 9   kernel and initrd images     (EV_IPL, H(SHA-256(file)))
+ *
+ * Images are hashed while they are read, and TCG2 can only extend with
+ * a hash it computes itself, so PCR 9 is extended with the hash of the
+ * file's SHA-256 digest rather than of the file (see measure.c).
+ * Policies written against GRUB's PCR 9 need new reference values; the
+ * event log carries each file's SHA-256 for computing them.
+ */
+
+#ifndef SUPERBOOT_MEASURE_H
+#define SUPERBOOT_MEASURE_H
+
+#include "../superboot.h"
+
+#define SB_PCR_CMDLINE          8
+#define SB_PCR_IMAGES           9
+
+#define SB_TCG_EV_IPL           0x0000000D
+
+/* ------------------------------------------------------------------ */
+/*  EFI_TCG2_PROTOCOL                                                  */
+/* ------------------------------------------------------------------ */
+
+#define SB_TCG2_PROTOCOL_GUID \
+    { 0x607f766c, 0x7455, 0x42be, \
+      { 0x93, 0x0b, 0xe4, 0xd7, 0x6d, 0xb2, 0x72, 0x0f } }
+
+#define SB_TCG2_EVENT_HEADER_VERSION  1
+
+typedef struct {
+    UINT8   Major;
+    UINT8   Minor;
+} SB_TCG2_VERSION;
+
+typedef struct {
+    UINT8            Size;
+    SB_TCG2_VERSION  StructureVersion;
+    SB_TCG2_VERSION  ProtocolVersion;
+    UINT32           HashAlgorithmBitmap;
+    UINT32           SupportedEventLogs;
+    BOOLEAN          TPMPresentFlag;
+    UINT16           MaxCommandSize;
+    UINT16           MaxResponseSize;
+    UINT32           ManufacturerID;
+    UINT32           NumberOfPCRBanks;
+    UINT32           ActivePcrBanks;
+} SB_TCG2_BOOT_SERVICE_CAPABILITY;
+
+#pragma pack(1)
+
+typedef struct {
+    UINT32  HeaderSize;
+    UINT16  HeaderVersion;
+    UINT32  PCRIndex;
+    UINT32  EventType;
+} SB_TCG2_EVENT_HEADER;
+
+typedef struct {
+    UINT32                Size;     /* whole structure incl. Event[] */
+    SB_TCG2_EVENT_HEADER  Header;
+    UINT8                 Event[];
+} SB_TCG2_EVENT;
+
+#pragma pack()
+
+_Static_assert(sizeof(SB_TCG2_EVENT_HEADER) == 14, "TCG2 event header");
+_Static_assert(sizeof(SB_TCG2_EVENT) == 18, "TCG2 event");
+
+typedef struct _SB_TCG2_PROTOCOL SB_TCG2_PROTOCOL;
+
+struct _SB_TCG2_PROTOCOL {
+    EFI_STATUS (EFIAPI *GetCapability)(
+        SB_TCG2_PROTOCOL *This,
+        SB_TCG2_BOOT_SERVICE_CAPABILITY *Capability);
+    EFI_STATUS (EFIAPI *GetEventLog)(
+        SB_TCG2_PROTOCOL *This, UINT32 EventLogFormat,
+        EFI_PHYSICAL_ADDRESS *EventLogLocation,
+        EFI_PHYSICAL_ADDRESS *EventLogLastEntry,
+        BOOLEAN *EventLogTruncated);
+    EFI_STATUS (EFIAPI *HashLogExtendEvent)(
+        SB_TCG2_PROTOCOL *This, UINT64 Flags,
+        EFI_PHYSICAL_ADDRESS DataToHash, UINT64 DataToHashLen,
+        SB_TCG2_EVENT *EfiTcgEvent);
+    EFI_STATUS (EFIAPI *SubmitCommand)(
+        SB_TCG2_PROTOCOL *This,
+        UINT32 InputParameterBlockSize, UINT8 *InputParameterBlock,
+        UINT32 OutputParameterBlockSize, UINT8 *OutputParameterBlock);
+    EFI_STATUS (EFIAPI *GetActivePcrBanks)(
+        SB_TCG2_PROTOCOL *This, UINT32 *ActivePcrBanks);
+    EFI_STATUS (EFIAPI *SetActivePcrBanks)(
+        SB_TCG2_PROTOCOL *This, UINT32 ActivePcrBanks);
+    EFI_STATUS (EFIAPI *GetResultOfSetActivePcrBanks)(
+        SB_TCG2_PROTOCOL *This, UINT32 *OperationPresent,
+        UINT32 *Response);
+};
+
+/* ------------------------------------------------------------------ */
+/*  Measurement API (measure.c)                                        */
+/* ------------------------------------------------------------------ */
+
+/* Locate the TPM.  Returns FALSE (and measurement is skipped) if the
+ * firmware has no TCG2 protocol or no TPM behind it. */
+BOOLEAN    sb_measure_available(SuperBootContext *ctx);
+
+/* Finalise `hash` — which has been fed the whole file while it was
+ * read — and extend `pcr` with it, logging `path` and the digest. */
+EFI_STATUS sb_measure_file(UINT32 pcr, const CHAR16 *path, SbSha256 *hash);
+
+/* Measure a NUL-terminated ASCII string (the string itself is both the
+ * hashed data and the event data). */
+EFI_STATUS sb_measure_string(UINT32 pcr, const CHAR8 *str);
+
+/* Verbose-mode summary of what was measured and hashing throughput. */
+void       sb_measure_report(SuperBootContext *ctx);
+
+#endif /* SUPERBOOT_MEASURE_H */
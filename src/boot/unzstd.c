@@ -0,0 +1,1175 @@
+/*
+ * unzstd.c — Zstandard decoder
+ *
+ * Decodes Zstandard frames (RFC 8878) into a flat output buffer that
+ * is also the match history, so the window size in the frame header
+ * does not matter: every earlier byte of output is addressable.
+ *
+ * Input is consumed through SbInStream.  Compressed blocks (at most
+ * 128 KiB) are gathered into the workspace before decoding, since the
+ * entropy-coded streams inside them are read backwards; raw and RLE
+ * blocks go straight to the output.
+ *
+ * Not supported: dictionaries (kernels are never built with one).
+ * The optional content checksum (XXH64) is verified per block, while
+ * the block's output is still in cache.
+ */
+
+#include "decompress.h"
+
+#define ZSTD_MAGIC            0xFD2FB528U
+#define ZSTD_SKIPPABLE_MASK   0xFFFFFFF0U
+#define ZSTD_SKIPPABLE_MAGIC  0x184D2A50U
+
+#define ZSTD_BLOCK_MAX        (128 * 1024)
+
+/* Wild copies may read and write up to this far past the end. */
+#define WILD                  32
+
+#define LL_MAX_LOG  9
+#define ML_MAX_LOG  9
+#define OF_MAX_LOG  8
+#define HUF_MAX_BITS 11
+
+#define LL_MAX_SYM  35
+#define ML_MAX_SYM  52
+#define OF_MAX_SYM  31
+
+/* ------------------------------------------------------------------ */
+/*  Workspace                                                          */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    UINT8  symbol;
+    UINT8  nb_bits;
+    UINT16 base;
+} FseEntry;
+
+typedef struct {
+    FseEntry  e[1 << LL_MAX_LOG];
+    UINT32    log;
+    BOOLEAN   valid;
+} FseTable;
+
+typedef struct {
+    UINT64 v[4];
+    UINT64 total;
+    UINT8  mem[32];
+    UINT32 mem_len;
+} Xxh64;
+
+typedef struct {
+    FseTable ll, ml, of;
+    FseTable weights;                   /* Huffman weight decoding */
+    UINT16   huf[1 << HUF_MAX_BITS];     /* symbol << 8 | bits */
+    UINT32   huf_bits;
+    BOOLEAN  huf_valid;
+    UINT32   rep[3];
+    Xxh64    xxh;
+    UINT8    block[ZSTD_BLOCK_MAX + WILD];
+    UINT8    lits[ZSTD_BLOCK_MAX + WILD];
+} Zstd;
+
+/* ------------------------------------------------------------------ */
+/*  Sequence code tables (RFC 8878, 3.1.1.3.2.1)                       */
+/* ------------------------------------------------------------------ */
+
+static const UINT32 ll_base[LL_MAX_SYM + 1] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+    16, 18, 20, 22, 24, 28, 32, 40, 48, 64, 128, 256, 512,
+    1024, 2048, 4096, 8192, 16384, 32768, 65536
+};
+static const UINT8 ll_bits[LL_MAX_SYM + 1] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    1, 1, 1, 1, 2, 2, 3, 3, 4, 6, 7, 8, 9, 10, 11, 12,
+    13, 14, 15, 16
+};
+static const UINT32 ml_base[ML_MAX_SYM + 1] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18,
+    19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34,
+    35, 37, 39, 41, 43, 47, 51, 59, 67, 83, 99, 131, 259, 515,
+    1027, 2051, 4099, 8195, 16387, 32771, 65539
+};
+static const UINT8 ml_bits[ML_MAX_SYM + 1] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    1, 1, 1, 1, 2, 2, 3, 3, 4, 4, 5, 7, 8, 9, 10, 11,
+    12, 13, 14, 15, 16
+};
+
+/* Predefined distributions (RFC 8878, 3.1.1.3.2.2). */
+static const INT16 ll_default[LL_MAX_SYM + 1] = {
+    4, 3, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1,
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 3, 2, 1, 1, 1, 1, 1,
+    -1, -1, -1, -1
+};
+static const INT16 ml_default[ML_MAX_SYM + 1] = {
+    1, 4, 3, 2, 2, 2, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, -1, -1,
+    -1, -1, -1, -1, -1
+};
+static const INT16 of_default[29] = {
+    1, 1, 1, 1, 1, 1, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, -1, -1, -1, -1, -1
+};
+
+/* ------------------------------------------------------------------ */
+/*  Small helpers                                                      */
+/* ------------------------------------------------------------------ */
+
+static inline UINT32
+highbit(UINT32 v)
+{
+    return 31 - (UINT32)__builtin_clz(v);
+}
+
+static inline UINT64
+load64(const UINT8 *p)
+{
+    UINT64 v;
+    __builtin_memcpy(&v, p, 8);
+    return v;
+}
+
+static inline UINT32
+load_le(const UINT8 *p, UINTN n)
+{
+    UINT32 v = 0;
+    for (UINTN i = 0; i < n; i++)
+        v |= (UINT32)p[i] << (8 * i);
+    return v;
+}
+
+/* Copy 16 bytes at a time; may overrun `n` by up to 15 bytes. */
+static inline void
+wild_copy(UINT8 *d, const UINT8 *s, UINTN n)
+{
+    UINT8 *e = d + n;
+    do {
+        __builtin_memcpy(d, s, 16);
+        d += 16;
+        s += 16;
+    } while (d < e);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Input                                                              */
+/* ------------------------------------------------------------------ */
+
+static BOOLEAN
+in_read(SbInStream *in, UINT8 *dst, UINTN n)
+{
+    while (n) {
+        if (in->next == in->end && !in->refill(in))
+            return FALSE;
+        UINTN k = (UINTN)(in->end - in->next);
+        if (k > n)
+            k = n;
+        if (k >= 64) {
+            sb_memcpy(dst, in->next, k);
+        } else {
+            for (UINTN i = 0; i < k; i++)
+                dst[i] = in->next[i];
+        }
+        in->next += k;
+        dst += k;
+        n   -= k;
+    }
+    return TRUE;
+}
+
+/* ------------------------------------------------------------------ */
+/*  XXH64 (content checksum)                                           */
+/* ------------------------------------------------------------------ */
+
+#define XP1 0x9E3779B185EBCA87ULL
+#define XP2 0xC2B2AE3D27D4EB4FULL
+#define XP3 0x165667B19E3779F9ULL
+#define XP4 0x85EBCA77C2B2AE63ULL
+#define XP5 0x27D4EB2F165667C5ULL
+
+static inline UINT64
+rotl64(UINT64 x, UINT32 r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline UINT64
+xxh_round(UINT64 acc, UINT64 in)
+{
+    acc += in * XP2;
+    acc  = rotl64(acc, 31);
+    return acc * XP1;
+}
+
+static void
+xxh_init(Xxh64 *x)
+{
+    x->v[0] = XP1 + XP2;
+    x->v[1] = XP2;
+    x->v[2] = 0;
+    x->v[3] = -XP1;
+    x->total = 0;
+    x->mem_len = 0;
+}
+
+static void
+xxh_update(Xxh64 *x, const UINT8 *p, UINTN n)
+{
+    x->total += n;
+
+    if (x->mem_len + n < 32) {
+        for (UINTN i = 0; i < n; i++)
+            x->mem[x->mem_len++] = p[i];
+        return;
+    }
+    if (x->mem_len) {
+        UINT32 fill = 32 - x->mem_len;
+        for (UINT32 i = 0; i < fill; i++)
+            x->mem[x->mem_len + i] = p[i];
+        for (UINTN i = 0; i < 4; i++)
+            x->v[i] = xxh_round(x->v[i], load64(x->mem + 8 * i));
+        p += fill;
+        n -= fill;
+        x->mem_len = 0;
+    }
+
+    UINT64 v0 = x->v[0], v1 = x->v[1], v2 = x->v[2], v3 = x->v[3];
+    for (; n >= 32; n -= 32, p += 32) {
+        v0 = xxh_round(v0, load64(p));
+        v1 = xxh_round(v1, load64(p + 8));
+        v2 = xxh_round(v2, load64(p + 16));
+        v3 = xxh_round(v3, load64(p + 24));
+    }
+    x->v[0] = v0; x->v[1] = v1; x->v[2] = v2; x->v[3] = v3;
+
+    for (UINTN i = 0; i < n; i++)
+        x->mem[i] = p[i];
+    x->mem_len = (UINT32)n;
+}
+
+static UINT64
+xxh_digest(const Xxh64 *x)
+{
+    UINT64 h;
+
+    if (x->total >= 32) {
+        h = rotl64(x->v[0], 1) + rotl64(x->v[1], 7) +
+            rotl64(x->v[2], 12) + rotl64(x->v[3], 18);
+        for (UINTN i = 0; i < 4; i++) {
+            h ^= xxh_round(0, x->v[i]);
+            h  = h * XP1 + XP4;
+        }
+    } else {
+        h = XP5;
+    }
+    h += x->total;
+
+    const UINT8 *p = x->mem;
+    UINTN n = x->mem_len;
+    for (; n >= 8; n -= 8, p += 8) {
+        h ^= xxh_round(0, load64(p));
+        h  = rotl64(h, 27) * XP1 + XP4;
+    }
+    if (n >= 4) {
+        h ^= (UINT64)load_le(p, 4) * XP1;
+        h  = rotl64(h, 23) * XP2 + XP3;
+        p += 4;
+        n -= 4;
+    }
+    for (; n; n--, p++) {
+        h ^= *p * XP5;
+        h  = rotl64(h, 11) * XP1;
+    }
+
+    h ^= h >> 33;
+    h *= XP2;
+    h ^= h >> 29;
+    h *= XP3;
+    h ^= h >> 32;
+    return h;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Backward bit stream (RFC 8878, 4.1)                                */
+/*                                                                     */
+/*  Read from the last byte towards the first, high bits first.  The  */
+/*  last byte's highest set bit marks where the data starts.           */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    UINT64       c;
+    UINT32       consumed;
+    const UINT8 *ptr;
+    const UINT8 *start;
+} BitRev;
+
+enum { REV_MORE, REV_END_BUF, REV_DONE, REV_OVERFLOW };
+
+static BOOLEAN
+rev_init(BitRev *b, const UINT8 *src, UINTN n)
+{
+    if (n == 0 || src[n - 1] == 0)
+        return FALSE;
+
+    b->start = src;
+    if (n >= 8) {
+        b->ptr = src + n - 8;
+        b->c   = load64(b->ptr);
+        b->consumed = 8 - highbit(src[n - 1]);
+    } else {
+        b->ptr = src;
+        b->c   = 0;
+        for (UINTN i = 0; i < n; i++)
+            b->c |= (UINT64)src[i] << (8 * i);
+        b->consumed = 8 - highbit(src[n - 1]) + (UINT32)(8 - n) * 8;
+    }
+    return TRUE;
+}
+
+static inline UINT64
+rev_peek(const BitRev *b, UINT32 n)
+{
+    return ((b->c << (b->consumed & 63)) >> 1) >> ((63 - n) & 63);
+}
+
+static inline UINT64
+rev_read(BitRev *b, UINT32 n)
+{
+    UINT64 v = rev_peek(b, n);
+    b->consumed += n;
+    return v;
+}
+
+static inline int
+rev_reload(BitRev *b)
+{
+    if (b->consumed > 64)
+        return REV_OVERFLOW;
+    if (b->ptr >= b->start + 8) {
+        b->ptr      -= b->consumed >> 3;
+        b->consumed &= 7;
+        b->c         = load64(b->ptr);
+        return REV_MORE;
+    }
+    if (b->ptr == b->start)
+        return b->consumed < 64 ? REV_END_BUF : REV_DONE;
+
+    UINT32 nb = b->consumed >> 3;
+    int r = REV_MORE;
+    if (b->ptr - nb < b->start) {
+        nb = (UINT32)(b->ptr - b->start);
+        r  = REV_END_BUF;
+    }
+    b->ptr      -= nb;
+    b->consumed -= nb * 8;
+    b->c         = load64(b->ptr);
+    return r;
+}
+
+static inline BOOLEAN
+rev_finished(const BitRev *b)
+{
+    return b->ptr == b->start && b->consumed == 64;
+}
+
+/* ------------------------------------------------------------------ */
+/*  FSE tables                                                         */
+/* ------------------------------------------------------------------ */
+
+static BOOLEAN
+fse_build(FseTable *t, const INT16 *norm, UINT32 max_sym, UINT32 log)
+{
+    UINT32 size = 1U << log, high = size - 1;
+    UINT16 next[256];
+
+    for (UINT32 s = 0; s <= max_sym; s++) {
+        if (norm[s] == -1) {
+            t->e[high--].symbol = (UINT8)s;
+            next[s] = 1;
+        } else {
+            next[s] = (UINT16)norm[s];
+        }
+    }
+
+    UINT32 step = (size >> 1) + (size >> 3) + 3, mask = size - 1, pos = 0;
+    for (UINT32 s = 0; s <= max_sym; s++) {
+        for (INT32 i = 0; i < norm[s]; i++) {
+            t->e[pos].symbol = (UINT8)s;
+            do {
+                pos = (pos + step) & mask;
+            } while (pos > high);
+        }
+    }
+    if (pos != 0)
+        return FALSE;
+
+    for (UINT32 u = 0; u < size; u++) {
+        UINT32 ns = next[t->e[u].symbol]++;
+        UINT32 nb = log - highbit(ns);
+        t->e[u].nb_bits = (UINT8)nb;
+        t->e[u].base    = (UINT16)((ns << nb) - size);
+    }
+    t->log   = log;
+    t->valid = TRUE;
+    return TRUE;
+}
+
+/*
+ * Read an FSE table description (RFC 8878, 4.1.1) from `src` and
+ * build the table.  Returns the number of bytes used, 0 on error.
+ */
+static UINTN
+fse_read(FseTable *t, UINT32 max_log, UINT32 max_sym,
+         const UINT8 *src, UINTN n)
+{
+    INT16  norm[256];
+    UINTN  bitpos = 0;
+
+#define GETBITS(k) ({                                                     \
+        UINT32 _v = 0;                                                    \
+        for (UINT32 _i = 0; _i < (k); _i++, bitpos++) {                   \
+            if ((bitpos >> 3) < n)                                        \
+                _v |= (UINT32)((src[bitpos >> 3] >> (bitpos & 7)) & 1) << _i; \
+        }                                                                 \
+        _v; })
+
+    UINT32 log = GETBITS(4) + 5;
+    if (log > max_log)
+        return 0;
+
+    INT32  remaining = (1 << log) + 1;
+    INT32  threshold = 1 << log;
+    UINT32 nbits = log + 1;
+    UINT32 sym = 0;
+
+    while (remaining > 1 && sym <= max_sym) {
+        /* Peek nbits, decide whether the value needs all of them. */
+        UINTN  save = bitpos;
+        UINT32 v = GETBITS(nbits);
+        INT32  max = (2 * threshold - 1) - remaining;
+        INT32  count;
+
+        if ((INT32)(v & (threshold - 1)) < max) {
+            count  = (INT32)(v & (threshold - 1));
+            bitpos = save + nbits - 1;
+        } else {
+            count = (INT32)(v & (2 * threshold - 1));
+            if (count >= threshold)
+                count -= max;
+        }
+        count--;
+        remaining -= count < 0 ? -count : count;
+        norm[sym++] = (INT16)count;
+
+        if (count == 0) {
+            /* Runs of zero-probability symbols: 2-bit repeat flags. */
+            UINT32 rep;
+            do {
+                rep = GETBITS(2);
+                for (UINT32 i = 0; i < rep && sym <= max_sym; i++)
+                    norm[sym++] = 0;
+            } while (rep == 3);
+        }
+        while (remaining < threshold) {
+            nbits--;
+            threshold >>= 1;
+        }
+    }
+
+#undef GETBITS
+
+    UINTN used = (bitpos + 7) >> 3;
+    if (remaining != 1 || used > n || sym > max_sym + 1)
+        return 0;
+    while (sym <= max_sym)
+        norm[sym++] = 0;
+
+    if (!fse_build(t, norm, max_sym, log))
+        return 0;
+    return used;
+}
+
+static inline UINT8
+fse_peek(const FseTable *t, UINT32 state)
+{
+    return t->e[state].symbol;
+}
+
+static inline UINT32
+fse_next(const FseTable *t, UINT32 state, BitRev *b)
+{
+    const FseEntry *e = &t->e[state];
+    return e->base + (UINT32)rev_read(b, e->nb_bits);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Huffman literals (RFC 8878, 4.2)                                   */
+/* ------------------------------------------------------------------ */
+
+/* Decode Huffman weights with an FSE table (two interleaved states). */
+static UINTN
+huf_fse_weights(Zstd *w, UINT8 *weights, const UINT8 *src, UINTN n)
+{
+    FseTable *t = &w->weights;
+    UINTN used = fse_read(t, 6, 255, src, n);
+    if (used == 0)
+        return 0;
+
+    BitRev b;
+    if (!rev_init(&b, src + used, n - used))
+        return 0;
+
+    UINT32 s1 = (UINT32)rev_read(&b, t->log);
+    UINT32 s2 = (UINT32)rev_read(&b, t->log);
+    UINTN count = 0;
+
+    for (;;) {
+        if (count > 253)
+            return 0;
+        weights[count++] = fse_peek(t, s1);
+        s1 = fse_next(t, s1, &b);
+        if (rev_reload(&b) == REV_OVERFLOW) {
+            weights[count++] = fse_peek(t, s2);
+            break;
+        }
+        weights[count++] = fse_peek(t, s2);
+        s2 = fse_next(t, s2, &b);
+        if (rev_reload(&b) == REV_OVERFLOW) {
+            weights[count++] = fse_peek(t, s1);
+            break;
+        }
+    }
+    return count;
+}
+
+/* Read a Huffman tree description; returns bytes used, 0 on error. */
+static UINTN
+huf_read(Zstd *w, const UINT8 *src, UINTN n)
+{
+    UINT8 weights[256];
+    UINTN count, used;
+
+    if (n == 0)
+        return 0;
+
+    UINT8 hdr = src[0];
+    if (hdr < 128) {
+        if (hdr == 0 || 1 + (UINTN)hdr > n)
+            return 0;
+        count = huf_fse_weights(w, weights, src + 1, hdr);
+        used = 1 + hdr;
+    } else {
+        count = hdr - 127;
+        used = 1 + (count + 1) / 2;
+        if (used > n)
+            return 0;
+        for (UINTN i = 0; i < count; i++) {
+            UINT8 byte = src[1 + i / 2];
+            weights[i] = (i & 1) ? (byte & 0xF) : (byte >> 4);
+        }
+    }
+    if (count == 0 || count > 255)
+        return 0;
+
+    /* The last weight is implied: it completes a power of two. */
+    UINT32 total = 0;
+    for (UINTN i = 0; i < count; i++) {
+        if (weights[i] > HUF_MAX_BITS)
+            return 0;
+        if (weights[i])
+            total += 1U << (weights[i] - 1);
+    }
+    if (total == 0)
+        return 0;
+    UINT32 bits = highbit(total) + 1;
+    UINT32 rest = (1U << bits) - total;
+    if (bits > HUF_MAX_BITS || (rest & (rest - 1)) != 0)
+        return 0;
+    weights[count++] = (UINT8)(highbit(rest) + 1);
+
+    /* Lower weights (longer codes) take the lower table slots. */
+    UINT32 rank[HUF_MAX_BITS + 2];
+    for (UINT32 i = 0; i <= HUF_MAX_BITS + 1; i++)
+        rank[i] = 0;
+    for (UINTN i = 0; i < count; i++)
+        rank[weights[i]]++;
+    UINT32 pos = 0;
+    for (UINT32 wt = 1; wt <= bits; wt++) {
+        UINT32 c = rank[wt];
+        rank[wt] = pos;
+        pos += c << (wt - 1);
+    }
+
+    for (UINTN s = 0; s < count; s++) {
+        UINT32 wt = weights[s];
+        if (!wt)
+            continue;
+        UINT16 e = (UINT16)((s << 8) | (bits + 1 - wt));
+        for (UINT32 i = 0; i < (1U << (wt - 1)); i++)
+            w->huf[rank[wt] + i] = e;
+        rank[wt] += 1U << (wt - 1);
+    }
+
+    w->huf_bits  = bits;
+    w->huf_valid = TRUE;
+    return used;
+}
+
+static BOOLEAN
+huf_stream(const Zstd *w, UINT8 *out, UINTN count,
+           const UINT8 *src, UINTN n)
+{
+    BitRev b;
+    if (!rev_init(&b, src, n))
+        return FALSE;
+
+    const UINT16 *t = w->huf;
+    UINT32 bits = w->huf_bits;
+
+    /* Four symbols of at most 11 bits fit after every reload. */
+    UINTN i = 0;
+    for (; i + 4 <= count; i += 4) {
+        rev_reload(&b);
+        for (UINTN k = 0; k < 4; k++) {
+            UINT16 e = t[rev_peek(&b, bits)];
+            out[i + k] = (UINT8)(e >> 8);
+            b.consumed += e & 0xFF;
+        }
+    }
+    rev_reload(&b);
+    for (; i < count; i++) {
+        UINT16 e = t[rev_peek(&b, bits)];
+        out[i] = (UINT8)(e >> 8);
+        b.consumed += e & 0xFF;
+    }
+    rev_reload(&b);
+    return rev_finished(&b);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Literals section (RFC 8878, 3.1.1.3.1)                             */
+/* ------------------------------------------------------------------ */
+
+enum { LIT_RAW, LIT_RLE, LIT_COMPRESSED, LIT_TREELESS };
+
+static EFI_STATUS
+literals(Zstd *w, const UINT8 *src, UINTN n, UINTN *used,
+         const UINT8 **lits, UINTN *nlits)
+{
+    if (n < 1)
+        return EFI_COMPROMISED_DATA;
+
+    UINT32 type = src[0] & 3, sf = (src[0] >> 2) & 3;
+    UINTN  hsize, regen;
+
+    if (type == LIT_RAW || type == LIT_RLE) {
+        switch (sf) {
+        case 0: case 2:
+            hsize = 1;
+            regen = src[0] >> 3;
+            break;
+        case 1:
+            hsize = 2;
+            if (n < 2)
+                return EFI_COMPROMISED_DATA;
+            regen = (src[0] >> 4) + ((UINTN)src[1] << 4);
+            break;
+        default:
+            hsize = 3;
+            if (n < 3)
+                return EFI_COMPROMISED_DATA;
+            regen = (src[0] >> 4) + ((UINTN)src[1] << 4) +
+                    ((UINTN)src[2] << 12);
+            break;
+        }
+        if (regen > ZSTD_BLOCK_MAX)
+            return EFI_COMPROMISED_DATA;
+
+        if (type == LIT_RAW) {
+            if (hsize + regen > n)
+                return EFI_COMPROMISED_DATA;
+            *lits  = src + hsize;
+            *used  = hsize + regen;
+        } else {
+            if (hsize + 1 > n)
+                return EFI_COMPROMISED_DATA;
+            for (UINTN i = 0; i < regen; i++)
+                w->lits[i] = src[hsize];
+            *lits  = w->lits;
+            *used  = hsize + 1;
+        }
+        *nlits = regen;
+        return EFI_SUCCESS;
+    }
+
+    /* Huffman-coded: 1 or 4 streams. */
+    UINTN comp, streams = (sf == 0) ? 1 : 4;
+    hsize = (sf < 2) ? 3 : sf + 2;
+    if (n < hsize)
+        return EFI_COMPROMISED_DATA;
+    UINT64 h = 0;
+    for (UINTN i = 0; i < hsize; i++)
+        h |= (UINT64)src[i] << (8 * i);
+    switch (sf) {
+    case 0: case 1:
+        regen = (h >> 4) & 0x3FF;
+        comp  = (h >> 14) & 0x3FF;
+        break;
+    case 2:
+        regen = (h >> 4) & 0x3FFF;
+        comp  = (h >> 18) & 0x3FFF;
+        break;
+    default:
+        regen = (h >> 4) & 0x3FFFF;
+        comp  = (h >> 22) & 0x3FFFF;
+        break;
+    }
+    if (regen > ZSTD_BLOCK_MAX || hsize + comp > n)
+        return EFI_COMPROMISED_DATA;
+
+    const UINT8 *p = src + hsize;
+    UINTN left = comp;
+    if (type == LIT_COMPRESSED) {
+        UINTN tree = huf_read(w, p, left);
+        if (tree == 0)
+            return EFI_COMPROMISED_DATA;
+        p += tree;
+        left -= tree;
+    } else if (!w->huf_valid) {
+        return EFI_COMPROMISED_DATA;
+    }
+
+    if (streams == 1) {
+        if (!huf_stream(w, w->lits, regen, p, left))
+            return EFI_COMPROMISED_DATA;
+    } else {
+        if (left < 6)
+            return EFI_COMPROMISED_DATA;
+        UINTN sz[4];
+        sz[0] = load_le(p, 2);
+        sz[1] = load_le(p + 2, 2);
+        sz[2] = load_le(p + 4, 2);
+        if (sz[0] + sz[1] + sz[2] > left - 6)
+            return EFI_COMPROMISED_DATA;
+        sz[3] = left - 6 - sz[0] - sz[1] - sz[2];
+        p += 6;
+
+        UINTN seg = (regen + 3) / 4;
+        if (3 * seg > regen)
+            return EFI_COMPROMISED_DATA;
+        UINT8 *o = w->lits;
+        for (UINTN s = 0; s < 4; s++) {
+            UINTN cnt = (s < 3) ? seg : regen - 3 * seg;
+            if (!huf_stream(w, o, cnt, p, sz[s]))
+                return EFI_COMPROMISED_DATA;
+            o += cnt;
+            p += sz[s];
+        }
+    }
+
+    *lits  = w->lits;
+    *nlits = regen;
+    *used  = hsize + comp;
+    return EFI_SUCCESS;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Sequences section (RFC 8878, 3.1.1.3.2)                            */
+/* ------------------------------------------------------------------ */
+
+enum { MODE_PREDEFINED, MODE_RLE, MODE_FSE, MODE_REPEAT };
+
+/* Set up one sequence table; returns bytes used, (UINTN)-1 on error. */
+static UINTN
+seq_table(FseTable *t, UINT32 mode, const INT16 *def, UINT32 def_max,
+          UINT32 def_log, UINT32 max_log, UINT32 max_sym,
+          const UINT8 *src, UINTN n)
+{
+    switch (mode) {
+    case MODE_PREDEFINED:
+        return fse_build(t, def, def_max, def_log) ? 0 : (UINTN)-1;
+    case MODE_RLE:
+        if (n < 1 || src[0] > max_sym)
+            return (UINTN)-1;
+        t->e[0].symbol  = src[0];
+        t->e[0].nb_bits = 0;
+        t->e[0].base    = 0;
+        t->log   = 0;
+        t->valid = TRUE;
+        return 1;
+    case MODE_FSE: {
+        UINTN used = fse_read(t, max_log, max_sym, src, n);
+        return used ? used : (UINTN)-1;
+    }
+    default:
+        return t->valid ? 0 : (UINTN)-1;
+    }
+}
+
+/* Copy `len` bytes of match from `off` bytes back. */
+static inline void
+copy_match(UINT8 *op, UINTN off, UINTN len, const UINT8 *oend)
+{
+    const UINT8 *from = op - off;
+    if (off >= 16 && (UINTN)(oend - op) >= len + WILD) {
+        wild_copy(op, from, len);
+    } else if (off >= 8 && (UINTN)(oend - op) >= len + WILD) {
+        UINT8 *e = op + len;
+        do {
+            __builtin_memcpy(op, from, 8);
+            op += 8;
+            from += 8;
+        } while (op < e);
+    } else {
+        for (UINTN i = 0; i < len; i++)
+            op[i] = from[i];
+    }
+}
+
+static EFI_STATUS
+sequences(Zstd *w, const UINT8 *src, UINTN n,
+          const UINT8 *lits, UINTN nlits,
+          UINT8 *out, UINT8 **opp, UINT8 *oend)
+{
+    UINT8 *op = *opp;
+    const UINT8 *lit_end = lits + nlits;
+    UINTN nseq, pos;
+
+    if (n < 1)
+        return EFI_COMPROMISED_DATA;
+    if (src[0] < 128) {
+        nseq = src[0];
+        pos = 1;
+    } else if (src[0] < 255) {
+        if (n < 2)
+            return EFI_COMPROMISED_DATA;
+        nseq = ((UINTN)(src[0] - 128) << 8) + src[1];
+        pos = 2;
+    } else {
+        if (n < 3)
+            return EFI_COMPROMISED_DATA;
+        nseq = src[1] + ((UINTN)src[2] << 8) + 0x7F00;
+        pos = 3;
+    }
+
+    if (nseq > 0) {
+        if (pos >= n)
+            return EFI_COMPROMISED_DATA;
+        UINT8 modes = src[pos++];
+        if (modes & 3)
+            return EFI_COMPROMISED_DATA;
+
+        UINTN u;
+        u = seq_table(&w->ll, modes >> 6, ll_default, LL_MAX_SYM, 6,
+                      LL_MAX_LOG, LL_MAX_SYM, src + pos, n - pos);
+        if (u == (UINTN)-1)
+            return EFI_COMPROMISED_DATA;
+        pos += u;
+        u = seq_table(&w->of, (modes >> 4) & 3, of_default, 28, 5,
+                      OF_MAX_LOG, OF_MAX_SYM, src + pos, n - pos);
+        if (u == (UINTN)-1)
+            return EFI_COMPROMISED_DATA;
+        pos += u;
+        u = seq_table(&w->ml, (modes >> 2) & 3, ml_default, ML_MAX_SYM, 6,
+                      ML_MAX_LOG, ML_MAX_SYM, src + pos, n - pos);
+        if (u == (UINTN)-1)
+            return EFI_COMPROMISED_DATA;
+        pos += u;
+
+        BitRev b;
+        if (pos > n || !rev_init(&b, src + pos, n - pos))
+            return EFI_COMPROMISED_DATA;
+
+        UINT32 ls = (UINT32)rev_read(&b, w->ll.log);
+        UINT32 os = (UINT32)rev_read(&b, w->of.log);
+        UINT32 ms = (UINT32)rev_read(&b, w->ml.log);
+        UINT32 *rep = w->rep;
+
+        for (UINTN i = 0; i < nseq; i++) {
+            UINT32 llc = fse_peek(&w->ll, ls);
+            UINT32 ofc = fse_peek(&w->of, os);
+            UINT32 mlc = fse_peek(&w->ml, ms);
+
+            rev_reload(&b);
+            UINT64 offv = (1ULL << ofc) + rev_read(&b, ofc);
+            rev_reload(&b);
+            UINTN ml = ml_base[mlc] + (UINTN)rev_read(&b, ml_bits[mlc]);
+            UINTN ll = ll_base[llc] + (UINTN)rev_read(&b, ll_bits[llc]);
+
+            /* Repeat offsets (RFC 8878, 3.1.1.5). */
+            UINT64 off;
+            if (offv > 3) {
+                off = offv - 3;
+                rep[2] = rep[1];
+                rep[1] = rep[0];
+                rep[0] = (UINT32)off;
+            } else {
+                UINT32 idx = (UINT32)offv - 1 + (ll == 0);
+                if (idx == 0) {
+                    off = rep[0];
+                } else {
+                    off = (idx == 3) ? rep[0] - 1 : rep[idx];
+                    if (idx != 1)
+                        rep[2] = rep[1];
+                    rep[1] = rep[0];
+                    rep[0] = (UINT32)off;
+                }
+            }
+
+            if (i + 1 < nseq) {
+                rev_reload(&b);
+                ls = fse_next(&w->ll, ls, &b);
+                ms = fse_next(&w->ml, ms, &b);
+                os = fse_next(&w->of, os, &b);
+            }
+
+            /* Execute: literals, then the match. */
+            if (ll > (UINTN)(lit_end - lits))
+                return EFI_COMPROMISED_DATA;
+            if (ll + ml > (UINTN)(oend - op))
+                return EFI_BUFFER_TOO_SMALL;
+            if ((UINTN)(oend - op) >= ll + WILD) {
+                wild_copy(op, lits, ll);
+            } else {
+                for (UINTN k = 0; k < ll; k++)
+                    op[k] = lits[k];
+            }
+            op   += ll;
+            lits += ll;
+
+            if (off == 0 || off > (UINT64)(op - out))
+                return EFI_COMPROMISED_DATA;
+            copy_match(op, (UINTN)off, ml, oend);
+            op += ml;
+        }
+
+        rev_reload(&b);
+        if (!rev_finished(&b))
+            return EFI_COMPROMISED_DATA;
+    } else if (pos != n) {
+        return EFI_COMPROMISED_DATA;
+    }
+
+    /* Trailing literals. */
+    UINTN rest = (UINTN)(lit_end - lits);
+    if (rest > (UINTN)(oend - op))
+        return EFI_BUFFER_TOO_SMALL;
+    for (UINTN k = 0; k < rest; k++)
+        op[k] = lits[k];
+    op += rest;
+
+    *opp = op;
+    return EFI_SUCCESS;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Frames                                                             */
+/* ------------------------------------------------------------------ */
+
+/* Parse a frame header from `hdr`; returns its length, 0 if invalid. */
+static UINTN
+frame_header(const UINT8 *hdr, UINTN len, UINT64 *fcs, BOOLEAN *checksum,
+             BOOLEAN *has_fcs, UINT32 *dict)
+{
+    if (len < 5 || load_le(hdr, 4) != ZSTD_MAGIC)
+        return 0;
+
+    UINT8 fhd = hdr[4];
+    UINT32 fcs_flag = fhd >> 6;
+    BOOLEAN single  = (fhd >> 5) & 1;
+    UINTN did_len   = (fhd & 3) == 3 ? 4 : (fhd & 3);
+    UINTN fcs_len   = fcs_flag == 0 ? (single ? 1 : 0) : 1U << fcs_flag;
+
+    if (fhd & 0x08)
+        return 0;   /* reserved bit */
+
+    UINTN pos = 5 + (single ? 0 : 1);
+    if (pos + did_len + fcs_len > len)
+        return 0;
+    *dict = load_le(hdr + pos, did_len);
+    pos += did_len;
+
+    UINT64 v = 0;
+    for (UINTN i = 0; i < fcs_len; i++)
+        v |= (UINT64)hdr[pos + i] << (8 * i);
+    if (fcs_len == 2)
+        v += 256;
+    pos += fcs_len;
+
+    *fcs      = v;
+    *has_fcs  = fcs_len != 0;
+    *checksum = (fhd >> 2) & 1;
+    return pos;
+}
+
+UINT64
+sb_unzstd_content_size(const UINT8 *hdr, UINTN len)
+{
+    UINT64 fcs;
+    BOOLEAN checksum, has_fcs;
+    UINT32 dict;
+
+    if (!frame_header(hdr, len, &fcs, &checksum, &has_fcs, &dict))
+        return 0;
+    return has_fcs ? fcs : 0;
+}
+
+static EFI_STATUS
+frame(Zstd *w, SbInStream *in, const UINT8 *magic,
+      UINT8 *out, UINT8 **opp, UINT8 *oend)
+{
+    UINT8 hdr[18];
+    UINT64 fcs;
+    BOOLEAN checksum, has_fcs;
+    UINT32 dict;
+
+    /* Magic (already read) + descriptor, then whatever it announces. */
+    for (UINTN i = 0; i < 4; i++)
+        hdr[i] = magic[i];
+    if (!in_read(in, hdr + 4, 1))
+        return EFI_END_OF_FILE;
+    UINT8 fhd = hdr[4];
+    UINTN need = ((fhd >> 5) & 1 ? 0 : 1) +
+                 ((fhd & 3) == 3 ? 4 : (fhd & 3)) +
+                 ((fhd >> 6) ? 1U << (fhd >> 6) : ((fhd >> 5) & 1));
+    if (!in_read(in, hdr + 5, need))
+        return EFI_END_OF_FILE;
+    if (!frame_header(hdr, 5 + need, &fcs, &checksum, &has_fcs, &dict))
+        return EFI_COMPROMISED_DATA;
+    if (dict)
+        return EFI_UNSUPPORTED;
+
+    w->rep[0] = 1;
+    w->rep[1] = 4;
+    w->rep[2] = 8;
+    w->ll.valid = w->ml.valid = w->of.valid = FALSE;
+    w->huf_valid = FALSE;
+    if (checksum)
+        xxh_init(&w->xxh);
+
+    UINT8 *op = *opp, *start = op;
+    UINT32 last;
+    do {
+        UINT8 bh[3];
+        if (!in_read(in, bh, 3))
+            return EFI_END_OF_FILE;
+        UINT32 h = load_le(bh, 3);
+        last = h & 1;
+        UINT32 type = (h >> 1) & 3;
+        UINTN  size = h >> 3;
+        UINT8 *block = op;
+
+        switch (type) {
+        case 0:     /* raw */
+            if (size > (UINTN)(oend - op))
+                return EFI_BUFFER_TOO_SMALL;
+            if (!in_read(in, op, size))
+                return EFI_END_OF_FILE;
+            op += size;
+            break;
+        case 1: {   /* RLE */
+            UINT8 c;
+            if (size > (UINTN)(oend - op))
+                return EFI_BUFFER_TOO_SMALL;
+            if (!in_read(in, &c, 1))
+                return EFI_END_OF_FILE;
+            if (size >= 64)
+                sb_memset(op, c, size);
+            else
+                for (UINTN i = 0; i < size; i++)
+                    op[i] = c;
+            op += size;
+            break;
+        }
+        case 2: {   /* compressed */
+            if (size > ZSTD_BLOCK_MAX)
+                return EFI_COMPROMISED_DATA;
+            if (!in_read(in, w->block, size))
+                return EFI_END_OF_FILE;
+            const UINT8 *lits;
+            UINTN used, nlits;
+            EFI_STATUS s = literals(w, w->block, size, &used, &lits, &nlits);
+            if (EFI_ERROR(s))
+                return s;
+            s = sequences(w, w->block + used, size - used, lits, nlits,
+                          out, &op, oend);
+            if (EFI_ERROR(s))
+                return s;
+            break;
+        }
+        default:
+            return EFI_COMPROMISED_DATA;
+        }
+
+        if (checksum)
+            xxh_update(&w->xxh, block, (UINTN)(op - block));
+    } while (!last);
+
+    if (checksum) {
+        UINT8 c[4];
+        if (!in_read(in, c, 4))
+            return EFI_END_OF_FILE;
+        if (load_le(c, 4) != (UINT32)xxh_digest(&w->xxh))
+            return EFI_CRC_ERROR;
+    }
+    if (has_fcs && (UINT64)(op - start) != fcs)
+        return EFI_COMPROMISED_DATA;
+
+    *opp = op;
+    return EFI_SUCCESS;
+}
+
+UINTN
+sb_unzstd_workspace(void)
+{
+    return sizeof(Zstd);
+}
+
+EFI_STATUS
+sb_unzstd(void *work, SbInStream *in, UINT8 *out, UINTN cap, UINTN *out_len)
+{
+    Zstd *w = work;
+    UINT8 *op = out, *oend = out + cap;
+    UINTN frames = 0;
+
+    *out_len = 0;
+
+    for (;;) {
+        UINT8 m[4];
+
+        /* End of input between frames is the normal end. */
+        if (in->next == in->end && !in->refill(in)) {
+            if (frames == 0)
+                return EFI_END_OF_FILE;
+            break;
+        }
+        if (!in_read(in, m, 4))
+            return EFI_END_OF_FILE;
+
+        UINT32 magic = load_le(m, 4);
+        if ((magic & ZSTD_SKIPPABLE_MASK) == ZSTD_SKIPPABLE_MAGIC) {
+            UINT8 sz[4], skip[64];
+            if (!in_read(in, sz, 4))
+                return EFI_END_OF_FILE;
+            for (UINT32 n = load_le(sz, 4); n; ) {
+                UINT32 k = n < sizeof(skip) ? n : sizeof(skip);
+                if (!in_read(in, skip, k))
+                    return EFI_END_OF_FILE;
+                n -= k;
+            }
+            continue;
+        }
+        if (magic != ZSTD_MAGIC)
+            return EFI_COMPROMISED_DATA;
+
+        EFI_STATUS s = frame(w, in, m, out, &op, oend);
+        if (EFI_ERROR(s))
+            return s;
+        frames++;
+        *out_len = (UINTN)(op - out);
+    }
+
+    return EFI_SUCCESS;
+}
@@ -1,13 +1,15 @@
 /*
- * config.c — Parser registry
+ * config.c — Parser registry and shared line scanner
+ *
+ * The parsers compiled in are chosen at build time (config.mk); the
+ * generated sb_features.h lists them in SB_PARSER_REGISTRY.
  */
 
 #include "config.h"
+#include "sb_features.h"
 
 static const ConfigParser *parsers[] = {
-    &sb_parser_grub,
-    &sb_parser_systemd_boot,
-    &sb_parser_limine,
+    SB_PARSER_REGISTRY
     NULL
 };
 
@@ -16,3 +18,49 @@ sb_config_get_parsers(void)
 {
     return parsers;
 }
+
+/* ------------------------------------------------------------------ */
+/*  Shared line scanner                                                */
+/* ------------------------------------------------------------------ */
+
+static inline BOOLEAN
+is_blank(CHAR8 c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+CHAR8 *
+sb_config_kv(CHAR8 *p, CHAR8 sep, const CHAR8 **key, UINTN *key_len,
+             CHAR8 *value, UINTN max)
+{
+    /* Find the line's end once; everything after works within it. */
+    CHAR8 *next = sb_next_line(p);
+    CHAR8 *end = (next > p && next[-1] == '\n') ? next - 1 : next;
+
+    *key = p = sb_skip_whitespace(p);
+    *key_len = 0;
+    value[0] = '\0';
+    if (p >= end || *p == '#')
+        return next;
+
+    if (sep) {
+        while (p < end && *p != sep) p++;
+    } else {
+        while (p < end && *p != ' ' && *p != '\t') p++;
+    }
+
+    CHAR8 *kend = p;
+    while (kend > *key && is_blank(kend[-1])) kend--;
+    *key_len = (UINTN)(kend - *key);
+
+    if (sep && p < end) p++;
+    while (p < end && is_blank(*p)) p++;
+    while (end > p && is_blank(end[-1])) end--;
+
+    UINTN n = (UINTN)(end - p);
+    if (n >= max)
+        n = max - 1;
+    sb_memcpy(value, p, n);
+    value[n] = '\0';
+    return next;
+}
@@ -3,7 +3,7 @@
  *
  * Each supported bootloader format (GRUB, systemd-boot, Limine) is a
  * ConfigParser.  Parsers are stateless: they receive raw file contents
- * and return an array of BootTargets.
+ * and append BootTargets to the shared target list.
  *
  * The scanner (scan.c) feeds config files to sb_parse_configs(), which
  * dispatches to every registered parser in turn.
@@ -36,7 +36,11 @@ typedef struct ConfigParser {
      *
      *  config_data / config_size   NUL-terminated ASCII text.
      *  device                      UEFI handle of the source partition.
-     *  targets / count / max       Output array (caller-owned).
+     *  list                        Output list: add entries with
+     *                              sb_targets_append(), intern their
+     *                              strings in list->strings and close
+     *                              each with sb_targets_finish().
+     *  count                       Number of entries this call kept.
      *
      * Returns EFI_SUCCESS even if zero entries are found (count == 0).
      * Returns an error only on hard failures (OOM, corrupt data, etc.)
@@ -46,9 +50,8 @@ typedef struct ConfigParser {
         UINTN           config_size,
         EFI_HANDLE      device,
         const CHAR16   *config_path,
-        BootTarget     *targets,
-        UINTN          *count,
-        UINTN           max
+        BootTargetList *list,
+        UINTN          *count
     );
 } ConfigParser;
 
@@ -69,6 +72,25 @@ extern ConfigParser sb_parser_limine;
  */
 const ConfigParser **sb_config_get_parsers(void);
 
+/* ------------------------------------------------------------------ */
+/*  Shared line scanner                                                */
+/* ------------------------------------------------------------------ */
+
+/*
+ * sb_config_kv() — split one `key value` line of a flat config format.
+ *
+ * `sep` separates key from value: ':' for Limine, or 0 for a run of
+ * blanks (systemd-boot).  *key points at the key in the text, which is
+ * not terminated; *key_len is 0 for blank and comment lines.  The
+ * value, trimmed of blanks and a CR, is copied NUL-terminated into
+ * `value` (truncated to `max`).  Returns the start of the next line.
+ *
+ * The key goes straight to the grammar's sb_kw_*() lookup, generated
+ * from keywords.def into sb_keywords.h.
+ */
+CHAR8 *sb_config_kv(CHAR8 *p, CHAR8 sep, const CHAR8 **key, UINTN *key_len,
+                    CHAR8 *value, UINTN max);
+
 /* ------------------------------------------------------------------ */
 /*  GRUB variable table (shared between grub.c and the transpiler)     */
 /* ------------------------------------------------------------------ */
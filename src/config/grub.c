@@ -17,9 +17,12 @@
  *         initrd[efi] ...   → initrd path(s)
  *         search ...        → resolve $root
  *         chainloader ...   → mark as chainload entry
- *   4.  `}` at depth 0 → close the current menuentry.
- *   5.  `submenu` is treated like `menuentry` but recurses.
- *   6.  Everything else (if/for/function/source) is skipped, but we
+ *   4.  `}` leaving the menuentry body → close the current entry.
+ *   5.  `submenu` is a container: its menuentries are collected too.
+ *   6.  `load_env` → read grubenv beside grub.cfg into the variables.
+ *   7.  `blscfg` → one entry per Boot Loader Specification file in
+ *       loader/entries, as RHEL and Fedora generate.
+ *   8.  Everything else (if/for/function/source) is skipped, but we
  *       still track brace depth so we can correctly close blocks.
  *
  * Variable expansion happens *lazily* when we build the final path
@@ -31,6 +34,8 @@
  */
 
 #include "config.h"
+#include "sb_keywords.h"
+#include "../fs/vfs.h"
 
 /* ------------------------------------------------------------------ */
 /*  GRUB variable table                                                */
@@ -203,14 +208,456 @@ grub_path_to_uefi(const CHAR8 *grub_path, CHAR16 *out, UINTN max)
     out[i] = L'\0';
 }
 
+/* ------------------------------------------------------------------ */
+/*  grubenv                                                            */
+/* ------------------------------------------------------------------ */
+
+/*
+ * Read the environment block GRUB keeps beside its config (`grubenv`
+ * in the same directory) into the scratch arena.  NULL if there is
+ * none.
+ */
+static CHAR8 *
+grubenv_read(EFI_HANDLE device, const CHAR16 *config_path)
+{
+    static const CHAR16 name[] = L"grubenv";
+    CHAR16 path[SB_MAX_PATH];
+    UINTN  dir = 0, i;
+
+    for (i = 0; config_path[i] && i + 1 < SB_MAX_PATH; i++) {
+        path[i] = config_path[i];
+        if (path[i] == L'\\')
+            dir = i + 1;
+    }
+    if (dir + sizeof(name) / sizeof(CHAR16) > SB_MAX_PATH)
+        return NULL;
+    sb_memcpy(path + dir, name, sizeof(name));
+
+    void  *data = NULL;
+    UINTN  size = 0;
+    if (EFI_ERROR(sb_vfs_read_file_arena(device, path, &sb_scratch,
+                                         &data, &size)))
+        return NULL;
+    return data;
+}
+
+/* `load_env`: set each name=value line; '#' lines pad the block. */
+static void
+grubenv_apply(GrubVarTable *vars, CHAR8 *env)
+{
+    CHAR8 name[SB_MAX_VAR_NAME], value[SB_MAX_VAR_VALUE];
+    const CHAR8 *key;
+    UINTN key_len;
+
+    while (env && *env) {
+        env = sb_config_kv(env, '=', &key, &key_len, value, sizeof(value));
+        if (key_len == 0 || key_len >= sizeof(name))
+            continue;
+        sb_memcpy(name, key, key_len);
+        name[key_len] = '\0';
+        grub_var_set(vars, name, value);
+    }
+}
+
+/* ------------------------------------------------------------------ */
+/*  blscfg: Boot Loader Specification entries                          */
+/*                                                                     */
+/*  On RHEL 8+ and Fedora 30+ grub.cfg has no menuentry at all:        */
+/*  blscfg builds the menu from loader/entries/NAME.conf, one file per */
+/*  installed kernel, on $root.  Their values may use GRUB variables;  */
+/*  RHEL 8 writes `options $kernelopts $tuned_params` and keeps        */
+/*  kernelopts in grubenv.                                             */
+/* ------------------------------------------------------------------ */
+
+static BOOLEAN is_digit(CHAR8 c) { return c >= '0' && c <= '9'; }
+
+static BOOLEAN
+is_alpha(CHAR8 c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+/*
+ * rpm's version comparison, which blscfg sorts with: runs of digits
+ * compare as numbers and beat runs of letters, anything else only
+ * separates, and '~' sorts before everything, even the end.
+ */
+static INTN
+vercmp(const CHAR8 *a, const CHAR8 *b)
+{
+    while (*a || *b) {
+        while (*a && !is_digit(*a) && !is_alpha(*a) && *a != '~') a++;
+        while (*b && !is_digit(*b) && !is_alpha(*b) && *b != '~') b++;
+
+        if (*a == '~' || *b == '~') {
+            if (*a != '~') return 1;
+            if (*b != '~') return -1;
+            a++;
+            b++;
+            continue;
+        }
+        if (!*a || !*b)
+            break;
+
+        const CHAR8 *a0 = a, *b0 = b;
+        BOOLEAN num = is_digit(*a);
+        if (num) {
+            while (is_digit(*a)) a++;
+            while (is_digit(*b)) b++;
+        } else {
+            while (is_alpha(*a)) a++;
+            while (is_alpha(*b)) b++;
+        }
+        if (b == b0)                    /* a number against letters */
+            return num ? 1 : -1;
+
+        if (num) {
+            while (*a0 == '0' && a0 < a) a0++;
+            while (*b0 == '0' && b0 < b) b0++;
+            if (a - a0 != b - b0)
+                return (a - a0) > (b - b0) ? 1 : -1;
+        }
+        UINTN la = (UINTN)(a - a0), lb = (UINTN)(b - b0);
+        INTN  r = sb_strncmp8(a0, b0, la < lb ? la : lb);
+        if (r != 0)
+            return r > 0 ? 1 : -1;
+        if (la != lb)
+            return la > lb ? 1 : -1;
+    }
+
+    if (!*a && !*b)
+        return 0;
+    return *a ? 1 : -1;
+}
+
+static CHAR8 *
+last_dash(CHAR8 *s)
+{
+    CHAR8 *dash = NULL;
+    for (; *s; s++)
+        if (*s == '-')
+            dash = s;
+    return dash;
+}
+
+/* Split "name-version-release" at its last two dashes, in place. */
+static void
+split_nvr(CHAR8 *s, const CHAR8 **name, const CHAR8 **version,
+          const CHAR8 **release)
+{
+    CHAR8 *dash = last_dash(s);
+
+    *name = (const CHAR8 *)"";
+    *release = (const CHAR8 *)"";
+    if (dash) {
+        *dash = '\0';
+        *release = dash + 1;
+    }
+    dash = last_dash(s);
+    if (dash) {
+        *dash = '\0';
+        *name = s;
+        *version = dash + 1;
+    } else {
+        *version = s;
+    }
+}
+
+/* Order of two entry ids: name, then version, then release. */
+static INTN
+bls_cmp(const CHAR8 *id_a, const CHAR8 *id_b)
+{
+    CHAR8 a[SB_MAX_TITLE], b[SB_MAX_TITLE];
+    const CHAR8 *na, *va, *ra, *nb, *vb, *rb;
+
+    sb_strcpy8(a, id_a, sizeof(a));
+    sb_strcpy8(b, id_b, sizeof(b));
+    split_nvr(a, &na, &va, &ra);
+    split_nvr(b, &nb, &vb, &rb);
+
+    INTN r = vercmp(na, nb);
+    if (r == 0)
+        r = vercmp(va, vb);
+    if (r == 0)
+        r = vercmp(ra, rb);
+    return r;
+}
+
+typedef struct BlsEntry {
+    struct BlsEntry *next;
+    CHAR16          *file;        /* name in the directory            */
+    CHAR8           *id;          /* the same without ".conf"         */
+} BlsEntry;
+
+/* The entries live in an arena of their own: drivers reset sb_scratch
+ * when read_dir() returns, taking anything the callback put there. */
+#define BLS_NAME_BLOCK  4096
+
+typedef struct {
+    BlsEntry *head;               /* newest first                     */
+    SbArena   names;
+    BOOLEAN   oom;
+} BlsDir;
+
+static BOOLEAN
+bls_collect(void *data, const CHAR16 *name, BOOLEAN is_dir, UINT64 size)
+{
+    BlsDir *d = data;
+    UINTN len = StrLen(name);
+
+    if (is_dir || len < 6 || StriCmp(name + len - 5, L".conf") != 0)
+        return TRUE;
+
+    /* UTF-16 to UTF-8 takes at most three bytes per unit. */
+    UINTN id_max = 3 * len + 1;
+    BlsEntry *e = sb_arena_alloc(&d->names, sizeof(*e) +
+                                 (len + 1) * sizeof(CHAR16) + id_max);
+    if (!e) {
+        d->oom = TRUE;
+        return FALSE;
+    }
+    e->file = (CHAR16 *)(e + 1);
+    e->id   = (CHAR8 *)(e->file + len + 1);
+    sb_memcpy(e->file, name, (len + 1) * sizeof(CHAR16));
+    sb_str16to8(e->id, name, id_max);
+    e->id[sb_strlen8(e->id) - 5] = '\0';
+
+    /* Newest first, as GRUB lists them; equal ids keep disk order. */
+    BlsEntry **pp = &d->head;
+    while (*pp && bls_cmp(e->id, (*pp)->id) <= 0)
+        pp = &(*pp)->next;
+    e->next = *pp;
+    *pp = e;
+    return TRUE;
+}
+
+/*
+ * One entry file.  Paths are from the root of the partition holding
+ * the entries, which GRUB prefixes with ($root).  `initrd` may list
+ * several, and `options` may repeat; with no `options` GRUB uses
+ * $default_kernelopts.  `buf` is 3 * SB_MAX_CMDLINE of scratch.
+ */
+static EFI_STATUS
+bls_parse_entry(const GrubVarTable *vars, CHAR8 *data, EFI_HANDLE device,
+                const CHAR16 *entry_path, const CHAR8 *id,
+                BootTargetList *list, BootTarget *t, CHAR8 *buf)
+{
+    SbStrPool *pool = &list->strings;
+    CHAR8  *value    = buf;
+    CHAR8  *options  = buf + SB_MAX_CMDLINE;
+    CHAR8  *expanded = buf + 2 * SB_MAX_CMDLINE;
+    CHAR16  wpath[SB_MAX_PATH];
+    const CHAR8 *key;
+    UINTN   key_len, olen = 0;
+
+    t->config_type   = CONFIG_TYPE_GRUB;
+    t->device_handle = device;
+    t->config_path   = sb_intern16(pool, entry_path);
+    options[0] = '\0';
+
+    while (*data) {
+        data = sb_config_kv(data, 0, &key, &key_len, value, SB_MAX_CMDLINE);
+
+        switch (sb_kw_sdboot(key, key_len)) {
+        case SB_KW_SDBOOT_TITLE:
+            t->title = sb_intern8to16(pool, value);
+            break;
+
+        case SB_KW_SDBOOT_LINUX:
+            grub_var_expand(vars, value, expanded, SB_MAX_PATH);
+            grub_path_to_uefi(expanded, wpath, SB_MAX_PATH);
+            t->kernel_path = sb_intern16(pool, wpath);
+            break;
+
+        case SB_KW_SDBOOT_INITRD: {
+            grub_var_expand(vars, value, expanded, SB_MAX_CMDLINE);
+            CHAR8 *p = skip_ws(expanded);
+            while (*p) {
+                CHAR8 *path = p;
+                while (*p && *p != ' ' && *p != '\t') p++;
+                if (*p) *p++ = '\0';
+                grub_path_to_uefi(path, wpath, SB_MAX_PATH);
+                if (EFI_ERROR(sb_target_add_initrd(list, t, wpath)))
+                    return EFI_OUT_OF_RESOURCES;
+                p = skip_ws(p);
+            }
+            break;
+        }
+
+        case SB_KW_SDBOOT_OPTIONS:
+            if (olen > 0 && olen + 1 < SB_MAX_CMDLINE)
+                options[olen++] = ' ';
+            sb_strcpy8(options + olen, value, SB_MAX_CMDLINE - olen);
+            olen += sb_strlen8(options + olen);
+            break;
+        }
+    }
+
+    if (t->title && t->title[0] == L'\0')
+        t->title = sb_intern8to16(pool, id);
+
+    /* An empty $tuned_params leaves a trailing blank. */
+    UINTN n = grub_var_expand(vars, olen ? options
+                                         : (CHAR8 *)"$default_kernelopts",
+                              expanded, SB_MAX_CMDLINE);
+    while (n > 0 && (expanded[n - 1] == ' ' || expanded[n - 1] == '\t'))
+        expanded[--n] = '\0';
+    t->cmdline = sb_intern8(pool, expanded);
+    return EFI_SUCCESS;
+}
+
+/* What `search --fs-uuid --set=root` leaves in $root. */
+static BOOLEAN
+looks_like_uuid(const CHAR8 *s)
+{
+    UINTN n = 0, dashes = 0;
+    for (; *s; s++, n++) {
+        if (*s == '-')
+            dashes++;
+        else if (!is_digit(*s) && !((*s | 0x20) >= 'a' && (*s | 0x20) <= 'f'))
+            return FALSE;
+    }
+    return dashes > 0 && n >= 9;
+}
+
+static EFI_STATUS
+grub_blscfg(const GrubVarTable *vars, EFI_HANDLE device,
+            BootTargetList *list, UINTN *count)
+{
+    /* The entries are on $root.  Unless `search` pointed that at a
+     * partition we can find, it is the one holding grub.cfg. */
+    const CHAR8 *root = grub_var_get(vars, "root");
+    if (root && looks_like_uuid(root)) {
+        EFI_HANDLE h = sb_vfs_find_uuid(root);
+        if (h)
+            device = h;
+    }
+
+    /* $blsdir, else /loader/entries, or /boot/loader/entries when
+     * /boot is not a partition of its own. */
+    static const CHAR16 *default_dirs[] = {
+        L"\\loader\\entries",
+        L"\\boot\\loader\\entries",
+        NULL
+    };
+    CHAR16 custom[SB_MAX_PATH];
+    const CHAR16 *custom_dirs[] = { custom, NULL };
+    const CHAR16 **dirs = default_dirs;
+
+    const CHAR8 *blsdir = grub_var_get(vars, "blsdir");
+    if (blsdir && *blsdir) {
+        CHAR8 expanded[SB_MAX_PATH];
+        grub_var_expand(vars, blsdir, expanded, sizeof(expanded));
+        grub_path_to_uefi(expanded, custom, SB_MAX_PATH);
+        dirs = custom_dirs;
+    }
+
+    BlsDir d = { NULL };
+    sb_arena_init(&d.names, BLS_NAME_BLOCK, SB_MEM_CONFIG);
+
+    EFI_STATUS status = EFI_SUCCESS;
+    const CHAR16 *dir = NULL;
+    for (; *dirs && !dir; dirs++) {
+        d.head = NULL;
+        if (!EFI_ERROR(sb_vfs_read_dir(device, *dirs, bls_collect, &d)))
+            dir = *dirs;
+        if (d.oom) {
+            status = EFI_OUT_OF_RESOURCES;
+            goto out;
+        }
+    }
+    if (!dir)
+        goto out;
+
+    CHAR8 *buf = sb_arena_alloc(&sb_scratch, 3 * SB_MAX_CMDLINE);
+    if (!buf) {
+        status = EFI_OUT_OF_RESOURCES;
+        goto out;
+    }
+
+    for (BlsEntry *e = d.head; e; e = e->next) {
+        CHAR16 path[SB_MAX_PATH];
+        SPrint(path, sizeof(path), L"%s\\%s", dir, e->file);
+
+        SbArenaMark mark = sb_arena_mark(&sb_scratch);
+        void  *data = NULL;
+        UINTN  size = 0;
+        if (EFI_ERROR(sb_vfs_read_file_arena(device, path, &sb_scratch,
+                                             &data, &size))) {
+            sb_arena_reset(&sb_scratch, mark);
+            continue;
+        }
+
+        BootTarget *t = sb_targets_append(list);
+        if (!t) {
+            status = EFI_OUT_OF_RESOURCES;
+            goto out;
+        }
+        t->index = (UINT32)*count;
+
+        status = bls_parse_entry(vars, data, device, path,
+                                 e->id, list, t, buf);
+        sb_arena_reset(&sb_scratch, mark);
+        if (EFI_ERROR(status)) {
+            list->count--;          /* drop the half-built entry */
+            goto out;
+        }
+
+        if (sb_targets_finish(list))
+            (*count)++;
+    }
+
+out:
+    sb_arena_release(&d.names);
+    return status;
+}
+
+/*
+ * Is `t` the entry GRUB would pick for a non-numeric `default`: one
+ * with that title, or a BLS entry with that id (RHEL's saved_entry)?
+ */
+static BOOLEAN
+grub_entry_named(const BootTarget *t, const CHAR16 *name)
+{
+    if (t->title && StrCmp(t->title, name) == 0)
+        return TRUE;
+
+    const CHAR16 *base = t->config_path;
+    for (const CHAR16 *c = base; c && *c; c++)
+        if (*c == L'\\')
+            base = c + 1;
+
+    UINTN n = StrLen(name);
+    return base && StrnCmp(base, name, n) == 0 &&
+           StriCmp(base + n, L".conf") == 0;
+}
+
 /* ------------------------------------------------------------------ */
 /*  Main parser                                                        */
 /* ------------------------------------------------------------------ */
 
+/* Count block openings on the remainder of an unrecognised line
+ * (`function foo {`, `if ...; then {`), skipping ${var} references. */
+static UINTN
+count_open_braces(const CHAR8 *p)
+{
+    UINTN n = 0;
+    while (*p && *p != '\n' && *p != '#') {
+        if (p[0] == '$' && p[1] == '{') {
+            while (*p && *p != '}' && *p != '\n') p++;
+            if (*p == '}') p++;
+            continue;
+        }
+        if (*p == '{') n++;
+        p++;
+    }
+    return n;
+}
+
 static EFI_STATUS
 grub_parse(const CHAR8 *config_data, UINTN config_size,
            EFI_HANDLE device, const CHAR16 *config_path,
-           BootTarget *targets, UINTN *count, UINTN max)
+           BootTargetList *list, UINTN *count)
 {
     (void)config_size;
 
@@ -220,11 +667,19 @@ grub_parse(const CHAR8 *config_data, UINTN config_size,
     /* Seed default variables. */
     grub_var_set(&vars, "prefix", "/boot/grub");
 
+    SbStrPool *pool = &list->strings;
+    const CHAR16 *cfg_path = sb_intern16(pool, config_path);
+    if (!cfg_path)
+        return EFI_OUT_OF_RESOURCES;
+
     CHAR8 *p = (CHAR8 *)config_data;
     UINTN  depth = 0;            /* brace nesting depth               */
-    BOOLEAN in_entry = FALSE;    /* are we inside a menuentry body?    */
+    UINTN  entry_depth = 0;      /* depth inside the open menuentry   */
+    UINTN  first = list->count;  /* our first entry in the list       */
     BootTarget *cur = NULL;      /* current entry being built          */
-    CHAR8 expanded[SB_MAX_PATH];
+    CHAR8  *env = NULL;          /* grubenv, once load_env read it    */
+    CHAR8  expanded[SB_MAX_CMDLINE];
+    CHAR16 wpath[SB_MAX_PATH];
 
     *count = 0;
 
@@ -235,12 +690,14 @@ grub_parse(const CHAR8 *config_data, UINTN config_size,
         if (*p == '\n') { p++; continue; }
         if (*p == '#')  { p = skip_line(p); continue; }
 
-        /* Closing brace. */
+        /* Closing brace.  Leaving the menuentry body closes the entry;
+         * braces of submenus and other blocks only change depth. */
         if (*p == '}') {
             p++;
             if (depth > 0) depth--;
-            if (depth == 0 && in_entry) {
-                in_entry = FALSE;
+            if (cur && depth < entry_depth) {
+                if (sb_targets_finish(list))
+                    (*count)++;
                 cur = NULL;
             }
             p = skip_line(p);
@@ -251,10 +708,13 @@ grub_parse(const CHAR8 *config_data, UINTN config_size,
         CHAR8 cmd[128];
         p = next_token(p, cmd, sizeof(cmd));
 
-        /* ---- menuentry / submenu -------------------------------- */
-        if (sb_strcmp8(cmd, "menuentry") == 0 ||
-            sb_strcmp8(cmd, "submenu") == 0) {
+        UINTN kw = sb_kw_grub(cmd, sb_strlen8(cmd));
+        switch (kw) {
 
+        /* ---- menuentry / submenu -------------------------------- */
+        case SB_KW_GRUB_MENUENTRY:
+        case SB_KW_GRUB_SUBMENU: {
+            BOOLEAN is_submenu = kw == SB_KW_GRUB_SUBMENU;
             CHAR8 title[SB_MAX_TITLE];
             p = next_token(p, title, sizeof(title));
 
@@ -268,105 +728,109 @@ grub_parse(const CHAR8 *config_data, UINTN config_size,
             p = skip_ws(p);
             if (*p == '{') { p++; depth++; }
 
-            /* Allocate a new BootTarget. */
-            if (*count < max) {
-                cur = &targets[*count];
-                SetMem(cur, sizeof(*cur), 0);
-                sb_str8to16(cur->title, title, SB_MAX_TITLE);
-                cur->config_type = CONFIG_TYPE_GRUB;
-                cur->device_handle = device;
-                CopyMem(cur->config_path, (void *)config_path,
-                        StrLen(config_path) * sizeof(CHAR16) + 2);
-                cur->index = (UINT32)*count;
-                in_entry = TRUE;
-            }
+            /* A submenu only groups entries; its children are listed
+             * alongside the top-level ones.  A menuentry nested in
+             * another (malformed) is ignored. */
+            if (is_submenu || cur)
+                continue;
+
+            cur = sb_targets_append(list);
+            if (!cur)
+                return EFI_OUT_OF_RESOURCES;
+            cur->title         = sb_intern8to16(pool, title);
+            cur->config_type   = CONFIG_TYPE_GRUB;
+            cur->device_handle = device;
+            cur->config_path   = cfg_path;
+            cur->index         = (UINT32)*count;
+            entry_depth        = depth;
             continue;
         }
 
         /* ---- set key=value -------------------------------------- */
-        if (sb_strcmp8(cmd, "set") == 0) {
-            CHAR8 assign[SB_MAX_VAR_VALUE + SB_MAX_VAR_NAME + 2];
-            p = next_token(p, assign, sizeof(assign));
-
-            CHAR8 *eq = assign;
-            while (*eq && *eq != '=') eq++;
-            if (*eq == '=') {
-                *eq = '\0';
-                /* Strip surrounding quotes from value. */
-                CHAR8 *val = eq + 1;
-                UINTN vlen = sb_strlen8(val);
-                if (vlen >= 2 &&
-                    ((val[0] == '\'' && val[vlen-1] == '\'') ||
-                     (val[0] == '"'  && val[vlen-1] == '"'))) {
-                    val[vlen-1] = '\0';
-                    val++;
-                }
-                grub_var_set(&vars, assign, val);
+        case SB_KW_GRUB_SET: {
+            CHAR8 name[SB_MAX_VAR_NAME];
+            UINTN ni = 0;
+
+            p = skip_ws(p);
+            while (*p && *p != '=' && *p != ' ' && *p != '\t' &&
+                   *p != '\n' && ni + 1 < sizeof(name))
+                name[ni++] = *p++;
+            name[ni] = '\0';
+
+            /* The value may be quoted, and then hold blanks
+             * (RHEL's `set kernelopts="root=... ro "`). */
+            if (*p == '=') {
+                CHAR8 val[SB_MAX_VAR_VALUE];
+                val[0] = '\0';
+                p++;
+                if (*p != ' ' && *p != '\t')
+                    p = next_token(p, val, sizeof(val));
+                grub_var_set(&vars, name, val);
             }
             p = skip_line(p);
             continue;
         }
 
         /* ---- linux / linuxefi ----------------------------------- */
-        if ((sb_strcmp8(cmd, "linux") == 0 ||
-             sb_strcmp8(cmd, "linuxefi") == 0 ||
-             sb_strcmp8(cmd, "linux16") == 0) && cur) {
+        case SB_KW_GRUB_LINUX: {
+            if (!cur)
+                break;
 
             CHAR8 kpath[SB_MAX_PATH];
             p = next_token(p, kpath, sizeof(kpath));
 
             /* Expand variables in the path. */
-            grub_var_expand(&vars, kpath, expanded, sizeof(expanded));
-            grub_path_to_uefi(expanded, cur->kernel_path, SB_MAX_PATH);
+            grub_var_expand(&vars, kpath, expanded, SB_MAX_PATH);
+            grub_path_to_uefi(expanded, wpath, SB_MAX_PATH);
+            cur->kernel_path = sb_intern16(pool, wpath);
 
             /* The rest of the line is the kernel command line. */
             CHAR8 raw_cmdline[SB_MAX_CMDLINE];
             p = rest_of_line(p, raw_cmdline, sizeof(raw_cmdline));
-            grub_var_expand(&vars, raw_cmdline,
-                            cur->cmdline, SB_MAX_CMDLINE);
+            grub_var_expand(&vars, raw_cmdline, expanded, sizeof(expanded));
+            cur->cmdline = sb_intern8(pool, expanded);
             continue;
         }
 
         /* ---- initrd / initrdefi --------------------------------- */
-        if ((sb_strcmp8(cmd, "initrd") == 0 ||
-             sb_strcmp8(cmd, "initrdefi") == 0 ||
-             sb_strcmp8(cmd, "initrd16") == 0) && cur) {
+        case SB_KW_GRUB_INITRD:
+            if (!cur)
+                break;
 
             /* Multiple initrds can be space-separated on one line. */
             while (*p && *p != '\n' && *p != '#') {
-                if (cur->initrd_count >= SB_MAX_INITRDS) break;
-
                 CHAR8 ipath[SB_MAX_PATH];
                 p = next_token(p, ipath, sizeof(ipath));
                 if (ipath[0] == '\0') break;
 
-                grub_var_expand(&vars, ipath, expanded, sizeof(expanded));
-                grub_path_to_uefi(
-                    expanded,
-                    cur->initrd_paths[cur->initrd_count],
-                    SB_MAX_PATH);
-                cur->initrd_count++;
+                grub_var_expand(&vars, ipath, expanded, SB_MAX_PATH);
+                grub_path_to_uefi(expanded, wpath, SB_MAX_PATH);
+                if (EFI_ERROR(sb_target_add_initrd(list, cur, wpath)))
+                    return EFI_OUT_OF_RESOURCES;
             }
             p = skip_line(p);
             continue;
-        }
 
         /* ---- chainloader ---------------------------------------- */
-        if (sb_strcmp8(cmd, "chainloader") == 0 && cur) {
+        case SB_KW_GRUB_CHAINLOADER: {
+            if (!cur)
+                break;
+
             CHAR8 efipath[SB_MAX_PATH];
             p = next_token(p, efipath, sizeof(efipath));
             /* +1 prefix means "force chainload" in GRUB. */
             CHAR8 *ep = efipath;
             if (*ep == '+') ep++;
-            grub_var_expand(&vars, ep, expanded, sizeof(expanded));
-            grub_path_to_uefi(expanded, cur->efi_path, SB_MAX_PATH);
+            grub_var_expand(&vars, ep, expanded, SB_MAX_PATH);
+            grub_path_to_uefi(expanded, wpath, SB_MAX_PATH);
+            cur->efi_path = sb_intern16(pool, wpath);
             cur->is_chainload = TRUE;
             p = skip_line(p);
             continue;
         }
 
         /* ---- search --------------------------------------------- */
-        if (sb_strcmp8(cmd, "search") == 0) {
+        case SB_KW_GRUB_SEARCH: {
             /*
              * `search --set=root --fs-uuid XXXX`
              * We record the UUID as $root so later path expansion
@@ -392,37 +856,71 @@ grub_parse(const CHAR8 *config_data, UINTN config_size,
             continue;
         }
 
-        /* ---- opening brace (from unrecognised block) ------------ */
-        if (*p == '{') {
-            depth++;
-            p++;
-        }
+        /* ---- load_env / blscfg ---------------------------------- */
+        case SB_KW_GRUB_LOAD_ENV:
+            if (!env)
+                env = grubenv_read(device, config_path);
+            grubenv_apply(&vars, env);
+            p = skip_line(p);
+            continue;
 
-        /* ---- Finalise the current entry when we leave depth 1 --- */
-        if (in_entry && depth == 0 && cur) {
-            /* Entry is complete. */
-            if (cur->kernel_path[0] != L'\0' || cur->is_chainload)
-                (*count)++;
-            in_entry = FALSE;
-            cur = NULL;
+        case SB_KW_GRUB_BLSCFG: {
+            if (cur)
+                break;
+
+            /*
+             * grubenv again: RHEL 8's grub.cfg sets kernelopts after
+             * load_env only `if [ -z "${kernelopts}" ]`, and we take
+             * every `set` regardless of its condition.
+             */
+            if (!env)
+                env = grubenv_read(device, config_path);
+            grubenv_apply(&vars, env);
+
+            EFI_STATUS status = grub_blscfg(&vars, device, list, count);
+            if (EFI_ERROR(status))
+                return status;
+            p = skip_line(p);
+            continue;
         }
+        }
+
+        /* ---- opening brace(s) of an unrecognised block ---------- */
+        depth += count_open_braces(p);
 
         p = skip_line(p);
     }
 
     /* Handle last entry if file ended without a closing brace. */
-    if (in_entry && cur &&
-        (cur->kernel_path[0] != L'\0' || cur->is_chainload))
+    if (cur && sb_targets_finish(list))
         (*count)++;
 
-    /* Mark the default entry. */
+    /* Mark the default entry: an index, or a title or BLS id, often
+     * through `set default="${saved_entry}"` and grubenv. */
     const CHAR8 *def = grub_var_get(&vars, "default");
     if (def && *count > 0) {
+        grub_var_expand(&vars, def, expanded, sizeof(expanded));
+
+        /* Only a whole number is an index: BLS ids start with the
+         * machine id, which may well begin with a digit. */
         UINTN def_idx = 0;
+        def = expanded;
         while (*def >= '0' && *def <= '9')
             def_idx = def_idx * 10 + (*def++ - '0');
-        if (def_idx < *count)
-            targets[def_idx].is_default = TRUE;
+
+        if (*def == '\0' && def != expanded) {
+            if (def_idx < *count)
+                list->entries[first + def_idx].is_default = TRUE;
+        } else if (expanded[0]) {
+            CHAR16 name[SB_MAX_TITLE];
+            sb_str8to16(name, expanded, SB_MAX_TITLE);
+            for (UINTN i = first; i < first + *count; i++) {
+                if (grub_entry_named(&list->entries[i], name)) {
+                    list->entries[i].is_default = TRUE;
+                    break;
+                }
+            }
+        }
     }
 
     return EFI_SUCCESS;
@@ -439,6 +937,9 @@ static const CHAR16 *grub_paths[] = {
     L"\\grub2\\grub.cfg",
     L"\\EFI\\centos\\grub.cfg",
     L"\\EFI\\fedora\\grub.cfg",
+    L"\\EFI\\redhat\\grub.cfg",
+    L"\\EFI\\rocky\\grub.cfg",
+    L"\\EFI\\almalinux\\grub.cfg",
     L"\\EFI\\ubuntu\\grub.cfg",
     L"\\EFI\\debian\\grub.cfg",
     L"\\EFI\\arch\\grub.cfg",
@@ -16,6 +16,7 @@
  */
 
 #include "config.h"
+#include "sb_keywords.h"
 
 /* ------------------------------------------------------------------ */
 /*  Path translation: strip Limine device prefixes                     */
@@ -54,33 +55,37 @@ limine_path_to_uefi(const CHAR8 *src, CHAR16 *dst, UINTN max)
 static EFI_STATUS
 limine_parse(const CHAR8 *config_data, UINTN config_size,
              EFI_HANDLE device, const CHAR16 *config_path,
-             BootTarget *targets, UINTN *count, UINTN max)
+             BootTargetList *list, UINTN *count)
 {
     (void)config_size;
     *count = 0;
 
+    SbStrPool *pool = &list->strings;
+    const CHAR16 *cfg_path = sb_intern16(pool, config_path);
+    if (!cfg_path)
+        return EFI_OUT_OF_RESOURCES;
+
     CHAR8 *p = (CHAR8 *)config_data;
+    CHAR8  value[SB_MAX_CMDLINE];
+    CHAR16 path[SB_MAX_PATH];
+    const CHAR8 *key;
+    UINTN  key_len;
     BootTarget *cur = NULL;
     BOOLEAN in_section = FALSE;
 
     while (*p) {
         p = sb_skip_whitespace(p);
 
-        /* Skip blank lines and comments. */
-        if (*p == '\n') { p++; continue; }
-        if (*p == '#')  { p = sb_next_line(p); continue; }
-
         /* Section header: /Title */
         if (*p == '/' && !in_section) {
             p++; /* skip the '/' */
-            if (*count >= max) break;
 
-            cur = &targets[*count];
-            SetMem(cur, sizeof(*cur), 0);
+            cur = sb_targets_append(list);
+            if (!cur)
+                return EFI_OUT_OF_RESOURCES;
             cur->config_type = CONFIG_TYPE_LIMINE;
             cur->device_handle = device;
-            CopyMem(cur->config_path, (void *)config_path,
-                    StrLen(config_path) * sizeof(CHAR16) + 2);
+            cur->config_path = cfg_path;
             cur->index = (UINT32)*count;
 
             /* Title is the rest of the line. */
@@ -89,7 +94,7 @@ limine_parse(const CHAR8 *config_data, UINTN config_size,
             while (*p && *p != '\n' && ti + 1 < sizeof(title))
                 title[ti++] = *p++;
             title[ti] = '\0';
-            sb_str8to16(cur->title, title, SB_MAX_TITLE);
+            cur->title = sb_intern8to16(pool, title);
 
             in_section = TRUE;
             p = sb_next_line(p);
@@ -98,66 +103,45 @@ limine_parse(const CHAR8 *config_data, UINTN config_size,
 
         /* New section also closes the previous one. */
         if (*p == '/' && in_section && cur) {
-            if (cur->kernel_path[0] || cur->is_chainload)
+            if (sb_targets_finish(list))
                 (*count)++;
             in_section = FALSE;
             cur = NULL;
             continue; /* Re-process this line as a new section. */
         }
 
-        /* Key: value pair (must be indented if in a section). */
-        if (in_section && cur) {
-            CHAR8 key[128];
-            UINTN ki = 0;
-            while (*p && *p != ':' && *p != '\n' && ki + 1 < sizeof(key))
-                key[ki++] = *p++;
-            key[ki] = '\0';
-
-            if (*p == ':') p++;
-            p = sb_skip_whitespace(p);
-
-            CHAR8 value[SB_MAX_CMDLINE];
-            UINTN vi = 0;
-            while (*p && *p != '\n' && vi + 1 < sizeof(value))
-                value[vi++] = *p++;
-            value[vi] = '\0';
-            /* Trim trailing whitespace. */
-            while (vi > 0 && (value[vi-1] == ' ' || value[vi-1] == '\t'))
-                value[--vi] = '\0';
-
-            if (sb_strcmp8(key, "kernel_path") == 0) {
-                limine_path_to_uefi(value, cur->kernel_path, SB_MAX_PATH);
-            }
-            else if (sb_strcmp8(key, "kernel_cmdline") == 0 ||
-                     sb_strcmp8(key, "cmdline") == 0) {
-                sb_strcpy8(cur->cmdline, value, SB_MAX_CMDLINE);
-            }
-            else if (sb_strcmp8(key, "module_path") == 0) {
-                if (cur->initrd_count < SB_MAX_INITRDS) {
-                    limine_path_to_uefi(
-                        value,
-                        cur->initrd_paths[cur->initrd_count],
-                        SB_MAX_PATH);
-                    cur->initrd_count++;
-                }
-            }
-            else if (sb_strcmp8(key, "protocol") == 0) {
-                if (sb_strcmp8(value, "chainload") == 0)
-                    cur->is_chainload = TRUE;
-            }
-            else if (sb_strcmp8(key, "path") == 0 ||
-                     sb_strcmp8(key, "image_path") == 0) {
-                limine_path_to_uefi(value, cur->efi_path, SB_MAX_PATH);
+        /* Key: value pair; outside a section, skip the line. */
+        p = sb_config_kv(p, ':', &key, &key_len, value, sizeof(value));
+        if (!in_section || !cur)
+            continue;
+
+        switch (sb_kw_limine(key, key_len)) {
+        case SB_KW_LIMINE_KERNEL_PATH:
+            limine_path_to_uefi(value, path, SB_MAX_PATH);
+            cur->kernel_path = sb_intern16(pool, path);
+            break;
+        case SB_KW_LIMINE_CMDLINE:
+            cur->cmdline = sb_intern8(pool, value);
+            break;
+        case SB_KW_LIMINE_MODULE_PATH:
+            limine_path_to_uefi(value, path, SB_MAX_PATH);
+            if (EFI_ERROR(sb_target_add_initrd(list, cur, path)))
+                return EFI_OUT_OF_RESOURCES;
+            break;
+        case SB_KW_LIMINE_PROTOCOL:
+            if (sb_strcmp8(value, "chainload") == 0)
                 cur->is_chainload = TRUE;
-            }
+            break;
+        case SB_KW_LIMINE_PATH:
+            limine_path_to_uefi(value, path, SB_MAX_PATH);
+            cur->efi_path = sb_intern16(pool, path);
+            cur->is_chainload = TRUE;
+            break;
         }
-
-        p = sb_next_line(p);
     }
 
     /* Close last section. */
-    if (in_section && cur &&
-        (cur->kernel_path[0] || cur->is_chainload))
+    if (in_section && cur && sb_targets_finish(list))
         (*count)++;
 
     return EFI_SUCCESS;
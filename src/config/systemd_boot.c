@@ -15,82 +15,63 @@
  */
 
 #include "config.h"
+#include "sb_keywords.h"
 
 /* ------------------------------------------------------------------ */
 /*  Parse a single entry .conf file                                    */
 /* ------------------------------------------------------------------ */
 
+/* Widen a path from an entry file, converting '/' to '\\'. */
+static CHAR16 *
+to_uefi_path(const CHAR8 *value, CHAR16 *path)
+{
+    sb_str8to16(path, value, SB_MAX_PATH);
+    for (CHAR16 *c = path; *c; c++)
+        if (*c == L'/') *c = L'\\';
+    return path;
+}
+
 static EFI_STATUS
 parse_entry_file(const CHAR8 *data, UINTN size,
                  EFI_HANDLE device, const CHAR16 *config_path,
-                 BootTarget *target)
+                 BootTargetList *list, BootTarget *target)
 {
     (void)size;
 
-    SetMem(target, sizeof(*target), 0);
+    SbStrPool *pool = &list->strings;
     target->config_type = CONFIG_TYPE_SYSTEMD_BOOT;
     target->device_handle = device;
-    CopyMem(target->config_path, (void *)config_path,
-            StrLen(config_path) * sizeof(CHAR16) + 2);
+    target->config_path = sb_intern16(pool, config_path);
 
     CHAR8 *p = (CHAR8 *)data;
-    CHAR8  key[64], value[SB_MAX_CMDLINE];
+    CHAR8  value[SB_MAX_CMDLINE];
+    CHAR16 path[SB_MAX_PATH];
+    const CHAR8 *key;
+    UINTN  key_len;
 
     while (*p) {
-        p = sb_skip_whitespace(p);
-        if (*p == '#' || *p == '\n') {
-            p = sb_next_line(p);
-            continue;
-        }
+        p = sb_config_kv(p, 0, &key, &key_len, value, sizeof(value));
 
-        /* Read key. */
-        UINTN ki = 0;
-        while (*p && *p != ' ' && *p != '\t' && *p != '\n' &&
-               ki + 1 < sizeof(key))
-            key[ki++] = *p++;
-        key[ki] = '\0';
-
-        /* Read value (rest of line). */
-        p = sb_skip_whitespace(p);
-        UINTN vi = 0;
-        while (*p && *p != '\n' && vi + 1 < sizeof(value))
-            value[vi++] = *p++;
-        value[vi] = '\0';
-
-        /* Trim trailing whitespace. */
-        while (vi > 0 && (value[vi-1] == ' ' || value[vi-1] == '\t'))
-            value[--vi] = '\0';
-
-        if (sb_strcmp8(key, "title") == 0) {
-            sb_str8to16(target->title, value, SB_MAX_TITLE);
-        }
-        else if (sb_strcmp8(key, "linux") == 0) {
-            sb_str8to16(target->kernel_path, value, SB_MAX_PATH);
-            /* Convert forward slashes to backslashes. */
-            for (CHAR16 *c = target->kernel_path; *c; c++)
-                if (*c == L'/') *c = L'\\';
-        }
-        else if (sb_strcmp8(key, "initrd") == 0) {
-            if (target->initrd_count < SB_MAX_INITRDS) {
-                sb_str8to16(
-                    target->initrd_paths[target->initrd_count],
-                    value, SB_MAX_PATH);
-                for (CHAR16 *c = target->initrd_paths[target->initrd_count]; *c; c++)
-                    if (*c == L'/') *c = L'\\';
-                target->initrd_count++;
-            }
-        }
-        else if (sb_strcmp8(key, "options") == 0) {
-            sb_strcpy8(target->cmdline, value, SB_MAX_CMDLINE);
-        }
-        else if (sb_strcmp8(key, "efi") == 0) {
-            sb_str8to16(target->efi_path, value, SB_MAX_PATH);
-            for (CHAR16 *c = target->efi_path; *c; c++)
-                if (*c == L'/') *c = L'\\';
+        switch (sb_kw_sdboot(key, key_len)) {
+        case SB_KW_SDBOOT_TITLE:
+            target->title = sb_intern8to16(pool, value);
+            break;
+        case SB_KW_SDBOOT_LINUX:
+            target->kernel_path = sb_intern16(pool, to_uefi_path(value, path));
+            break;
+        case SB_KW_SDBOOT_INITRD:
+            if (EFI_ERROR(sb_target_add_initrd(list, target,
+                                               to_uefi_path(value, path))))
+                return EFI_OUT_OF_RESOURCES;
+            break;
+        case SB_KW_SDBOOT_OPTIONS:
+            target->cmdline = sb_intern8(pool, value);
+            break;
+        case SB_KW_SDBOOT_EFI:
+            target->efi_path = sb_intern16(pool, to_uefi_path(value, path));
             target->is_chainload = TRUE;
+            break;
         }
-
-        p = sb_next_line(p);
     }
 
     return EFI_SUCCESS;
@@ -108,29 +89,25 @@ parse_entry_file(const CHAR8 *data, UINTN size,
 static EFI_STATUS
 systemd_boot_parse(const CHAR8 *config_data, UINTN config_size,
                    EFI_HANDLE device, const CHAR16 *config_path,
-                   BootTarget *targets, UINTN *count, UINTN max)
+                   BootTargetList *list, UINTN *count)
 {
     (void)config_size;
     *count = 0;
 
     /*
      * Parse loader.conf for global settings.
-     * We look for "default" and "timeout" lines.
+     * We look for the "default" line.
      */
     CHAR8 default_pattern[256] = {0};
+    CHAR8 value[sizeof(default_pattern)];
     CHAR8 *p = (CHAR8 *)config_data;
+    const CHAR8 *key;
+    UINTN key_len;
 
     while (*p) {
-        p = sb_skip_whitespace(p);
-        if (sb_starts_with8(p, "default")) {
-            p += 7;
-            p = sb_skip_whitespace(p);
-            UINTN i = 0;
-            while (*p && *p != '\n' && i + 1 < sizeof(default_pattern))
-                default_pattern[i++] = *p++;
-            default_pattern[i] = '\0';
-        }
-        p = sb_next_line(p);
+        p = sb_config_kv(p, 0, &key, &key_len, value, sizeof(value));
+        if (sb_kw_loader(key, key_len) == SB_KW_LOADER_DEFAULT)
+            sb_strcpy8(default_pattern, value, sizeof(default_pattern));
     }
 
     /*
@@ -189,8 +166,9 @@ systemd_boot_parse(const CHAR8 *config_data, UINTN config_size,
         if (EFI_ERROR(status))
             continue;
 
+        SbArenaMark mark = sb_arena_mark(&sb_scratch);
         UINTN file_size = (UINTN)info->FileSize;
-        CHAR8 *file_data = AllocatePool(file_size + 1);
+        CHAR8 *file_data = sb_arena_alloc(&sb_scratch, file_size + 1);
         if (!file_data) {
             entry_file->Close(entry_file);
             continue;
@@ -199,7 +177,7 @@ systemd_boot_parse(const CHAR8 *config_data, UINTN config_size,
         status = entry_file->Read(entry_file, &file_size, file_data);
         entry_file->Close(entry_file);
         if (EFI_ERROR(status)) {
-            FreePool(file_data);
+            sb_arena_reset(&sb_scratch, mark);
             continue;
         }
         file_data[file_size] = '\0';
@@ -210,26 +188,30 @@ systemd_boot_parse(const CHAR8 *config_data, UINTN config_size,
                L"\\loader\\entries\\%s", info->FileName);
 
         /* Parse the entry. */
-        if (*count < max) {
-            parse_entry_file(file_data, file_size, device,
-                             entry_path, &targets[*count]);
-            targets[*count].index = (UINT32)*count;
-
-            /* Mark default entry. */
-            if (default_pattern[0]) {
-                CHAR8 fname8[256];
-                sb_str16to8(fname8, info->FileName, sizeof(fname8));
-                if (sb_strstr8(fname8, default_pattern))
-                    targets[*count].is_default = TRUE;
-            }
-
-            /* Only count entries that have a kernel or chainload. */
-            if (targets[*count].kernel_path[0] ||
-                targets[*count].is_chainload)
-                (*count)++;
+        BootTarget *t = sb_targets_append(list);
+        if (!t) {
+            sb_arena_reset(&sb_scratch, mark);
+            break;
         }
+        status = parse_entry_file(file_data, file_size, device,
+                                  entry_path, list, t);
+        if (EFI_ERROR(status))
+            t->kernel_path = NULL;   /* incomplete: finish drops it */
+        t->index = (UINT32)*count;
+
+        /* Mark default entry. */
+        if (default_pattern[0]) {
+            CHAR8 fname8[256];
+            sb_str16to8(fname8, info->FileName, sizeof(fname8));
+            if (sb_strstr8(fname8, default_pattern))
+                t->is_default = TRUE;
+        }
+
+        /* Only keep entries that have a kernel or chainload. */
+        if (sb_targets_finish(list))
+            (*count)++;
 
-        FreePool(file_data);
+        sb_arena_reset(&sb_scratch, mark);
     }
 
     entries_dir->Close(entries_dir);
@@ -9,9 +9,11 @@
  *   1. Locate the SuperBoot binary on the current boot device.
  *   2. Find the internal ESP (GPT partition type C12A7328-...).
  *   3. Create \EFI\superboot\ directory on the ESP.
- *   4. Copy the binary.
- *   5. Create a UEFI Boot#### variable pointing to it.
- *   6. Optionally prepend it to BootOrder.
+ *   4. Copy the binary and the drivers\ directory, skipping files
+ *      already installed and verifying the rest.
+ *   5. Create a UEFI Boot#### variable pointing to it, or reuse the
+ *      one an earlier deployment made (nvram.c).
+ *   6. Put it first in BootOrder.
  */
 
 #include "deploy.h"
@@ -84,224 +86,353 @@ done:
 }
 
 /* ------------------------------------------------------------------ */
-/*  Copy file between ESPs                                             */
+/*  Copy files between ESPs                                            */
 /* ------------------------------------------------------------------ */
 
+/*
+ * Files are streamed through one DEPLOY_CHUNK buffer, never held whole.
+ * A file whose SHA-256 matches what is already on the target is left
+ * alone, so re-running a deployment of the same build writes nothing to
+ * the ESP's flash.  Otherwise the new copy goes to "<name>.new", is read
+ * back and checked against the source digest, and only then replaces
+ * the installed file:
+ *
+ *   name.new  --verify-->  name -> name.old,  name.new -> name,  rm name.old
+ *
+ * FAT cannot rename over an existing file, so the old copy is moved
+ * aside first; at every step a complete binary exists under one of the
+ * three names, and an interrupted deployment is finished by the next.
+ */
+
+#define DEPLOY_CHUNK  (64 * 1024)
+
+typedef struct {
+    SuperBootContext  *ctx;
+    EFI_FILE_PROTOCOL *src_root;
+    EFI_FILE_PROTOCOL *dst_root;
+    UINT8             *buf;            /* DEPLOY_CHUNK bytes */
+    UINTN              written;
+    UINTN              unchanged;
+} DeployJob;
+
+/* Hash `file` from the start; *size gets the number of bytes read. */
 static EFI_STATUS
-copy_self_to_esp(SuperBootContext *ctx, EFI_HANDLE target_esp)
+hash_file(DeployJob *job, EFI_FILE_PROTOCOL *file,
+          UINT8 digest[SB_SHA256_SIZE], UINT64 *size)
 {
-    EFI_STATUS status;
+    SbSha256 sha;
+    EFI_STATUS status = file->SetPosition(file, 0);
+    if (EFI_ERROR(status))
+        return status;
 
-    /* Open source: our own binary. */
-    EFI_LOADED_IMAGE_PROTOCOL *loaded;
-    status = ctx->boot_services->HandleProtocol(
-                 ctx->image_handle, &gEfiLoadedImageProtocolGuid,
-                 (void **)&loaded);
-    SB_CHECK(status, L"Cannot locate loaded image");
+    sb_sha256_init(&sha);
+    *size = 0;
+    for (;;) {
+        UINTN n = DEPLOY_CHUNK;
+        status = file->Read(file, &n, job->buf);
+        if (EFI_ERROR(status))
+            return status;
+        if (n == 0)
+            break;
+        sb_sha256_update(&sha, job->buf, n);
+        *size += n;
+    }
+    sb_sha256_final(&sha, digest);
+    return EFI_SUCCESS;
+}
 
-    /* Read our own binary. */
-    EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *src_fs;
-    status = ctx->boot_services->HandleProtocol(
-                 loaded->DeviceHandle,
-                 &gEfiSimpleFileSystemProtocolGuid,
-                 (void **)&src_fs);
-    SB_CHECK(status, L"Cannot open source FS");
+/* Does `path` on `root` already hold exactly these bytes? */
+static BOOLEAN
+same_content(DeployJob *job, EFI_FILE_PROTOCOL *root, CHAR16 *path,
+             const UINT8 digest[SB_SHA256_SIZE], UINT64 size)
+{
+    EFI_FILE_PROTOCOL *file;
+    if (EFI_ERROR(root->Open(root, &file, path, EFI_FILE_MODE_READ, 0)))
+        return FALSE;
 
-    EFI_FILE_PROTOCOL *src_root;
-    status = src_fs->OpenVolume(src_fs, &src_root);
-    SB_CHECK(status, L"Cannot open source volume");
+    UINT8  have[SB_SHA256_SIZE];
+    UINT64 have_size;
+    EFI_STATUS status = hash_file(job, file, have, &have_size);
+    file->Close(file);
 
-    /* Determine our file path from the loaded image. */
-    EFI_DEVICE_PATH_PROTOCOL *fp = loaded->FilePath;
-    CHAR16 *self_path = DevicePathToStr(fp);
-    if (!self_path)
-        return EFI_NOT_FOUND;
+    return !EFI_ERROR(status) && have_size == size &&
+           CompareMem(have, digest, SB_SHA256_SIZE) == 0;
+}
 
-    EFI_FILE_PROTOCOL *src_file;
-    status = src_root->Open(src_root, &src_file, self_path,
-                            EFI_FILE_MODE_READ, 0);
-    src_root->Close(src_root);
-    FreePool(self_path);
-    SB_CHECK(status, L"Cannot open self binary");
+/* Remove `path` if it exists. */
+static void
+remove_file(EFI_FILE_PROTOCOL *root, CHAR16 *path)
+{
+    EFI_FILE_PROTOCOL *file;
+    if (!EFI_ERROR(root->Open(root, &file, path,
+                              EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE, 0)))
+        file->Delete(file);             /* closes the handle */
+}
 
-    /* Get file size. */
-    UINT8 info_buf[256];
+/* Final component of a backslash-separated path. */
+static CHAR16 *
+leaf_name(CHAR16 *path)
+{
+    CHAR16 *leaf = path;
+    for (CHAR16 *p = path; *p; p++)
+        if (*p == L'\\')
+            leaf = p + 1;
+    return leaf;
+}
+
+/* Rename `path` within its directory to the leaf of `to`. */
+static EFI_STATUS
+rename_file(EFI_FILE_PROTOCOL *root, CHAR16 *path, CHAR16 *to)
+{
+    EFI_FILE_PROTOCOL *file;
+    EFI_STATUS status = root->Open(root, &file, path,
+                                   EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE,
+                                   0);
+    if (EFI_ERROR(status))
+        return status;
+
+    UINT8 info_buf[SIZE_OF_EFI_FILE_INFO + SB_MAX_PATH * sizeof(CHAR16)];
     UINTN info_size = sizeof(info_buf);
-    status = src_file->GetInfo(src_file, &gEfiFileInfoGuid,
-                               &info_size, info_buf);
-    SB_CHECK(status, L"Cannot stat self binary");
-    UINTN file_size = (UINTN)((EFI_FILE_INFO *)info_buf)->FileSize;
-
-    void *buf = AllocatePool(file_size);
-    if (!buf) {
-        src_file->Close(src_file);
-        return EFI_OUT_OF_RESOURCES;
+    status = file->GetInfo(file, &gEfiFileInfoGuid, &info_size, info_buf);
+    if (!EFI_ERROR(status)) {
+        EFI_FILE_INFO *info = (EFI_FILE_INFO *)info_buf;
+        CHAR16 *leaf = leaf_name(to);
+        UINTN name_size = (StrLen(leaf) + 1) * sizeof(CHAR16);
+        if (SIZE_OF_EFI_FILE_INFO + name_size > sizeof(info_buf)) {
+            status = EFI_BUFFER_TOO_SMALL;
+        } else {
+            CopyMem(info->FileName, leaf, name_size);
+            info->Size = SIZE_OF_EFI_FILE_INFO + name_size;
+            status = file->SetInfo(file, &gEfiFileInfoGuid,
+                                   (UINTN)info->Size, info);
+        }
     }
-    status = src_file->Read(src_file, &file_size, buf);
-    src_file->Close(src_file);
-    if (EFI_ERROR(status)) {
-        FreePool(buf);
+    file->Close(file);
+    return status;
+}
+
+/* Stream `src` into a fresh `tmp` and check that it reads back intact. */
+static EFI_STATUS
+write_verified(DeployJob *job, EFI_FILE_PROTOCOL *src, CHAR16 *tmp,
+               const UINT8 digest[SB_SHA256_SIZE], UINT64 size)
+{
+    EFI_FILE_PROTOCOL *dst_root = job->dst_root;
+    EFI_FILE_PROTOCOL *dst;
+
+    /* Left over from an interrupted run: start it again. */
+    remove_file(dst_root, tmp);
+
+    EFI_STATUS status = dst_root->Open(dst_root, &dst, tmp,
+                                       EFI_FILE_MODE_READ |
+                                       EFI_FILE_MODE_WRITE |
+                                       EFI_FILE_MODE_CREATE, 0);
+    if (EFI_ERROR(status))
         return status;
+
+    status = src->SetPosition(src, 0);
+    while (!EFI_ERROR(status)) {
+        UINTN n = DEPLOY_CHUNK;
+        status = src->Read(src, &n, job->buf);
+        if (EFI_ERROR(status) || n == 0)
+            break;
+        UINTN want = n;
+        status = dst->Write(dst, &n, job->buf);
+        if (!EFI_ERROR(status) && n != want)
+            status = EFI_VOLUME_FULL;
+    }
+    if (!EFI_ERROR(status))
+        status = dst->Flush(dst);
+
+    /* Read back what the medium now holds, not what we meant to write. */
+    if (!EFI_ERROR(status)) {
+        UINT8  got[SB_SHA256_SIZE];
+        UINT64 got_size;
+        status = hash_file(job, dst, got, &got_size);
+        if (!EFI_ERROR(status) &&
+            (got_size != size ||
+             CompareMem(got, digest, SB_SHA256_SIZE) != 0))
+            status = EFI_CRC_ERROR;
     }
 
-    /* Open destination ESP. */
-    EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *dst_fs;
-    status = ctx->boot_services->HandleProtocol(
-                 target_esp, &gEfiSimpleFileSystemProtocolGuid,
-                 (void **)&dst_fs);
-    if (EFI_ERROR(status)) {
-        FreePool(buf);
+    if (EFI_ERROR(status))
+        dst->Delete(dst);
+    else
+        dst->Close(dst);
+    return status;
+}
+
+/*
+ * Deploy one file: `src_path` on the source volume to `dst_path` on
+ * the target.  A missing source is reported as EFI_NOT_FOUND.
+ */
+static EFI_STATUS
+deploy_file(DeployJob *job, CHAR16 *src_path, CHAR16 *dst_path)
+{
+    EFI_FILE_PROTOCOL *src;
+    EFI_STATUS status = job->src_root->Open(job->src_root, &src, src_path,
+                                            EFI_FILE_MODE_READ, 0);
+    if (EFI_ERROR(status))
         return status;
+
+    UINT8  digest[SB_SHA256_SIZE];
+    UINT64 size;
+    status = hash_file(job, src, digest, &size);
+    if (EFI_ERROR(status))
+        goto out;
+
+    if (same_content(job, job->dst_root, dst_path, digest, size)) {
+        SB_DBG(job->ctx, L"  %s: up to date", dst_path);
+        job->unchanged++;
+        goto out;
     }
 
-    EFI_FILE_PROTOCOL *dst_root;
-    status = dst_fs->OpenVolume(dst_fs, &dst_root);
+    CHAR16 tmp[SB_MAX_PATH], old[SB_MAX_PATH];
+    SPrint(tmp, sizeof(tmp), L"%s.new", dst_path);
+    SPrint(old, sizeof(old), L"%s.old", dst_path);
+
+    status = write_verified(job, src, tmp, digest, size);
     if (EFI_ERROR(status)) {
-        FreePool(buf);
-        return status;
+        SB_LOG(L"  %s: write failed: %r", dst_path, status);
+        goto out;
     }
 
-    /* Create \EFI\superboot\ directory. */
-    EFI_FILE_PROTOCOL *dir;
-    status = dst_root->Open(dst_root, &dir, SB_DEPLOY_DIR,
-                            EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE |
-                            EFI_FILE_MODE_CREATE,
-                            EFI_FILE_DIRECTORY);
-    if (!EFI_ERROR(status))
-        dir->Close(dir);
-
-    /* Write the binary. */
-    EFI_FILE_PROTOCOL *dst_file;
-    status = dst_root->Open(dst_root, &dst_file, SB_DEPLOY_BINARY,
-                            EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE |
-                            EFI_FILE_MODE_CREATE, 0);
+    remove_file(job->dst_root, old);
+    EFI_STATUS moved = rename_file(job->dst_root, dst_path, old);
+    status = rename_file(job->dst_root, tmp, dst_path);
     if (EFI_ERROR(status)) {
-        dst_root->Close(dst_root);
-        FreePool(buf);
-        return status;
+        /* Put the previous copy back rather than leave nothing. */
+        if (!EFI_ERROR(moved))
+            rename_file(job->dst_root, old, dst_path);
+        SB_LOG(L"  %s: rename failed: %r", dst_path, status);
+        goto out;
     }
+    remove_file(job->dst_root, old);
 
-    status = dst_file->Write(dst_file, &file_size, buf);
-    dst_file->Close(dst_file);
-    dst_root->Close(dst_root);
-    FreePool(buf);
+    SB_DBG(job->ctx, L"  %s: %lu bytes written", dst_path, size);
+    job->written++;
 
+out:
+    src->Close(src);
     return status;
 }
 
-/* ------------------------------------------------------------------ */
-/*  Create a UEFI boot entry                                           */
-/* ------------------------------------------------------------------ */
+/* Create directory `path` on the target if it is not there yet. */
+static EFI_STATUS
+make_dir(EFI_FILE_PROTOCOL *root, CHAR16 *path)
+{
+    EFI_FILE_PROTOCOL *dir;
+    EFI_STATUS status = root->Open(root, &dir, path,
+                                   EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE |
+                                   EFI_FILE_MODE_CREATE,
+                                   EFI_FILE_DIRECTORY);
+    if (!EFI_ERROR(status))
+        dir->Close(dir);
+    return status;
+}
 
+/*
+ * Deploy every regular file in source directory `path` to the same
+ * path on the target.  A source without the directory is not an error.
+ */
 static EFI_STATUS
-create_boot_entry(SuperBootContext *ctx, EFI_HANDLE target_esp)
+deploy_dir(DeployJob *job, CHAR16 *path)
 {
-    /*
-     * Find a free Boot#### variable number.
-     * We scan Boot0000–Boot00FF looking for an unused slot.
-     */
-    UINT16 boot_num = 0xFFFF;
-    for (UINT16 i = 0; i <= 0x00FF; i++) {
-        CHAR16 varname[32];
-        SPrint(varname, sizeof(varname), L"Boot%04X", i);
-
-        UINTN size = 0;
-        EFI_STATUS s = ctx->runtime_services->GetVariable(
-                           varname, &gEfiGlobalVariableGuid,
-                           NULL, &size, NULL);
-        if (s == EFI_NOT_FOUND) {
-            boot_num = i;
-            break;
-        }
-    }
+    EFI_FILE_PROTOCOL *dir;
+    if (EFI_ERROR(job->src_root->Open(job->src_root, &dir, path,
+                                      EFI_FILE_MODE_READ, 0)))
+        return EFI_SUCCESS;
 
-    if (boot_num == 0xFFFF) {
-        SB_LOG(L"No free Boot#### slot found.");
-        return EFI_OUT_OF_RESOURCES;
-    }
+    EFI_STATUS status = make_dir(job->dst_root, path);
+    UINT8 info_buf[512];
 
-    /*
-     * Build the EFI_LOAD_OPTION structure.
-     * Layout: Attributes(4) + FilePathListLen(2) + Description(var) +
-     *         DevicePath(var)
-     */
-    EFI_DEVICE_PATH_PROTOCOL *dp = FileDevicePath(target_esp,
-                                                   SB_DEPLOY_BINARY);
-    if (!dp)
-        return EFI_OUT_OF_RESOURCES;
+    while (!EFI_ERROR(status)) {
+        UINTN buf_size = sizeof(info_buf);
+        if (EFI_ERROR(dir->Read(dir, &buf_size, info_buf)) || buf_size == 0)
+            break;
 
-    UINTN dp_size = DevicePathSize(dp);
-    UINTN desc_size = (StrLen(SB_DEPLOY_LABEL) + 1) * sizeof(CHAR16);
-    UINTN opt_size = 4 + 2 + desc_size + dp_size;
+        EFI_FILE_INFO *info = (EFI_FILE_INFO *)info_buf;
+        if (info->Attribute & EFI_FILE_DIRECTORY)
+            continue;
 
-    UINT8 *opt = AllocateZeroPool(opt_size);
-    if (!opt)
-        return EFI_OUT_OF_RESOURCES;
+        CHAR16 file_path[SB_MAX_PATH];
+        SPrint(file_path, sizeof(file_path), L"%s\\%s",
+               path, info->FileName);
+        status = deploy_file(job, file_path, file_path);
+    }
+
+    dir->Close(dir);
+    return status;
+}
 
-    UINT8 *p = opt;
+static EFI_STATUS
+copy_self_to_esp(SuperBootContext *ctx, EFI_HANDLE target_esp)
+{
+    EFI_STATUS status;
 
-    /* Attributes: LOAD_OPTION_ACTIVE */
-    *(UINT32 *)p = 0x00000001;
-    p += 4;
+    /* Open source: our own binary. */
+    EFI_LOADED_IMAGE_PROTOCOL *loaded;
+    status = ctx->boot_services->HandleProtocol(
+                 ctx->image_handle, &gEfiLoadedImageProtocolGuid,
+                 (void **)&loaded);
+    SB_CHECK(status, L"Cannot locate loaded image");
 
-    /* FilePathListLength */
-    *(UINT16 *)p = (UINT16)dp_size;
-    p += 2;
+    EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *src_fs;
+    status = ctx->boot_services->HandleProtocol(
+                 loaded->DeviceHandle,
+                 &gEfiSimpleFileSystemProtocolGuid,
+                 (void **)&src_fs);
+    SB_CHECK(status, L"Cannot open source FS");
 
-    /* Description */
-    CopyMem(p, SB_DEPLOY_LABEL, desc_size);
-    p += desc_size;
+    EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *dst_fs;
+    status = ctx->boot_services->HandleProtocol(
+                 target_esp, &gEfiSimpleFileSystemProtocolGuid,
+                 (void **)&dst_fs);
+    SB_CHECK(status, L"Cannot open target ESP");
 
-    /* Device path */
-    CopyMem(p, dp, dp_size);
+    /* Determine our file path from the loaded image. */
+    CHAR16 *self_path = DevicePathToStr(loaded->FilePath);
+    if (!self_path)
+        return EFI_NOT_FOUND;
 
-    CHAR16 varname[32];
-    SPrint(varname, sizeof(varname), L"Boot%04X", boot_num);
+    DeployJob job = { .ctx = ctx };
+    job.buf = sb_malloc(SB_MEM_DEPLOY, DEPLOY_CHUNK);
+    if (!job.buf) {
+        status = EFI_OUT_OF_RESOURCES;
+        goto out;
+    }
 
-    EFI_STATUS status = ctx->runtime_services->SetVariable(
-                            varname, &gEfiGlobalVariableGuid,
-                            EFI_VARIABLE_NON_VOLATILE |
-                            EFI_VARIABLE_BOOTSERVICE_ACCESS |
-                            EFI_VARIABLE_RUNTIME_ACCESS,
-                            opt_size, opt);
+    status = src_fs->OpenVolume(src_fs, &job.src_root);
+    if (EFI_ERROR(status))
+        goto out;
+    status = dst_fs->OpenVolume(dst_fs, &job.dst_root);
+    if (EFI_ERROR(status))
+        goto out;
 
-    FreePool(opt);
-    FreePool(dp);
+    status = make_dir(job.dst_root, SB_DEPLOY_DIR);
+    if (EFI_ERROR(status))
+        goto out;
 
+    /* The binary first: without it nothing else matters. */
+    status = deploy_file(&job, self_path, SB_DEPLOY_BINARY);
     if (EFI_ERROR(status))
-        return status;
+        goto out;
 
-    SB_LOG(L"Created boot entry: %s", varname);
-
-    /*
-     * Prepend to BootOrder.
-     */
-    UINTN order_size = 0;
-    ctx->runtime_services->GetVariable(
-        L"BootOrder", &gEfiGlobalVariableGuid, NULL, &order_size, NULL);
-
-    UINTN new_order_size = order_size + sizeof(UINT16);
-    UINT16 *new_order = AllocatePool(new_order_size);
-    if (!new_order)
-        return EFI_SUCCESS; /* Non-fatal: entry exists, just not ordered. */
-
-    new_order[0] = boot_num;
-    if (order_size > 0) {
-        UINT16 *old_order = (UINT16 *)(new_order + 1);
-        ctx->runtime_services->GetVariable(
-            L"BootOrder", &gEfiGlobalVariableGuid, NULL,
-            &order_size, old_order);
-    }
+    /* Filesystem drivers, so the installed copy reads what we read. */
+    status = deploy_dir(&job, SB_DEPLOY_DRIVERS);
+    if (EFI_ERROR(status))
+        goto out;
 
-    ctx->runtime_services->SetVariable(
-        L"BootOrder", &gEfiGlobalVariableGuid,
-        EFI_VARIABLE_NON_VOLATILE |
-        EFI_VARIABLE_BOOTSERVICE_ACCESS |
-        EFI_VARIABLE_RUNTIME_ACCESS,
-        new_order_size, new_order);
+    SB_LOG(L"%lu file(s) written, %lu already up to date.",
+           (UINT64)job.written, (UINT64)job.unchanged);
 
-    FreePool(new_order);
-    return EFI_SUCCESS;
+out:
+    if (job.dst_root)
+        job.dst_root->Close(job.dst_root);
+    if (job.src_root)
+        job.src_root->Close(job.src_root);
+    sb_free(job.buf);
+    FreePool(self_path);
+    return status;
 }
 
 /* ------------------------------------------------------------------ */
@@ -334,8 +465,15 @@ sb_deploy_to_esp(SuperBootContext *ctx)
 
     SB_LOG(L"Creating UEFI boot entry...");
 
-    status = create_boot_entry(ctx, esp);
+    EFI_DEVICE_PATH_PROTOCOL *dp = FileDevicePath(esp, SB_DEPLOY_BINARY);
+    if (!dp)
+        return EFI_OUT_OF_RESOURCES;
+    UINT16 boot_num;
+    status = sb_nvram_install_boot_option(ctx, SB_DEPLOY_LABEL, dp,
+                                          &boot_num);
+    FreePool(dp);
     SB_CHECK(status, L"Failed to create boot entry");
+    SB_LOG(L"NVRAM writes: %lu", (UINT64)sb_nvram_write_count());
 
     SB_LOG(L"Deployment complete. SuperBoot is now installed on the internal disk.");
     SB_LOG(L"Press any key to continue...");
@@ -8,10 +8,26 @@
 #include "../superboot.h"
 
 /*
- * Installation paths on the target ESP.
+ * Installation paths on the target ESP.  The drivers directory is
+ * copied from the same path on the source.
  */
-#define SB_DEPLOY_DIR    L"\\EFI\\superboot"
-#define SB_DEPLOY_BINARY L"\\EFI\\superboot\\superboot.efi"
-#define SB_DEPLOY_LABEL  L"SuperBoot"
+#define SB_DEPLOY_DIR     L"\\EFI\\superboot"
+#define SB_DEPLOY_BINARY  L"\\EFI\\superboot\\superboot.efi"
+#define SB_DEPLOY_DRIVERS L"\\EFI\\superboot\\drivers"
+#define SB_DEPLOY_LABEL   L"SuperBoot"
+
+/*
+ * sb_nvram_install_boot_option() — make sure a Boot#### entry with
+ * description `label` launches `dp`, and that it is first in
+ * BootOrder.  An existing entry for the same device path is reused.
+ * Sets *boot_num to the entry's number.
+ */
+EFI_STATUS sb_nvram_install_boot_option(SuperBootContext *ctx,
+                                        const CHAR16 *label,
+                                        EFI_DEVICE_PATH_PROTOCOL *dp,
+                                        UINT16 *boot_num);
+
+/* Number of SetVariable() calls made by the NVRAM module so far. */
+UINTN sb_nvram_write_count(void);
 
 #endif /* SUPERBOOT_DEPLOY_H */
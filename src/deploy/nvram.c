@@ -0,0 +1,274 @@
+/*
+ * nvram.c — Boot#### and BootOrder management
+ *
+ * NVRAM writes are slow, and on many machines every SetVariable()
+ * erases and rewrites a flash block, so this module writes only what
+ * has to change:
+ *
+ *   - The variable store is enumerated once with GetNextVariableName(),
+ *     recording which Boot#### numbers exist, instead of probing each
+ *     candidate number with GetVariable().
+ *   - A load option whose file path list is ours is reused; it is only
+ *     rewritten if its attributes or description differ.
+ *   - BootOrder is rewritten only if our entry is not already first.
+ *
+ * Every SetVariable() goes through nvram_set(), which counts them so
+ * the deployment can report how much it actually wrote.
+ */
+
+#include "deploy.h"
+
+#define LOAD_OPTION_ACTIVE  0x00000001
+
+#define NVRAM_ATTRS  (EFI_VARIABLE_NON_VOLATILE |        \
+                      EFI_VARIABLE_BOOTSERVICE_ACCESS |  \
+                      EFI_VARIABLE_RUNTIME_ACCESS)
+
+static UINTN nvram_writes;
+
+static EFI_STATUS
+nvram_set(SuperBootContext *ctx, CHAR16 *name, UINTN size, void *data)
+{
+    nvram_writes++;
+    return ctx->runtime_services->SetVariable(
+               name, &gEfiGlobalVariableGuid, NVRAM_ATTRS, size, data);
+}
+
+/*
+ * Read a global variable into a fresh pool buffer.  Returns NULL if it
+ * does not exist or cannot be read.
+ */
+static void *
+nvram_get(SuperBootContext *ctx, CHAR16 *name, UINTN *size)
+{
+    *size = 0;
+    EFI_STATUS s = ctx->runtime_services->GetVariable(
+                       name, &gEfiGlobalVariableGuid, NULL, size, NULL);
+    if (s != EFI_BUFFER_TOO_SMALL || *size == 0)
+        return NULL;
+
+    void *data = sb_malloc(SB_MEM_DEPLOY, *size);
+    if (!data)
+        return NULL;
+    s = ctx->runtime_services->GetVariable(
+            name, &gEfiGlobalVariableGuid, NULL, size, data);
+    if (EFI_ERROR(s)) {
+        sb_free(data);
+        return NULL;
+    }
+    return data;
+}
+
+/* "Boot####" with exactly four hex digits; returns the number or -1. */
+static INTN
+boot_option_number(const CHAR16 *name)
+{
+    static const CHAR16 prefix[] = L"Boot";
+    for (UINTN i = 0; i < 4; i++)
+        if (name[i] != prefix[i])
+            return -1;
+
+    INTN n = 0;
+    for (UINTN i = 4; i < 8; i++) {
+        CHAR16 c = name[i];
+        n <<= 4;
+        if (c >= L'0' && c <= L'9')
+            n |= c - L'0';
+        else if (c >= L'A' && c <= L'F')
+            n |= c - L'A' + 10;
+        else
+            return -1;          /* lower case is not a Boot#### name */
+    }
+    return name[8] == L'\0' ? n : -1;
+}
+
+/*
+ * The file path list of an EFI_LOAD_OPTION, or NULL if the option is
+ * malformed.  Layout: Attributes(4) + FilePathListLength(2) +
+ * Description(NUL-terminated CHAR16) + FilePathList + OptionalData.
+ */
+static const UINT8 *
+load_option_path(const UINT8 *opt, UINTN size, UINTN *path_size)
+{
+    if (size < 6)
+        return NULL;
+
+    UINTN off = 6;
+    for (;;) {
+        if (off + sizeof(CHAR16) > size)
+            return NULL;
+        CHAR16 c = *(const CHAR16 *)(opt + off);
+        off += sizeof(CHAR16);
+        if (c == L'\0')
+            break;
+    }
+
+    *path_size = *(const UINT16 *)(opt + 4);
+    if (*path_size > size - off)
+        return NULL;
+    return opt + off;
+}
+
+/*
+ * One pass over the variable store: note which Boot#### numbers are
+ * taken and find one whose file path list equals `path`.  `used` is a
+ * 0x10000-bit map.  Returns the matching number or -1.
+ */
+static INTN
+scan_boot_options(SuperBootContext *ctx, const void *path, UINTN path_size,
+                  UINT8 *used)
+{
+    UINTN   name_cap = 64 * sizeof(CHAR16);
+    CHAR16 *name = sb_zalloc(SB_MEM_DEPLOY, name_cap);
+    INTN    match = -1;
+    if (!name)
+        return -1;
+
+    for (;;) {
+        EFI_GUID guid;
+        UINTN    name_size = name_cap;
+        EFI_STATUS s = ctx->runtime_services->GetNextVariableName(
+                           &name_size, name, &guid);
+        if (s == EFI_BUFFER_TOO_SMALL) {
+            /* Grow, keeping the current name: it is the cursor. */
+            CHAR16 *bigger = sb_zalloc(SB_MEM_DEPLOY, name_size);
+            if (!bigger)
+                break;
+            sb_memcpy(bigger, name, name_cap);
+            sb_free(name);
+            name     = bigger;
+            name_cap = name_size;
+            continue;
+        }
+        if (EFI_ERROR(s))
+            break;              /* EFI_NOT_FOUND: end of the store */
+
+        if (CompareMem(&guid, &gEfiGlobalVariableGuid, sizeof(guid)) != 0)
+            continue;
+        INTN num = boot_option_number(name);
+        if (num < 0)
+            continue;
+        used[num >> 3] |= (UINT8)(1 << (num & 7));
+
+        if (match >= 0)
+            continue;
+        UINTN opt_size;
+        UINT8 *opt = nvram_get(ctx, name, &opt_size);
+        if (!opt)
+            continue;
+        UINTN have_size;
+        const UINT8 *have = load_option_path(opt, opt_size, &have_size);
+        if (have && have_size == path_size &&
+            CompareMem(have, path, path_size) == 0)
+            match = num;
+        sb_free(opt);
+    }
+
+    sb_free(name);
+    return match;
+}
+
+/* Make `num` the first entry of BootOrder, writing only if needed. */
+static EFI_STATUS
+put_first_in_boot_order(SuperBootContext *ctx, UINT16 num)
+{
+    UINTN   size;
+    UINT16 *order = nvram_get(ctx, L"BootOrder", &size);
+    UINTN   count = order ? size / sizeof(UINT16) : 0;
+
+    if (count > 0 && order[0] == num) {
+        sb_free(order);
+        return EFI_SUCCESS;
+    }
+
+    UINT16 *new_order = sb_malloc(SB_MEM_DEPLOY,
+                                  (count + 1) * sizeof(UINT16));
+    if (!new_order) {
+        sb_free(order);
+        return EFI_OUT_OF_RESOURCES;
+    }
+
+    UINTN n = 0;
+    new_order[n++] = num;
+    for (UINTN i = 0; i < count; i++)
+        if (order[i] != num)
+            new_order[n++] = order[i];
+
+    EFI_STATUS status = nvram_set(ctx, L"BootOrder",
+                                  n * sizeof(UINT16), new_order);
+    sb_free(new_order);
+    sb_free(order);
+    return status;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Public API                                                         */
+/* ------------------------------------------------------------------ */
+
+EFI_STATUS
+sb_nvram_install_boot_option(SuperBootContext *ctx, const CHAR16 *label,
+                             EFI_DEVICE_PATH_PROTOCOL *dp, UINT16 *boot_num)
+{
+    UINTN dp_size   = DevicePathSize(dp);
+    UINTN desc_size = (StrLen(label) + 1) * sizeof(CHAR16);
+    UINTN opt_size  = 4 + 2 + desc_size + dp_size;
+
+    UINT8 *opt  = sb_zalloc(SB_MEM_DEPLOY, opt_size);
+    UINT8 *used = sb_zalloc(SB_MEM_DEPLOY, 0x10000 / 8);
+    EFI_STATUS status = EFI_OUT_OF_RESOURCES;
+    if (!opt || !used)
+        goto out;
+
+    *(UINT32 *)opt       = LOAD_OPTION_ACTIVE;
+    *(UINT16 *)(opt + 4) = (UINT16)dp_size;
+    sb_memcpy(opt + 6, label, desc_size);
+    sb_memcpy(opt + 6 + desc_size, dp, dp_size);
+
+    INTN num = scan_boot_options(ctx, dp, dp_size, used);
+    CHAR16 varname[16];
+
+    if (num >= 0) {
+        /* Ours already: rewrite only if it has drifted. */
+        SPrint(varname, sizeof(varname), L"Boot%04X", (UINTN)num);
+        UINTN have_size;
+        UINT8 *have = nvram_get(ctx, varname, &have_size);
+        BOOLEAN same = have && have_size == opt_size &&
+                       CompareMem(have, opt, opt_size) == 0;
+        sb_free(have);
+        status = same ? EFI_SUCCESS
+                      : nvram_set(ctx, varname, opt_size, opt);
+        SB_LOG(L"Reusing boot entry %s%s", varname,
+               same ? L"" : L" (updated)");
+    } else {
+        for (num = 0; num < 0x10000; num++)
+            if (!(used[num >> 3] & (1 << (num & 7))))
+                break;
+        if (num == 0x10000) {
+            SB_LOG(L"No free Boot#### slot found.");
+            goto out;
+        }
+        SPrint(varname, sizeof(varname), L"Boot%04X", (UINTN)num);
+        status = nvram_set(ctx, varname, opt_size, opt);
+        if (!EFI_ERROR(status))
+            SB_LOG(L"Created boot entry: %s", varname);
+    }
+    if (EFI_ERROR(status))
+        goto out;
+
+    *boot_num = (UINT16)num;
+
+    /* The entry exists either way; a failed reorder is not fatal. */
+    if (EFI_ERROR(put_first_in_boot_order(ctx, (UINT16)num)))
+        SB_LOG(L"Could not update BootOrder.");
+
+out:
+    sb_free(used);
+    sb_free(opt);
+    return status;
+}
+
+UINTN
+sb_nvram_write_count(void)
+{
+    return nvram_writes;
+}
@@ -38,25 +38,9 @@ static EFI_STATUS
 btrfs_probe(EFI_BLOCK_IO_PROTOCOL *block_io, EFI_DISK_IO_PROTOCOL *disk_io)
 {
     BtrfsSuperblock sb;
-    EFI_STATUS status;
-
-    if (disk_io) {
-        status = disk_io->ReadDisk(
-            disk_io, block_io->Media->MediaId,
-            BTRFS_SUPERBLOCK_OFFSET, sizeof(sb), &sb);
-    } else {
-        UINT32 bs = block_io->Media->BlockSize;
-        UINTN  read_size = sizeof(sb) < bs ? bs : sizeof(sb);
-        void *tmp = AllocatePool(read_size);
-        if (!tmp) return EFI_OUT_OF_RESOURCES;
-        UINT64 lba = BTRFS_SUPERBLOCK_OFFSET / bs;
-        status = block_io->ReadBlocks(
-            block_io, block_io->Media->MediaId, lba, read_size, tmp);
-        if (!EFI_ERROR(status))
-            CopyMem(&sb, tmp, sizeof(sb));
-        FreePool(tmp);
-    }
-
+    EFI_STATUS status = sb_vfs_disk_read(block_io, disk_io,
+                                         BTRFS_SUPERBLOCK_OFFSET,
+                                         sizeof(sb), &sb);
     if (EFI_ERROR(status))
         return status;
 
@@ -74,9 +58,10 @@ btrfs_mount(EFI_BLOCK_IO_PROTOCOL *block_io, EFI_DISK_IO_PROTOCOL *disk_io,
 
 static EFI_STATUS
 btrfs_read_file(void *fs_context, const CHAR16 *path,
-                void **buffer, UINTN *size)
+                SbArena *arena, SbSha256 *hash, void **buffer, UINTN *size)
 {
-    (void)fs_context; (void)path; (void)buffer; (void)size;
+    (void)fs_context; (void)path; (void)arena; (void)hash;
+    (void)buffer; (void)size;
     return EFI_UNSUPPORTED;
 }
 
@@ -90,7 +75,7 @@ btrfs_dir_exists(void *fs_context, const CHAR16 *path)
 static void
 btrfs_unmount(void *fs_context)
 {
-    if (fs_context) FreePool(fs_context);
+    sb_free(fs_context);
 }
 
 VfsDriver sb_vfs_btrfs = {
@@ -149,9 +149,18 @@ typedef struct {
 #define EXT4_FT_REG_FILE  1
 #define EXT4_FT_DIR       2
 
+/* Inode mode. */
+#define EXT4_S_IFMT       0xF000
+#define EXT4_S_IFDIR      0x4000
+
 /* Inode flags. */
 #define EXT4_EXTENTS_FL   0x00080000
 
+/* Whole-file reads are issued in pieces of this size: large enough
+ * for NVMe to keep many commands in flight, small enough to hash
+ * each piece while it is still in cache. */
+#define EXT4_READ_CHUNK   (2 * 1024 * 1024)
+
 /* ------------------------------------------------------------------ */
 /*  Driver context                                                     */
 /* ------------------------------------------------------------------ */
@@ -169,47 +178,10 @@ typedef struct {
 /*  Block I/O helpers                                                  */
 /* ------------------------------------------------------------------ */
 
-static EFI_STATUS
-ext4_read_block(Ext4Context *c, UINT64 block, void *buf)
-{
-    UINT64 offset = block * c->block_size;
-    if (c->disk_io) {
-        return c->disk_io->ReadDisk(
-            c->disk_io, c->block_io->Media->MediaId,
-            offset, c->block_size, buf);
-    }
-    /* Fallback: use Block I/O with aligned reads. */
-    UINT64 lba = offset / c->block_io->Media->BlockSize;
-    return c->block_io->ReadBlocks(
-        c->block_io, c->block_io->Media->MediaId,
-        lba, c->block_size, buf);
-}
-
 static EFI_STATUS
 ext4_read_bytes(Ext4Context *c, UINT64 offset, UINTN size, void *buf)
 {
-    if (c->disk_io) {
-        return c->disk_io->ReadDisk(
-            c->disk_io, c->block_io->Media->MediaId,
-            offset, size, buf);
-    }
-    /* Block I/O fallback — read full blocks containing the range. */
-    UINT32 bs = c->block_io->Media->BlockSize;
-    UINT64 start_lba = offset / bs;
-    UINT64 end_lba = (offset + size + bs - 1) / bs;
-    UINTN  total = (UINTN)(end_lba - start_lba) * bs;
-
-    void *tmp = AllocatePool(total);
-    if (!tmp)
-        return EFI_OUT_OF_RESOURCES;
-
-    EFI_STATUS s = c->block_io->ReadBlocks(
-        c->block_io, c->block_io->Media->MediaId,
-        start_lba, total, tmp);
-    if (!EFI_ERROR(s))
-        CopyMem(buf, (UINT8 *)tmp + (offset % bs), size);
-    FreePool(tmp);
-    return s;
+    return sb_vfs_disk_read(c->block_io, c->disk_io, offset, size, buf);
 }
 
 /* ------------------------------------------------------------------ */
@@ -242,40 +214,85 @@ ext4_read_inode(Ext4Context *c, UINT32 ino, Ext4Inode *inode)
 /*  Extent tree traversal → read file data                             */
 /* ------------------------------------------------------------------ */
 
+/*
+ * Read `len` bytes at byte `offset` of a file.  Each extent overlapping
+ * the range is one device read; holes and uninitialized extents read
+ * as zeroes.
+ */
 static EFI_STATUS
-ext4_read_file_data(Ext4Context *c, Ext4Inode *inode,
-                    void *buf, UINT64 file_size)
+ext4_read_range(Ext4Context *c, Ext4Inode *inode,
+                UINT64 offset, UINTN len, UINT8 *buf)
 {
     if (!(inode->i_flags & EXT4_EXTENTS_FL))
-        return EFI_UNSUPPORTED; /* Only extent-based files. */
+        return EFI_UNSUPPORTED;
 
     Ext4ExtentHeader *eh = (Ext4ExtentHeader *)inode->i_block;
     if (eh->eh_magic != 0xF30A)
         return EFI_VOLUME_CORRUPTED;
-
     if (eh->eh_depth != 0)
         return EFI_UNSUPPORTED; /* TODO: handle index nodes. */
 
     Ext4Extent *ext = (Ext4Extent *)(eh + 1);
-    UINT8 *dst = (UINT8 *)buf;
-    UINT64 remaining = file_size;
+    UINT64 end = offset + len;
+    UINT64 pos = offset;          /* everything below is filled */
 
-    for (UINT16 i = 0; i < eh->eh_entries && remaining > 0; i++) {
-        UINT64 phys_block = ((UINT64)ext[i].ee_start_hi << 32)
-                            | ext[i].ee_start_lo;
+    for (UINT16 i = 0; i < eh->eh_entries && pos < end; i++) {
         UINT32 len_blocks = ext[i].ee_len;
-        /* High bit set means uninitialized (sparse). */
-        if (len_blocks > 32768) len_blocks -= 32768;
+        BOOLEAN uninit = len_blocks > 32768;
+        if (uninit) len_blocks -= 32768;
+
+        UINT64 ext_start = (UINT64)ext[i].ee_block * c->block_size;
+        UINT64 ext_end   = ext_start + (UINT64)len_blocks * c->block_size;
+        if (ext_end <= pos)
+            continue;
+        if (ext_start >= end)
+            break;
+
+        if (ext_start > pos) {
+            sb_memset(buf + (pos - offset), 0, (UINTN)(ext_start - pos));
+            pos = ext_start;
+        }
 
-        for (UINT32 b = 0; b < len_blocks && remaining > 0; b++) {
-            UINTN to_read = (remaining < c->block_size)
-                            ? (UINTN)remaining : c->block_size;
-            EFI_STATUS s = ext4_read_block(c, phys_block + b, dst);
+        UINTN n = (UINTN)((ext_end < end ? ext_end : end) - pos);
+        if (uninit) {
+            sb_memset(buf + (pos - offset), 0, n);
+        } else {
+            UINT64 phys = ((UINT64)ext[i].ee_start_hi << 32)
+                          | ext[i].ee_start_lo;
+            EFI_STATUS s = ext4_read_bytes(c,
+                               phys * c->block_size + (pos - ext_start),
+                               n, buf + (pos - offset));
             if (EFI_ERROR(s))
                 return s;
-            dst += to_read;
-            remaining -= to_read;
         }
+        pos += n;
+    }
+
+    if (pos < end)
+        sb_memset(buf + (pos - offset), 0, (UINTN)(end - pos));
+    return EFI_SUCCESS;
+}
+
+/*
+ * Read a whole file, EXT4_READ_CHUNK bytes at a time so each extent
+ * goes to the device as a few large requests rather than one per
+ * block.  The hash is fed after each chunk, while it is still warm.
+ */
+static EFI_STATUS
+ext4_read_file_data(Ext4Context *c, Ext4Inode *inode,
+                    void *buf, UINT64 file_size, SbSha256 *hash)
+{
+    UINT8 *dst = (UINT8 *)buf;
+
+    for (UINT64 pos = 0; pos < file_size; ) {
+        UINTN n = file_size - pos < EXT4_READ_CHUNK
+                  ? (UINTN)(file_size - pos) : EXT4_READ_CHUNK;
+        EFI_STATUS s = ext4_read_range(c, inode, pos, n, dst + pos);
+        if (EFI_ERROR(s))
+            return s;
+        if (hash)
+            sb_sha256_update(hash, dst + pos, n);
+        pos += n;
     }
 
     return EFI_SUCCESS;
@@ -291,12 +308,13 @@ ext4_dir_lookup(Ext4Context *c, Ext4Inode *dir_inode, const CHAR8 *name)
     UINT64 dir_size = ((UINT64)dir_inode->i_size_high << 32)
                       | dir_inode->i_size_lo;
 
-    void *dir_data = AllocatePool((UINTN)dir_size);
+    SbArenaMark mark = sb_arena_mark(&sb_scratch);
+    void *dir_data = sb_arena_alloc(&sb_scratch, (UINTN)dir_size);
     if (!dir_data)
         return 0;
 
-    if (EFI_ERROR(ext4_read_file_data(c, dir_inode, dir_data, dir_size))) {
-        FreePool(dir_data);
+    if (EFI_ERROR(ext4_read_file_data(c, dir_inode, dir_data, dir_size, NULL))) {
+        sb_arena_reset(&sb_scratch, mark);
         return 0;
     }
 
@@ -318,7 +336,7 @@ ext4_dir_lookup(Ext4Context *c, Ext4Inode *dir_inode, const CHAR8 *name)
         p += de->rec_len;
     }
 
-    FreePool(dir_data);
+    sb_arena_reset(&sb_scratch, mark);
     return result;
 }
 
@@ -372,27 +390,9 @@ static EFI_STATUS
 ext4_probe(EFI_BLOCK_IO_PROTOCOL *block_io, EFI_DISK_IO_PROTOCOL *disk_io)
 {
     Ext4Superblock sb;
-    EFI_STATUS status;
-
-    if (disk_io) {
-        status = disk_io->ReadDisk(
-            disk_io, block_io->Media->MediaId,
-            EXT4_SUPERBLOCK_OFFSET, sizeof(sb), &sb);
-    } else {
-        /* Read via Block I/O — need a full sector. */
-        UINT32 bs = block_io->Media->BlockSize;
-        void *tmp = AllocatePool(bs < 2048 ? 2048 : bs);
-        if (!tmp)
-            return EFI_OUT_OF_RESOURCES;
-        status = block_io->ReadBlocks(
-            block_io, block_io->Media->MediaId,
-            EXT4_SUPERBLOCK_OFFSET / bs, bs < 2048 ? 2048 : bs, tmp);
-        if (!EFI_ERROR(status))
-            CopyMem(&sb, (UINT8 *)tmp + (EXT4_SUPERBLOCK_OFFSET % bs),
-                    sizeof(sb));
-        FreePool(tmp);
-    }
-
+    EFI_STATUS status = sb_vfs_disk_read(block_io, disk_io,
+                                         EXT4_SUPERBLOCK_OFFSET,
+                                         sizeof(sb), &sb);
     if (EFI_ERROR(status))
         return status;
 
@@ -403,7 +403,7 @@ static EFI_STATUS
 ext4_mount(EFI_BLOCK_IO_PROTOCOL *block_io, EFI_DISK_IO_PROTOCOL *disk_io,
            void **fs_context)
 {
-    Ext4Context *c = AllocateZeroPool(sizeof(Ext4Context));
+    Ext4Context *c = sb_zalloc(SB_MEM_VFS, sizeof(Ext4Context));
     if (!c)
         return EFI_OUT_OF_RESOURCES;
 
@@ -413,13 +413,15 @@ ext4_mount(EFI_BLOCK_IO_PROTOCOL *block_io, EFI_DISK_IO_PROTOCOL *disk_io,
     /* Read superblock. */
     EFI_STATUS s = ext4_probe(block_io, disk_io);
     if (EFI_ERROR(s)) {
-        FreePool(c);
+        sb_free(c);
         return s;
     }
 
-    if (disk_io) {
-        disk_io->ReadDisk(disk_io, block_io->Media->MediaId,
-                          EXT4_SUPERBLOCK_OFFSET, sizeof(c->sb), &c->sb);
+    s = sb_vfs_disk_read(block_io, disk_io, EXT4_SUPERBLOCK_OFFSET,
+                         sizeof(c->sb), &c->sb);
+    if (EFI_ERROR(s)) {
+        sb_free(c);
+        return s;
     }
 
     c->block_size = 1024U << c->sb.s_log_block_size;
@@ -432,7 +434,7 @@ ext4_mount(EFI_BLOCK_IO_PROTOCOL *block_io, EFI_DISK_IO_PROTOCOL *disk_io,
 
 static EFI_STATUS
 ext4_read_file(void *fs_context, const CHAR16 *path,
-               void **buffer, UINTN *size)
+               SbArena *arena, SbSha256 *hash, void **buffer, UINTN *size)
 {
     Ext4Context *c = (Ext4Context *)fs_context;
 
@@ -447,13 +449,13 @@ ext4_read_file(void *fs_context, const CHAR16 *path,
 
     UINT64 file_size = ((UINT64)inode.i_size_high << 32) | inode.i_size_lo;
     *size = (UINTN)file_size;
-    *buffer = AllocatePool(*size + 1);
+    *buffer = sb_vfs_alloc(arena, *size + 1);
     if (!*buffer)
         return EFI_OUT_OF_RESOURCES;
 
-    s = ext4_read_file_data(c, &inode, *buffer, file_size);
+    s = ext4_read_file_data(c, &inode, *buffer, file_size, hash);
     if (EFI_ERROR(s)) {
-        FreePool(*buffer);
+        sb_vfs_free(arena, *buffer);
         *buffer = NULL;
         return s;
     }
@@ -462,6 +464,104 @@ ext4_read_file(void *fs_context, const CHAR16 *path,
     return EFI_SUCCESS;
 }
 
+static EFI_STATUS
+ext4_open_file(void *fs_context, const CHAR16 *path,
+               void **file, UINT64 *size)
+{
+    Ext4Context *c = (Ext4Context *)fs_context;
+
+    UINT32 ino = ext4_resolve_path(c, path);
+    if (ino == 0)
+        return EFI_NOT_FOUND;
+
+    Ext4Inode *inode = sb_malloc(SB_MEM_VFS, sizeof(*inode));
+    if (!inode)
+        return EFI_OUT_OF_RESOURCES;
+
+    EFI_STATUS s = ext4_read_inode(c, ino, inode);
+    if (EFI_ERROR(s)) {
+        sb_free(inode);
+        return s;
+    }
+
+    *file = inode;
+    *size = ((UINT64)inode->i_size_high << 32) | inode->i_size_lo;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS
+ext4_read_at(void *fs_context, void *file,
+             UINT64 offset, UINTN len, void *buf)
+{
+    return ext4_read_range((Ext4Context *)fs_context, (Ext4Inode *)file,
+                           offset, len, buf);
+}
+
+static void
+ext4_close_file(void *fs_context, void *file)
+{
+    sb_free(file);
+}
+
+static EFI_STATUS
+ext4_read_dir(void *fs_context, const CHAR16 *path,
+              SbVfsDirFn fn, void *data)
+{
+    Ext4Context *c = (Ext4Context *)fs_context;
+
+    UINT32 ino = ext4_resolve_path(c, path);
+    if (ino == 0)
+        return EFI_NOT_FOUND;
+
+    Ext4Inode dir;
+    EFI_STATUS s = ext4_read_inode(c, ino, &dir);
+    if (EFI_ERROR(s))
+        return s;
+    if ((dir.i_mode & EXT4_S_IFMT) != EXT4_S_IFDIR)
+        return EFI_NOT_FOUND;
+
+    UINT64 dir_size = ((UINT64)dir.i_size_high << 32) | dir.i_size_lo;
+
+    SbArenaMark mark = sb_arena_mark(&sb_scratch);
+    UINT8 *dir_data = sb_arena_alloc(&sb_scratch, (UINTN)dir_size);
+    if (!dir_data)
+        return EFI_OUT_OF_RESOURCES;
+
+    s = ext4_read_file_data(c, &dir, dir_data, dir_size, NULL);
+    if (EFI_ERROR(s)) {
+        sb_arena_reset(&sb_scratch, mark);
+        return s;
+    }
+
+    /* Sizes would cost an inode read per entry: not reported.  Hash
+     * tree index blocks look like one empty entry and are skipped. */
+    UINT8 *p = dir_data, *end = dir_data + (UINTN)dir_size;
+    while (p + 8 <= end) {
+        Ext4DirEntry2 *de = (Ext4DirEntry2 *)p;
+        if (de->rec_len < 8 || p + de->rec_len > end)
+            break;
+        p += de->rec_len;
+
+        if (de->inode == 0 || de->name_len == 0 ||
+            (de->name_len == 1 && de->name[0] == '.') ||
+            (de->name_len == 2 && de->name[0] == '.' && de->name[1] == '.'))
+            continue;
+
+        CHAR8  name8[256];
+        CHAR16 name[256];
+        sb_memcpy(name8, de->name, de->name_len);
+        name8[de->name_len] = '\0';
+        sb_str8to16(name, name8, 256);
+
+        if (!fn(data, name, de->file_type == EXT4_FT_DIR,
+                SB_VFS_SIZE_UNKNOWN))
+            break;
+    }
+
+    sb_arena_reset(&sb_scratch, mark);
+    return EFI_SUCCESS;
+}
+
 static EFI_STATUS
 ext4_dir_exists(void *fs_context, const CHAR16 *path)
 {
@@ -473,8 +573,7 @@ ext4_dir_exists(void *fs_context, const CHAR16 *path)
 static void
 ext4_unmount(void *fs_context)
 {
-    if (fs_context)
-        FreePool(fs_context);
+    sb_free(fs_context);
 }
 
 /* ------------------------------------------------------------------ */
@@ -486,6 +585,10 @@ VfsDriver sb_vfs_ext4 = {
     .probe      = ext4_probe,
     .mount      = ext4_mount,
     .read_file  = ext4_read_file,
+    .open_file  = ext4_open_file,
+    .read_at    = ext4_read_at,
+    .close_file = ext4_close_file,
+    .read_dir   = ext4_read_dir,
     .dir_exists = ext4_dir_exists,
     .unmount    = ext4_unmount,
 };
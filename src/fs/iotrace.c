@@ -0,0 +1,240 @@
+/*
+ * iotrace.c — Block I/O record-and-replay tracing
+ *
+ * With the "iotrace" load option, every read issued through
+ * sb_vfs_disk_read() is appended to an in-memory log: device, byte
+ * offset, length, issue timestamp, latency and a CRC32 of the data
+ * returned.  sb_vfs_shutdown() writes the log to SB_IOTRACE_PATH on
+ * the SuperBoot ESP just before hand-off.
+ *
+ * Offline, tools/iotrace.py dumps a trace, captures the byte ranges
+ * it touched from a disk into a sparse metadata image, and replays
+ * the access pattern against that image with the recorded (or a
+ * modelled) per-request latency.
+ *
+ * Reads served by UEFI-native SimpleFileSystem drivers (FAT ESPs,
+ * external .efi drivers) never reach our block layer and are not
+ * part of the trace.
+ */
+
+#include "iotrace.h"
+
+/* ------------------------------------------------------------------ */
+/*  Recorder state                                                     */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    EFI_BLOCK_IO_PROTOCOL *block_io;
+    IoTraceDevice          info;
+} TraceDevice;
+
+static SuperBootContext *trace_ctx;
+static IoTraceRecord    *records;
+static UINT32            record_count;
+static UINT32            dropped;
+static TraceDevice       devices[SB_IOTRACE_MAX_DEVICES];
+static UINT32            device_count;
+
+EFI_STATUS
+sb_iotrace_start(SuperBootContext *ctx)
+{
+    if (records)
+        return EFI_SUCCESS;
+
+    records = sb_malloc(SB_MEM_TRACE,
+                        SB_IOTRACE_MAX_RECORDS * sizeof(IoTraceRecord));
+    if (!records)
+        return EFI_OUT_OF_RESOURCES;
+
+    trace_ctx    = ctx;
+    record_count = 0;
+    dropped      = 0;
+    device_count = 0;
+
+    SB_LOG(L"I/O trace enabled (up to %u requests)", SB_IOTRACE_MAX_RECORDS);
+    return EFI_SUCCESS;
+}
+
+BOOLEAN
+sb_iotrace_active(void)
+{
+    return records != NULL;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Device table                                                       */
+/* ------------------------------------------------------------------ */
+
+static INTN
+find_device(EFI_BLOCK_IO_PROTOCOL *block_io)
+{
+    for (UINT32 i = 0; i < device_count; i++) {
+        if (devices[i].block_io == block_io)
+            return (INTN)i;
+    }
+
+    if (device_count >= SB_IOTRACE_MAX_DEVICES)
+        return -1;
+
+    TraceDevice *d = &devices[device_count];
+    SetMem(d, sizeof(*d), 0);
+    d->block_io        = block_io;
+    d->info.media_id   = block_io->Media->MediaId;
+    d->info.block_size = block_io->Media->BlockSize;
+    d->info.last_block = block_io->Media->LastBlock;
+    return (INTN)device_count++;
+}
+
+void
+sb_iotrace_add_device(EFI_HANDLE device, EFI_BLOCK_IO_PROTOCOL *block_io)
+{
+    if (!records)
+        return;
+
+    INTN idx = find_device(block_io);
+    if (idx < 0)
+        return;
+
+    EFI_DEVICE_PATH_PROTOCOL *dp = DevicePathFromHandle(device);
+    if (!dp)
+        return;
+
+    CHAR16 *text = DevicePathToStr(dp);
+    if (!text)
+        return;
+
+    sb_str16to8(devices[idx].info.path, text,
+                sizeof(devices[idx].info.path));
+    FreePool(text);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Recording                                                          */
+/* ------------------------------------------------------------------ */
+
+void
+sb_iotrace_record(EFI_BLOCK_IO_PROTOCOL *block_io,
+                  UINT64 offset, UINTN size, const void *buf,
+                  UINT64 start_us, UINT8 flags, EFI_STATUS status)
+{
+    if (!records)
+        return;
+
+    UINT64 end_us = sb_time_us();
+
+    INTN dev = find_device(block_io);
+    if (dev < 0 || record_count >= SB_IOTRACE_MAX_RECORDS) {
+        dropped++;
+        return;
+    }
+
+    IoTraceRecord *r = &records[record_count++];
+    r->start_us   = start_us;
+    r->offset     = offset;
+    r->length     = (UINT32)size;
+    r->latency_us = (UINT32)(end_us - start_us);
+    r->crc32      = 0;
+    r->device     = (UINT16)dev;
+    r->flags      = flags;
+    r->status     = (UINT8)(status & 0xFF);
+
+    /* The CRC lets the replayer verify that a captured image really
+     * holds the bytes the firmware returned at record time. */
+    if (!EFI_ERROR(status) && buf)
+        gBS->CalculateCrc32((void *)buf, size, &r->crc32);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Writing the trace to the ESP                                       */
+/* ------------------------------------------------------------------ */
+
+static EFI_STATUS
+write_all(EFI_FILE_PROTOCOL *file, const void *data, UINTN size)
+{
+    UINTN n = size;
+    EFI_STATUS s = file->Write(file, &n, (void *)data);
+    if (!EFI_ERROR(s) && n != size)
+        s = EFI_VOLUME_FULL;
+    return s;
+}
+
+EFI_STATUS
+sb_iotrace_flush(void)
+{
+    if (!records)
+        return EFI_NOT_STARTED;
+
+    SuperBootContext *ctx = trace_ctx;
+    EFI_STATUS status;
+
+    EFI_LOADED_IMAGE_PROTOCOL *loaded;
+    status = ctx->boot_services->HandleProtocol(
+                 ctx->image_handle, &gEfiLoadedImageProtocolGuid,
+                 (void **)&loaded);
+    if (EFI_ERROR(status))
+        goto out;
+
+    EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *fs;
+    status = ctx->boot_services->HandleProtocol(
+                 loaded->DeviceHandle, &gEfiSimpleFileSystemProtocolGuid,
+                 (void **)&fs);
+    if (EFI_ERROR(status))
+        goto out;
+
+    EFI_FILE_PROTOCOL *root, *file;
+    status = fs->OpenVolume(fs, &root);
+    if (EFI_ERROR(status))
+        goto out;
+
+    /* Started from \EFI\BOOT, the directory may not exist yet. */
+    status = root->Open(root, &file, SB_IOTRACE_DIR,
+                        EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE |
+                        EFI_FILE_MODE_CREATE, EFI_FILE_DIRECTORY);
+    if (EFI_ERROR(status)) {
+        root->Close(root);
+        goto out;
+    }
+    file->Close(file);
+
+    /* Replace any trace left over from a previous boot. */
+    status = root->Open(root, &file, SB_IOTRACE_PATH,
+                        EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE, 0);
+    if (!EFI_ERROR(status))
+        file->Delete(file);
+
+    status = root->Open(root, &file, SB_IOTRACE_PATH,
+                        EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE |
+                        EFI_FILE_MODE_CREATE, 0);
+    root->Close(root);
+    if (EFI_ERROR(status))
+        goto out;
+
+    IoTraceHeader hdr;
+    SetMem(&hdr, sizeof(hdr), 0);
+    CopyMem(hdr.magic, SB_IOTRACE_MAGIC, sizeof(SB_IOTRACE_MAGIC));
+    hdr.version      = SB_IOTRACE_VERSION;
+    hdr.device_count = device_count;
+    hdr.record_count = record_count;
+    hdr.dropped      = dropped;
+
+    status = write_all(file, &hdr, sizeof(hdr));
+    for (UINT32 i = 0; i < device_count && !EFI_ERROR(status); i++)
+        status = write_all(file, &devices[i].info, sizeof(IoTraceDevice));
+    if (!EFI_ERROR(status))
+        status = write_all(file, records,
+                           record_count * sizeof(IoTraceRecord));
+
+    file->Close(file);
+
+    if (!EFI_ERROR(status))
+        SB_LOG(L"I/O trace: %u requests on %u devices written to %s",
+               record_count, device_count, SB_IOTRACE_PATH);
+
+out:
+    if (EFI_ERROR(status))
+        SB_LOG(L"WARN: could not write I/O trace: %r", status);
+
+    sb_free(records);
+    records = NULL;
+    return status;
+}
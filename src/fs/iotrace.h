@@ -0,0 +1,91 @@
+/*
+ * iotrace.h — Block I/O trace file format
+ *
+ * A trace is written to SB_IOTRACE_PATH on the SuperBoot ESP when the
+ * "iotrace" load option is given.  Layout (all little-endian, packed):
+ *
+ *   IoTraceHeader
+ *   IoTraceDevice  [header.device_count]
+ *   IoTraceRecord  [header.record_count]
+ *
+ * tools/iotrace.py reads this format; keep the two in sync and bump
+ * SB_IOTRACE_VERSION on any change.
+ */
+
+#ifndef SUPERBOOT_IOTRACE_H
+#define SUPERBOOT_IOTRACE_H
+
+#include "../superboot.h"
+
+#define SB_IOTRACE_DIR          L"\\EFI\\superboot"
+#define SB_IOTRACE_PATH         L"\\EFI\\superboot\\iotrace.bin"
+#define SB_IOTRACE_MAGIC        "SBIOTRC"
+#define SB_IOTRACE_VERSION      1
+#define SB_IOTRACE_MAX_RECORDS  65536  /* 2 MiB of records            */
+#define SB_IOTRACE_MAX_DEVICES  64
+
+/* Record flags: which firmware path served the request. */
+#define IOTRACE_F_DISK_IO       0x01   /* EFI_DISK_IO_PROTOCOL          */
+#define IOTRACE_F_BLOCK_IO      0x02   /* EFI_BLOCK_IO_PROTOCOL, direct */
+#define IOTRACE_F_BOUNCE        0x04   /* Block I/O via bounce buffer   */
+#define IOTRACE_F_NVME          0x08   /* queued NVMe PassThru commands */
+
+#pragma pack(1)
+
+typedef struct {
+    CHAR8   magic[8];           /* "SBIOTRC\0"                        */
+    UINT32  version;
+    UINT32  device_count;
+    UINT32  record_count;
+    UINT32  dropped;            /* records lost to a full buffer      */
+} IoTraceHeader;
+
+typedef struct {
+    UINT32  media_id;
+    UINT32  block_size;
+    UINT64  last_block;
+    CHAR8   path[112];          /* device path text, NUL-terminated   */
+} IoTraceDevice;
+
+typedef struct {
+    UINT64  start_us;           /* sb_time_us() when issued           */
+    UINT64  offset;             /* byte offset within the partition   */
+    UINT32  length;             /* bytes requested                    */
+    UINT32  latency_us;
+    UINT32  crc32;              /* of the returned data (0 on error)  */
+    UINT16  device;             /* index into the device table        */
+    UINT8   flags;              /* IOTRACE_F_*                        */
+    UINT8   status;             /* low byte of the EFI_STATUS         */
+} IoTraceRecord;
+
+#pragma pack()
+
+_Static_assert(sizeof(IoTraceHeader) == 24, "trace header layout");
+_Static_assert(sizeof(IoTraceDevice) == 128, "trace device layout");
+_Static_assert(sizeof(IoTraceRecord) == 32, "trace record layout");
+
+/* ------------------------------------------------------------------ */
+/*  Recorder API (iotrace.c)                                           */
+/* ------------------------------------------------------------------ */
+
+/* Allocate the record buffer and start tracing. */
+EFI_STATUS sb_iotrace_start(SuperBootContext *ctx);
+
+/* TRUE while a trace is being recorded. */
+BOOLEAN    sb_iotrace_active(void);
+
+/* Associate a partition handle with its Block I/O instance so the
+ * device table carries a human-readable device path. */
+void       sb_iotrace_add_device(EFI_HANDLE device,
+                                 EFI_BLOCK_IO_PROTOCOL *block_io);
+
+/* Append one completed request. */
+void       sb_iotrace_record(EFI_BLOCK_IO_PROTOCOL *block_io,
+                             UINT64 offset, UINTN size, const void *buf,
+                             UINT64 start_us, UINT8 flags,
+                             EFI_STATUS status);
+
+/* Write the trace to SB_IOTRACE_PATH and stop recording. */
+EFI_STATUS sb_iotrace_flush(void);
+
+#endif /* SUPERBOOT_IOTRACE_H */
@@ -13,22 +13,8 @@ static EFI_STATUS
 ntfs_probe(EFI_BLOCK_IO_PROTOCOL *block_io, EFI_DISK_IO_PROTOCOL *disk_io)
 {
     UINT8 sector[512];
-    EFI_STATUS status;
-
-    if (disk_io) {
-        status = disk_io->ReadDisk(
-            disk_io, block_io->Media->MediaId, 0, 512, sector);
-    } else {
-        UINT32 bs = block_io->Media->BlockSize;
-        void *tmp = AllocatePool(bs);
-        if (!tmp) return EFI_OUT_OF_RESOURCES;
-        status = block_io->ReadBlocks(
-            block_io, block_io->Media->MediaId, 0, bs, tmp);
-        if (!EFI_ERROR(status))
-            CopyMem(sector, tmp, 512);
-        FreePool(tmp);
-    }
-
+    EFI_STATUS status = sb_vfs_disk_read(block_io, disk_io, 0,
+                                         sizeof(sector), sector);
     if (EFI_ERROR(status))
         return status;
 
@@ -44,15 +30,16 @@ ntfs_mount(EFI_BLOCK_IO_PROTOCOL *b, EFI_DISK_IO_PROTOCOL *d, void **c)
 { (void)b; (void)d; (void)c; return EFI_UNSUPPORTED; }
 
 static EFI_STATUS
-ntfs_read_file(void *c, const CHAR16 *p, void **buf, UINTN *sz)
-{ (void)c; (void)p; (void)buf; (void)sz; return EFI_UNSUPPORTED; }
+ntfs_read_file(void *c, const CHAR16 *p, SbArena *a, SbSha256 *h,
+               void **buf, UINTN *sz)
+{ (void)c; (void)p; (void)a; (void)h; (void)buf; (void)sz; return EFI_UNSUPPORTED; }
 
 static EFI_STATUS
 ntfs_dir_exists(void *c, const CHAR16 *p)
 { (void)c; (void)p; return EFI_UNSUPPORTED; }
 
 static void
-ntfs_unmount(void *c) { if (c) FreePool(c); }
+ntfs_unmount(void *c) { sb_free(c); }
 
 VfsDriver sb_vfs_ntfs = {
     .name       = L"ntfs",
@@ -0,0 +1,413 @@
+/*
+ * nvme.c — Queued NVMe reads through the NVM Express Pass Thru protocol
+ *
+ * A large read is cut into Read commands of at most max_xfer bytes
+ * (the controller's MDTS, capped at NVME_MAX_XFER) and submitted with
+ * an event, so PassThru() returns as soon as the command is queued.
+ * Up to NVME_QUEUE_DEPTH commands are kept outstanding; completed
+ * slots are found with CheckEvent() and refilled until the request is
+ * done.  The commands write straight into the caller's buffer.
+ *
+ * Any failure — a rejected submission, an error status, a command
+ * that does not complete within NVME_TIMEOUT_US — disables the device
+ * and returns EFI_UNSUPPORTED, and the VFS repeats the read through
+ * Block I/O.  After a timeout the firmware may still own the slots,
+ * so the backend stays off for every device from then on.
+ */
+
+#include "nvme.h"
+
+#define NVME_MAX_DEVICES    32
+#define NVME_QUEUE_DEPTH    16
+#define NVME_MAX_XFER       (128 * 1024)
+#define NVME_PAGE_SIZE      4096U           /* MDTS unit (CAP.MPSMIN) */
+#define NVME_TIMEOUT_US     (5 * 1000 * 1000)
+
+/* Identify (CNS 01h): controller data structure, MDTS at byte 77. */
+#define NVME_CNS_CONTROLLER 1
+#define NVME_ID_MDTS        77
+
+/* Completion DW3 bits 27:17: status code and status code type. */
+#define NVME_CPL_STATUS(dw3)  (((dw3) >> 17) & 0x7FF)
+
+/* "bench": bytes read per pass, and per request. */
+#define NVME_BENCH_BYTES    (32 * 1024 * 1024)
+#define NVME_BENCH_REQUEST  (4 * 1024 * 1024)
+
+static EFI_GUID NvmePassThruGuid = SB_NVME_PASS_THRU_PROTOCOL_GUID;
+
+typedef struct {
+    EFI_BLOCK_IO_PROTOCOL       *block_io;      /* lookup key          */
+    SB_NVME_PASS_THRU_PROTOCOL  *pt;
+    UINT32                       nsid;
+    UINT32                       block_size;
+    UINT64                       first_lba;     /* partition start     */
+    UINT32                       max_xfer;      /* bytes per command   */
+    BOOLEAN                      disabled;      /* Block I/O only      */
+} NvmeDevice;
+
+typedef struct {
+    SB_NVME_PASS_THRU_PACKET  packet;
+    SB_NVME_COMMAND           cmd;
+    SB_NVME_COMPLETION        cpl;
+    EFI_EVENT                 event;
+    UINT64                    issued_us;
+    BOOLEAN                   busy;
+} NvmeSlot;
+
+static NvmeDevice devices[NVME_MAX_DEVICES];
+static UINTN      device_count;
+
+static NvmeSlot   slots[NVME_QUEUE_DEPTH];
+static BOOLEAN    slots_ready;
+static BOOLEAN    slots_lost;       /* a command timed out */
+
+/* ------------------------------------------------------------------ */
+/*  Devices                                                            */
+/* ------------------------------------------------------------------ */
+
+static NvmeDevice *
+find_device(EFI_BLOCK_IO_PROTOCOL *block_io)
+{
+    for (UINTN i = 0; i < device_count; i++) {
+        if (devices[i].block_io == block_io)
+            return &devices[i];
+    }
+    return NULL;
+}
+
+/*
+ * Largest Read the controller accepts, from Identify Controller.  Every
+ * namespace of a controller shares the answer, so it is asked once.
+ */
+static UINT32
+controller_max_xfer(SB_NVME_PASS_THRU_PROTOCOL *pt)
+{
+    for (UINTN i = 0; i < device_count; i++) {
+        if (devices[i].pt == pt)
+            return devices[i].max_xfer;
+    }
+
+    UINT32 max = NVME_MAX_XFER;
+    EFI_PHYSICAL_ADDRESS addr;
+    if (EFI_ERROR(sb_page_alloc(SB_MEM_VFS, AllocateAnyPages, 1, &addr)))
+        return max;
+
+    SB_NVME_COMMAND          cmd;
+    SB_NVME_COMPLETION       cpl;
+    SB_NVME_PASS_THRU_PACKET packet;
+    sb_memset(&cmd, 0, sizeof(cmd));
+    sb_memset(&cpl, 0, sizeof(cpl));
+    sb_memset(&packet, 0, sizeof(packet));
+
+    cmd.Cdw0  = SB_NVME_ADMIN_IDENTIFY;
+    cmd.Cdw10 = NVME_CNS_CONTROLLER;
+    cmd.Flags = SB_NVME_CDW10_VALID;
+
+    packet.CommandTimeout = (UINT64)NVME_TIMEOUT_US * 10;
+    packet.TransferBuffer = (void *)(UINTN)addr;
+    packet.TransferLength = NVME_PAGE_SIZE;
+    packet.QueueType      = SB_NVME_ADMIN_QUEUE;
+    packet.NvmeCmd        = &cmd;
+    packet.NvmeCompletion = &cpl;
+
+    if (!EFI_ERROR(pt->PassThru(pt, 0, &packet, NULL))) {
+        UINT8 mdts = ((UINT8 *)(UINTN)addr)[NVME_ID_MDTS];
+        /* 0 means no limit. */
+        if (mdts != 0 && mdts < 16 && (NVME_PAGE_SIZE << mdts) < max)
+            max = NVME_PAGE_SIZE << mdts;
+    }
+
+    sb_page_free(addr, 1);
+    return max;
+}
+
+void
+sb_nvme_add_device(EFI_HANDLE device, EFI_BLOCK_IO_PROTOCOL *block_io)
+{
+    if (find_device(block_io) || device_count >= NVME_MAX_DEVICES)
+        return;
+
+    EFI_DEVICE_PATH_PROTOCOL *dp = DevicePathFromHandle(device);
+    if (!dp)
+        return;
+
+    /* The namespace node names the namespace; a hard drive node after
+     * it, if any, gives the partition's first LBA on it. */
+    UINT32 nsid = 0;
+    UINT64 first_lba = 0;
+    UINTN  partitions = 0;
+    for (EFI_DEVICE_PATH_PROTOCOL *node = dp; !IsDevicePathEnd(node);
+         node = NextDevicePathNode(node)) {
+        if (DevicePathType(node) == MESSAGING_DEVICE_PATH &&
+            DevicePathSubType(node) == SB_MSG_NVME_NAMESPACE_DP) {
+            nsid = ((SB_NVME_NAMESPACE_DEVICE_PATH *)node)->NamespaceId;
+        } else if (DevicePathType(node) == MEDIA_DEVICE_PATH &&
+                   DevicePathSubType(node) == MEDIA_HARDDRIVE_DP) {
+            first_lba = ((HARDDRIVE_DEVICE_PATH *)node)->PartitionStart;
+            partitions++;
+        }
+    }
+    /* Nested partitions would need their starts added up; not worth it. */
+    if (nsid == 0 || partitions > 1)
+        return;
+
+    EFI_DEVICE_PATH_PROTOCOL *rest = dp;
+    EFI_HANDLE controller;
+    SB_NVME_PASS_THRU_PROTOCOL *pt;
+    if (EFI_ERROR(gBS->LocateDevicePath(&NvmePassThruGuid, &rest,
+                                        &controller)) ||
+        EFI_ERROR(gBS->HandleProtocol(controller, &NvmePassThruGuid,
+                                      (void **)&pt)))
+        return;
+
+    UINT32 need = SB_NVME_ATTR_NONBLOCKIO | SB_NVME_ATTR_CMD_SET_NVM;
+    if ((pt->Mode->Attributes & need) != need)
+        return;
+
+    UINT32 bs  = block_io->Media->BlockSize;
+    UINT32 max = controller_max_xfer(pt);
+    if (bs == 0 || max < bs)
+        return;
+
+    NvmeDevice *d = &devices[device_count++];
+    d->block_io   = block_io;
+    d->pt         = pt;
+    d->nsid       = nsid;
+    d->block_size = bs;
+    d->first_lba  = first_lba;
+    d->max_xfer   = max - max % bs;
+    d->disabled   = FALSE;
+}
+
+void
+sb_nvme_shutdown(void)
+{
+    if (slots_ready && !slots_lost) {
+        for (UINTN i = 0; i < NVME_QUEUE_DEPTH; i++)
+            gBS->CloseEvent(slots[i].event);
+        slots_ready = FALSE;
+    }
+    device_count = 0;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Queued reads                                                       */
+/* ------------------------------------------------------------------ */
+
+static EFI_STATUS
+slots_init(void)
+{
+    for (UINTN i = 0; i < NVME_QUEUE_DEPTH; i++) {
+        EFI_STATUS s = gBS->CreateEvent(0, TPL_CALLBACK, NULL, NULL,
+                                        &slots[i].event);
+        if (EFI_ERROR(s)) {
+            while (i-- > 0)
+                gBS->CloseEvent(slots[i].event);
+            return s;
+        }
+        slots[i].busy = FALSE;
+    }
+    slots_ready = TRUE;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS
+submit_read(NvmeDevice *d, NvmeSlot *slot, UINT64 lba, UINTN bytes,
+            void *buf)
+{
+    sb_memset(&slot->cmd, 0, sizeof(slot->cmd));
+    sb_memset(&slot->cpl, 0, sizeof(slot->cpl));
+    sb_memset(&slot->packet, 0, sizeof(slot->packet));
+
+    slot->cmd.Cdw0  = SB_NVME_IO_READ;
+    slot->cmd.Nsid  = d->nsid;
+    slot->cmd.Cdw10 = (UINT32)lba;
+    slot->cmd.Cdw11 = (UINT32)(lba >> 32);
+    slot->cmd.Cdw12 = (UINT32)(bytes / d->block_size - 1);   /* NLB, 0's based */
+    slot->cmd.Flags = SB_NVME_CDW10_VALID | SB_NVME_CDW11_VALID |
+                      SB_NVME_CDW12_VALID;
+
+    slot->packet.CommandTimeout = (UINT64)NVME_TIMEOUT_US * 10;
+    slot->packet.TransferBuffer = buf;
+    slot->packet.TransferLength = (UINT32)bytes;
+    slot->packet.QueueType      = SB_NVME_IO_QUEUE;
+    slot->packet.NvmeCmd        = &slot->cmd;
+    slot->packet.NvmeCompletion = &slot->cpl;
+
+    return d->pt->PassThru(d->pt, d->nsid, &slot->packet, slot->event);
+}
+
+EFI_STATUS
+sb_nvme_read(EFI_BLOCK_IO_PROTOCOL *block_io,
+             UINT64 offset, UINTN size, void *buf)
+{
+    NvmeDevice *d = find_device(block_io);
+    if (!d || d->disabled || slots_lost)
+        return EFI_UNSUPPORTED;
+
+    UINT32 bs    = d->block_size;
+    UINT32 align = d->pt->Mode->IoAlign;
+    if (size == 0 || offset % bs != 0 || size % bs != 0 ||
+        (align > 1 && (UINTN)buf % align != 0))
+        return EFI_UNSUPPORTED;
+
+    if (!slots_ready && EFI_ERROR(slots_init()))
+        return EFI_UNSUPPORTED;
+
+    UINT8 *dst      = (UINT8 *)buf;
+    UINT64 lba      = d->first_lba + offset / bs;
+    UINTN  left     = size;         /* bytes not yet submitted */
+    UINTN  inflight = 0;
+    EFI_STATUS status = EFI_SUCCESS;
+
+    while ((left > 0 && !EFI_ERROR(status)) || inflight > 0) {
+        /* Fill the free slots. */
+        for (UINTN i = 0; i < NVME_QUEUE_DEPTH && left > 0 &&
+                          !EFI_ERROR(status); i++) {
+            if (slots[i].busy)
+                continue;
+            UINTN n = left < d->max_xfer ? left : d->max_xfer;
+            EFI_STATUS s = submit_read(d, &slots[i], lba, n, dst);
+            if (s == EFI_NOT_READY && inflight > 0)
+                break;          /* submission queue full: reap first */
+            if (EFI_ERROR(s)) {
+                status = s;
+                break;
+            }
+            slots[i].busy      = TRUE;
+            slots[i].issued_us = sb_time_us();
+            inflight++;
+            lba  += n / bs;
+            dst  += n;
+            left -= n;
+        }
+
+        /* Reap whatever has completed. */
+        for (UINTN i = 0; i < NVME_QUEUE_DEPTH; i++) {
+            if (!slots[i].busy)
+                continue;
+            if (gBS->CheckEvent(slots[i].event) == EFI_SUCCESS) {
+                slots[i].busy = FALSE;
+                inflight--;
+                if (NVME_CPL_STATUS(slots[i].cpl.DW3) != 0)
+                    status = EFI_DEVICE_ERROR;
+            } else if (sb_time_us() - slots[i].issued_us > NVME_TIMEOUT_US) {
+                /* The firmware may still write into these slots. */
+                slots_lost = TRUE;
+                status = EFI_TIMEOUT;
+                inflight = 0;
+                break;
+            }
+        }
+    }
+
+    if (EFI_ERROR(status)) {
+        SB_LOG(L"NVMe namespace %u: %r, using Block I/O", (UINTN)d->nsid,
+               status);
+        d->disabled = TRUE;
+        return EFI_UNSUPPORTED;
+    }
+    return EFI_SUCCESS;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Benchmark                                                          */
+/* ------------------------------------------------------------------ */
+
+static UINTN
+mib_per_s(UINT64 bytes, UINT64 us)
+{
+    return (UINTN)(bytes * 1000000 / (us ? us : 1) / (1024 * 1024));
+}
+
+/* Read `bytes` from the start of the disk in NVME_BENCH_REQUEST pieces;
+ * returns the elapsed time in microseconds, or 0 on error. */
+static UINT64
+bench_pass(EFI_BLOCK_IO_PROTOCOL *bio, UINT8 *buf, UINTN bytes,
+           BOOLEAN pass_thru)
+{
+    UINT64 t0 = sb_time_us();
+    for (UINTN off = 0; off < bytes; off += NVME_BENCH_REQUEST) {
+        EFI_STATUS s = pass_thru
+            ? sb_nvme_read(bio, off, NVME_BENCH_REQUEST, buf + off)
+            : bio->ReadBlocks(bio, bio->Media->MediaId,
+                              off / bio->Media->BlockSize,
+                              NVME_BENCH_REQUEST, buf + off);
+        if (EFI_ERROR(s))
+            return 0;
+    }
+    UINT64 us = sb_time_us() - t0;
+    return us ? us : 1;
+}
+
+EFI_STATUS
+sb_nvme_bench(SuperBootContext *ctx)
+{
+    EFI_HANDLE *handles = NULL;
+    UINTN       count   = 0;
+    EFI_STATUS  status  = ctx->boot_services->LocateHandleBuffer(
+                              ByProtocol, &gEfiBlockIoProtocolGuid,
+                              NULL, &count, &handles);
+    if (EFI_ERROR(status))
+        return status;
+
+    /* Block I/O reads into one half, PassThru into the other. */
+    EFI_PHYSICAL_ADDRESS addr;
+    UINTN pages = 2 * NVME_BENCH_BYTES / 4096;
+    status = sb_page_alloc(SB_MEM_CORE, AllocateAnyPages, pages, &addr);
+    if (EFI_ERROR(status)) {
+        FreePool(handles);
+        return status;
+    }
+    UINT8 *a = (UINT8 *)(UINTN)addr;
+    UINT8 *b = a + NVME_BENCH_BYTES;
+
+    UINTN found = 0;
+    for (UINTN i = 0; i < count; i++) {
+        EFI_BLOCK_IO_PROTOCOL *bio;
+        if (EFI_ERROR(ctx->boot_services->HandleProtocol(
+                          handles[i], &gEfiBlockIoProtocolGuid,
+                          (void **)&bio)) ||
+            bio->Media->LogicalPartition || !bio->Media->MediaPresent)
+            continue;
+
+        sb_nvme_add_device(handles[i], bio);
+        NvmeDevice *d = find_device(bio);
+        if (!d)
+            continue;
+
+        UINT64 disk  = (bio->Media->LastBlock + 1) * bio->Media->BlockSize;
+        UINTN  bytes = disk < NVME_BENCH_BYTES
+                       ? (UINTN)(disk - disk % NVME_BENCH_REQUEST)
+                       : NVME_BENCH_BYTES;
+        if (bytes == 0)
+            continue;
+        found++;
+
+        /* Warm every cache between us and the media once. */
+        bench_pass(bio, a, bytes, FALSE);
+        UINT64 t_blk = bench_pass(bio, a, bytes, FALSE);
+        UINT64 t_pt  = bench_pass(bio, b, bytes, TRUE);
+        if (!t_blk || !t_pt) {
+            SB_LOG(L"bench: NVMe namespace %u: read failed", (UINTN)d->nsid);
+            continue;
+        }
+
+        BOOLEAN same = CompareMem(a, b, bytes) == 0;
+        SB_LOG(L"bench: NVMe namespace %u, %u MiB in %u MiB reads",
+               (UINTN)d->nsid, bytes / (1024 * 1024),
+               (UINTN)NVME_BENCH_REQUEST / (1024 * 1024));
+        SB_LOG(L"bench:   Block I/O  %5u MiB/s", mib_per_s(bytes, t_blk));
+        SB_LOG(L"bench:   PassThru   %5u MiB/s  (QD %u x %u KiB)%s",
+               mib_per_s(bytes, t_pt), (UINTN)NVME_QUEUE_DEPTH,
+               (UINTN)d->max_xfer / 1024, same ? L"" : L"  DATA MISMATCH");
+    }
+
+    if (found == 0)
+        SB_LOG(L"bench: no NVMe namespace with non-blocking PassThru");
+
+    sb_page_free(addr, pages);
+    FreePool(handles);
+    return found ? EFI_SUCCESS : EFI_NOT_FOUND;
+}
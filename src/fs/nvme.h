@@ -0,0 +1,157 @@
+/*
+ * nvme.h — NVMe reads through EFI_NVM_EXPRESS_PASS_THRU_PROTOCOL
+ *
+ * Block I/O hands the controller one command at a time, which leaves
+ * an NVMe drive nearly idle.  For large reads on NVMe namespaces the
+ * VFS instead splits the request into Read commands and keeps up to
+ * NVME_QUEUE_DEPTH of them in flight with the non-blocking form of
+ * PassThru(); anything else still goes through Block I/O.
+ *
+ * gnu-efi does not ship the protocol, so the parts we use are declared
+ * here from the UEFI specification (2.10, section 13.16), with SB_
+ * prefixes to stay clear of any future gnu-efi definitions.
+ */
+
+#ifndef SUPERBOOT_NVME_H
+#define SUPERBOOT_NVME_H
+
+#include "../superboot.h"
+
+/* Reads shorter than this are not worth splitting. */
+#define SB_NVME_MIN_READ  (256 * 1024)
+
+/* ------------------------------------------------------------------ */
+/*  EFI_NVM_EXPRESS_PASS_THRU_PROTOCOL                                 */
+/* ------------------------------------------------------------------ */
+
+#define SB_NVME_PASS_THRU_PROTOCOL_GUID \
+    { 0x52c78312, 0x8edc, 0x4233, \
+      { 0x98, 0xf2, 0x1a, 0x1a, 0xa5, 0xe3, 0x88, 0xa5 } }
+
+/* Mode.Attributes */
+#define SB_NVME_ATTR_PHYSICAL       0x0001
+#define SB_NVME_ATTR_LOGICAL        0x0002
+#define SB_NVME_ATTR_NONBLOCKIO     0x0004
+#define SB_NVME_ATTR_CMD_SET_NVM    0x0008
+
+/* Command.Flags: which command dwords the caller filled in. */
+#define SB_NVME_CDW2_VALID          0x01
+#define SB_NVME_CDW3_VALID          0x02
+#define SB_NVME_CDW10_VALID         0x04
+#define SB_NVME_CDW11_VALID         0x08
+#define SB_NVME_CDW12_VALID         0x10
+#define SB_NVME_CDW13_VALID         0x20
+#define SB_NVME_CDW14_VALID         0x40
+#define SB_NVME_CDW15_VALID         0x80
+
+/* Packet.QueueType */
+#define SB_NVME_ADMIN_QUEUE         0
+#define SB_NVME_IO_QUEUE            1
+
+/* Opcodes */
+#define SB_NVME_ADMIN_IDENTIFY      0x06
+#define SB_NVME_IO_READ             0x02
+
+typedef struct {
+    UINT32  Attributes;
+    UINT32  IoAlign;
+    UINT32  NvmeVersion;
+} SB_NVME_PASS_THRU_MODE;
+
+typedef struct {
+    UINT32  Cdw0;               /* opcode in bits 7:0 */
+    UINT8   Flags;              /* SB_NVME_CDW*_VALID */
+    UINT32  Nsid;
+    UINT32  Cdw2;
+    UINT32  Cdw3;
+    UINT32  Cdw10;
+    UINT32  Cdw11;
+    UINT32  Cdw12;
+    UINT32  Cdw13;
+    UINT32  Cdw14;
+    UINT32  Cdw15;
+} SB_NVME_COMMAND;
+
+typedef struct {
+    UINT32  DW0;
+    UINT32  DW1;
+    UINT32  DW2;
+    UINT32  DW3;                /* status field in bits 31:17 */
+} SB_NVME_COMPLETION;
+
+typedef struct {
+    UINT64               CommandTimeout;    /* 100 ns units, 0 = none */
+    VOID                *TransferBuffer;
+    UINT32               TransferLength;
+    VOID                *MetadataBuffer;
+    UINT32               MetadataLength;
+    UINT8                QueueType;
+    SB_NVME_COMMAND     *NvmeCmd;
+    SB_NVME_COMPLETION  *NvmeCompletion;
+} SB_NVME_PASS_THRU_PACKET;
+
+typedef struct _SB_NVME_PASS_THRU_PROTOCOL SB_NVME_PASS_THRU_PROTOCOL;
+
+struct _SB_NVME_PASS_THRU_PROTOCOL {
+    SB_NVME_PASS_THRU_MODE *Mode;
+    EFI_STATUS (EFIAPI *PassThru)(
+        SB_NVME_PASS_THRU_PROTOCOL *This, UINT32 NamespaceId,
+        SB_NVME_PASS_THRU_PACKET *Packet, EFI_EVENT Event);
+    EFI_STATUS (EFIAPI *GetNextNamespace)(
+        SB_NVME_PASS_THRU_PROTOCOL *This, UINT32 *NamespaceId);
+    EFI_STATUS (EFIAPI *BuildDevicePath)(
+        SB_NVME_PASS_THRU_PROTOCOL *This, UINT32 NamespaceId,
+        EFI_DEVICE_PATH_PROTOCOL **DevicePath);
+    EFI_STATUS (EFIAPI *GetNamespace)(
+        SB_NVME_PASS_THRU_PROTOCOL *This,
+        EFI_DEVICE_PATH_PROTOCOL *DevicePath, UINT32 *NamespaceId);
+};
+
+/* Messaging device path node for an NVMe namespace. */
+#define SB_MSG_NVME_NAMESPACE_DP    0x17
+
+#pragma pack(1)
+
+typedef struct {
+    EFI_DEVICE_PATH_PROTOCOL  Header;
+    UINT32                    NamespaceId;
+    UINT64                    NamespaceUuid;
+} SB_NVME_NAMESPACE_DEVICE_PATH;
+
+#pragma pack()
+
+_Static_assert(sizeof(SB_NVME_NAMESPACE_DEVICE_PATH) == 16,
+               "NVMe namespace device path");
+
+/* ------------------------------------------------------------------ */
+/*  API (nvme.c)                                                       */
+/* ------------------------------------------------------------------ */
+
+/*
+ * Note a partition or whole-disk Block I/O instance that sits on an
+ * NVMe namespace whose controller supports non-blocking PassThru.
+ * Anything else is silently ignored.
+ */
+void       sb_nvme_add_device(EFI_HANDLE device,
+                              EFI_BLOCK_IO_PROTOCOL *block_io);
+
+/*
+ * Read `size` bytes at byte `offset` of the partition behind
+ * `block_io` with several commands outstanding.  Returns
+ * EFI_UNSUPPORTED, having read nothing useful, when the device is not
+ * a registered NVMe namespace, the request is not block-aligned, or
+ * the controller fails a command; the caller then uses Block I/O.
+ */
+EFI_STATUS sb_nvme_read(EFI_BLOCK_IO_PROTOCOL *block_io,
+                        UINT64 offset, UINTN size, void *buf);
+
+/* Forget all devices and release the command events. */
+void       sb_nvme_shutdown(void);
+
+/*
+ * "bench" load option: time sequential reads from every NVMe namespace
+ * through Block I/O and through PassThru, and log both in MiB/s.
+ */
+EFI_STATUS sb_nvme_bench(SuperBootContext *ctx);
+
+#endif /* SUPERBOOT_NVME_H */
@@ -0,0 +1,479 @@
+/*
+ * sfs.c — SimpleFileSystem for partitions read by built-in drivers
+ *
+ * The firmware cannot see ext4, btrfs or XFS, so LoadImage() with a
+ * device path, chain-loaded binaries and a kernel EFI stub reading
+ * initrd= all fail there.  Once a built-in driver mounts a partition,
+ * vfs.c calls sb_vfs_publish() to install a read-only
+ * EFI_SIMPLE_FILE_SYSTEM_PROTOCOL on its handle.  The file handles it
+ * hands out read through sb_vfs_open()/sb_vfs_read_at(), so the
+ * firmware pulls in only what it asks for, straight from the extents.
+ *
+ * Directories are listed once when opened and served from that list.
+ * Where the driver does not report sizes, each file's size is looked
+ * up as its entry is returned.  Anything that would write fails with
+ * EFI_WRITE_PROTECTED.
+ */
+
+#include "vfs.h"
+
+typedef struct SfsVolume {
+    EFI_SIMPLE_FILE_SYSTEM_PROTOCOL  sfs;       /* the installed interface */
+    EFI_HANDLE                       device;
+    EFI_BLOCK_IO_PROTOCOL           *block_io;
+    struct SfsVolume                *next;
+} SfsVolume;
+
+/* Everything installed, so it can be taken down again: the interface
+ * lives in our image, which the firmware unloads when we return. */
+static SfsVolume *volumes;
+
+typedef struct {
+    CHAR16    *name;
+    BOOLEAN    is_dir;
+    UINT64     size;
+} SfsDirEntry;
+
+typedef struct {
+    EFI_FILE_PROTOCOL  file;        /* what callers hold: keep first */
+    SfsVolume         *vol;
+    CHAR16             path[SB_MAX_PATH];   /* "\\" for the root      */
+    SbVfsFile         *vfs;         /* NULL for directories          */
+    UINT64             pos;         /* byte offset, or next entry    */
+    SfsDirEntry       *entries;
+    UINTN              entry_count;
+    UINTN              entry_cap;
+} SfsFile;
+
+static const EFI_FILE_PROTOCOL sfs_file_ops;
+
+/* ------------------------------------------------------------------ */
+/*  Paths                                                              */
+/* ------------------------------------------------------------------ */
+
+/* Resolve `name` against directory `base` into out[SB_MAX_PATH]:
+ * absolute when it starts with '\', with "." and ".." folded. */
+static BOOLEAN
+sfs_join(CHAR16 *out, const CHAR16 *base, const CHAR16 *name)
+{
+    UINTN len = 0;
+
+    if (*name != L'\\' && *name != L'/') {
+        len = StrLen(base);
+        if (len >= SB_MAX_PATH)
+            return FALSE;
+        sb_memcpy(out, base, len * sizeof(CHAR16));
+        if (len == 1)
+            len = 0;                        /* the root: "\" */
+    }
+
+    while (*name) {
+        while (*name == L'\\' || *name == L'/')
+            name++;
+        const CHAR16 *comp = name;
+        while (*name && *name != L'\\' && *name != L'/')
+            name++;
+        UINTN n = (UINTN)(name - comp);
+
+        if (n == 0 || (n == 1 && comp[0] == L'.'))
+            continue;
+        if (n == 2 && comp[0] == L'.' && comp[1] == L'.') {
+            while (len > 0 && out[len - 1] != L'\\')
+                len--;
+            if (len > 0)
+                len--;
+            continue;
+        }
+        if (len + 1 + n >= SB_MAX_PATH)
+            return FALSE;
+        out[len++] = L'\\';
+        sb_memcpy(out + len, comp, n * sizeof(CHAR16));
+        len += n;
+    }
+
+    if (len == 0)
+        out[len++] = L'\\';
+    out[len] = L'\0';
+    return TRUE;
+}
+
+static const CHAR16 *
+sfs_basename(const CHAR16 *path)
+{
+    const CHAR16 *name = path;
+    for (const CHAR16 *p = path; *p; p++) {
+        if (*p == L'\\')
+            name = p + 1;
+    }
+    return name;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Handles                                                            */
+/* ------------------------------------------------------------------ */
+
+static SfsFile *
+sfs_new(SfsVolume *vol, const CHAR16 *path)
+{
+    SfsFile *f = sb_zalloc(SB_MEM_VFS, sizeof(*f));
+    if (!f)
+        return NULL;
+    f->file = sfs_file_ops;
+    f->vol  = vol;
+    StrCpy(f->path, path);
+    return f;
+}
+
+static void
+sfs_free(SfsFile *f)
+{
+    for (UINTN i = 0; i < f->entry_count; i++)
+        sb_free(f->entries[i].name);
+    sb_free(f->entries);
+    sb_vfs_close(f->vfs);
+    sb_free(f);
+}
+
+static BOOLEAN
+sfs_collect(void *data, const CHAR16 *name, BOOLEAN is_dir, UINT64 size)
+{
+    SfsFile *f = data;
+
+    if (f->entry_count == f->entry_cap) {
+        UINTN cap = f->entry_cap ? f->entry_cap * 2 : 32;
+        SfsDirEntry *e = sb_malloc(SB_MEM_VFS, cap * sizeof(*e));
+        if (!e)
+            return FALSE;
+        if (f->entries)
+            sb_memcpy(e, f->entries, f->entry_count * sizeof(*e));
+        sb_free(f->entries);
+        f->entries   = e;
+        f->entry_cap = cap;
+    }
+
+    UINTN bytes = (StrLen(name) + 1) * sizeof(CHAR16);
+    CHAR16 *copy = sb_malloc(SB_MEM_VFS, bytes);
+    if (!copy)
+        return FALSE;
+    sb_memcpy(copy, name, bytes);
+
+    SfsDirEntry *e = &f->entries[f->entry_count++];
+    e->name   = copy;
+    e->is_dir = is_dir;
+    e->size   = is_dir ? 0 : size;
+    return TRUE;
+}
+
+/* Open `path` as a directory (listing it) or, failing that, a file. */
+static EFI_STATUS
+sfs_open_path(SfsVolume *vol, const CHAR16 *path, SfsFile **out)
+{
+    SfsFile *f = sfs_new(vol, path);
+    if (!f)
+        return EFI_OUT_OF_RESOURCES;
+
+    EFI_STATUS s = sb_vfs_read_dir(vol->device, path, sfs_collect, f);
+    if (EFI_ERROR(s)) {
+        for (UINTN i = 0; i < f->entry_count; i++)
+            sb_free(f->entries[i].name);
+        f->entry_count = 0;
+        s = sb_vfs_open(vol->device, path, &f->vfs);
+    }
+    if (EFI_ERROR(s)) {
+        sfs_free(f);
+        return s == EFI_UNSUPPORTED ? EFI_NOT_FOUND : s;
+    }
+
+    *out = f;
+    return EFI_SUCCESS;
+}
+
+/* ------------------------------------------------------------------ */
+/*  EFI_FILE_PROTOCOL                                                  */
+/* ------------------------------------------------------------------ */
+
+static EFI_STATUS EFIAPI
+sfs_file_open(EFI_FILE_PROTOCOL *this, EFI_FILE_PROTOCOL **new_handle,
+              CHAR16 *name, UINT64 mode, UINT64 attributes)
+{
+    SfsFile *f = (SfsFile *)this;
+
+    if (!new_handle || !name)
+        return EFI_INVALID_PARAMETER;
+    if (mode != EFI_FILE_MODE_READ)
+        return EFI_WRITE_PROTECTED;
+
+    CHAR16 path[SB_MAX_PATH];
+    if (!sfs_join(path, f->path, name))
+        return EFI_NOT_FOUND;
+
+    SfsFile *nf;
+    EFI_STATUS s = sfs_open_path(f->vol, path, &nf);
+    if (EFI_ERROR(s))
+        return s;
+    *new_handle = &nf->file;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+sfs_file_close(EFI_FILE_PROTOCOL *this)
+{
+    sfs_free((SfsFile *)this);
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+sfs_file_delete(EFI_FILE_PROTOCOL *this)
+{
+    sfs_free((SfsFile *)this);
+    return EFI_WARN_DELETE_FAILURE;
+}
+
+/* One directory entry as EFI_FILE_INFO. */
+static EFI_STATUS
+sfs_read_entry(SfsFile *f, UINTN *len, void *buf)
+{
+    if (f->pos >= f->entry_count) {
+        *len = 0;
+        return EFI_SUCCESS;
+    }
+
+    SfsDirEntry *e = &f->entries[f->pos];
+    UINTN name_bytes = (StrLen(e->name) + 1) * sizeof(CHAR16);
+    UINTN need = SIZE_OF_EFI_FILE_INFO + name_bytes;
+    if (*len < need) {
+        *len = need;
+        return EFI_BUFFER_TOO_SMALL;
+    }
+
+    if (e->size == SB_VFS_SIZE_UNKNOWN) {
+        CHAR16 path[SB_MAX_PATH];
+        SbVfsFile *vf;
+        e->size = 0;
+        if (sfs_join(path, f->path, e->name) &&
+            !EFI_ERROR(sb_vfs_open(f->vol->device, path, &vf))) {
+            e->size = sb_vfs_file_size(vf);
+            sb_vfs_close(vf);
+        }
+    }
+
+    EFI_FILE_INFO *info = buf;
+    sb_memset(info, 0, SIZE_OF_EFI_FILE_INFO);
+    info->Size         = need;
+    info->FileSize     = e->size;
+    info->PhysicalSize = e->size;
+    info->Attribute    = EFI_FILE_READ_ONLY |
+                         (e->is_dir ? EFI_FILE_DIRECTORY : 0);
+    sb_memcpy(info->FileName, e->name, name_bytes);
+
+    f->pos++;
+    *len = need;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+sfs_file_read(EFI_FILE_PROTOCOL *this, UINTN *len, void *buf)
+{
+    SfsFile *f = (SfsFile *)this;
+
+    if (!len || (*len && !buf))
+        return EFI_INVALID_PARAMETER;
+    if (!f->vfs)
+        return sfs_read_entry(f, len, buf);
+
+    if (f->pos > sb_vfs_file_size(f->vfs))
+        return EFI_DEVICE_ERROR;
+    EFI_STATUS s = sb_vfs_read_at(f->vfs, f->pos, buf, len);
+    if (EFI_ERROR(s))
+        return EFI_DEVICE_ERROR;
+    f->pos += *len;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+sfs_file_write(EFI_FILE_PROTOCOL *this, UINTN *len, void *buf)
+{
+    return ((SfsFile *)this)->vfs ? EFI_WRITE_PROTECTED : EFI_UNSUPPORTED;
+}
+
+static EFI_STATUS EFIAPI
+sfs_file_get_position(EFI_FILE_PROTOCOL *this, UINT64 *pos)
+{
+    SfsFile *f = (SfsFile *)this;
+
+    if (!f->vfs)
+        return EFI_UNSUPPORTED;
+    *pos = f->pos;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+sfs_file_set_position(EFI_FILE_PROTOCOL *this, UINT64 pos)
+{
+    SfsFile *f = (SfsFile *)this;
+
+    /* Directories can only be rewound; ~0 is end of file. */
+    if (!f->vfs) {
+        if (pos != 0)
+            return EFI_UNSUPPORTED;
+    } else if (pos == ~(UINT64)0) {
+        pos = sb_vfs_file_size(f->vfs);
+    }
+    f->pos = pos;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+sfs_file_get_info(EFI_FILE_PROTOCOL *this, EFI_GUID *type,
+                  UINTN *len, void *buf)
+{
+    SfsFile *f = (SfsFile *)this;
+
+    if (!type || !len || (*len && !buf))
+        return EFI_INVALID_PARAMETER;
+
+    if (CompareGuid(type, &gEfiFileInfoGuid) == 0) {
+        const CHAR16 *name = sfs_basename(f->path);
+        UINTN name_bytes = (StrLen(name) + 1) * sizeof(CHAR16);
+        UINTN need = SIZE_OF_EFI_FILE_INFO + name_bytes;
+        if (*len < need) {
+            *len = need;
+            return EFI_BUFFER_TOO_SMALL;
+        }
+
+        UINT64 size = f->vfs ? sb_vfs_file_size(f->vfs) : 0;
+        EFI_FILE_INFO *info = buf;
+        sb_memset(info, 0, SIZE_OF_EFI_FILE_INFO);
+        info->Size         = need;
+        info->FileSize     = size;
+        info->PhysicalSize = size;
+        info->Attribute    = EFI_FILE_READ_ONLY |
+                             (f->vfs ? 0 : EFI_FILE_DIRECTORY);
+        sb_memcpy(info->FileName, name, name_bytes);
+        *len = need;
+        return EFI_SUCCESS;
+    }
+
+    if (CompareGuid(type, &gEfiFileSystemInfoGuid) == 0) {
+        UINTN need = SIZE_OF_EFI_FILE_SYSTEM_INFO + sizeof(CHAR16);
+        if (*len < need) {
+            *len = need;
+            return EFI_BUFFER_TOO_SMALL;
+        }
+
+        EFI_BLOCK_IO_MEDIA *media = f->vol->block_io->Media;
+        EFI_FILE_SYSTEM_INFO *info = buf;
+        sb_memset(info, 0, need);
+        info->Size       = need;
+        info->ReadOnly   = TRUE;
+        info->VolumeSize = (media->LastBlock + 1) * media->BlockSize;
+        info->FreeSpace  = 0;
+        info->BlockSize  = media->BlockSize;
+        *len = need;
+        return EFI_SUCCESS;
+    }
+
+    if (CompareGuid(type, &gEfiFileSystemVolumeLabelInfoIdGuid) == 0) {
+        if (*len < sizeof(CHAR16)) {
+            *len = sizeof(CHAR16);
+            return EFI_BUFFER_TOO_SMALL;
+        }
+        *(CHAR16 *)buf = L'\0';
+        *len = sizeof(CHAR16);
+        return EFI_SUCCESS;
+    }
+
+    return EFI_UNSUPPORTED;
+}
+
+static EFI_STATUS EFIAPI
+sfs_file_set_info(EFI_FILE_PROTOCOL *this, EFI_GUID *type,
+                  UINTN len, void *buf)
+{
+    return EFI_WRITE_PROTECTED;
+}
+
+static EFI_STATUS EFIAPI
+sfs_file_flush(EFI_FILE_PROTOCOL *this)
+{
+    return EFI_ACCESS_DENIED;       /* opened read-only, always */
+}
+
+static const EFI_FILE_PROTOCOL sfs_file_ops = {
+    .Revision    = EFI_FILE_PROTOCOL_REVISION,
+    .Open        = sfs_file_open,
+    .Close       = sfs_file_close,
+    .Delete      = sfs_file_delete,
+    .Read        = sfs_file_read,
+    .Write       = sfs_file_write,
+    .GetPosition = sfs_file_get_position,
+    .SetPosition = sfs_file_set_position,
+    .GetInfo     = sfs_file_get_info,
+    .SetInfo     = sfs_file_set_info,
+    .Flush       = sfs_file_flush,
+};
+
+/* ------------------------------------------------------------------ */
+/*  EFI_SIMPLE_FILE_SYSTEM_PROTOCOL                                    */
+/* ------------------------------------------------------------------ */
+
+static EFI_STATUS EFIAPI
+sfs_open_volume(EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *this,
+                EFI_FILE_PROTOCOL **root)
+{
+    SfsFile *f;
+    EFI_STATUS s = sfs_open_path((SfsVolume *)this, L"\\", &f);
+    if (EFI_ERROR(s)) {
+        /* Drivers that cannot list directories still open files. */
+        f = sfs_new((SfsVolume *)this, L"\\");
+        if (!f)
+            return EFI_OUT_OF_RESOURCES;
+    }
+    *root = &f->file;
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS
+sb_vfs_publish(EFI_HANDLE device, EFI_BLOCK_IO_PROTOCOL *block_io)
+{
+    SfsVolume *vol = sb_zalloc(SB_MEM_VFS, sizeof(*vol));
+    if (!vol)
+        return EFI_OUT_OF_RESOURCES;
+
+    vol->sfs.Revision   = EFI_SIMPLE_FILE_SYSTEM_PROTOCOL_REVISION;
+    vol->sfs.OpenVolume = sfs_open_volume;
+    vol->device         = device;
+    vol->block_io       = block_io;
+
+    EFI_STATUS s = gBS->InstallProtocolInterface(
+                       &device, &gEfiSimpleFileSystemProtocolGuid,
+                       EFI_NATIVE_INTERFACE, &vol->sfs);
+    if (EFI_ERROR(s)) {
+        sb_free(vol);
+        return s;
+    }
+
+    vol->next = volumes;
+    volumes   = vol;
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS
+sb_vfs_unpublish(EFI_HANDLE device)
+{
+    for (SfsVolume **pp = &volumes; *pp; pp = &(*pp)->next) {
+        SfsVolume *vol = *pp;
+        if (vol->device != device)
+            continue;
+
+        EFI_STATUS s = gBS->UninstallProtocolInterface(
+                           device, &gEfiSimpleFileSystemProtocolGuid,
+                           &vol->sfs);
+        if (EFI_ERROR(s))
+            return s;
+        *pp = vol->next;
+        sb_free(vol);
+        return EFI_SUCCESS;
+    }
+    return EFI_NOT_FOUND;
+}
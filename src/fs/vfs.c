@@ -2,10 +2,16 @@
  * vfs.c — Virtual Filesystem dispatcher
  *
  * Manages a table of mounted devices with their associated drivers.
- * Falls through from UEFI-native SimpleFileSystem to built-in drivers.
+ * Falls through from UEFI-native SimpleFileSystem to built-in drivers,
+ * and publishes a SimpleFileSystem of its own (sfs.c) on partitions a
+ * built-in driver mounts.  Those are found in the table first, so the
+ * VFS never reads through its own protocol.
  */
 
 #include "vfs.h"
+#include "iotrace.h"
+#include "nvme.h"
+#include "sb_features.h"
 
 /* ------------------------------------------------------------------ */
 /*  Mount table                                                        */
@@ -13,22 +19,25 @@
 
 #define VFS_MAX_MOUNTS 64
 
+/* Read size for native files that are being hashed: large enough to
+ * keep firmware call overhead negligible, small enough that each
+ * chunk is still in L2 when it is hashed. */
+#define VFS_HASH_CHUNK (256 * 1024)
+
 typedef struct {
     EFI_HANDLE   device;
     BOOLEAN      is_native;     /* Using UEFI SimpleFileSystem?       */
     VfsDriver   *driver;        /* Non-NULL only for built-in drivers */
     void        *fs_context;    /* Opaque driver state                */
+    BOOLEAN      published;     /* SimpleFileSystem installed on it   */
 } VfsMount;
 
 static VfsMount  mounts[VFS_MAX_MOUNTS];
 static UINTN     mount_count = 0;
 
-/* Built-in filesystem driver table. */
+/* Built-in filesystem driver table, as selected in config.mk. */
 static VfsDriver *builtin_drivers[] = {
-    &sb_vfs_ext4,
-    &sb_vfs_btrfs,
-    &sb_vfs_xfs,
-    &sb_vfs_ntfs,
+    SB_FS_REGISTRY
     NULL
 };
 
@@ -50,11 +59,30 @@ sb_vfs_init(SuperBootContext *ctx)
 void
 sb_vfs_shutdown(void)
 {
+    /* Mounts behind a published SimpleFileSystem stay: the image about
+     * to be started may read through them.  On the way back to the
+     * firmware sb_vfs_unpublish_all() has run, and nothing does. */
+    UINTN kept = 0;
     for (UINTN i = 0; i < mount_count; i++) {
-        if (!mounts[i].is_native && mounts[i].driver && mounts[i].fs_context)
+        if (mounts[i].published)
+            mounts[kept++] = mounts[i];
+        else if (!mounts[i].is_native && mounts[i].driver &&
+                 mounts[i].fs_context)
             mounts[i].driver->unmount(mounts[i].fs_context);
     }
-    mount_count = 0;
+    mount_count = kept;
+
+    if (sb_iotrace_active())
+        sb_iotrace_flush();
+#if SB_FEATURE_NVME
+    sb_nvme_shutdown();
+#endif
+
+    /* Nothing scan-lifetime survives past this point, except the
+     * driver state of the mounts kept above. */
+    sb_arena_release(&sb_scratch);
+    sb_mem_check_leaks(kept ? SB_MEM_SCAN_LIFETIME & ~(1U << SB_MEM_VFS)
+                            : SB_MEM_SCAN_LIFETIME);
 }
 
 /* ------------------------------------------------------------------ */
@@ -124,9 +152,11 @@ sb_vfs_load_external_drivers(SuperBootContext *ctx)
             continue;
 
         /* Build device path for the driver. */
-        EFI_DEVICE_PATH_PROTOCOL *dev_path = FileDevicePath(
-            loaded->DeviceHandle,
-            PoolPrint(L"\\EFI\\superboot\\drivers\\%s", info->FileName));
+        CHAR16 drv_path[SB_MAX_PATH];
+        SPrint(drv_path, sizeof(drv_path),
+               L"\\EFI\\superboot\\drivers\\%s", info->FileName);
+        EFI_DEVICE_PATH_PROTOCOL *dev_path =
+            FileDevicePath(loaded->DeviceHandle, drv_path);
         if (!dev_path)
             continue;
 
@@ -134,6 +164,7 @@ sb_vfs_load_external_drivers(SuperBootContext *ctx)
         status = ctx->boot_services->LoadImage(
                      FALSE, ctx->image_handle, dev_path,
                      NULL, 0, &drv_handle);
+        FreePool(dev_path);
         if (EFI_ERROR(status))
             continue;
 
@@ -210,6 +241,11 @@ sb_vfs_open_device(EFI_HANDLE device)
     if (EFI_ERROR(status))
         disk_io = NULL; /* Some firmwares don't provide Disk I/O. */
 
+    sb_iotrace_add_device(device, block_io);
+#if SB_FEATURE_NVME
+    sb_nvme_add_device(device, block_io);
+#endif
+
     for (VfsDriver **drv = builtin_drivers; *drv; drv++) {
         if ((*drv)->probe && !EFI_ERROR((*drv)->probe(block_io, disk_io))) {
             void *ctx = NULL;
@@ -219,6 +255,9 @@ sb_vfs_open_device(EFI_HANDLE device)
                 m->driver = *drv;
                 m->fs_context = ctx;
                 mount_count++;
+#if SB_FEATURE_SFS
+                m->published = !EFI_ERROR(sb_vfs_publish(device, block_io));
+#endif
                 return EFI_SUCCESS;
             }
         }
@@ -228,12 +267,126 @@ sb_vfs_open_device(EFI_HANDLE device)
 }
 
 /* ------------------------------------------------------------------ */
-/*  Read a file from a mounted device                                  */
+/*  Raw partition reads for built-in drivers                           */
 /* ------------------------------------------------------------------ */
 
 EFI_STATUS
-sb_vfs_read_file(EFI_HANDLE device, const CHAR16 *path,
-                 void **buffer, UINTN *size)
+sb_vfs_disk_read(EFI_BLOCK_IO_PROTOCOL *block_io,
+                 EFI_DISK_IO_PROTOCOL  *disk_io,
+                 UINT64 offset, UINTN size, void *buf)
+{
+    UINT64 start_us = sb_time_us();
+    UINT8  flags;
+    EFI_STATUS s;
+
+#if SB_FEATURE_NVME
+    /* Large reads on NVMe: the whole blocks go out as queued PassThru
+     * commands, any partial tail block the usual way. */
+    if (size >= SB_NVME_MIN_READ) {
+        UINTN bulk = size - size % block_io->Media->BlockSize;
+        s = sb_nvme_read(block_io, offset, bulk, buf);
+        if (s != EFI_UNSUPPORTED) {
+            flags = IOTRACE_F_NVME;
+            if (sb_iotrace_active())
+                sb_iotrace_record(block_io, offset, bulk, buf, start_us,
+                                  flags, s);
+            if (EFI_ERROR(s) || bulk == size)
+                return s;
+            return sb_vfs_disk_read(block_io, disk_io, offset + bulk,
+                                    size - bulk, (UINT8 *)buf + bulk);
+        }
+    }
+#endif
+
+    if (disk_io) {
+        flags = IOTRACE_F_DISK_IO;
+        s = disk_io->ReadDisk(disk_io, block_io->Media->MediaId,
+                              offset, size, buf);
+        goto done;
+    }
+
+    UINT32 bs    = block_io->Media->BlockSize;
+    UINT32 align = block_io->Media->IoAlign;
+
+    /* Block-aligned request into a suitably aligned buffer: read
+     * straight into the caller's memory. */
+    if (offset % bs == 0 && size % bs == 0 &&
+        (align <= 1 || (UINTN)buf % align == 0)) {
+        flags = IOTRACE_F_BLOCK_IO;
+        s = block_io->ReadBlocks(block_io, block_io->Media->MediaId,
+                                 offset / bs, size, buf);
+        goto done;
+    }
+
+    /* Otherwise read the whole blocks covering the range. */
+    flags = IOTRACE_F_BLOCK_IO | IOTRACE_F_BOUNCE;
+    UINT64 start_lba = offset / bs;
+    UINT64 end_lba   = (offset + size + bs - 1) / bs;
+    UINTN  total     = (UINTN)(end_lba - start_lba) * bs;
+
+    SbArenaMark mark = sb_arena_mark(&sb_scratch);
+    void *tmp = sb_arena_alloc(&sb_scratch, total);
+    if (!tmp)
+        return EFI_OUT_OF_RESOURCES;
+
+    s = block_io->ReadBlocks(block_io, block_io->Media->MediaId,
+                             start_lba, total, tmp);
+    if (!EFI_ERROR(s))
+        CopyMem(buf, (UINT8 *)tmp + (offset % bs), size);
+    sb_arena_reset(&sb_scratch, mark);
+
+done:
+    if (sb_iotrace_active())
+        sb_iotrace_record(block_io, offset, size, buf, start_us, flags, s);
+    return s;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Read a file from a mounted device                                  */
+/* ------------------------------------------------------------------ */
+
+void *
+sb_vfs_alloc(SbArena *arena, UINTN size)
+{
+    return arena ? sb_arena_alloc(arena, size) : sb_malloc(SB_MEM_FILE, size);
+}
+
+void
+sb_vfs_free(SbArena *arena, void *p)
+{
+    if (!arena)
+        sb_free(p);
+}
+
+/* Read up to *size bytes from a native file, in chunks when hashing.
+ * *size is updated to the number of bytes actually read. */
+static EFI_STATUS
+native_read(EFI_FILE_PROTOCOL *file, UINT8 *buf, UINTN *size,
+            SbSha256 *hash)
+{
+    if (!hash)
+        return file->Read(file, size, buf);
+
+    UINTN done = 0;
+    while (done < *size) {
+        UINTN n = *size - done;
+        if (n > VFS_HASH_CHUNK)
+            n = VFS_HASH_CHUNK;
+        EFI_STATUS s = file->Read(file, &n, buf + done);
+        if (EFI_ERROR(s))
+            return s;
+        if (n == 0)
+            break;
+        sb_sha256_update(hash, buf + done, n);
+        done += n;
+    }
+    *size = done;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS
+vfs_read_file(EFI_HANDLE device, const CHAR16 *path, SbArena *arena,
+              SbSha256 *hash, void **buffer, UINTN *size)
 {
     VfsMount *m = find_mount(device);
     if (!m) {
@@ -280,28 +433,334 @@ sb_vfs_read_file(EFI_HANDLE device, const CHAR16 *path,
 
         EFI_FILE_INFO *info = (EFI_FILE_INFO *)info_buf;
         *size = (UINTN)info->FileSize;
-        *buffer = AllocatePool(*size + 1);
+        *buffer = sb_vfs_alloc(arena, *size + 1);
         if (!*buffer) {
             file->Close(file);
             root->Close(root);
             return EFI_OUT_OF_RESOURCES;
         }
 
-        status = file->Read(file, size, *buffer);
-        ((UINT8 *)*buffer)[*size] = 0; /* NUL-terminate for text files. */
-
+        status = native_read(file, *buffer, size, hash);
         file->Close(file);
         root->Close(root);
-        return status;
+        if (EFI_ERROR(status)) {
+            sb_vfs_free(arena, *buffer);
+            *buffer = NULL;
+            return status;
+        }
+
+        ((UINT8 *)*buffer)[*size] = 0; /* NUL-terminate for text files. */
+        return EFI_SUCCESS;
     }
 
     /* Built-in driver path. */
     if (m->driver && m->driver->read_file)
-        return m->driver->read_file(m->fs_context, path, buffer, size);
+        return m->driver->read_file(m->fs_context, path, arena, hash,
+                                    buffer, size);
+
+    return EFI_UNSUPPORTED;
+}
+
+EFI_STATUS
+sb_vfs_read_file(EFI_HANDLE device, const CHAR16 *path,
+                 void **buffer, UINTN *size)
+{
+    return vfs_read_file(device, path, NULL, NULL, buffer, size);
+}
+
+EFI_STATUS
+sb_vfs_read_file_arena(EFI_HANDLE device, const CHAR16 *path,
+                       SbArena *arena, void **buffer, UINTN *size)
+{
+    return vfs_read_file(device, path, arena, NULL, buffer, size);
+}
+
+EFI_STATUS
+sb_vfs_read_file_hashed(EFI_HANDLE device, const CHAR16 *path,
+                        SbSha256 *hash, void **buffer, UINTN *size)
+{
+    return vfs_read_file(device, path, NULL, hash, buffer, size);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Random access                                                      */
+/*                                                                     */
+/*  Native files keep their EFI_FILE_PROTOCOL open and seek; built-in  */
+/*  drivers with read_at() go straight to the extents; anything else   */
+/*  is read whole on open and served from that buffer.                 */
+/* ------------------------------------------------------------------ */
+
+struct SbVfsFile {
+    VfsDriver         *driver;      /* not the mount: shutdown moves  */
+    void              *fs_context;  /* the ones it keeps              */
+    UINT64             size;
+    EFI_FILE_PROTOCOL *root;        /* native                         */
+    EFI_FILE_PROTOCOL *file;
+    void              *handle;      /* driver read_at()               */
+    UINT8             *data;        /* whole-file fallback            */
+};
+
+EFI_STATUS
+sb_vfs_open(EFI_HANDLE device, const CHAR16 *path, SbVfsFile **file)
+{
+    *file = NULL;
+
+    VfsMount *m = find_mount(device);
+    if (!m) {
+        EFI_STATUS s = sb_vfs_open_device(device);
+        if (EFI_ERROR(s))
+            return s;
+        m = find_mount(device);
+        if (!m)
+            return EFI_NOT_FOUND;
+    }
+
+    SbVfsFile *f = sb_zalloc(SB_MEM_VFS, sizeof(*f));
+    if (!f)
+        return EFI_OUT_OF_RESOURCES;
+    f->driver     = m->driver;
+    f->fs_context = m->fs_context;
+
+    EFI_STATUS status;
+    if (m->is_native) {
+        EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *sfs;
+        status = gBS->HandleProtocol(device,
+                                     &gEfiSimpleFileSystemProtocolGuid,
+                                     (void **)&sfs);
+        if (EFI_ERROR(status))
+            goto fail;
+        status = sfs->OpenVolume(sfs, &f->root);
+        if (EFI_ERROR(status))
+            goto fail;
+        status = f->root->Open(f->root, &f->file, (CHAR16 *)path,
+                               EFI_FILE_MODE_READ, 0);
+        if (EFI_ERROR(status))
+            goto fail;
+
+        UINT8 info_buf[256];
+        UINTN info_size = sizeof(info_buf);
+        status = f->file->GetInfo(f->file, &gEfiFileInfoGuid,
+                                  &info_size, info_buf);
+        if (EFI_ERROR(status))
+            goto fail;
+        f->size = ((EFI_FILE_INFO *)info_buf)->FileSize;
+    } else if (m->driver && m->driver->open_file) {
+        status = m->driver->open_file(m->fs_context, path,
+                                      &f->handle, &f->size);
+        if (EFI_ERROR(status))
+            goto fail;
+    } else if (m->driver && m->driver->read_file) {
+        UINTN size;
+        status = m->driver->read_file(m->fs_context, path, NULL, NULL,
+                                      (void **)&f->data, &size);
+        if (EFI_ERROR(status))
+            goto fail;
+        f->size = size;
+    } else {
+        status = EFI_UNSUPPORTED;
+        goto fail;
+    }
+
+    *file = f;
+    return EFI_SUCCESS;
+
+fail:
+    sb_vfs_close(f);
+    return status;
+}
+
+UINT64
+sb_vfs_file_size(const SbVfsFile *file)
+{
+    return file->size;
+}
+
+EFI_STATUS
+sb_vfs_read_at(SbVfsFile *file, UINT64 offset, void *buf, UINTN *len)
+{
+    if (offset >= file->size) {
+        *len = 0;
+        return EFI_SUCCESS;
+    }
+    if (*len > file->size - offset)
+        *len = (UINTN)(file->size - offset);
+
+    if (file->file) {
+        EFI_STATUS s = file->file->SetPosition(file->file, offset);
+        if (EFI_ERROR(s))
+            return s;
+        UINTN done = 0;
+        while (done < *len) {
+            UINTN n = *len - done;
+            s = file->file->Read(file->file, &n, (UINT8 *)buf + done);
+            if (EFI_ERROR(s))
+                return s;
+            if (n == 0)
+                break;
+            done += n;
+        }
+        *len = done;
+        return EFI_SUCCESS;
+    }
+
+    if (file->handle)
+        return file->driver->read_at(file->fs_context, file->handle,
+                                     offset, *len, buf);
+
+    sb_memcpy(buf, file->data + offset, *len);
+    return EFI_SUCCESS;
+}
+
+void
+sb_vfs_close(SbVfsFile *file)
+{
+    if (!file)
+        return;
+    if (file->file)
+        file->file->Close(file->file);
+    if (file->root)
+        file->root->Close(file->root);
+    if (file->handle)
+        file->driver->close_file(file->fs_context, file->handle);
+    sb_free(file->data);
+    sb_free(file);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Directories and the mount list                                     */
+/* ------------------------------------------------------------------ */
+
+static EFI_STATUS
+native_read_dir(EFI_HANDLE device, const CHAR16 *path,
+                SbVfsDirFn fn, void *data)
+{
+    EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *sfs;
+    EFI_STATUS status = gBS->HandleProtocol(
+                            device, &gEfiSimpleFileSystemProtocolGuid,
+                            (void **)&sfs);
+    if (EFI_ERROR(status))
+        return status;
+
+    EFI_FILE_PROTOCOL *root, *dir;
+    status = sfs->OpenVolume(sfs, &root);
+    if (EFI_ERROR(status))
+        return status;
+
+    status = root->Open(root, &dir, (CHAR16 *)path, EFI_FILE_MODE_READ, 0);
+    if (EFI_ERROR(status)) {
+        root->Close(root);
+        return status;
+    }
+
+    /* Room for EFI_FILE_INFO with a 255-character name. */
+    UINT8 info_buf[SIZE_OF_EFI_FILE_INFO + 256 * sizeof(CHAR16)];
 
+    for (;;) {
+        UINTN buf_size = sizeof(info_buf);
+        status = dir->Read(dir, &buf_size, info_buf);
+        if (EFI_ERROR(status) || buf_size == 0)
+            break;
+
+        EFI_FILE_INFO *info = (EFI_FILE_INFO *)info_buf;
+        if (StrCmp(info->FileName, L".") == 0 ||
+            StrCmp(info->FileName, L"..") == 0)
+            continue;
+
+        if (!fn(data, info->FileName,
+                !!(info->Attribute & EFI_FILE_DIRECTORY), info->FileSize))
+            break;
+    }
+
+    dir->Close(dir);
+    root->Close(root);
+    return EFI_ERROR(status) ? status : EFI_SUCCESS;
+}
+
+EFI_STATUS
+sb_vfs_read_dir(EFI_HANDLE device, const CHAR16 *path,
+                SbVfsDirFn fn, void *data)
+{
+    VfsMount *m = find_mount(device);
+    if (!m) {
+        EFI_STATUS s = sb_vfs_open_device(device);
+        if (EFI_ERROR(s))
+            return s;
+        m = find_mount(device);
+        if (!m)
+            return EFI_NOT_FOUND;
+    }
+
+    if (m->is_native)
+        return native_read_dir(device, path, fn, data);
+    if (m->driver && m->driver->read_dir)
+        return m->driver->read_dir(m->fs_context, path, fn, data);
     return EFI_UNSUPPORTED;
 }
 
+UINTN
+sb_vfs_mount_count(void)
+{
+    return mount_count;
+}
+
+EFI_HANDLE
+sb_vfs_mount_info(UINTN index, const CHAR16 **fs_name)
+{
+    if (index >= mount_count)
+        return NULL;
+    if (fs_name)
+        *fs_name = mounts[index].is_native ? L"uefi"
+                                           : mounts[index].driver->name;
+    return mounts[index].device;
+}
+
+UINTN
+sb_vfs_mount_all(void)
+{
+    EFI_HANDLE *handles = NULL;
+    UINTN       count = 0;
+
+    if (EFI_ERROR(gBS->LocateHandleBuffer(ByProtocol,
+                                          &gEfiBlockIoProtocolGuid, NULL,
+                                          &count, &handles)))
+        return mount_count;
+
+    for (UINTN i = 0; i < count; i++) {
+        EFI_BLOCK_IO_PROTOCOL *block_io;
+
+        if (EFI_ERROR(gBS->HandleProtocol(handles[i],
+                                          &gEfiBlockIoProtocolGuid,
+                                          (void **)&block_io)) ||
+            !block_io->Media->LogicalPartition ||
+            !block_io->Media->MediaPresent)
+            continue;
+
+        /* Already-mounted devices return at once; unreadable ones
+         * are simply left out. */
+        sb_vfs_open_device(handles[i]);
+    }
+
+    FreePool(handles);
+    return mount_count;
+}
+
+void
+sb_vfs_unpublish_all(void)
+{
+#if SB_FEATURE_SFS
+    for (UINTN i = 0; i < mount_count; i++) {
+        if (!mounts[i].published)
+            continue;
+        EFI_STATUS s = sb_vfs_unpublish(mounts[i].device);
+        if (EFI_ERROR(s))
+            SB_LOG(L"WARN: SimpleFileSystem left installed on %s: %r",
+                   mounts[i].driver->name, s);
+        else
+            mounts[i].published = FALSE;
+    }
+#endif
+}
+
 /* ------------------------------------------------------------------ */
 /*  File existence probe                                               */
 /* ------------------------------------------------------------------ */
@@ -341,8 +800,146 @@ sb_vfs_file_exists(EFI_HANDLE device, const CHAR16 *path)
         return TRUE;
     }
 
-    EFI_STATUS s = sb_vfs_read_file(device, path, &buf, &sz);
-    if (buf)
-        FreePool(buf);
+    SbArenaMark mark = sb_arena_mark(&sb_scratch);
+    EFI_STATUS s = vfs_read_file(device, path, &sb_scratch, NULL, &buf, &sz);
+    sb_arena_reset(&sb_scratch, mark);
     return !EFI_ERROR(s);
 }
+
+/* ------------------------------------------------------------------ */
+/*  Filesystem UUIDs                                                   */
+/*                                                                     */
+/*  Read from the superblock rather than asked of a driver, so every   */
+/*  partition has one whether the firmware, a built-in driver or       */
+/*  nothing at all serves its files.                                   */
+/* ------------------------------------------------------------------ */
+
+#define EXT_SB_OFFSET    1024
+#define BTRFS_SB_OFFSET  0x10000
+
+static CHAR8 *
+put_hex(CHAR8 *out, const UINT8 *bytes, UINTN n)
+{
+    static const CHAR8 digits[] = "0123456789abcdef";
+    for (UINTN i = 0; i < n; i++) {
+        *out++ = digits[bytes[i] >> 4];
+        *out++ = digits[bytes[i] & 15];
+    }
+    return out;
+}
+
+/* 16 bytes as 8-4-4-4-12. */
+static void
+format_uuid(CHAR8 *out, const UINT8 *u)
+{
+    out = put_hex(out, u, 4);      *out++ = '-';
+    out = put_hex(out, u + 4, 2);  *out++ = '-';
+    out = put_hex(out, u + 6, 2);  *out++ = '-';
+    out = put_hex(out, u + 8, 2);  *out++ = '-';
+    out = put_hex(out, u + 10, 6);
+    *out = '\0';
+}
+
+EFI_STATUS
+sb_vfs_fs_uuid(EFI_HANDLE device, CHAR8 *out, UINTN max)
+{
+    EFI_BLOCK_IO_PROTOCOL *block_io;
+    EFI_DISK_IO_PROTOCOL  *disk_io;
+    UINT8 buf[4096];
+
+    if (max < 37)
+        return EFI_BUFFER_TOO_SMALL;
+    if (EFI_ERROR(gBS->HandleProtocol(device, &gEfiBlockIoProtocolGuid,
+                                      (void **)&block_io)))
+        return EFI_UNSUPPORTED;
+    if (EFI_ERROR(gBS->HandleProtocol(device, &gEfiDiskIoProtocolGuid,
+                                      (void **)&disk_io)))
+        disk_io = NULL;
+
+    EFI_STATUS s = sb_vfs_disk_read(block_io, disk_io, 0, sizeof(buf), buf);
+    if (EFI_ERROR(s))
+        return s;
+
+    /* ext2/3/4: magic 0xEF53 at 0x38, UUID at 0x68. */
+    const UINT8 *ext = buf + EXT_SB_OFFSET;
+    if (ext[0x38] == 0x53 && ext[0x39] == 0xEF) {
+        format_uuid(out, ext + 0x68);
+        return EFI_SUCCESS;
+    }
+
+    /* XFS: "XFSB", UUID at 32. */
+    if (buf[0] == 'X' && buf[1] == 'F' && buf[2] == 'S' && buf[3] == 'B') {
+        format_uuid(out, buf + 32);
+        return EFI_SUCCESS;
+    }
+
+    /* FAT: the volume serial, high half first, as "xxxx-xxxx".  FAT32
+     * keeps it at 0x43 (the 16-bit FAT size at 0x16 is zero), FAT12/16
+     * at 0x27. */
+    if (buf[510] == 0x55 && buf[511] == 0xAA &&
+        (sb_strncmp8((CHAR8 *)buf + 0x52, (const CHAR8 *)"FAT", 3) == 0 ||
+         sb_strncmp8((CHAR8 *)buf + 0x36, (const CHAR8 *)"FAT", 3) == 0)) {
+        const UINT8 *id = buf + ((buf[0x16] | buf[0x17]) ? 0x27 : 0x43);
+        UINT8 be[4] = { id[3], id[2], id[1], id[0] };
+        CHAR8 *o = put_hex(out, be, 2);
+        *o++ = '-';
+        o = put_hex(o, be + 2, 2);
+        *o = '\0';
+        return EFI_SUCCESS;
+    }
+
+    /* btrfs: "_BHRfS_M" at 0x40 of the superblock, fsid at 0x20. */
+    s = sb_vfs_disk_read(block_io, disk_io, BTRFS_SB_OFFSET, 0x48, buf);
+    if (!EFI_ERROR(s) &&
+        sb_strncmp8((CHAR8 *)buf + 0x40, (const CHAR8 *)"_BHRfS_M", 8) == 0) {
+        format_uuid(out, buf + 0x20);
+        return EFI_SUCCESS;
+    }
+
+    return EFI_NOT_FOUND;
+}
+
+static BOOLEAN
+uuid_equal(const CHAR8 *a, const CHAR8 *b)
+{
+    for (;; a++, b++) {
+        CHAR8 x = (*a >= 'A' && *a <= 'Z') ? *a + 32 : *a;
+        CHAR8 y = (*b >= 'A' && *b <= 'Z') ? *b + 32 : *b;
+        if (x != y)
+            return FALSE;
+        if (!x)
+            return TRUE;
+    }
+}
+
+EFI_HANDLE
+sb_vfs_find_uuid(const CHAR8 *uuid)
+{
+    EFI_HANDLE *handles = NULL;
+    UINTN       count = 0;
+    EFI_HANDLE  found = NULL;
+
+    if (EFI_ERROR(gBS->LocateHandleBuffer(ByProtocol,
+                                          &gEfiBlockIoProtocolGuid, NULL,
+                                          &count, &handles)))
+        return NULL;
+
+    for (UINTN i = 0; i < count && !found; i++) {
+        EFI_BLOCK_IO_PROTOCOL *block_io;
+        CHAR8 id[40];
+
+        if (EFI_ERROR(gBS->HandleProtocol(handles[i],
+                                          &gEfiBlockIoProtocolGuid,
+                                          (void **)&block_io)) ||
+            !block_io->Media->LogicalPartition ||
+            !block_io->Media->MediaPresent)
+            continue;
+
+        if (!EFI_ERROR(sb_vfs_fs_uuid(handles[i], id, sizeof(id))) &&
+            uuid_equal(id, uuid))
+            found = handles[i];
+    }
+
+    FreePool(handles);
+    return found;
+}
@@ -23,6 +23,18 @@
 /*  Filesystem driver vtable                                           */
 /* ------------------------------------------------------------------ */
 
+/*
+ * Directory walk callback: one call per entry ("." and ".." are not
+ * reported).  `size` is SB_VFS_SIZE_UNKNOWN where the driver would
+ * need an extra read per entry to know it.  Return FALSE to stop.
+ * Drivers read the directory into sb_scratch and reset it before
+ * returning, so the callback must not keep anything allocated there.
+ */
+#define SB_VFS_SIZE_UNKNOWN  ((UINT64)-1)
+
+typedef BOOLEAN (*SbVfsDirFn)(void *data, const CHAR16 *name,
+                              BOOLEAN is_dir, UINT64 size);
+
 typedef struct VfsDriver {
     const CHAR16 *name;        /* e.g. L"ext4", L"btrfs" */
 
@@ -43,13 +55,36 @@ typedef struct VfsDriver {
                         void **fs_context);
 
     /*
-     * read_file() — read an entire file into a caller-freed buffer.
+     * read_file() — read an entire file into a NUL-terminated buffer.
      * Path uses forward-slash separators, e.g. "/boot/vmlinuz".
-     * Allocates *buffer via AllocatePool; caller must FreePool.
+     * Allocates *buffer with sb_vfs_alloc(arena, ...): from `arena`,
+     * or with sb_malloc (caller must sb_free) when arena is NULL.
+     * If `hash` is non-NULL, file data is fed to it in order as each
+     * piece arrives from disk.
      */
     EFI_STATUS (*read_file)(void *fs_context, const CHAR16 *path,
+                            SbArena *arena, SbSha256 *hash,
                             void **buffer, UINTN *size);
 
+    /*
+     * open_file() / read_at() / close_file() — optional random access.
+     * open_file() returns a driver handle and the file size; read_at()
+     * fills exactly `len` bytes at `offset` (holes read as zeroes).
+     * Drivers without them are served from a read_file() buffer.
+     */
+    EFI_STATUS (*open_file)(void *fs_context, const CHAR16 *path,
+                            void **file, UINT64 *size);
+    EFI_STATUS (*read_at)(void *fs_context, void *file,
+                          UINT64 offset, UINTN len, void *buf);
+    void       (*close_file)(void *fs_context, void *file);
+
+    /*
+     * read_dir() — optional: call `fn` for each entry of directory
+     * `path`, in on-disk order.
+     */
+    EFI_STATUS (*read_dir)(void *fs_context, const CHAR16 *path,
+                           SbVfsDirFn fn, void *data);
+
     /*
      * dir_exists() — check if a directory path exists.
      */
@@ -90,9 +125,115 @@ EFI_STATUS sb_vfs_load_external_drivers(SuperBootContext *ctx);
  */
 EFI_STATUS sb_vfs_open_device(EFI_HANDLE device);
 
+/*
+ * sb_vfs_disk_read() — read `size` bytes at byte `offset` of a
+ * partition.  Uses Disk I/O when the firmware provides it, otherwise
+ * Block I/O (bouncing through a sector-aligned buffer when the request
+ * is not block-aligned).  Built-in drivers must do all device reads
+ * through here so the I/O tracer sees every request.
+ */
+EFI_STATUS sb_vfs_disk_read(EFI_BLOCK_IO_PROTOCOL *block_io,
+                            EFI_DISK_IO_PROTOCOL  *disk_io,
+                            UINT64 offset, UINTN size, void *buf);
+
+/*
+ * sb_vfs_read_file_arena() — like sb_vfs_read_file(), but the buffer
+ * is carved from `arena` and released with it.  Used for config files
+ * and other scan-lifetime data.
+ */
+EFI_STATUS sb_vfs_read_file_arena(EFI_HANDLE device, const CHAR16 *path,
+                                  SbArena *arena,
+                                  void **buffer, UINTN *size);
+
+/*
+ * sb_vfs_read_file_hashed() — like sb_vfs_read_file(), additionally
+ * feeding the file contents to `hash` while they are read, so the
+ * caller gets a digest without a second pass over the buffer.
+ */
+EFI_STATUS sb_vfs_read_file_hashed(EFI_HANDLE device, const CHAR16 *path,
+                                   SbSha256 *hash,
+                                   void **buffer, UINTN *size);
+
+/*
+ * sb_vfs_open() / sb_vfs_read_at() / sb_vfs_close() — read a file in
+ * pieces instead of whole, for images too large to want twice in
+ * memory.  sb_vfs_read_at() reads up to *len bytes at `offset` and
+ * sets *len to the number read (less only at end of file).
+ */
+typedef struct SbVfsFile SbVfsFile;
+
+EFI_STATUS sb_vfs_open(EFI_HANDLE device, const CHAR16 *path,
+                       SbVfsFile **file);
+UINT64     sb_vfs_file_size(const SbVfsFile *file);
+EFI_STATUS sb_vfs_read_at(SbVfsFile *file, UINT64 offset,
+                          void *buf, UINTN *len);
+void       sb_vfs_close(SbVfsFile *file);
+
+/*
+ * sb_vfs_read_dir() — walk directory `path` through the firmware's
+ * SimpleFileSystem or the driver's read_dir().  Entries come in
+ * on-disk order; sorting is up to the caller.
+ */
+EFI_STATUS sb_vfs_read_dir(EFI_HANDLE device, const CHAR16 *path,
+                           SbVfsDirFn fn, void *data);
+
+/*
+ * sb_vfs_mount_count() / sb_vfs_mount_info() — the devices mounted so
+ * far, in mount order, and the filesystem serving each: the driver
+ * name, or L"uefi" for the firmware's own SimpleFileSystem.
+ */
+UINTN      sb_vfs_mount_count(void);
+EFI_HANDLE sb_vfs_mount_info(UINTN index, const CHAR16 **fs_name);
+
+/*
+ * sb_vfs_mount_all() — mount every partition with media present that
+ * is not mounted yet, and return the mount count.  For the explorer,
+ * which may run after sb_vfs_shutdown() or a cancelled scan has left
+ * the table short.
+ */
+UINTN      sb_vfs_mount_all(void);
+
+/*
+ * sb_vfs_publish() (sfs.c) — install a read-only SimpleFileSystem on a
+ * partition mounted by a built-in driver, so the firmware (LoadImage()
+ * by device path, images started from here) can open files on it.
+ * Called by sb_vfs_open_device(); the mount then outlives
+ * sb_vfs_shutdown().
+ *
+ * sb_vfs_unpublish() (sfs.c) — uninstall that interface from `device`
+ * and free it.
+ *
+ * sb_vfs_unpublish_all() — unpublish every mount, so the next
+ * sb_vfs_shutdown() drops them all.  The interfaces point into our
+ * image: call it before returning to the firmware, which unloads us.
+ * Only a hand-off to a started image keeps them.
+ */
+EFI_STATUS sb_vfs_publish(EFI_HANDLE device,
+                          EFI_BLOCK_IO_PROTOCOL *block_io);
+EFI_STATUS sb_vfs_unpublish(EFI_HANDLE device);
+
+/*
+ * sb_vfs_alloc() / sb_vfs_free() — allocate from `arena`, or from the
+ * pool when arena is NULL.  Freeing arena memory is a no-op.
+ */
+void *sb_vfs_alloc(SbArena *arena, UINTN size);
+void  sb_vfs_free(SbArena *arena, void *p);
+
 /*
  * sb_vfs_file_exists() — quick probe for a file's existence.
  */
 BOOLEAN sb_vfs_file_exists(EFI_HANDLE device, const CHAR16 *path);
 
+/*
+ * sb_vfs_fs_uuid() — a partition's filesystem UUID as GRUB's `search
+ * --fs-uuid` spells it: 8-4-4-4-12 lowercase hex for ext2/3/4, XFS and
+ * btrfs, xxxx-xxxx for FAT.  `out` needs 37 bytes.  Read from the
+ * superblock, so the partition need not be mountable.
+ *
+ * sb_vfs_find_uuid() — the partition whose filesystem UUID is `uuid`
+ * (in any case), or NULL.
+ */
+EFI_STATUS sb_vfs_fs_uuid(EFI_HANDLE device, CHAR8 *out, UINTN max);
+EFI_HANDLE sb_vfs_find_uuid(const CHAR8 *uuid);
+
 #endif /* SUPERBOOT_VFS_H */
@@ -4,12 +4,19 @@
  * Orchestrates the full boot flow:
  *   1. Initialise UEFI library and global context
  *   2. Initialise the VFS layer (load filesystem drivers)
- *   3. Scan every block device for known config files
- *   4. Present the TUI menu (or auto-boot on timeout)
+ *   3. Scan every block device for known config files, in the
+ *      background while
+ *   4. the TUI menu is presented (or auto-boot on timeout)
  *   5. Load the selected kernel / chain-load .efi
  */
 
 #include "superboot.h"
+#include "fs/iotrace.h"
+#include "fs/nvme.h"
+#include "sb_features.h"
+
+/* Stands in for load options when there are none (see below). */
+#define SB_OPTIONS_PATH  L"\\EFI\\superboot\\options.txt"
 
 /* Forward declarations for local helpers. */
 static EFI_STATUS sb_init_context(EFI_HANDLE image, EFI_SYSTEM_TABLE *st,
@@ -56,39 +63,72 @@ efi_main(EFI_HANDLE image_handle, EFI_SYSTEM_TABLE *system_table)
     if (EFI_ERROR(status))
         return status;
 
+    if (ctx.iotrace)
+        sb_iotrace_start(&ctx);
+    sb_control_init(&ctx);
+    sb_control_mark(L"init");
+
     SB_LOG(L"SuperBoot v0.1.0 — Universal Meta-Bootloader");
     SB_LOG(L"Firmware: %s  Rev %d",
            system_table->FirmwareVendor,
            system_table->FirmwareRevision);
 
+    sb_workers_init(&ctx);
+    if (ctx.bench) {
+        sb_bench_run(&ctx);
+#if SB_FEATURE_NVME
+        sb_nvme_bench(&ctx);
+#endif
+    }
+
     /* ---- Phase 1: Filesystem layer ------------------------------ */
     status = sb_vfs_init(&ctx);
     if (EFI_ERROR(status))
         SB_LOG(L"WARN: VFS init incomplete (%r), falling back to ESP-only", status);
 
     /* ---- Phase 2: Scan all block devices for boot configs ------- */
-    status = sb_scan_all_devices(&ctx);
-    if (EFI_ERROR(status) || ctx.targets.count == 0) {
-        SB_LOG(L"No bootable entries found — launching EFI explorer.");
-        sb_tui_file_browser(&ctx);
-        return EFI_NOT_FOUND;
-    }
+    sb_sched_init(&ctx);
+    sb_scan_start(&ctx);
 
-    SB_LOG(L"Found %u bootable entries.", ctx.targets.count);
+    /* Verbose output would be drawn over by the menu: finish the
+     * scan first so the log stays readable. */
+    if (ctx.verbose)
+        sb_sched_run(&ctx.scan_done);
 
-    /* ---- Phase 3: TUI ------------------------------------------ */
+    /* ---- Phase 3: TUI (the scan continues underneath) ---------- */
     status = sb_tui_run_menu(&ctx);
-    if (EFI_ERROR(status))
-        return status;
+    if (status == EFI_NOT_FOUND) {
+        /* The explorer reads through the mounts: keep the VFS up
+         * until it returns. */
+        sb_sched_shutdown();
+#if SB_FEATURE_EXPLORER
+        SB_LOG(L"No bootable entries found — launching EFI explorer.");
+        sb_tui_file_browser(&ctx);
+#else
+        SB_LOG(L"No bootable entries found.");
+#endif
+        goto out;
+    }
+    if (EFI_ERROR(status)) {
+        sb_sched_shutdown();
+        goto out;
+    }
 
     /* ---- Phase 4: Boot ----------------------------------------- */
     status = sb_boot_selected(&ctx);
 
     /* If we reach here, booting failed. */
     SB_LOG(L"Boot failed: %r", status);
+#if SB_FEATURE_EXPLORER
     SB_LOG(L"Dropping to EFI explorer.");
     sb_tui_file_browser(&ctx);
+#endif
 
+out:
+    /* The firmware unloads us when we return: take down the
+     * SimpleFileSystems we installed, then everything else. */
+    sb_vfs_unpublish_all();
+    sb_vfs_shutdown();
     return status;
 }
 
@@ -96,6 +136,34 @@ efi_main(EFI_HANDLE image_handle, EFI_SYSTEM_TABLE *system_table)
 /*  Helpers                                                            */
 /* ================================================================== */
 
+/*
+ * Firmware starting us from the removable-media path (\EFI\BOOT\
+ * BOOTX64.EFI), as OVMF does with a bare disk image, passes no load
+ * options.  SB_OPTIONS_PATH on our own volume is read instead, so test
+ * images can carry "control", "bench" and the like.  The copy lives
+ * as long as SuperBoot: ctx->script points into it.
+ */
+static CHAR16 *
+sb_read_options_file(EFI_HANDLE device)
+{
+    CHAR8 *text;
+    UINTN  size;
+    if (EFI_ERROR(sb_vfs_read_file(device, SB_OPTIONS_PATH,
+                                   (void **)&text, &size)))
+        return NULL;
+
+    CHAR16 *opts = sb_malloc(SB_MEM_CORE, (size + 1) * sizeof(CHAR16));
+    if (opts) {
+        sb_str8to16(opts, text, size + 1);
+        for (CHAR16 *p = opts; *p; p++) {
+            if (*p == L'\r' || *p == L'\n' || *p == L'\t')
+                *p = L' ';
+        }
+    }
+    sb_free(text);
+    return opts;
+}
+
 static EFI_STATUS
 sb_init_context(EFI_HANDLE image, EFI_SYSTEM_TABLE *st,
                 SuperBootContext *ctx)
@@ -108,8 +176,10 @@ sb_init_context(EFI_HANDLE image, EFI_SYSTEM_TABLE *st,
     ctx->runtime_services = st->RuntimeServices;
     ctx->timeout_sec     = 5;
     ctx->verbose         = FALSE;
-    ctx->targets.count   = 0;
     ctx->selected        = 0;
+    sb_targets_init(&ctx->targets);
+
+    sb_timer_init(ctx->boot_services);
 
     /* Parse our own command-line for flags (e.g. "verbose"). */
     {
@@ -117,10 +187,27 @@ sb_init_context(EFI_HANDLE image, EFI_SYSTEM_TABLE *st,
         EFI_STATUS s = ctx->boot_services->HandleProtocol(
                             image, &gEfiLoadedImageProtocolGuid,
                             (void **)&loaded);
-        if (!EFI_ERROR(s) && loaded->LoadOptions) {
-            CHAR16 *opts = (CHAR16 *)loaded->LoadOptions;
+        CHAR16 *opts = NULL;
+        if (!EFI_ERROR(s)) {
+            opts = loaded->LoadOptionsSize >= sizeof(CHAR16)
+                   ? (CHAR16 *)loaded->LoadOptions
+                   : sb_read_options_file(loaded->DeviceHandle);
+        }
+        if (opts) {
             if (sb_stristr16(opts, L"verbose"))
                 ctx->verbose = TRUE;
+            if (sb_stristr16(opts, L"iotrace"))
+                ctx->iotrace = TRUE;
+            if (sb_stristr16(opts, L"bench"))
+                ctx->bench = TRUE;
+            if (sb_stristr16(opts, L"textmode"))
+                ctx->textmode = TRUE;
+            if (sb_stristr16(opts, L"control"))
+                ctx->control = TRUE;
+            /* Takes the rest of the options: see tui/control.c. */
+            CHAR16 *script = sb_stristr16(opts, L"script=");
+            if (script)
+                ctx->script = script + 7;
         }
     }
 
@@ -133,6 +220,11 @@ sb_boot_selected(SuperBootContext *ctx)
     const BootTarget *t = &ctx->targets.entries[ctx->selected];
 
     SB_LOG(L"Booting: %s", t->title);
+    sb_control_mark(L"boot");
+
+    /* Stop the scan if the user picked an entry before it finished,
+     * and release the scheduler tick. */
+    sb_sched_shutdown();
 
     if (t->is_chainload)
         return sb_chainload_efi(ctx, t);
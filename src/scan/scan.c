@@ -10,6 +10,19 @@
 #include "../config/config.h"
 #include "../fs/vfs.h"
 
+/* Under the menu (a rescan, or the scan outliving the first frame)
+ * console output would land on top of the shadow screen, which never
+ * learns it is there: progress is only printed before the menu is up. */
+#define SCAN_LOG(ctx, fmt, ...) do {                            \
+    if (!(ctx)->tui_active)                                     \
+        SB_LOG(fmt, ##__VA_ARGS__);                             \
+} while (0)
+
+#define SCAN_DBG(ctx, fmt, ...) do {                            \
+    if (!(ctx)->tui_active)                                     \
+        SB_DBG(ctx, fmt, ##__VA_ARGS__);                        \
+} while (0)
+
 /* ------------------------------------------------------------------ */
 /*  Probe a single partition for boot configs                          */
 /* ------------------------------------------------------------------ */
@@ -30,40 +43,44 @@ scan_partition(SuperBootContext *ctx, EFI_HANDLE device)
     for (const ConfigParser **pp = parsers; *pp; pp++) {
         const ConfigParser *parser = *pp;
 
-        /* Try each config path this parser knows about. */
+        /* Try each config path this parser knows about.  Reading it
+         * is the existence probe: a miss costs one path lookup. */
         for (const CHAR16 **path = parser->config_paths; *path; path++) {
-            if (!sb_vfs_file_exists(device, *path))
-                continue;
+            SbArenaMark mark = sb_arena_mark(&sb_scratch);
 
-            SB_DBG(ctx, L"Found %s: %s", parser->name, *path);
-
-            /* Read the config file. */
             void  *data = NULL;
             UINTN  size = 0;
-            status = sb_vfs_read_file(device, *path, &data, &size);
-            if (EFI_ERROR(status))
+            status = sb_vfs_read_file_arena(device, *path, &sb_scratch,
+                                            &data, &size);
+            if (EFI_ERROR(status)) {
+                sb_arena_reset(&sb_scratch, mark);
                 continue;
-
-            /* Parse it. */
-            UINTN remaining = SB_MAX_TARGETS - ctx->targets.count;
-            if (remaining == 0) {
-                FreePool(data);
-                return EFI_SUCCESS;
             }
 
-            UINTN found = 0;
+            SCAN_DBG(ctx, L"Found %s: %s", parser->name, *path);
+
+            /* Parse it. */
+            UINTN before = ctx->targets.count;
+            UINTN found  = 0;
             status = parser->parse(
                          (CHAR8 *)data, size, device, *path,
-                         &ctx->targets.entries[ctx->targets.count],
-                         &found, remaining);
-
-            if (!EFI_ERROR(status) && found > 0) {
-                SB_LOG(L"  %s: %u entries from %s",
-                       parser->name, found, *path);
-                ctx->targets.count += found;
+                         &ctx->targets, &found);
+
+            /* On a hard failure keep the entries the parser completed
+             * and discard the one it was building. */
+            if (EFI_ERROR(status)) {
+                ctx->targets.count = before + found;
+                SCAN_LOG(ctx, L"WARN: %s: %s: %r",
+                         parser->name, *path, status);
             }
 
-            FreePool(data);
+            if (found > 0)
+                SCAN_LOG(ctx, L"  %s: %u entries from %s",
+                         parser->name, found, *path);
+
+            /* The config text and anything the parser borrowed from
+             * the scratch arena are dead once parse() returns. */
+            sb_arena_reset(&sb_scratch, mark);
 
             /* Only use the first matching config path per parser
              * per partition (e.g., don't parse both /boot/grub/grub.cfg
@@ -76,43 +93,62 @@ scan_partition(SuperBootContext *ctx, EFI_HANDLE device)
 }
 
 /* ------------------------------------------------------------------ */
-/*  Public API: scan all connected block devices                       */
+/*  Scan task: one partition per step                                  */
 /* ------------------------------------------------------------------ */
 
-EFI_STATUS
-sb_scan_all_devices(SuperBootContext *ctx)
-{
-    EFI_STATUS status;
-    EFI_HANDLE *handles = NULL;
-    UINTN       handle_count = 0;
+static struct {
+    SuperBootContext *ctx;
+    EFI_HANDLE       *handles;
+    UINTN             count;
+    UINTN             next;
+    SbTask            task;
+} scan;
 
-    SB_LOG(L"Scanning for bootable configurations...");
+static void
+scan_release(void)
+{
+    if (scan.handles)
+        FreePool(scan.handles);
+    scan.handles = NULL;
+    scan.ctx->scan_done = TRUE;
+}
 
-    /*
-     * Enumerate all handles that provide the Block I/O protocol.
-     * This includes both whole-disk devices and individual partitions.
-     * We only care about partitions (logical partitions have
-     * BlockIO->Media->LogicalPartition == TRUE).
-     */
-    status = ctx->boot_services->LocateHandleBuffer(
-                 ByProtocol,
-                 &gEfiBlockIoProtocolGuid,
-                 NULL,
-                 &handle_count,
-                 &handles);
-    if (EFI_ERROR(status)) {
-        SB_LOG(L"No block devices found.");
-        return status;
+static void
+scan_finish(void)
+{
+    SuperBootContext *ctx = scan.ctx;
+
+    scan_release();
+    sb_control_mark(L"scan-done");
+
+    SCAN_DBG(ctx, L"Targets: %u entries, %u unique strings (%u bytes, "
+                  L"%u intern calls)",
+             ctx->targets.count, ctx->targets.strings.count,
+             ctx->targets.strings.bytes, ctx->targets.strings.lookups);
+    SCAN_DBG(ctx, L"Scratch: %u allocations from %u page blocks "
+                  L"(%u pages)",
+             sb_scratch.allocs, sb_scratch.block_allocs, sb_scratch.pages);
+
+    if (ctx->targets.count > 0) {
+        SCAN_LOG(ctx, L"Found %u bootable entries.", ctx->targets.count);
+        if (ctx->verbose && !ctx->tui_active)
+            sb_mem_summary();
     }
+}
 
-    SB_LOG(L"Found %u block I/O handles.", handle_count);
+static SbTaskStatus
+scan_step(SbTask *t)
+{
+    SuperBootContext *ctx = scan.ctx;
+
+    while (scan.next < scan.count) {
+        UINTN i = scan.next++;
 
-    for (UINTN i = 0; i < handle_count; i++) {
         /* Filter: only scan logical partitions, not whole disks. */
         EFI_BLOCK_IO_PROTOCOL *block_io;
-        status = ctx->boot_services->HandleProtocol(
-                     handles[i], &gEfiBlockIoProtocolGuid,
-                     (void **)&block_io);
+        EFI_STATUS status = ctx->boot_services->HandleProtocol(
+                                scan.handles[i], &gEfiBlockIoProtocolGuid,
+                                (void **)&block_io);
         if (EFI_ERROR(status))
             continue;
 
@@ -123,18 +159,76 @@ sb_scan_all_devices(SuperBootContext *ctx)
         if (!block_io->Media->MediaPresent)
             continue;
 
-        SB_DBG(ctx, L"Scanning partition handle %u (MediaId=%u, BlockSize=%u)",
-               i, block_io->Media->MediaId,
-               block_io->Media->BlockSize);
+        SCAN_DBG(ctx, L"Scanning partition handle %u (MediaId=%u, "
+                      L"BlockSize=%u)",
+                 i, block_io->Media->MediaId,
+                 block_io->Media->BlockSize);
 
-        scan_partition(ctx, handles[i]);
+        /* Per-partition scope: drop whatever the probe and parsers
+         * left in the scratch arena. */
+        SbArenaMark mark = sb_arena_mark(&sb_scratch);
+        scan_partition(ctx, scan.handles[i]);
+        sb_arena_reset(&sb_scratch, mark);
 
-        if (ctx->targets.count >= SB_MAX_TARGETS)
-            break;
+        /* One partition per step keeps input responsive. */
+        return SB_TASK_YIELD;
     }
 
-    if (handles)
-        FreePool(handles);
+    scan_finish();
+    return SB_TASK_DONE;
+}
+
+static void
+scan_cancel(SbTask *t)
+{
+    scan_release();
+}
+
+/* ------------------------------------------------------------------ */
+/*  Public API                                                         */
+/* ------------------------------------------------------------------ */
+
+/*
+ * Start scanning every connected block device as a background task.
+ * ctx->scan_done becomes TRUE when it finishes (or is cancelled);
+ * entries are appended to ctx->targets as they are found.
+ */
+EFI_STATUS
+sb_scan_start(SuperBootContext *ctx)
+{
+    EFI_STATUS status;
+
+    SetMem(&scan, sizeof(scan), 0);
+    scan.ctx       = ctx;
+    ctx->scan_done = FALSE;
 
-    return (ctx->targets.count > 0) ? EFI_SUCCESS : EFI_NOT_FOUND;
+    SCAN_LOG(ctx, L"Scanning for bootable configurations...");
+    sb_control_mark(L"scan-start");
+
+    /*
+     * Enumerate all handles that provide the Block I/O protocol.
+     * This includes both whole-disk devices and individual partitions.
+     * We only care about partitions (logical partitions have
+     * BlockIO->Media->LogicalPartition == TRUE).
+     */
+    status = ctx->boot_services->LocateHandleBuffer(
+                 ByProtocol,
+                 &gEfiBlockIoProtocolGuid,
+                 NULL,
+                 &scan.count,
+                 &scan.handles);
+    if (EFI_ERROR(status)) {
+        SCAN_LOG(ctx, L"No block devices found.");
+        ctx->scan_done = TRUE;
+        return status;
+    }
+
+    SCAN_LOG(ctx, L"Found %u block I/O handles.", scan.count);
+
+    scan.task.name   = L"scan";
+    scan.task.prio   = SB_PRIO_BACKGROUND;
+    scan.task.step   = scan_step;
+    scan.task.cancel = scan_cancel;
+    sb_sched_add(&scan.task);
+    return EFI_SUCCESS;
 }
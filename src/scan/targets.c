@@ -0,0 +1,225 @@
+/*
+ * targets.c — Growable BootTarget list
+ *
+ * Parsers build entries in place: sb_targets_append() hands out a
+ * fresh entry at the end of the list, the parser fills it with strings
+ * interned in list->strings, and sb_targets_finish() decides whether
+ * it stays.  Entries are small fixed-size records, so the menu walks a
+ * dense array.  Kept entries are also indexed in an open-addressed set
+ * hashed on their (interned) string pointers, so duplicate detection
+ * costs one probe rather than a pass over the list.
+ */
+
+#include "scan.h"
+
+#define TARGETS_MIN_CAPACITY  16
+#define TARGETS_MIN_SLOTS     64
+#define INITRDS_MIN_CAPACITY  4
+
+void
+sb_targets_init(BootTargetList *list)
+{
+    SetMem(list, sizeof(*list), 0);
+    sb_strpool_init(&list->strings);
+}
+
+void
+sb_targets_free(BootTargetList *list)
+{
+    sb_free(list->entries);
+    sb_free(list->slots);
+    sb_strpool_free(&list->strings);
+    SetMem(list, sizeof(*list), 0);
+}
+
+static BOOLEAN
+grow(BootTargetList *list)
+{
+    UINTN cap = list->capacity ? list->capacity * 2 : TARGETS_MIN_CAPACITY;
+    BootTarget *entries = sb_malloc(SB_MEM_CORE, cap * sizeof(BootTarget));
+    if (!entries)
+        return FALSE;
+
+    if (list->entries) {
+        CopyMem(entries, list->entries, list->count * sizeof(BootTarget));
+        sb_free(list->entries);
+    }
+    list->entries  = entries;
+    list->capacity = cap;
+    return TRUE;
+}
+
+/*
+ * Append a zeroed entry whose string fields are all "".  Returns NULL
+ * on allocation failure.  The pointer is only valid until the next
+ * append.
+ */
+BootTarget *
+sb_targets_append(BootTargetList *list)
+{
+    if (list->count == list->capacity && !grow(list))
+        return NULL;
+
+    const CHAR16 *empty16 = sb_intern16(&list->strings, L"");
+    const CHAR8  *empty8  = sb_intern8(&list->strings, "");
+    if (!empty16 || !empty8)
+        return NULL;
+
+    BootTarget *t = &list->entries[list->count++];
+    SetMem(t, sizeof(*t), 0);
+    t->title       = empty16;
+    t->kernel_path = empty16;
+    t->cmdline     = empty8;
+    t->config_path = empty16;
+    t->efi_path    = empty16;
+    return t;
+}
+
+static BOOLEAN
+same_target(const BootTarget *a, const BootTarget *b)
+{
+    /* Interned strings: pointer equality is string equality. */
+    if (a->device_handle != b->device_handle ||
+        a->is_chainload  != b->is_chainload  ||
+        a->title         != b->title         ||
+        a->kernel_path   != b->kernel_path   ||
+        a->cmdline       != b->cmdline       ||
+        a->efi_path      != b->efi_path      ||
+        a->initrd_count  != b->initrd_count)
+        return FALSE;
+
+    for (UINT32 i = 0; i < a->initrd_count; i++) {
+        if (a->initrd_paths[i] != b->initrd_paths[i])
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Duplicate set                                                      */
+/* ------------------------------------------------------------------ */
+
+/* Interned strings: hashing the pointers hashes the strings. */
+static UINT64
+target_hash(const BootTarget *t)
+{
+    UINT64 h = 14695981039346656037ull;       /* FNV-1a over words */
+#define MIX(v)  (h = (h ^ (UINT64)(UINTN)(v)) * 1099511628211ull)
+    MIX(t->device_handle);
+    MIX(t->is_chainload);
+    MIX(t->title);
+    MIX(t->kernel_path);
+    MIX(t->cmdline);
+    MIX(t->efi_path);
+    for (UINT32 i = 0; i < t->initrd_count; i++)
+        MIX(t->initrd_paths[i]);
+#undef MIX
+    return h ^ (h >> 29);
+}
+
+static BOOLEAN
+grow_slots(BootTargetList *list)
+{
+    UINTN new_count = list->slot_count ? list->slot_count * 2
+                                       : TARGETS_MIN_SLOTS;
+    UINT32 *slots = sb_zalloc(SB_MEM_CORE, new_count * sizeof(*slots));
+    if (!slots)
+        return FALSE;
+
+    for (UINTN i = 0; i < list->slot_count; i++) {
+        UINT32 e = list->slots[i];
+        if (e == 0 || e > list->count)
+            continue;
+        UINTN j = target_hash(&list->entries[e - 1]) & (new_count - 1);
+        while (slots[j])
+            j = (j + 1) & (new_count - 1);
+        slots[j] = e;
+    }
+
+    sb_free(list->slots);
+    list->slots = slots;
+    list->slot_count = new_count;
+    return TRUE;
+}
+
+/*
+ * Add the last entry to the set unless an identical one is already
+ * there.  FALSE for a duplicate, or if the set cannot grow.
+ */
+static BOOLEAN
+insert_unique(BootTargetList *list)
+{
+    /* Keep the load factor under 3/4. */
+    if ((list->slot_used + 1) * 4 > list->slot_count * 3 &&
+        !grow_slots(list))
+        return FALSE;
+
+    const BootTarget *t = &list->entries[list->count - 1];
+    UINTN mask = list->slot_count - 1;
+    UINTN i    = target_hash(t) & mask;
+
+    for (UINT32 e; (e = list->slots[i]) != 0; i = (i + 1) & mask) {
+        /* Entries past count were discarded after a parse error. */
+        if (e < list->count && same_target(&list->entries[e - 1], t))
+            return FALSE;
+    }
+
+    list->slots[i] = (UINT32)list->count;
+    list->slot_used++;
+    return TRUE;
+}
+
+/*
+ * Validate the entry most recently appended.  It is dropped if an
+ * intern failed while filling it, if it has nothing to boot, or if an
+ * identical entry is already listed (e.g. the same config reached
+ * through two paths).  Returns TRUE if the entry was kept.
+ */
+BOOLEAN
+sb_targets_finish(BootTargetList *list)
+{
+    if (list->count == 0)
+        return FALSE;
+
+    BootTarget *t = &list->entries[list->count - 1];
+    BOOLEAN keep = t->title && t->kernel_path && t->cmdline &&
+                   t->config_path && t->efi_path &&
+                   (t->kernel_path[0] != L'\0' || t->is_chainload);
+
+    if (keep)
+        keep = insert_unique(list);
+
+    if (!keep)
+        list->count--;
+    return keep;
+}
+
+/*
+ * Append an initrd path to an entry under construction.  The array
+ * lives in the string pool and doubles when full; the old one is
+ * simply abandoned there.
+ */
+EFI_STATUS
+sb_target_add_initrd(BootTargetList *list, BootTarget *t,
+                     const CHAR16 *path)
+{
+    const CHAR16 *s = sb_intern16(&list->strings, path);
+    if (!s)
+        return EFI_OUT_OF_RESOURCES;
+
+    if (t->initrd_count == t->initrd_capacity) {
+        UINT32 cap = t->initrd_capacity ? t->initrd_capacity * 2
+                                        : INITRDS_MIN_CAPACITY;
+        const CHAR16 **paths = sb_strpool_alloc(&list->strings,
+                                                cap * sizeof(*paths));
+        if (!paths)
+            return EFI_OUT_OF_RESOURCES;
+        for (UINT32 i = 0; i < t->initrd_count; i++)
+            paths[i] = t->initrd_paths[i];
+        t->initrd_paths    = paths;
+        t->initrd_capacity = cap;
+    }
+
+    t->initrd_paths[t->initrd_count++] = s;
+    return EFI_SUCCESS;
+}
@@ -16,8 +16,8 @@
 /*  Build-time limits                                                  */
 /* ------------------------------------------------------------------ */
 
-#define SB_MAX_TARGETS        64   /* max boot entries across all configs */
-#define SB_MAX_INITRDS         8   /* max initrd images per entry        */
+/* Parser scratch-buffer sizes.  BootTargets themselves store interned
+ * strings of any length; these bound single tokens while parsing. */
 #define SB_MAX_PATH          512
 #define SB_MAX_TITLE         256
 #define SB_MAX_CMDLINE      4096
@@ -36,49 +36,193 @@ typedef enum {
     CONFIG_TYPE_LIMINE,          /* limine.cfg                       */
 } ConfigType;
 
+/* ------------------------------------------------------------------ */
+/*  Memory accounting tags (util/memory.c)                             */
+/*                                                                     */
+/*  Every pool and page allocation is charged to a subsystem.  Live    */
+/*  and peak bytes per tag are always tracked; building with           */
+/*  DEBUG_ALLOC=1 additionally records the call site of every live     */
+/*  allocation so leaks can be listed.                                 */
+/* ------------------------------------------------------------------ */
+
+typedef enum {
+    SB_MEM_CORE = 0,             /* context, target list, strings    */
+    SB_MEM_SCAN,                 /* scan-lifetime scratch arena      */
+    SB_MEM_CONFIG,               /* config parsers                   */
+    SB_MEM_VFS,                  /* mounts and driver state          */
+    SB_MEM_FILE,                 /* whole-file buffers from the VFS  */
+    SB_MEM_BOOT,                 /* kernel, initrd, boot_params      */
+    SB_MEM_TUI,
+    SB_MEM_DEPLOY,
+    SB_MEM_TRACE,                /* I/O trace recorder               */
+    SB_MEM_TAG_COUNT
+} SbMemTag;
+
+/* Tags whose allocations must all be gone once sb_vfs_shutdown() has
+ * run: anything still live there is a leak. */
+#define SB_MEM_SCAN_LIFETIME \
+    ((1U << SB_MEM_SCAN) | (1U << SB_MEM_CONFIG) | \
+     (1U << SB_MEM_VFS)  | (1U << SB_MEM_TRACE))
+
+/* ------------------------------------------------------------------ */
+/*  SbArena — region allocator (util/memory.c)                         */
+/*                                                                     */
+/*  Bump allocation from page-sized blocks; nothing is freed           */
+/*  individually.  sb_arena_mark()/sb_arena_reset() bracket a unit of  */
+/*  work, sb_arena_release() hands all pages back to the firmware.     */
+/* ------------------------------------------------------------------ */
+
+#define SB_SCRATCH_BLOCK_SIZE  (256 * 1024)
+
+typedef struct SbArenaBlock SbArenaBlock;
+
+typedef struct {
+    SbArenaBlock *blocks;          /* in use, newest first             */
+    SbArenaBlock *spare;           /* emptied by a reset, reused       */
+    UINTN         block_size;      /* minimum size of a new block      */
+    UINTN         pages;           /* pages held from the firmware     */
+    UINTN         allocs;          /* sb_arena_alloc() calls           */
+    UINTN         block_allocs;    /* AllocatePages() calls            */
+    SbMemTag      tag;             /* accounting tag for its pages     */
+} SbArena;
+
+typedef struct {
+    SbArenaBlock *block;
+    UINTN         used;
+} SbArenaMark;
+
+/* ------------------------------------------------------------------ */
+/*  SbStrPool — interned string storage (util/strpool.c)               */
+/*                                                                     */
+/*  Strings are immutable once interned and live as long as the pool.  */
+/*  Equal strings share one copy, so equality is pointer equality.     */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    SbArena          arena;        /* string storage                   */
+    struct SbStrHdr **slots;       /* open-addressed hash set          */
+    UINTN            slot_count;   /* power of two                     */
+    UINTN            count;        /* distinct strings                 */
+    UINTN            bytes;        /* storage used                     */
+    UINTN            lookups;      /* intern calls                     */
+} SbStrPool;
+
+/* ------------------------------------------------------------------ */
+/*  SbSha256 — streaming SHA-256 state (util/sha256.c)                 */
+/* ------------------------------------------------------------------ */
+
+#define SB_SHA256_SIZE  32
+
+typedef struct {
+    UINT32   state[8];
+    UINT8    buf[64];          /* partial block                    */
+    UINTN    buf_len;
+    UINT64   length;           /* bytes hashed so far              */
+    UINT64   busy_us;          /* time spent hashing               */
+    BOOLEAN  use_shani;
+} SbSha256;
+
+/* ------------------------------------------------------------------ */
+/*  SbJob — one unit of pure-CPU work for the worker pool              */
+/*  (util/workers.c).  run() may execute on any processor and must not */
+/*  call firmware or the allocator.                                    */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    void  (*run)(void *arg);
+    void   *arg;
+} SbJob;
+
+/* ------------------------------------------------------------------ */
+/*  SbTask — cooperative task (util/sched.c)                           */
+/* ------------------------------------------------------------------ */
+
+typedef enum {
+    SB_PRIO_INPUT,             /* key handling: always first       */
+    SB_PRIO_UI,                /* redraws, countdowns              */
+    SB_PRIO_BACKGROUND,        /* scanning, preloading             */
+    SB_PRIO_COUNT
+} SbTaskPrio;
+
+typedef enum {
+    SB_TASK_YIELD,             /* ready again immediately          */
+    SB_TASK_BLOCK,             /* sleep until wait / wake_us / wake */
+    SB_TASK_DONE               /* finished; remove from scheduler  */
+} SbTaskStatus;
+
+typedef struct SbTask SbTask;
+
+struct SbTask {
+    const CHAR16  *name;
+    SbTaskPrio     prio;
+    SbTaskStatus (*step)(SbTask *t);
+    void         (*cancel)(SbTask *t);   /* optional cleanup        */
+    void          *data;
+
+    /* Set by step() before returning SB_TASK_BLOCK. */
+    EFI_EVENT      wait;       /* waitable (non-NOTIFY_SIGNAL) event */
+    UINT64         wake_us;    /* sb_time_us() deadline, 0 = none  */
+
+    /* Scheduler-private. */
+    BOOLEAN        ready;
+    SbTask        *next;
+};
+
 /* ------------------------------------------------------------------ */
 /*  BootTarget — the universal "parsed boot entry"                     */
 /*                                                                     */
 /*  Every config parser produces an array of these.  The kernel        */
 /*  loader consumes them.  This struct is the central abstraction      */
 /*  that decouples parsing from booting.                               */
+/*                                                                     */
+/*  String fields point into the owning list's string pool and are     */
+/*  never NULL; an absent value is the empty string.                   */
 /* ------------------------------------------------------------------ */
 
 typedef struct {
     /* Human-readable label shown in the TUI menu. */
-    CHAR16      title[SB_MAX_TITLE];
+    const CHAR16   *title;
 
     /* Absolute paths on the source filesystem. */
-    CHAR16      kernel_path[SB_MAX_PATH];
-    CHAR16      initrd_paths[SB_MAX_INITRDS][SB_MAX_PATH];
-    UINT32      initrd_count;
+    const CHAR16   *kernel_path;
+    const CHAR16  **initrd_paths;      /* initrd_count entries */
+    UINT32          initrd_count;
+    UINT32          initrd_capacity;   /* slots in initrd_paths */
 
     /* Kernel command line (ASCII, as the Linux protocol requires). */
-    CHAR8       cmdline[SB_MAX_CMDLINE];
+    const CHAR8    *cmdline;
 
     /* Where this entry came from. */
-    CHAR16      config_path[SB_MAX_PATH];
-    ConfigType  config_type;
+    const CHAR16   *config_path;
+    ConfigType      config_type;
 
     /* UEFI handle of the block device / partition. */
-    EFI_HANDLE  device_handle;
+    EFI_HANDLE      device_handle;
 
     /* If TRUE, this entry should chain-load an .efi instead. */
-    BOOLEAN     is_chainload;
-    CHAR16      efi_path[SB_MAX_PATH];
+    BOOLEAN         is_chainload;
+    const CHAR16   *efi_path;
 
     /* Ordering hint (0 = default entry). */
-    UINT32      index;
-    BOOLEAN     is_default;
+    UINT32          index;
+    BOOLEAN         is_default;
 } BootTarget;
 
 /* ------------------------------------------------------------------ */
 /*  BootTargetList — collected results from scanning                   */
+/*                                                                     */
+/*  A growable heap array; entries may move when it grows, so never    */
+/*  hold a BootTarget pointer across sb_targets_append().              */
 /* ------------------------------------------------------------------ */
 
 typedef struct {
-    BootTarget  entries[SB_MAX_TARGETS];
-    UINTN       count;
+    BootTarget  *entries;
+    UINTN        count;
+    UINTN        capacity;
+    SbStrPool    strings;
+    UINT32      *slots;        /* open-addressed set: entry index + 1 */
+    UINTN        slot_count;   /* power of two                     */
+    UINTN        slot_used;
 } BootTargetList;
 
 /* ------------------------------------------------------------------ */
@@ -94,12 +238,32 @@ typedef struct {
     /* Collected boot targets from all scanned devices. */
     BootTargetList          targets;
 
+    /* TRUE once the (background) device scan has finished. */
+    BOOLEAN                 scan_done;
+
+    /* TRUE while the menu owns the screen: nothing else may Print(). */
+    BOOLEAN                 tui_active;
+
     /* The target the user selected (index into targets.entries). */
     UINTN                   selected;
 
     /* Configuration: timeout in seconds, 0 = immediate boot. */
     UINT32                  timeout_sec;
     BOOLEAN                 verbose;
+
+    /* Record every built-in-driver disk read (fs/iotrace.c). */
+    BOOLEAN                 iotrace;
+
+    /* Run the CPU benchmark at startup (util/bench.c). */
+    BOOLEAN                 bench;
+
+    /* Draw the menu through ConOut even if GOP is present (tui/gop.c). */
+    BOOLEAN                 textmode;
+
+    /* Automation (tui/control.c): take commands from a serial port,
+     * and/or run the script= load option (points into LoadOptions). */
+    BOOLEAN                 control;
+    const CHAR16           *script;
 } SuperBootContext;
 
 /* ------------------------------------------------------------------ */
@@ -127,7 +291,15 @@ typedef struct {
 /* ------------------------------------------------------------------ */
 
 /* scan/scan.c */
-EFI_STATUS sb_scan_all_devices(SuperBootContext *ctx);
+EFI_STATUS sb_scan_start(SuperBootContext *ctx);
+
+/* scan/targets.c */
+void        sb_targets_init(BootTargetList *list);
+void        sb_targets_free(BootTargetList *list);
+BootTarget *sb_targets_append(BootTargetList *list);
+BOOLEAN     sb_targets_finish(BootTargetList *list);
+EFI_STATUS  sb_target_add_initrd(BootTargetList *list, BootTarget *t,
+                                 const CHAR16 *path);
 
 /* config/config.c */
 EFI_STATUS sb_parse_configs(SuperBootContext *ctx, EFI_HANDLE device);
@@ -141,6 +313,18 @@ EFI_STATUS sb_chainload_efi(SuperBootContext *ctx, const BootTarget *target);
 /* tui/menu.c */
 EFI_STATUS sb_tui_run_menu(SuperBootContext *ctx);
 
+/* tui/control.c */
+typedef enum {
+    SB_CONTROL_IDLE,           /* nothing to act on                */
+    SB_CONTROL_CHANGED,        /* selection or entries changed     */
+    SB_CONTROL_BOOT            /* boot ctx->selected now           */
+} SbControlAction;
+
+void            sb_control_init(SuperBootContext *ctx);
+BOOLEAN         sb_control_active(void);
+SbControlAction sb_control_poll(SuperBootContext *ctx);
+void            sb_control_mark(const CHAR16 *name);
+
 /* tui/explorer.c */
 EFI_STATUS sb_tui_file_browser(SuperBootContext *ctx);
 
@@ -149,16 +333,20 @@ EFI_STATUS sb_deploy_to_esp(SuperBootContext *ctx);
 
 /* fs/vfs.c */
 EFI_STATUS sb_vfs_init(SuperBootContext *ctx);
+/* *buffer comes from sb_malloc(): release it with sb_free(). */
 EFI_STATUS sb_vfs_read_file(EFI_HANDLE device, const CHAR16 *path,
                             void **buffer, UINTN *size);
 void       sb_vfs_shutdown(void);
+void       sb_vfs_unpublish_all(void);     /* see fs/vfs.h */
 
 /* util/string.c */
 INTN    sb_strcmp8(const CHAR8 *a, const CHAR8 *b);
 INTN    sb_strncmp8(const CHAR8 *a, const CHAR8 *b, UINTN n);
 UINTN   sb_strlen8(const CHAR8 *a);
+CHAR8  *sb_strchr8(const CHAR8 *s, CHAR8 c);
 CHAR8  *sb_strstr8(const CHAR8 *haystack, const CHAR8 *needle);
 void    sb_strcpy8(CHAR8 *dst, const CHAR8 *src, UINTN max);
+/* UTF-8 <-> UTF-16; `max` counts destination units, NUL included */
 void    sb_str8to16(CHAR16 *dst, const CHAR8 *src, UINTN max);
 void    sb_str16to8(CHAR8 *dst, const CHAR16 *src, UINTN max);
 CHAR8  *sb_skip_whitespace(CHAR8 *p);
@@ -166,11 +354,89 @@ CHAR8  *sb_next_line(CHAR8 *p);
 BOOLEAN sb_starts_with8(const CHAR8 *s, const CHAR8 *prefix);
 
 /* util/memory.c */
-void   *sb_alloc(EFI_BOOT_SERVICES *bs, UINTN size);
-void   *sb_alloc_pages(EFI_BOOT_SERVICES *bs, UINTN pages,
-                       EFI_PHYSICAL_ADDRESS preferred);
-void    sb_free(EFI_BOOT_SERVICES *bs, void *p, UINTN size);
-void    sb_free_pages(EFI_BOOT_SERVICES *bs, EFI_PHYSICAL_ADDRESS addr,
-                      UINTN pages);
+#ifdef SB_DEBUG_ALLOC
+#define SB_ALLOC_SITE   __FILE__, __LINE__
+#else
+#define SB_ALLOC_SITE   NULL, 0
+#endif
+
+#define sb_malloc(tag, size)  sb_mem_alloc((tag), (size), FALSE, SB_ALLOC_SITE)
+#define sb_zalloc(tag, size)  sb_mem_alloc((tag), (size), TRUE, SB_ALLOC_SITE)
+#define sb_page_alloc(tag, type, pages, addr) \
+    sb_mem_alloc_pages((tag), (type), (pages), (addr), SB_ALLOC_SITE)
+
+void       *sb_mem_alloc(SbMemTag tag, UINTN size, BOOLEAN zero,
+                         const char *file, UINT32 line);
+void        sb_free(void *p);
+EFI_STATUS  sb_mem_alloc_pages(SbMemTag tag, EFI_ALLOCATE_TYPE type,
+                               UINTN pages, EFI_PHYSICAL_ADDRESS *addr,
+                               const char *file, UINT32 line);
+void        sb_page_free(EFI_PHYSICAL_ADDRESS addr, UINTN pages);
+void        sb_mem_summary(void);
+const CHAR16 *sb_mem_usage(UINTN tag, UINTN *live, UINTN *peak,
+                           UINTN *allocs);
+UINTN       sb_mem_check_leaks(UINT32 tag_mask);
+
+extern SbArena sb_scratch;
+
+void        sb_arena_init(SbArena *a, UINTN block_size, SbMemTag tag);
+void       *sb_arena_alloc(SbArena *a, UINTN size);
+void       *sb_arena_zalloc(SbArena *a, UINTN size);
+SbArenaMark sb_arena_mark(SbArena *a);
+void        sb_arena_reset(SbArena *a, SbArenaMark m);
+void        sb_arena_release(SbArena *a);
+
+/* util/strpool.c */
+void          sb_strpool_init(SbStrPool *pool);
+void          sb_strpool_free(SbStrPool *pool);
+void         *sb_strpool_alloc(SbStrPool *pool, UINTN size);
+const CHAR8  *sb_intern8(SbStrPool *pool, const CHAR8 *s);
+const CHAR16 *sb_intern16(SbStrPool *pool, const CHAR16 *s);
+const CHAR16 *sb_intern8to16(SbStrPool *pool, const CHAR8 *s);
+
+/* util/timer.c */
+void    sb_timer_init(EFI_BOOT_SERVICES *bs);
+UINT64  sb_time_us(void);
+
+/* util/cpu.c */
+#define SB_CPU_SSE2     0x0001
+#define SB_CPU_SSSE3    0x0002
+#define SB_CPU_SSE41    0x0004
+#define SB_CPU_AVX2     0x0008     /* only if the firmware enabled YMM state */
+#define SB_CPU_SHA      0x0010
+#define SB_CPU_ERMS     0x0020     /* enhanced REP MOVSB/STOSB */
+#define SB_CPU_FSRM     0x0040     /* fast short REP MOVSB */
+
+BOOLEAN sb_cpu_has(UINT32 features);
+
+/* util/memops.c — bulk copy/fill; sb_memcpy buffers must not overlap */
+void   *sb_memcpy(void *dst, const void *src, UINTN n);
+void   *sb_memset(void *dst, UINT8 value, UINTN n);
+
+/* util/sha256.c */
+void          sb_sha256_init(SbSha256 *ctx);
+void          sb_sha256_update(SbSha256 *ctx, const void *data, UINTN len);
+void          sb_sha256_final(SbSha256 *ctx, UINT8 digest[SB_SHA256_SIZE]);
+const CHAR16 *sb_sha256_impl(const SbSha256 *ctx);
+
+/* util/workers.c */
+UINTN       sb_workers_init(SuperBootContext *ctx);
+EFI_STATUS  sb_workers_start(void);
+void        sb_workers_stop(void);
+UINTN       sb_workers_count(void);
+void        sb_workers_submit(SbJob *jobs, UINTN count);
+void        sb_workers_wait(void);
+void        sb_workers_run(SbJob *jobs, UINTN count);
+
+/* util/sched.c */
+EFI_STATUS  sb_sched_init(SuperBootContext *ctx);
+void        sb_sched_add(SbTask *t);
+void        sb_sched_cancel(SbTask *t);
+void        sb_sched_wake(SbTask *t);
+void        sb_sched_run(const BOOLEAN *stop);
+void        sb_sched_shutdown(void);
+
+/* util/bench.c */
+EFI_STATUS  sb_bench_run(SuperBootContext *ctx);
 
 #endif /* SUPERBOOT_H */
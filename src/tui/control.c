@@ -0,0 +1,574 @@
+/*
+ * control.c — Line-based automation protocol and boot-time marks
+ *
+ * A test harness drives SuperBoot without keystrokes, one command per
+ * line, from two sources:
+ *
+ *   control          load option: read commands from a Serial I/O port
+ *                    (the last one the firmware exposes, so under QEMU
+ *                    a second -serial is a private channel while the
+ *                    first carries the console)
+ *   script=A;B;...   load option: run these commands first; it must be
+ *                    the last option, as it takes the rest of the line
+ *
+ * Replies go to the control port, or to the console when there is
+ * none.  Every protocol line starts with "@sb " so it can be picked
+ * out of firmware and kernel output, and carries key=value fields
+ * (strings double-quoted, '"' and '\' escaped):
+ *
+ *   list               @sb entry id=0 type=grub default=1 ... per entry
+ *   select N           make entry N the selection
+ *   cmdline TEXT       replace the selected entry's command line
+ *   wait               reply once the scan has finished
+ *   rescan             clear the entries and scan again (mounts stay)
+ *   stats              entry, string pool and memory counters
+ *   profile            the boot-time marks so far
+ *   boot [N]           boot the selection (or entry N)
+ *   reset              cold reset
+ *   hello, help
+ *
+ * Each command ends with "@sb ok <cmd> ..." or "@sb err <cmd> <why>".
+ * Any command cancels the auto-boot countdown, as a key does.
+ *
+ * sb_control_mark() timestamps a point in the boot (scan start, first
+ * menu frame, kernel entry...) for "profile", and announces it as
+ * "@sb mark name=... t=<us>" while the channel is open.
+ */
+
+#include "tui.h"
+
+#define CONTROL_PROTO       1
+#define CONTROL_LINE_MAX    (SB_MAX_CMDLINE + 64)
+#define CONTROL_MAX_MARKS   32
+
+typedef struct {
+    const CHAR16  *name;
+    UINT64         us;
+} ControlMark;
+
+static struct {
+    EFI_SERIAL_IO_PROTOCOL *serial;     /* NULL: reply on the console */
+    BOOLEAN                 active;
+    CHAR8                  *script;     /* rest of script=, or NULL    */
+    CHAR8                   line[CONTROL_LINE_MAX];
+    UINTN                   line_len;
+    BOOLEAN                 waiting;    /* "wait" until the scan ends  */
+} ctl;
+
+static ControlMark marks[CONTROL_MAX_MARKS];
+static UINTN       mark_count;
+
+/* ------------------------------------------------------------------ */
+/*  Replies                                                            */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    CHAR8   text[CONTROL_LINE_MAX];
+    UINTN   len;
+} Reply;
+
+/* Append, leaving room for the line ending. */
+static void
+reply_put(Reply *r, const CHAR8 *s)
+{
+    while (*s && r->len + 3 < CONTROL_LINE_MAX)
+        r->text[r->len++] = *s++;
+}
+
+static void
+reply_begin(Reply *r, const CHAR8 *kind)
+{
+    r->len = 0;
+    reply_put(r, "@sb ");
+    reply_put(r, kind);
+}
+
+static void
+reply_num(Reply *r, const CHAR8 *key, UINT64 v)
+{
+    CHAR8 digits[24];
+    UINTN n = sizeof(digits);
+    digits[--n] = '\0';
+    do {
+        digits[--n] = (CHAR8)('0' + v % 10);
+        v /= 10;
+    } while (v);
+
+    reply_put(r, " ");
+    reply_put(r, key);
+    reply_put(r, "=");
+    reply_put(r, digits + n);
+}
+
+static void
+reply_str(Reply *r, const CHAR8 *key, const CHAR8 *s)
+{
+    reply_put(r, " ");
+    reply_put(r, key);
+    reply_put(r, "=\"");
+    for (; *s && r->len + 5 < CONTROL_LINE_MAX; s++) {
+        if (*s == '"' || *s == '\\')
+            r->text[r->len++] = '\\';
+        /* Keep every reply on one line. */
+        r->text[r->len++] = (UINT8)*s < 0x20 ? '?' : *s;
+    }
+    reply_put(r, "\"");
+}
+
+static void
+reply_str16(Reply *r, const CHAR8 *key, const CHAR16 *s)
+{
+    CHAR8 utf8[CONTROL_LINE_MAX];
+    sb_str16to8(utf8, s, sizeof(utf8));
+    reply_str(r, key, utf8);
+}
+
+static void
+reply_send(Reply *r)
+{
+    if (ctl.serial) {
+        r->text[r->len++] = '\r';
+        r->text[r->len++] = '\n';
+        UINTN n = r->len;
+        ctl.serial->Write(ctl.serial, &n, r->text);
+    } else {
+        r->text[r->len] = '\0';
+        Print(L"%a\n", r->text);
+    }
+}
+
+static void
+reply_ok(Reply *r, const CHAR8 *cmd)
+{
+    reply_begin(r, "ok ");
+    reply_put(r, cmd);
+}
+
+static void
+reply_err(const CHAR8 *cmd, const CHAR8 *why)
+{
+    Reply r;
+    reply_begin(&r, "err ");
+    reply_put(&r, cmd);
+    reply_put(&r, " ");
+    reply_put(&r, why);
+    reply_send(&r);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Commands                                                           */
+/* ------------------------------------------------------------------ */
+
+/* Decimal argument; FALSE unless `s` is all digits. */
+static BOOLEAN
+parse_index(const CHAR8 *s, UINTN *out)
+{
+    UINTN v = 0;
+    if (!*s)
+        return FALSE;
+    for (; *s; s++) {
+        if (*s < '0' || *s > '9')
+            return FALSE;
+        v = v * 10 + (UINTN)(*s - '0');
+    }
+    *out = v;
+    return TRUE;
+}
+
+static const CHAR8 *
+type_name(ConfigType type)
+{
+    switch (type) {
+    case CONFIG_TYPE_GRUB:          return "grub";
+    case CONFIG_TYPE_SYSTEMD_BOOT:  return "systemd-boot";
+    case CONFIG_TYPE_LIMINE:        return "limine";
+    default:                        return "unknown";
+    }
+}
+
+static SbControlAction
+cmd_hello(SuperBootContext *ctx, CHAR8 *args)
+{
+    Reply r;
+    reply_ok(&r, "hello");
+    reply_num(&r, "proto", CONTROL_PROTO);
+    reply_str(&r, "version", "0.1.0");
+    reply_send(&r);
+    return SB_CONTROL_IDLE;
+}
+
+static SbControlAction
+cmd_list(SuperBootContext *ctx, CHAR8 *args)
+{
+    Reply r;
+    for (UINTN i = 0; i < ctx->targets.count; i++) {
+        const BootTarget *t = &ctx->targets.entries[i];
+        reply_begin(&r, "entry");
+        reply_num(&r, "id", i);
+        reply_str(&r, "type", type_name(t->config_type));
+        reply_num(&r, "default", t->is_default);
+        reply_num(&r, "selected", i == ctx->selected);
+        reply_str16(&r, "title", t->title);
+        if (t->is_chainload) {
+            reply_str16(&r, "efi", t->efi_path);
+        } else {
+            reply_str16(&r, "kernel", t->kernel_path);
+            reply_num(&r, "initrds", t->initrd_count);
+            reply_str(&r, "cmdline", t->cmdline);
+        }
+        reply_send(&r);
+    }
+    reply_ok(&r, "list");
+    reply_num(&r, "count", ctx->targets.count);
+    reply_num(&r, "scan_done", ctx->scan_done);
+    reply_send(&r);
+    return SB_CONTROL_IDLE;
+}
+
+static SbControlAction
+cmd_select(SuperBootContext *ctx, CHAR8 *args)
+{
+    UINTN id;
+    if (!parse_index(args, &id) || id >= ctx->targets.count) {
+        reply_err("select", "no-such-entry");
+        return SB_CONTROL_IDLE;
+    }
+    ctx->selected = id;
+
+    Reply r;
+    reply_ok(&r, "select");
+    reply_num(&r, "id", id);
+    reply_send(&r);
+    return SB_CONTROL_CHANGED;
+}
+
+static SbControlAction
+cmd_cmdline(SuperBootContext *ctx, CHAR8 *args)
+{
+    if (ctx->selected >= ctx->targets.count) {
+        reply_err("cmdline", "no-selection");
+        return SB_CONTROL_IDLE;
+    }
+    const CHAR8 *s = sb_intern8(&ctx->targets.strings, args);
+    if (!s) {
+        reply_err("cmdline", "out-of-memory");
+        return SB_CONTROL_IDLE;
+    }
+    ctx->targets.entries[ctx->selected].cmdline = s;
+
+    Reply r;
+    reply_ok(&r, "cmdline");
+    reply_num(&r, "id", ctx->selected);
+    reply_send(&r);
+    return SB_CONTROL_CHANGED;
+}
+
+static SbControlAction
+cmd_wait(SuperBootContext *ctx, CHAR8 *args)
+{
+    /* Answered from sb_control_poll() once the scan is done. */
+    ctl.waiting = TRUE;
+    return SB_CONTROL_CHANGED;
+}
+
+static SbControlAction
+cmd_rescan(SuperBootContext *ctx, CHAR8 *args)
+{
+    if (!ctx->scan_done) {
+        reply_err("rescan", "busy");
+        return SB_CONTROL_IDLE;
+    }
+    sb_targets_free(&ctx->targets);
+    sb_targets_init(&ctx->targets);
+    ctx->selected = 0;
+    sb_scan_start(ctx);
+
+    /* The scan keeps quiet under the menu, but redraw every cell in
+     * case the firmware printed anything while re-reading disks. */
+    tui_screen_invalidate();
+
+    Reply r;
+    reply_ok(&r, "rescan");
+    reply_send(&r);
+    return SB_CONTROL_CHANGED;
+}
+
+static SbControlAction
+cmd_stats(SuperBootContext *ctx, CHAR8 *args)
+{
+    Reply r;
+    reply_begin(&r, "stat");
+    reply_num(&r, "t", sb_time_us());
+    reply_num(&r, "entries", ctx->targets.count);
+    reply_num(&r, "scan_done", ctx->scan_done);
+    reply_num(&r, "strings", ctx->targets.strings.count);
+    reply_num(&r, "string_bytes", ctx->targets.strings.bytes);
+    reply_num(&r, "scratch_pages", sb_scratch.pages);
+    reply_send(&r);
+
+    UINTN live, peak, allocs;
+    const CHAR16 *name;
+    for (UINTN tag = 0;
+         (name = sb_mem_usage(tag, &live, &peak, &allocs)); tag++) {
+        reply_begin(&r, "mem");
+        reply_str16(&r, "tag", name);
+        reply_num(&r, "live", live);
+        reply_num(&r, "peak", peak);
+        reply_num(&r, "allocs", allocs);
+        reply_send(&r);
+    }
+
+    reply_ok(&r, "stats");
+    reply_send(&r);
+    return SB_CONTROL_IDLE;
+}
+
+static SbControlAction
+cmd_profile(SuperBootContext *ctx, CHAR8 *args)
+{
+    Reply r;
+    for (UINTN i = 0; i < mark_count; i++) {
+        reply_begin(&r, "mark");
+        reply_str16(&r, "name", marks[i].name);
+        reply_num(&r, "t", marks[i].us);
+        reply_send(&r);
+    }
+    reply_ok(&r, "profile");
+    reply_num(&r, "count", mark_count);
+    reply_send(&r);
+    return SB_CONTROL_IDLE;
+}
+
+static SbControlAction
+cmd_boot(SuperBootContext *ctx, CHAR8 *args)
+{
+    UINTN id = ctx->selected;
+    if ((*args && !parse_index(args, &id)) || id >= ctx->targets.count) {
+        reply_err("boot", "no-such-entry");
+        return SB_CONTROL_IDLE;
+    }
+    ctx->selected = id;
+
+    Reply r;
+    reply_ok(&r, "boot");
+    reply_num(&r, "id", id);
+    reply_send(&r);
+    return SB_CONTROL_BOOT;
+}
+
+static SbControlAction
+cmd_reset(SuperBootContext *ctx, CHAR8 *args)
+{
+    Reply r;
+    reply_ok(&r, "reset");
+    reply_send(&r);
+    ctx->runtime_services->ResetSystem(EfiResetCold, EFI_SUCCESS, 0, NULL);
+    return SB_CONTROL_IDLE;
+}
+
+static SbControlAction cmd_help(SuperBootContext *ctx, CHAR8 *args);
+
+static const struct {
+    const CHAR8      *name;
+    SbControlAction (*run)(SuperBootContext *ctx, CHAR8 *args);
+} commands[] = {
+    { "hello",   cmd_hello   },
+    { "list",    cmd_list    },
+    { "select",  cmd_select  },
+    { "cmdline", cmd_cmdline },
+    { "wait",    cmd_wait    },
+    { "rescan",  cmd_rescan  },
+    { "stats",   cmd_stats   },
+    { "profile", cmd_profile },
+    { "boot",    cmd_boot    },
+    { "reset",   cmd_reset   },
+    { "help",    cmd_help    },
+};
+
+#define COMMAND_COUNT (sizeof(commands) / sizeof(commands[0]))
+
+static SbControlAction
+cmd_help(SuperBootContext *ctx, CHAR8 *args)
+{
+    Reply r;
+    reply_ok(&r, "help");
+    for (UINTN i = 0; i < COMMAND_COUNT; i++) {
+        reply_put(&r, " ");
+        reply_put(&r, commands[i].name);
+    }
+    reply_send(&r);
+    return SB_CONTROL_IDLE;
+}
+
+/* Split "cmd args..." in place and run it. */
+static SbControlAction
+dispatch(SuperBootContext *ctx, CHAR8 *line)
+{
+    CHAR8 *cmd = sb_skip_whitespace(line);
+    CHAR8 *args = cmd;
+    while (*args && *args != ' ' && *args != '\t')
+        args++;
+    if (*args)
+        *args++ = '\0';
+    args = sb_skip_whitespace(args);
+
+    /* Trailing blanks are not part of an argument. */
+    UINTN n = sb_strlen8(args);
+    while (n > 0 && (args[n - 1] == ' ' || args[n - 1] == '\t'))
+        args[--n] = '\0';
+
+    if (!*cmd)
+        return SB_CONTROL_IDLE;
+    for (UINTN i = 0; i < COMMAND_COUNT; i++) {
+        if (sb_strcmp8(cmd, commands[i].name) == 0)
+            return commands[i].run(ctx, args);
+    }
+    reply_err(cmd, "unknown-command");
+    return SB_CONTROL_IDLE;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Input                                                              */
+/* ------------------------------------------------------------------ */
+
+/* Next script command into ctl.line. */
+static BOOLEAN
+script_line(void)
+{
+    while (ctl.script && *ctl.script) {
+        CHAR8 *end = ctl.script;
+        while (*end && *end != ';')
+            end++;
+        UINTN n = (UINTN)(end - ctl.script);
+        if (n >= CONTROL_LINE_MAX)
+            n = CONTROL_LINE_MAX - 1;
+        sb_memcpy(ctl.line, ctl.script, n);
+        ctl.line[n] = '\0';
+        ctl.script = *end ? end + 1 : end;
+        if (*sb_skip_whitespace(ctl.line))
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/* Drain the port; TRUE once ctl.line holds a whole line. */
+static BOOLEAN
+serial_line(void)
+{
+    if (!ctl.serial)
+        return FALSE;
+
+    for (;;) {
+        UINT32 control;
+        if (EFI_ERROR(ctl.serial->GetControl(ctl.serial, &control)) ||
+            (control & EFI_SERIAL_INPUT_BUFFER_EMPTY))
+            return FALSE;
+
+        CHAR8 c;
+        UINTN n = 1;
+        if (EFI_ERROR(ctl.serial->Read(ctl.serial, &n, &c)) || n == 0)
+            return FALSE;
+
+        if (c == '\r' || c == '\n') {
+            if (ctl.line_len == 0)
+                continue;
+            ctl.line[ctl.line_len] = '\0';
+            ctl.line_len = 0;
+            return TRUE;
+        }
+        if (ctl.line_len + 1 < CONTROL_LINE_MAX)
+            ctl.line[ctl.line_len++] = c;
+    }
+}
+
+/* ------------------------------------------------------------------ */
+/*  Public API                                                         */
+/* ------------------------------------------------------------------ */
+
+void
+sb_control_init(SuperBootContext *ctx)
+{
+    if (ctx->script) {
+        UINTN n = StrLen(ctx->script) * 3 + 1;     /* UTF-8 worst case */
+        ctl.script = sb_malloc(SB_MEM_CORE, n);
+        if (ctl.script)
+            sb_str16to8(ctl.script, ctx->script, n);
+        ctl.active = TRUE;
+    }
+
+    if (ctx->control) {
+        EFI_HANDLE *handles = NULL;
+        UINTN       count   = 0;
+        EFI_STATUS  s = ctx->boot_services->LocateHandleBuffer(
+                            ByProtocol, &gEfiSerialIoProtocolGuid,
+                            NULL, &count, &handles);
+        if (!EFI_ERROR(s) && count > 0)
+            s = ctx->boot_services->HandleProtocol(
+                    handles[count - 1], &gEfiSerialIoProtocolGuid,
+                    (void **)&ctl.serial);
+        if (EFI_ERROR(s) || count == 0) {
+            ctl.serial = NULL;
+            SB_LOG(L"control: no Serial I/O port, replying on the console");
+        }
+        if (handles)
+            FreePool(handles);
+        ctl.active = TRUE;
+    }
+
+    if (ctl.active) {
+        Reply r;
+        reply_begin(&r, "ready");
+        reply_num(&r, "proto", CONTROL_PROTO);
+        reply_num(&r, "t", sb_time_us());
+        reply_send(&r);
+    }
+}
+
+BOOLEAN
+sb_control_active(void)
+{
+    return ctl.active;
+}
+
+SbControlAction
+sb_control_poll(SuperBootContext *ctx)
+{
+    if (!ctl.active)
+        return SB_CONTROL_IDLE;
+
+    /* Hold further commands until a pending "wait" is answered. */
+    if (ctl.waiting) {
+        if (!ctx->scan_done)
+            return SB_CONTROL_IDLE;
+        ctl.waiting = FALSE;
+        Reply r;
+        reply_ok(&r, "wait");
+        reply_num(&r, "entries", ctx->targets.count);
+        reply_num(&r, "t", sb_time_us());
+        reply_send(&r);
+        return SB_CONTROL_CHANGED;
+    }
+
+    if (!script_line() && !serial_line())
+        return SB_CONTROL_IDLE;
+    return dispatch(ctx, ctl.line);
+}
+
+void
+sb_control_mark(const CHAR16 *name)
+{
+    UINT64 us = sb_time_us();
+    if (mark_count < CONTROL_MAX_MARKS) {
+        marks[mark_count].name = name;
+        marks[mark_count].us   = us;
+        mark_count++;
+    }
+
+    if (ctl.active) {
+        Reply r;
+        reply_begin(&r, "mark");
+        reply_str16(&r, "name", name);
+        reply_num(&r, "t", us);
+        reply_send(&r);
+    }
+}
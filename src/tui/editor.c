@@ -0,0 +1,217 @@
+/*
+ * editor.c — Single-line editor for kernel command lines
+ *
+ * The line is held in a gap buffer: the text before the cursor at the
+ * start of the array, the text after it at the end, and the free space
+ * (the gap) in between.  Typing and deleting at the cursor only move
+ * the gap's edges; moving the cursor moves the characters it passes
+ * across the gap.  Either way the cost is independent of line length,
+ * which matters for a 4 KiB command line on a slow machine.
+ *
+ * The line scrolls horizontally to keep the cursor in view, and is
+ * drawn through the shadow screen, so a keystroke sends the console
+ * only the cells of the field that changed.
+ */
+
+#include "tui.h"
+
+#define EDIT_ATTR_FIELD     (EFI_WHITE | EFI_BACKGROUND_BLACK)
+#define EDIT_ATTR_CURSOR    (EFI_BLACK | EFI_BACKGROUND_LIGHTGRAY)
+#define EDIT_ROW            4
+
+typedef struct {
+    CHAR8  *buf;
+    UINTN   size;
+    UINTN   gap_start;          /* == cursor position               */
+    UINTN   gap_end;            /* first character after the cursor */
+} GapBuffer;
+
+static UINTN
+gb_length(const GapBuffer *g)
+{
+    return g->size - (g->gap_end - g->gap_start);
+}
+
+/* Character at logical position i (< gb_length). */
+static CHAR8
+gb_at(const GapBuffer *g, UINTN i)
+{
+    return g->buf[i < g->gap_start ? i : i + (g->gap_end - g->gap_start)];
+}
+
+static BOOLEAN
+gb_insert(GapBuffer *g, CHAR8 c)
+{
+    if (g->gap_start == g->gap_end)
+        return FALSE;
+    g->buf[g->gap_start++] = c;
+    return TRUE;
+}
+
+static void
+gb_backspace(GapBuffer *g)
+{
+    if (g->gap_start > 0)
+        g->gap_start--;
+}
+
+static void
+gb_delete(GapBuffer *g)
+{
+    if (g->gap_end < g->size)
+        g->gap_end++;
+}
+
+static void
+gb_left(GapBuffer *g)
+{
+    if (g->gap_start > 0)
+        g->buf[--g->gap_end] = g->buf[--g->gap_start];
+}
+
+static void
+gb_right(GapBuffer *g)
+{
+    if (g->gap_end < g->size)
+        g->buf[g->gap_start++] = g->buf[g->gap_end++];
+}
+
+/* Word jumps stop at the start of a word, as in most shells. */
+static void
+gb_word_left(GapBuffer *g)
+{
+    while (g->gap_start > 0 && g->buf[g->gap_start - 1] == ' ')
+        gb_left(g);
+    while (g->gap_start > 0 && g->buf[g->gap_start - 1] != ' ')
+        gb_left(g);
+}
+
+static void
+gb_word_right(GapBuffer *g)
+{
+    while (g->gap_end < g->size && g->buf[g->gap_end] != ' ')
+        gb_right(g);
+    while (g->gap_end < g->size && g->buf[g->gap_end] == ' ')
+        gb_right(g);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Drawing                                                            */
+/* ------------------------------------------------------------------ */
+
+static void
+draw_editor(const CHAR16 *title, const GapBuffer *g, UINTN *scroll)
+{
+    UINTN cols  = tui_screen_cols();
+    UINTN rows  = tui_screen_rows();
+    UINTN width = cols > 4 ? cols - 4 : 1;     /* field, less margins */
+    UINTN len   = gb_length(g);
+    UINTN cur   = g->gap_start;
+
+    /* Scroll so the cursor stays inside the field, a few columns
+     * from either edge while there is more text that way. */
+    UINTN margin = width > 16 ? 8 : 0;
+    if (cur < *scroll + margin)
+        *scroll = cur > margin ? cur - margin : 0;
+    else if (cur + margin >= *scroll + width)
+        *scroll = cur + margin - width + 1;
+
+    tui_screen_clear(TUI_ATTR_NORMAL);
+    tui_screen_put_centre(0, TUI_ATTR_HEADER, L"Edit kernel command line");
+    tui_screen_put(2, 2, TUI_ATTR_NORMAL, title);
+
+    tui_screen_fill(2, EDIT_ROW, EDIT_ATTR_FIELD, width);
+    CHAR16 cell[2] = { 0, 0 };
+    for (UINTN i = 0; i < width && *scroll + i <= len; i++) {
+        UINTN pos = *scroll + i;
+        cell[0] = pos < len ? (CHAR16)gb_at(g, pos) : L' ';
+        tui_screen_put(2 + i, EDIT_ROW,
+                       pos == cur ? EDIT_ATTR_CURSOR : EDIT_ATTR_FIELD, cell);
+    }
+
+    /* Text beyond the field's edges. */
+    if (*scroll > 0)
+        tui_screen_put(1, EDIT_ROW, TUI_ATTR_HEADER, L"<");
+    if (*scroll + width < len + 1)
+        tui_screen_put(2 + width, EDIT_ROW, TUI_ATTR_HEADER, L">");
+
+    CHAR16 status[64];
+    SPrint(status, sizeof(status), L" Column %u, length %u", cur + 1, len);
+    tui_screen_put(0, rows - 2, TUI_ATTR_HEADER,
+        L" [Enter] Accept  [Esc] Cancel  [Home/End] Line  [Up/Down] Word  [Del] Delete");
+    tui_screen_put(0, rows - 1, TUI_ATTR_HEADER, status);
+
+    tui_screen_flush();
+}
+
+/* ------------------------------------------------------------------ */
+/*  Editor loop                                                        */
+/* ------------------------------------------------------------------ */
+
+/*
+ * Edit `line` (NUL-terminated, at most `max` bytes with the NUL) in
+ * place.  Returns FALSE, with `line` unchanged, if the user cancels.
+ */
+BOOLEAN
+tui_edit_line(SuperBootContext *ctx, const CHAR16 *title, CHAR8 *line,
+              UINTN max)
+{
+    CHAR8 store[SB_MAX_CMDLINE];
+    GapBuffer g;
+    UINTN len = sb_strlen8(line);
+
+    if (max > sizeof(store))
+        max = sizeof(store);
+    if (len + 1 > max)
+        len = max - 1;
+
+    /* All of the text before the gap: the cursor starts at the end. */
+    g.buf       = store;
+    g.size      = max - 1;
+    sb_memcpy(store, line, len);
+    g.gap_start = len;
+    g.gap_end   = g.size;
+
+    UINTN scroll = 0;
+    tui_screen_init(ctx);
+
+    for (;;) {
+        draw_editor(title, &g, &scroll);
+
+        UINT16 key = tui_read_key(ctx->system_table);
+        switch (key) {
+        case TUI_KEY_ESCAPE:
+            return FALSE;
+
+        case TUI_KEY_ENTER:
+        case '\n':
+            len = gb_length(&g);
+            for (UINTN i = 0; i < len; i++)
+                line[i] = gb_at(&g, i);
+            line[len] = '\0';
+            return TRUE;
+
+        case TUI_KEY_LEFT:   gb_left(&g);       break;
+        case TUI_KEY_RIGHT:  gb_right(&g);      break;
+        case TUI_KEY_UP:     gb_word_left(&g);  break;
+        case TUI_KEY_DOWN:   gb_word_right(&g); break;
+        case TUI_KEY_DELETE: gb_delete(&g);     break;
+        case 0x08:           gb_backspace(&g);  break;   /* backspace */
+
+        case TUI_KEY_HOME:
+            while (g.gap_start > 0)
+                gb_left(&g);
+            break;
+
+        case TUI_KEY_END:
+            while (g.gap_end < g.size)
+                gb_right(&g);
+            break;
+
+        default:
+            if (key >= 0x20 && key < 0x7F)
+                gb_insert(&g, (CHAR8)key);
+            break;
+        }
+    }
+}
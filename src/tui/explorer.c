@@ -2,136 +2,328 @@
  * explorer.c — EFI file browser / explorer
  *
  * Presents a navigable view of all mounted partitions and their
- * contents.  The user can browse directories, view file info,
- * and launch .efi binaries directly.
+ * contents.  The user can browse directories, page through files as
+ * text or hex (with the setup header decoded for kernels), and launch
+ * .efi binaries directly.
+ *
+ * The first screen lists every VFS mount, so partitions served by the
+ * built-in drivers (ext4, ...) are browsable as well as the ones the
+ * firmware reads.  Directories are read through sb_vfs_read_dir(),
+ * sorted (directories first, then names with digit runs compared as
+ * numbers, so vmlinuz-6.10 follows vmlinuz-6.9) and kept in a small
+ * cache, so going back up to a directory does not read it again and
+ * restores the selection.  Only the visible rows are ever drawn, so
+ * a directory of thousands of entries scrolls as fast as a short one.
  */
 
 #include "tui.h"
 #include "../fs/vfs.h"
+#include "../boot/loader.h"
 
 /* ------------------------------------------------------------------ */
-/*  Directory entry list                                               */
+/*  Directory listings                                                 */
 /* ------------------------------------------------------------------ */
 
-#define EXPLORER_MAX_ENTRIES 256
+/* Directories kept in memory, least recently used evicted first. */
+#define EXPLORER_CACHE_DIRS     16
+#define EXPLORER_NAME_BLOCK     (16 * 1024)
 
 typedef struct {
-    CHAR16   name[256];
-    BOOLEAN  is_dir;
-    UINT64   size;
+    const CHAR16 *name;         /* in the listing's arena           */
+    UINT64        size;         /* SB_VFS_SIZE_UNKNOWN if not known */
+    BOOLEAN       is_dir;
 } ExplorerEntry;
 
-static ExplorerEntry entries[EXPLORER_MAX_ENTRIES];
-static UINTN         entry_count;
+typedef struct {
+    EFI_HANDLE     device;      /* NULL: slot free                  */
+    CHAR16         path[SB_MAX_PATH];
+    ExplorerEntry *entries;     /* entries[0] is ".."               */
+    UINTN          count;
+    UINTN          capacity;
+    SbArena        names;
+    UINTN          selected;    /* where the user left it           */
+    UINT64         last_used;
+} Listing;
 
-/* ------------------------------------------------------------------ */
-/*  Read directory contents via UEFI SimpleFileSystem                  */
-/* ------------------------------------------------------------------ */
+static Listing cache[EXPLORER_CACHE_DIRS];
+static UINT64  cache_clock;
 
-static EFI_STATUS
-read_directory(EFI_HANDLE device, const CHAR16 *dir_path)
+static void
+listing_free(Listing *l)
 {
-    entry_count = 0;
-
-    EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *sfs;
-    EFI_STATUS status = gBS->HandleProtocol(
-                            device, &gEfiSimpleFileSystemProtocolGuid,
-                            (void **)&sfs);
-    if (EFI_ERROR(status))
-        return status;
+    sb_free(l->entries);
+    sb_arena_release(&l->names);
+    SetMem(l, sizeof(*l), 0);
+}
 
-    EFI_FILE_PROTOCOL *root, *dir;
-    status = sfs->OpenVolume(sfs, &root);
-    if (EFI_ERROR(status))
-        return status;
+static BOOLEAN
+listing_add(void *data, const CHAR16 *name, BOOLEAN is_dir, UINT64 size)
+{
+    Listing *l = data;
 
-    status = root->Open(root, &dir, (CHAR16 *)dir_path,
-                        EFI_FILE_MODE_READ, 0);
-    if (EFI_ERROR(status)) {
-        root->Close(root);
-        return status;
+    if (l->count == l->capacity) {
+        UINTN cap = l->capacity ? l->capacity * 2 : 64;
+        ExplorerEntry *e = sb_malloc(SB_MEM_TUI, cap * sizeof(*e));
+        if (!e)
+            return FALSE;           /* keep what we have */
+        if (l->count)
+            sb_memcpy(e, l->entries, l->count * sizeof(*e));
+        sb_free(l->entries);
+        l->entries  = e;
+        l->capacity = cap;
     }
 
-    /* Add ".." entry for parent navigation. */
-    StrCpy(entries[0].name, L"..");
-    entries[0].is_dir = TRUE;
-    entries[0].size = 0;
-    entry_count = 1;
+    UINTN bytes = (StrLen(name) + 1) * sizeof(CHAR16);
+    CHAR16 *copy = sb_arena_alloc(&l->names, bytes);
+    if (!copy)
+        return FALSE;
+    sb_memcpy(copy, name, bytes);
 
-    UINT8 info_buf[1024];
-    UINTN buf_size;
+    l->entries[l->count].name   = copy;
+    l->entries[l->count].size   = size;
+    l->entries[l->count].is_dir = is_dir;
+    l->count++;
+    return TRUE;
+}
 
-    for (;;) {
-        buf_size = sizeof(info_buf);
-        status = dir->Read(dir, &buf_size, info_buf);
-        if (EFI_ERROR(status) || buf_size == 0)
-            break;
+static CHAR16
+fold(CHAR16 c)
+{
+    return (c >= 'A' && c <= 'Z') ? c + 32 : c;
+}
 
-        EFI_FILE_INFO *info = (EFI_FILE_INFO *)info_buf;
+static BOOLEAN
+is_digit(CHAR16 c)
+{
+    return c >= '0' && c <= '9';
+}
 
-        /* Skip "." entries. */
-        if (StrCmp(info->FileName, L".") == 0)
-            continue;
-        if (StrCmp(info->FileName, L"..") == 0)
+/* Case-insensitive, with runs of digits compared by value. */
+static INTN
+name_cmp(const CHAR16 *a, const CHAR16 *b)
+{
+    while (*a && *b) {
+        if (is_digit(*a) && is_digit(*b)) {
+            while (*a == '0') a++;
+            while (*b == '0') b++;
+            UINTN na = 0, nb = 0;
+            while (is_digit(a[na])) na++;
+            while (is_digit(b[nb])) nb++;
+            if (na != nb)
+                return na < nb ? -1 : 1;
+            for (UINTN i = 0; i < na; i++)
+                if (a[i] != b[i])
+                    return a[i] < b[i] ? -1 : 1;
+            a += na;
+            b += nb;
             continue;
+        }
+        if (fold(*a) != fold(*b))
+            return fold(*a) < fold(*b) ? -1 : 1;
+        a++;
+        b++;
+    }
+    return *a ? 1 : *b ? -1 : 0;
+}
 
-        if (entry_count >= EXPLORER_MAX_ENTRIES)
-            break;
+static BOOLEAN
+entry_before(const ExplorerEntry *a, const ExplorerEntry *b)
+{
+    if (a->is_dir != b->is_dir)
+        return a->is_dir;
+    return name_cmp(a->name, b->name) < 0;
+}
 
-        StrCpy(entries[entry_count].name, info->FileName);
-        entries[entry_count].is_dir = !!(info->Attribute & EFI_FILE_DIRECTORY);
-        entries[entry_count].size = info->FileSize;
-        entry_count++;
+/* Bottom-up merge sort of e[0..n): directories can be large. */
+static void
+sort_entries(ExplorerEntry *e, UINTN n)
+{
+    if (n < 2)
+        return;
+
+    ExplorerEntry *tmp = sb_malloc(SB_MEM_TUI, n * sizeof(*tmp));
+    if (!tmp) {
+        /* Insertion sort still works, just slower. */
+        for (UINTN i = 1; i < n; i++) {
+            ExplorerEntry x = e[i];
+            UINTN j = i;
+            while (j > 0 && entry_before(&x, &e[j - 1])) {
+                e[j] = e[j - 1];
+                j--;
+            }
+            e[j] = x;
+        }
+        return;
     }
 
-    dir->Close(dir);
-    root->Close(root);
-    return EFI_SUCCESS;
+    ExplorerEntry *src = e, *dst = tmp;
+    for (UINTN width = 1; width < n; width *= 2) {
+        for (UINTN lo = 0; lo < n; lo += 2 * width) {
+            UINTN mid = lo + width < n ? lo + width : n;
+            UINTN hi  = lo + 2 * width < n ? lo + 2 * width : n;
+            UINTN i = lo, j = mid, k = lo;
+            while (i < mid && j < hi)
+                dst[k++] = entry_before(&src[j], &src[i]) ? src[j++]
+                                                          : src[i++];
+            while (i < mid) dst[k++] = src[i++];
+            while (j < hi)  dst[k++] = src[j++];
+        }
+        ExplorerEntry *t = src;
+        src = dst;
+        dst = t;
+    }
+    if (src != e)
+        sb_memcpy(e, src, n * sizeof(*e));
+    sb_free(tmp);
+}
+
+/* The listing of `path`, from the cache or read now. */
+static Listing *
+open_listing(EFI_HANDLE device, const CHAR16 *path, EFI_STATUS *status)
+{
+    Listing *victim = &cache[0];
+
+    for (UINTN i = 0; i < EXPLORER_CACHE_DIRS; i++) {
+        Listing *l = &cache[i];
+        if (l->device == device && StrCmp(l->path, path) == 0) {
+            l->last_used = ++cache_clock;
+            *status = EFI_SUCCESS;
+            return l;
+        }
+        if (!l->device || (victim->device &&
+                           l->last_used < victim->last_used))
+            victim = l;
+    }
+
+    listing_free(victim);
+    Listing *l = victim;
+    sb_arena_init(&l->names, EXPLORER_NAME_BLOCK, SB_MEM_TUI);
+    StrnCpy(l->path, path, SB_MAX_PATH - 1);
+
+    listing_add(l, L"..", TRUE, 0);
+    *status = sb_vfs_read_dir(device, path, listing_add, l);
+    if (EFI_ERROR(*status) || l->count == 0) {
+        listing_free(l);
+        if (!EFI_ERROR(*status))
+            *status = EFI_OUT_OF_RESOURCES;
+        return NULL;
+    }
+
+    sort_entries(l->entries + 1, l->count - 1);
+    l->device    = device;
+    l->last_used = ++cache_clock;
+    return l;
+}
+
+static void
+cache_free_all(void)
+{
+    for (UINTN i = 0; i < EXPLORER_CACHE_DIRS; i++)
+        if (cache[i].device)
+            listing_free(&cache[i]);
 }
 
 /* ------------------------------------------------------------------ */
-/*  Draw the file browser                                              */
+/*  Drawing                                                            */
 /* ------------------------------------------------------------------ */
 
+/* First row of the scrolling list. */
+#define LIST_TOP    3
+
+static UINTN
+list_rows(void)
+{
+    UINTN rows = tui_screen_rows();
+    return rows > LIST_TOP + 3 ? rows - LIST_TOP - 3 : 1;
+}
+
+/* Keep `selected` inside the window starting at *scroll. */
 static void
-draw_browser(EFI_SYSTEM_TABLE *st, const CHAR16 *path,
-             UINTN selected, UINTN scroll_off)
+follow(UINTN selected, UINTN *scroll)
 {
-    UINTN cols, rows;
-    st->ConOut->QueryMode(st->ConOut, st->ConOut->Mode->Mode, &cols, &rows);
+    UINTN visible = list_rows();
+    if (selected < *scroll)
+        *scroll = selected;
+    else if (selected >= *scroll + visible)
+        *scroll = selected - visible + 1;
+}
 
-    tui_clear(st, TUI_ATTR_NORMAL);
+static void
+draw_frame(const CHAR16 *title, const CHAR16 *help)
+{
+    tui_screen_clear(TUI_ATTR_NORMAL);
+    tui_screen_put_centre(0, TUI_ATTR_HEADER,
+                          L"SuperBoot — EFI File Explorer");
+    tui_screen_put(1, 1, TUI_ATTR_HEADER, title);
+    tui_screen_put(0, tui_screen_rows() - 2, TUI_ATTR_HEADER, help);
+}
 
-    st->ConOut->SetAttribute(st->ConOut, TUI_ATTR_HEADER);
-    tui_print_centre(st, 0, L"SuperBoot — EFI File Explorer");
-    st->ConOut->SetCursorPosition(st->ConOut, 1, 1);
-    Print(L"Path: %s", path);
+static void
+draw_row(UINTN i, BOOLEAN hilite, const CHAR16 *text)
+{
+    UINTN cols = tui_screen_cols();
+    UINTN attr = hilite ? TUI_ATTR_HILITE : TUI_ATTR_NORMAL;
 
-    UINTN start_row = 3;
-    UINTN visible = (rows > start_row + 3) ? rows - start_row - 3 : 1;
+    if (cols > 3)
+        tui_screen_fill(2, LIST_TOP + i, attr, cols - 3);
+    tui_screen_put(2, LIST_TOP + i, attr, text);
+}
 
-    for (UINTN i = 0; i < visible && (scroll_off + i) < entry_count; i++) {
-        UINTN idx = scroll_off + i;
+static void
+draw_browser(const CHAR16 *label, const Listing *l, UINTN scroll)
+{
+    CHAR16 line[SB_MAX_PATH + 32];
 
-        if (idx == selected)
-            st->ConOut->SetAttribute(st->ConOut, TUI_ATTR_HILITE);
-        else
-            st->ConOut->SetAttribute(st->ConOut, TUI_ATTR_NORMAL);
+    SPrint(line, sizeof(line), L"%s:%s", label, l->path);
+    draw_frame(line,
+        L" [Enter] Open/Run  [v] View  [Backspace] Up  [PgUp/PgDn] Page  [Esc] Menu");
 
-        st->ConOut->SetCursorPosition(st->ConOut, 2, start_row + i);
+    UINTN visible = list_rows();
+    for (UINTN i = 0; i < visible && scroll + i < l->count; i++) {
+        const ExplorerEntry *e = &l->entries[scroll + i];
 
-        if (entries[idx].is_dir) {
-            Print(L" [DIR]  %s", entries[idx].name);
-        } else {
-            Print(L" %10lu  %s", entries[idx].size, entries[idx].name);
-        }
+        if (e->is_dir)
+            SPrint(line, sizeof(line), L" [DIR]       %s", e->name);
+        else if (e->size == SB_VFS_SIZE_UNKNOWN)
+            SPrint(line, sizeof(line), L"          -  %s", e->name);
+        else
+            SPrint(line, sizeof(line), L" %10lu  %s", e->size, e->name);
+        draw_row(i, scroll + i == l->selected, line);
     }
 
-    st->ConOut->SetAttribute(st->ConOut, TUI_ATTR_HEADER);
-    st->ConOut->SetCursorPosition(st->ConOut, 0, rows - 2);
-    st->ConOut->OutputString(
-        st->ConOut,
-        L" [Enter] Open/Run  [Backspace] Up  [Esc] Back to menu");
+    SPrint(line, sizeof(line), L" %u of %u", l->selected + 1, l->count);
+    tui_screen_put(0, tui_screen_rows() - 1, TUI_ATTR_HEADER, line);
+    tui_screen_flush();
+}
+
+/* Move `*selected` within [0, count) for a navigation key. */
+static BOOLEAN
+navigate(UINT16 key, UINTN count, UINTN *selected)
+{
+    UINTN page = list_rows();
+
+    switch (key) {
+    case TUI_KEY_UP:
+        if (*selected > 0) (*selected)--;
+        return TRUE;
+    case TUI_KEY_DOWN:
+        if (*selected + 1 < count) (*selected)++;
+        return TRUE;
+    case TUI_KEY_PGUP:
+        *selected = *selected > page ? *selected - page : 0;
+        return TRUE;
+    case TUI_KEY_PGDN:
+        *selected = *selected + page < count ? *selected + page
+                                             : (count ? count - 1 : 0);
+        return TRUE;
+    case TUI_KEY_HOME:
+        *selected = 0;
+        return TRUE;
+    case TUI_KEY_END:
+        *selected = count ? count - 1 : 0;
+        return TRUE;
+    }
+    return FALSE;
 }
 
 /* ------------------------------------------------------------------ */
@@ -141,16 +333,35 @@ draw_browser(EFI_SYSTEM_TABLE *st, const CHAR16 *path,
 static EFI_STATUS
 launch_efi(SuperBootContext *ctx, EFI_HANDLE device, const CHAR16 *path)
 {
+    tui_clear(ctx->system_table, TUI_ATTR_NORMAL);
     Print(L"\nLaunching %s ...\n", path);
 
     EFI_DEVICE_PATH_PROTOCOL *dp = FileDevicePath(device, (CHAR16 *)path);
     if (!dp)
         return EFI_OUT_OF_RESOURCES;
 
+    /* The firmware can only load from filesystems it reads itself;
+     * anything else is read through the VFS and loaded from memory. */
+    void  *image = NULL;
+    UINTN  size  = 0;
+    EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *sfs;
+    if (EFI_ERROR(ctx->boot_services->HandleProtocol(
+                      device, &gEfiSimpleFileSystemProtocolGuid,
+                      (void **)&sfs))) {
+        EFI_STATUS s = sb_vfs_read_file(device, path, &image, &size);
+        if (EFI_ERROR(s)) {
+            FreePool(dp);
+            return s;
+        }
+    }
+
     EFI_HANDLE child;
     EFI_STATUS status = ctx->boot_services->LoadImage(
                             FALSE, ctx->image_handle, dp,
-                            NULL, 0, &child);
+                            image, size, &child);
+    FreePool(dp);
+    if (image)
+        sb_free(image);
     if (EFI_ERROR(status))
         return status;
 
@@ -171,118 +382,730 @@ is_efi_file(const CHAR16 *name)
 }
 
 /* ------------------------------------------------------------------ */
-/*  Public API                                                         */
+/*  File viewer                                                        */
+/*                                                                     */
+/*  Text and hex views read only the screenful they show, through     */
+/*  sb_vfs_read_at(), so a 1 GiB initrd opens instantly.  Text rows    */
+/*  wrap at the screen width, one byte per column, which lets the     */
+/*  row before any offset be found from the nearest newline behind    */
+/*  it without reading the file from the start.  Searches scan ahead   */
+/*  in VIEW_CHUNK pieces and can be interrupted with Esc.              */
 /* ------------------------------------------------------------------ */
 
-EFI_STATUS
-sb_tui_file_browser(SuperBootContext *ctx)
+#define VIEW_CHUNK      (64 * 1024)
+#define VIEW_QUERY_MAX  64
+
+typedef enum {
+    VIEW_TEXT,
+    VIEW_HEX,
+    VIEW_KERNEL,
+} ViewMode;
+
+typedef struct {
+    SuperBootContext *ctx;
+    const CHAR16     *name;
+    SbVfsFile        *file;
+    UINT64            size;
+    ViewMode          mode;
+    UINT64            top;          /* first byte on screen           */
+    UINT64            match;        /* last search hit, or size       */
+    CHAR8             query[VIEW_QUERY_MAX];
+    UINTN             query_len;
+    UINT8            *buf;          /* VIEW_CHUNK bytes               */
+    const CHAR16     *message;      /* one-shot status line text      */
+
+    /* Kernel images: the setup header, and zboot's compression. */
+    BOOLEAN           is_kernel;
+    BOOLEAN           is_zboot;
+    BOOLEAN           has_pe;
+    LinuxSetupHeader  hdr;
+    CHAR8             kver[80];
+    CHAR8             zboot_type[8];
+} Viewer;
+
+/* Read up to `len` bytes at `offset`; returns the count read. */
+static UINTN
+view_read(Viewer *v, UINT64 offset, void *buf, UINTN len)
 {
-    /*
-     * Start by listing all partitions with SimpleFileSystem as
-     * top-level "drives."  The user picks one, then browses its tree.
-     */
-    EFI_HANDLE *fs_handles = NULL;
-    UINTN       fs_count = 0;
+    if (offset >= v->size)
+        return 0;
+    if (len > v->size - offset)
+        len = (UINTN)(v->size - offset);
+    if (EFI_ERROR(sb_vfs_read_at(v->file, offset, buf, &len)))
+        return 0;
+    return len;
+}
 
-    ctx->boot_services->LocateHandleBuffer(
-        ByProtocol, &gEfiSimpleFileSystemProtocolGuid,
-        NULL, &fs_count, &fs_handles);
+/* Read up to `len` bytes at `offset` into v->buf. */
+static UINTN
+view_fill(Viewer *v, UINT64 offset, UINTN len)
+{
+    return view_read(v, offset, v->buf, len < VIEW_CHUNK ? len : VIEW_CHUNK);
+}
 
-    if (fs_count == 0) {
-        Print(L"No accessible filesystems found.\n");
-        tui_read_key(ctx->system_table);
-        return EFI_NOT_FOUND;
+static UINTN
+text_width(void)
+{
+    UINTN cols = tui_screen_cols();
+    return cols > 1 ? cols - 1 : 1;
+}
+
+static UINTN
+body_rows(void)
+{
+    UINTN rows = tui_screen_rows();
+    return rows > 4 ? rows - 3 : 1;
+}
+
+static UINTN
+hex_per_row(void)
+{
+    return tui_screen_cols() >= 78 ? 16 : 8;
+}
+
+/* Length of the text row starting at b[0]: up to `width` bytes, a
+ * newline ending it early. */
+static UINTN
+text_row_len(const UINT8 *b, UINTN avail, UINTN width)
+{
+    UINTN i = 0;
+    while (i < avail && i < width) {
+        if (b[i++] == '\n')
+            break;
     }
+    return i;
+}
 
-    /* For now, use the first filesystem as root.
-     * TODO: show partition picker. */
-    EFI_HANDLE device = fs_handles[0];
-    FreePool(fs_handles);
+/* Start of the text row holding the byte before `pos`. */
+static UINT64
+text_prev_row(Viewer *v, UINT64 pos)
+{
+    if (pos == 0)
+        return 0;
 
-    CHAR16 current_path[SB_MAX_PATH] = L"\\";
-    UINTN  selected = 0;
+    UINT64 start = pos > VIEW_CHUNK ? pos - VIEW_CHUNK : 0;
+    UINTN  n     = view_fill(v, start, (UINTN)(pos - start));
+    UINT64 line  = start;               /* no newline found: guess  */
 
-    for (;;) {
-        EFI_STATUS status = read_directory(device, current_path);
-        if (EFI_ERROR(status)) {
-            Print(L"Cannot read directory: %r\n", status);
-            tui_read_key(ctx->system_table);
-            return status;
+    /* The byte at pos - 1 belongs to the row; its line begins after
+     * the newline before it. */
+    for (UINTN i = n > 1 ? n - 1 : 0; i > 0; i--) {
+        if (v->buf[i - 1] == '\n') {
+            line = start + i;
+            break;
+        }
+    }
+
+    UINTN width = text_width();
+    return line + ((pos - 1 - line) / width) * width;
+}
+
+/* Start of the row holding `offset`, in the current mode. */
+static UINT64
+view_row_of(Viewer *v, UINT64 offset)
+{
+    if (v->mode == VIEW_HEX)
+        return offset - offset % hex_per_row();
+    return text_prev_row(v, offset + 1);
+}
+
+/* Move `rows` rows down (positive) or up from v->top. */
+static void
+view_scroll(Viewer *v, INTN rows)
+{
+    if (v->mode == VIEW_HEX) {
+        UINT64 step = hex_per_row();
+        if (rows < 0) {
+            UINT64 back = (UINT64)(-rows) * step;
+            v->top = v->top > back ? v->top - back : 0;
+        } else if (v->size > step) {
+            UINT64 last = (v->size - 1) - (v->size - 1) % step;
+            v->top += (UINT64)rows * step;
+            if (v->top > last)
+                v->top = last;
         }
+        return;
+    }
 
-        UINTN scroll_off = 0;
+    for (; rows < 0; rows++)
+        v->top = text_prev_row(v, v->top);
 
-        for (;;) {
-            if (selected >= entry_count && entry_count > 0)
-                selected = entry_count - 1;
-            if (selected >= scroll_off + 20)
-                scroll_off = selected - 19;
-            if (selected < scroll_off)
-                scroll_off = selected;
+    UINTN width = text_width();
+    while (rows > 0) {
+        UINTN n = view_fill(v, v->top, (UINTN)rows * width);
+        UINTN i = 0;
+        while (rows > 0 && i < n) {
+            UINTN len = text_row_len(v->buf + i, n - i, width);
+            if (v->top + i + len >= v->size)
+                break;                  /* keep the last row on screen */
+            i += len;
+            rows--;
+        }
+        v->top += i;
+        if (i == 0 || n == 0)
+            break;
+    }
+}
 
-            draw_browser(ctx->system_table, current_path,
-                         selected, scroll_off);
+static CHAR16
+view_char(UINT8 c)
+{
+    return (c >= 0x20 && c < 0x7F) ? (CHAR16)c : L'.';
+}
 
-            UINT16 key = tui_read_key(ctx->system_table);
+static BOOLEAN
+in_match(const Viewer *v, UINT64 offset)
+{
+    return v->match < v->size && offset >= v->match &&
+           offset < v->match + v->query_len;
+}
 
-            if (key == TUI_KEY_ESCAPE)
-                return EFI_SUCCESS;
+static void
+draw_text(Viewer *v, UINTN top_row, UINTN nrows)
+{
+    UINTN width = text_width();
+    UINTN n = view_fill(v, v->top, nrows * width);
+    CHAR16 line[TUI_MAX_COLS + 1];
+    UINTN i = 0;
+
+    for (UINTN r = 0; r < nrows && i < n; r++) {
+        UINTN len = text_row_len(v->buf + i, n - i, width);
+        UINTN k = 0;
+        for (UINTN j = 0; j < len; j++) {
+            UINT8 c = v->buf[i + j];
+            if (c == '\n')
+                break;
+            line[k++] = c == '\t' || c == '\r' ? L' ' : view_char(c);
+        }
+        line[k] = L'\0';
+        tui_screen_put(0, top_row + r, TUI_ATTR_NORMAL, line);
 
-            if (key == TUI_KEY_UP && selected > 0)
-                selected--;
-            else if (key == TUI_KEY_DOWN && selected + 1 < entry_count)
-                selected++;
-            else if (key == TUI_KEY_ENTER && entry_count > 0) {
-                ExplorerEntry *e = &entries[selected];
-
-                if (e->is_dir) {
-                    if (StrCmp(e->name, L"..") == 0) {
-                        /* Go up: strip last path component. */
-                        CHAR16 *last = current_path;
-                        CHAR16 *sep = NULL;
-                        for (CHAR16 *c = current_path; *c; c++) {
-                            if (*c == L'\\' && *(c+1) != L'\0')
-                                sep = c;
-                        }
-                        if (sep && sep != current_path)
-                            *(sep + 1) = L'\0';
-                        else
-                            StrCpy(current_path, L"\\");
-                        (void)last;
-                    } else {
-                        /* Descend into directory. */
-                        UINTN len = StrLen(current_path);
-                        if (len > 1) /* Not just "\\" */
-                            StrCat(current_path, L"\\");
-                        StrCat(current_path, e->name);
-                    }
-                    selected = 0;
-                    break; /* Re-read directory. */
-                }
-
-                /* It's a file.  If .efi, offer to launch it. */
-                if (is_efi_file(e->name)) {
-                    CHAR16 full[SB_MAX_PATH];
-                    SPrint(full, sizeof(full), L"%s\\%s",
-                           current_path, e->name);
-                    launch_efi(ctx, device, full);
-                    /* If it returns, redraw. */
-                }
+        for (UINTN j = 0; j < k; j++) {
+            if (in_match(v, v->top + i + j)) {
+                CHAR16 one[2] = { line[j], 0 };
+                tui_screen_put(j, top_row + r, TUI_ATTR_HILITE, one);
             }
-            else if (key == 0x08 /* backspace */) {
-                /* Same as selecting ".." */
-                CHAR16 *sep = NULL;
-                for (CHAR16 *c = current_path; *c; c++) {
-                    if (*c == L'\\' && *(c+1) != L'\0')
-                        sep = c;
-                }
-                if (sep && sep != current_path)
-                    *(sep + 1) = L'\0';
-                else
-                    StrCpy(current_path, L"\\");
-                selected = 0;
+        }
+        i += len;
+    }
+}
+
+static void
+draw_hex(Viewer *v, UINTN top_row, UINTN nrows)
+{
+    static const CHAR16 digits[] = L"0123456789abcdef";
+    UINTN per = hex_per_row();
+    UINTN n   = view_fill(v, v->top, nrows * per);
+    CHAR16 line[32];
+
+    for (UINTN r = 0; r * per < n && r < nrows; r++) {
+        UINT64 off = v->top + r * per;
+        SPrint(line, sizeof(line), L"%08lx", off);
+        tui_screen_put(0, top_row + r, TUI_ATTR_HEADER, line);
+
+        for (UINTN j = 0; j < per && r * per + j < n; j++) {
+            UINT8  c    = v->buf[r * per + j];
+            UINTN  attr = in_match(v, off + j) ? TUI_ATTR_HILITE
+                                               : TUI_ATTR_NORMAL;
+            CHAR16 hex[3] = { digits[c >> 4], digits[c & 15], 0 };
+            CHAR16 chr[2] = { view_char(c), 0 };
+
+            tui_screen_put(10 + j * 3 + (j >= 8), top_row + r, attr, hex);
+            tui_screen_put(11 + per * 3 + j, top_row + r, attr, chr);
+        }
+    }
+}
+
+static void
+draw_kernel(Viewer *v, UINTN top_row)
+{
+    const LinuxSetupHeader *h = &v->hdr;
+    CHAR16 line[128];
+    UINTN r = top_row;
+
+#define KLINE(...)  do { SPrint(line, sizeof(line), __VA_ARGS__); \
+                         tui_screen_put(2, r++, TUI_ATTR_NORMAL, line); } while (0)
+
+    if (v->is_zboot) {
+        KLINE(L"EFI zboot image, %a-compressed payload", v->zboot_type);
+        KLINE(L"The setup header is inside the payload; use the hex view.");
+        return;
+    }
+
+    KLINE(L"Linux kernel image (bzImage%s)", v->has_pe ? L", EFI stub" : L"");
+    r++;
+    KLINE(L"Version:          %a", v->kver[0] ? v->kver : (CHAR8 *)"?");
+    KLINE(L"Boot protocol:    %u.%02u", h->version >> 8, h->version & 0xFF);
+    KLINE(L"Setup sectors:    %u", h->setup_sects ? h->setup_sects : 4);
+    KLINE(L"Load flags:       0x%02x%s", h->loadflags,
+          (h->loadflags & LINUX_LOAD_HIGH) ? L" (loads high)" : L"");
+    KLINE(L"Extended flags:   0x%04x%s%s%s%s", h->xloadflags,
+          (h->xloadflags & 0x01) ? L" 64-bit" : L"",
+          (h->xloadflags & 0x02) ? L" above-4G" : L"",
+          (h->xloadflags & 0x04) ? L" handover-32" : L"",
+          (h->xloadflags & 0x08) ? L" handover-64" : L"");
+    KLINE(L"Relocatable:      %s, alignment 0x%x",
+          h->relocatable_kernel ? L"yes" : L"no", h->kernel_alignment);
+    KLINE(L"Preferred load:   0x%lx", h->pref_address);
+    KLINE(L"Memory needed:    %u KiB (init_size)", h->init_size / 1024);
+    KLINE(L"Handover offset:  0x%x", h->handover_offset);
+    KLINE(L"Max command line: %u bytes", h->cmdline_size);
+
+#undef KLINE
+}
+
+/* Recognise bzImage and zboot kernels from their first bytes. */
+static void
+view_probe_kernel(Viewer *v)
+{
+    UINT8 head[0x300];
+    UINTN n = view_read(v, 0, head, sizeof(head));
+
+    v->has_pe = n >= 2 && head[0] == 'M' && head[1] == 'Z';
+
+    if (v->has_pe && n >= 32 && sb_strncmp8((CHAR8 *)head + 4,
+                                            (CHAR8 *)"zimg", 4) == 0) {
+        v->is_zboot = v->is_kernel = TRUE;
+        sb_memcpy(v->zboot_type, head + 24, 7);
+        v->zboot_type[7] = '\0';
+        return;
+    }
+
+    if (n < 0x1F1 + sizeof(LinuxSetupHeader))
+        return;
+    sb_memcpy(&v->hdr, head + 0x1F1, sizeof(v->hdr));
+    if (v->hdr.header != LINUX_BOOT_HDR_MAGIC || v->hdr.version < 0x0200)
+        return;
+    v->is_kernel = TRUE;
+
+    /* kernel_version points at a NUL-terminated string, less 0x200. */
+    if (v->hdr.kernel_version) {
+        UINTN got = view_read(v, 0x200 + (UINT64)v->hdr.kernel_version,
+                              v->kver, sizeof(v->kver) - 1);
+        v->kver[got] = '\0';
+    }
+}
+
+/* Text unless the start of the file looks binary. */
+static ViewMode
+view_guess_mode(Viewer *v)
+{
+    UINTN n = view_fill(v, 0, 4096);
+    UINTN odd = 0;
+
+    for (UINTN i = 0; i < n; i++) {
+        UINT8 c = v->buf[i];
+        if (c == 0)
+            return VIEW_HEX;
+        if (c < 0x20 && c != '\n' && c != '\r' && c != '\t')
+            odd++;
+    }
+    return odd * 16 > n ? VIEW_HEX : VIEW_TEXT;
+}
+
+static void
+draw_viewer(Viewer *v, const CHAR16 *prompt, const CHAR8 *input)
+{
+    UINTN rows = tui_screen_rows();
+    CHAR16 line[SB_MAX_PATH + 64];
+
+    tui_screen_clear(TUI_ATTR_NORMAL);
+
+    UINT64 pct = v->size ? v->top * 100 / v->size : 100;
+    SPrint(line, sizeof(line), L" %s   0x%lx of %lu bytes (%lu%%)",
+           v->name, v->top, v->size, pct);
+    tui_screen_fill(0, 0, TUI_ATTR_HEADER, tui_screen_cols());
+    tui_screen_put(0, 0, TUI_ATTR_HEADER, line);
+
+    if (v->mode == VIEW_KERNEL)
+        draw_kernel(v, 2);
+    else if (v->mode == VIEW_HEX)
+        draw_hex(v, 1, body_rows());
+    else
+        draw_text(v, 1, body_rows());
+
+    tui_screen_put(0, rows - 2, TUI_ATTR_HEADER,
+        L" [PgUp/PgDn] Page  [/] Search  [n] Next  [g] Go to  [Tab] View  [Esc] Close");
+
+    if (prompt) {
+        SPrint(line, sizeof(line), L" %s: %a_", prompt, input);
+        tui_screen_put(0, rows - 1, TUI_ATTR_HEADER, line);
+    } else if (v->message) {
+        tui_screen_put(0, rows - 1, TUI_ATTR_HEADER, v->message);
+    }
+    tui_screen_flush();
+}
+
+/* Read a line of ASCII on the status row.  FALSE if cancelled. */
+static BOOLEAN
+view_prompt(Viewer *v, const CHAR16 *prompt, CHAR8 *buf, UINTN max)
+{
+    UINTN len = 0;
+    buf[0] = '\0';
+
+    for (;;) {
+        draw_viewer(v, prompt, buf);
+        UINT16 key = tui_read_key(v->ctx->system_table);
+
+        if (key == TUI_KEY_ESCAPE)
+            return FALSE;
+        if (key == TUI_KEY_ENTER)
+            return len > 0;
+        if (key == 0x08 /* backspace */) {
+            if (len > 0)
+                buf[--len] = '\0';
+        } else if (key >= 0x20 && key < 0x7F && len + 1 < max) {
+            buf[len++] = (CHAR8)key;
+            buf[len] = '\0';
+        }
+    }
+}
+
+static UINT8
+fold8(UINT8 c)
+{
+    return (c >= 'A' && c <= 'Z') ? c + 32 : c;
+}
+
+/* Find the query (ASCII case-insensitive) at or after `from`. */
+static EFI_STATUS
+view_search(Viewer *v, UINT64 from, UINT64 *hit)
+{
+    UINTN qlen = v->query_len;
+    UINT64 pos = from;
+
+    while (pos + qlen <= v->size) {
+        UINTN n = view_fill(v, pos, VIEW_CHUNK);
+        if (n < qlen)
+            break;
+
+        for (UINTN i = 0; i + qlen <= n; i++) {
+            if (fold8(v->buf[i]) != (UINT8)v->query[0])
+                continue;
+            UINTN k = 1;
+            while (k < qlen && fold8(v->buf[i + k]) == (UINT8)v->query[k])
+                k++;
+            if (k == qlen) {
+                *hit = pos + i;
+                return EFI_SUCCESS;
+            }
+        }
+
+        /* Overlap chunks so a match across the seam is not missed. */
+        pos += n - (qlen - 1);
+
+        UINT16 key;
+        if (tui_poll_key(v->ctx->system_table, &key) &&
+            key == TUI_KEY_ESCAPE)
+            return EFI_ABORTED;
+    }
+    return EFI_NOT_FOUND;
+}
+
+static void
+view_find_next(Viewer *v)
+{
+    if (v->query_len == 0)
+        return;
+
+    UINT64 from = v->match < v->size ? v->match + 1 : v->top;
+    UINT64 hit;
+    EFI_STATUS s = view_search(v, from, &hit);
+
+    if (s == EFI_ABORTED) {
+        v->message = L" Search interrupted";
+    } else if (EFI_ERROR(s)) {
+        v->message = L" Not found";
+    } else {
+        v->match = hit;
+        if (v->mode == VIEW_KERNEL)
+            v->mode = VIEW_HEX;
+        v->top = view_row_of(v, hit);
+    }
+}
+
+/* Parse a hex (0x...) or decimal offset. */
+static BOOLEAN
+parse_offset(const CHAR8 *s, UINT64 *out)
+{
+    UINT64 val = 0;
+    UINTN base = 10;
+
+    if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+        base = 16;
+        s += 2;
+    }
+    if (!*s)
+        return FALSE;
+    for (; *s; s++) {
+        UINTN d;
+        if (*s >= '0' && *s <= '9')       d = *s - '0';
+        else if (*s >= 'a' && *s <= 'f')  d = *s - 'a' + 10;
+        else if (*s >= 'A' && *s <= 'F')  d = *s - 'A' + 10;
+        else return FALSE;
+        if (d >= base)
+            return FALSE;
+        val = val * base + d;
+    }
+    *out = val;
+    return TRUE;
+}
+
+static void
+view_file(SuperBootContext *ctx, EFI_HANDLE device, const CHAR16 *path,
+          const CHAR16 *name)
+{
+    Viewer v;
+    SetMem(&v, sizeof(v), 0);
+    v.ctx  = ctx;
+    v.name = name;
+
+    EFI_STATUS s = sb_vfs_open(device, path, &v.file);
+    v.buf = sb_malloc(SB_MEM_TUI, VIEW_CHUNK);
+    if (EFI_ERROR(s) || !v.buf) {
+        tui_clear(ctx->system_table, TUI_ATTR_NORMAL);
+        Print(L"Cannot open %s: %r\n", path,
+              EFI_ERROR(s) ? s : EFI_OUT_OF_RESOURCES);
+        tui_read_key(ctx->system_table);
+        if (v.file)
+            sb_vfs_close(v.file);
+        sb_free(v.buf);
+        return;
+    }
+
+    v.size  = sb_vfs_file_size(v.file);
+    v.match = v.size;
+    view_probe_kernel(&v);
+    v.mode  = v.is_kernel ? VIEW_KERNEL : view_guess_mode(&v);
+
+    for (;;) {
+        draw_viewer(&v, NULL, NULL);
+        v.message = NULL;
+
+        UINT16 key = tui_read_key(ctx->system_table);
+        INTN page = (INTN)body_rows();
+        CHAR8 input[VIEW_QUERY_MAX];
+
+        switch (key) {
+        case TUI_KEY_ESCAPE:
+        case 'q':
+            sb_vfs_close(v.file);
+            sb_free(v.buf);
+            return;
+
+        case TUI_KEY_UP:    view_scroll(&v, -1);    break;
+        case TUI_KEY_DOWN:  view_scroll(&v, 1);     break;
+        case TUI_KEY_PGUP:  view_scroll(&v, -page); break;
+        case TUI_KEY_PGDN:
+        case ' ':           view_scroll(&v, page);  break;
+        case TUI_KEY_HOME:  v.top = 0;              break;
+
+        case TUI_KEY_END:
+            v.top = v.size ? view_row_of(&v, v.size - 1) : 0;
+            view_scroll(&v, 1 - page);
+            break;
+
+        case TUI_KEY_TAB:
+            /* text -> hex -> kernel header (if any) -> text */
+            if (v.mode == VIEW_TEXT)
+                v.mode = VIEW_HEX;
+            else if (v.mode == VIEW_HEX && v.is_kernel)
+                v.mode = VIEW_KERNEL;
+            else
+                v.mode = VIEW_TEXT;
+            v.top = view_row_of(&v, v.top);
+            break;
+
+        case '/':
+            if (!view_prompt(&v, L"Search", input, sizeof(input)))
                 break;
+            v.query_len = 0;
+            for (UINTN i = 0; input[i]; i++)
+                v.query[v.query_len++] = (CHAR8)fold8((UINT8)input[i]);
+            v.match = v.size;
+            view_find_next(&v);
+            break;
+
+        case 'n':
+            view_find_next(&v);
+            break;
+
+        case 'g': {
+            UINT64 off;
+            if (!view_prompt(&v, L"Offset (0x.. or decimal)", input,
+                             sizeof(input)))
+                break;
+            if (!parse_offset(input, &off) || off >= v.size) {
+                v.message = L" Offset out of range";
+                break;
+            }
+            if (v.mode == VIEW_KERNEL)
+                v.mode = VIEW_HEX;
+            v.top = view_row_of(&v, off);
+            break;
+        }
+        }
+    }
+}
+
+/* ------------------------------------------------------------------ */
+/*  Browse one partition                                               */
+/* ------------------------------------------------------------------ */
+
+/* Strip the last component of `path` ("\a\b" -> "\a", "\a" -> "\"). */
+static void
+path_up(CHAR16 *path)
+{
+    CHAR16 *sep = NULL;
+    for (CHAR16 *c = path; *c; c++)
+        if (*c == L'\\' && c[1] != L'\0')
+            sep = c;
+    if (sep && sep != path)
+        *sep = L'\0';
+    else
+        StrCpy(path, L"\\");
+}
+
+/*
+ * Browse `device` from its root.  Returns TRUE to go back to the
+ * partition list, FALSE to leave the explorer.
+ */
+static BOOLEAN
+browse(SuperBootContext *ctx, EFI_HANDLE device, const CHAR16 *label)
+{
+    CHAR16 path[SB_MAX_PATH] = L"\\";
+    UINTN  scroll = 0;
+
+    for (;;) {
+        EFI_STATUS status;
+        Listing *l = open_listing(device, path, &status);
+        if (!l) {
+            tui_clear(ctx->system_table, TUI_ATTR_NORMAL);
+            Print(L"Cannot read %s:%s: %r\n", label, path, status);
+            tui_read_key(ctx->system_table);
+            if (StrCmp(path, L"\\") == 0)
+                return TRUE;
+            path_up(path);
+            continue;
+        }
+
+        follow(l->selected, &scroll);
+        draw_browser(label, l, scroll);
+
+        UINT16 key = tui_read_key(ctx->system_table);
+        if (key == TUI_KEY_ESCAPE)
+            return FALSE;
+        if (navigate(key, l->count, &l->selected))
+            continue;
+
+        ExplorerEntry *e = &l->entries[l->selected];
+        CHAR16 full[SB_MAX_PATH];
+        SPrint(full, sizeof(full), L"%s%s%s", path,
+               StrCmp(path, L"\\") == 0 ? L"" : L"\\", e->name);
+
+        BOOLEAN up = key == 0x08 /* backspace */;
+        if (key == TUI_KEY_ENTER) {
+            if (e->is_dir && StrCmp(e->name, L"..") == 0) {
+                up = TRUE;
+            } else if (e->is_dir) {
+                if (StrLen(full) + 1 >= SB_MAX_PATH)
+                    continue;
+                StrCpy(path, full);
+                scroll = 0;
+            } else if (is_efi_file(e->name)) {
+                launch_efi(ctx, device, full);
+                /* If it returns, redraw. */
+                tui_screen_invalidate();
+            } else {
+                view_file(ctx, device, full, e->name);
             }
+        } else if ((key == 'v' || key == 'V') && !e->is_dir) {
+            view_file(ctx, device, full, e->name);
+        }
+
+        if (up) {
+            if (StrCmp(path, L"\\") == 0)
+                return TRUE;
+            path_up(path);
+            scroll = 0;
+        }
+    }
+}
+
+/* ------------------------------------------------------------------ */
+/*  Partition picker                                                   */
+/* ------------------------------------------------------------------ */
+
+#define PICKER_LABEL_LEN    96
+
+/* "ext4  HD(2,GPT,...)": the filesystem and the last device path node. */
+static void
+mount_label(UINTN index, CHAR16 *buf, UINTN size)
+{
+    const CHAR16 *fs = L"?";
+    EFI_HANDLE device = sb_vfs_mount_info(index, &fs);
+    const CHAR16 *node = L"";
+    CHAR16 *text = NULL;
+
+    EFI_DEVICE_PATH_PROTOCOL *dp = DevicePathFromHandle(device);
+    if (dp)
+        text = DevicePathToStr(dp);
+    if (text) {
+        node = text;
+        for (CHAR16 *c = text; *c; c++)
+            if (*c == L'/' && c[1])
+                node = c + 1;
+    }
+
+    SPrint(buf, size, L"%s  %s", fs, node);
+    if (text)
+        FreePool(text);
+}
+
+EFI_STATUS
+sb_tui_file_browser(SuperBootContext *ctx)
+{
+    UINTN selected = 0, scroll = 0;
+    CHAR16 label[PICKER_LABEL_LEN];
+
+    /* Once the scan is over nothing else will mount: after a failed
+     * boot or an empty scan, pick up every partition now. */
+    if (ctx->scan_done)
+        sb_vfs_mount_all();
+
+    tui_screen_init(ctx);
+    tui_screen_invalidate();
+
+    for (;;) {
+        /* Re-read every time: the scan may have mounted more. */
+        UINTN count = sb_vfs_mount_count();
+
+        draw_frame(L"Partitions",
+                   L" [Enter] Browse  [Esc] Back to menu");
+        if (count == 0)
+            tui_screen_put(4, LIST_TOP, TUI_ATTR_NORMAL,
+                           L"(no accessible filesystems yet)");
+
+        follow(selected, &scroll);
+        for (UINTN i = 0; i < list_rows() && scroll + i < count; i++) {
+            mount_label(scroll + i, label, sizeof(label));
+            draw_row(i, scroll + i == selected, label);
         }
+        tui_screen_flush();
+
+        UINT16 key = tui_read_key(ctx->system_table);
+        if (key == TUI_KEY_ESCAPE)
+            break;
+        if (navigate(key, count, &selected) || key != TUI_KEY_ENTER ||
+            selected >= count)
+            continue;
+
+        EFI_HANDLE device = sb_vfs_mount_info(selected, NULL);
+        mount_label(selected, label, sizeof(label));
+        if (!browse(ctx, device, label))
+            break;
     }
+
+    cache_free_all();
+    return EFI_SUCCESS;
 }
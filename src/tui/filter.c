@@ -0,0 +1,235 @@
+/*
+ * filter.c — Type-to-filter search over the boot targets
+ *
+ * The menu's '/' mode keeps a ranked list of the targets matching the
+ * query typed so far.  A target matches when the query occurs in its
+ * title, kernel path or command line, either as a substring or as a
+ * subsequence ("fuzzy": "arcl" finds "Arch Linux").  Case is ignored
+ * for ASCII.
+ *
+ * Adding a character can only remove matches, so tui_filter_push()
+ * rescores just the previous result set.  Backspace rebuilds from all
+ * targets, and targets the scan adds later are tested once each by
+ * tui_filter_update().  Several hundred targets cost well under a
+ * millisecond per keystroke.
+ */
+
+#include "tui.h"
+
+/* Field weights: a title hit outranks a kernel path hit, which
+ * outranks a command-line hit, whatever the kind of match. */
+#define SCORE_SUBSTRING     1000
+#define SCORE_FUZZY         400
+#define WEIGHT_TITLE        3
+#define WEIGHT_KERNEL       2
+#define WEIGHT_CMDLINE      1
+
+static CHAR16
+fold(CHAR16 c)
+{
+    return (c >= 'A' && c <= 'Z') ? c + 32 : c;
+}
+
+/* Character i of a CHAR16 or CHAR8 string, folded. */
+static CHAR16
+char_at(const void *s, BOOLEAN wide, UINTN i)
+{
+    return fold(wide ? ((const CHAR16 *)s)[i] : ((const CHAR8 *)s)[i]);
+}
+
+static BOOLEAN
+word_start(const void *s, BOOLEAN wide, UINTN i)
+{
+    if (i == 0)
+        return TRUE;
+    CHAR16 p = char_at(s, wide, i - 1);
+    return p == ' ' || p == '/' || p == '\\' || p == '-' || p == '_' ||
+           p == '.' || p == '(' || p == '=';
+}
+
+/*
+ * Score one field against the query: 0 for no match.  Substring hits
+ * score by where they start (start of field, start of a word, inside
+ * a word); subsequence hits lose a point per character the match
+ * spans beyond the query length.
+ */
+static UINT32
+field_score(const void *s, BOOLEAN wide, const CHAR16 *q, UINTN qlen)
+{
+    if (!s)
+        return 0;
+
+    /* Substring. */
+    UINT32 best = 0;
+    for (UINTN i = 0; char_at(s, wide, i); i++) {
+        UINTN k = 0;
+        while (k < qlen && char_at(s, wide, i + k) == q[k])
+            k++;
+        if (k < qlen)
+            continue;
+
+        UINT32 score = SCORE_SUBSTRING + (i == 0 ? 200 :
+                       word_start(s, wide, i) ? 100 : 0);
+        if (score > best)
+            best = score;
+        if (i == 0)
+            break;
+    }
+    if (best)
+        return best;
+
+    /* Subsequence: find where the first greedy match ends, then walk
+     * back from there for the tightest start. */
+    UINTN i = 0, k = 0;
+    for (; k < qlen; i++) {
+        CHAR16 c = char_at(s, wide, i);
+        if (!c)
+            return 0;
+        if (c == q[k])
+            k++;
+    }
+    UINTN end = i;
+    while (k > 0) {
+        i--;
+        if (char_at(s, wide, i) == q[k - 1])
+            k--;
+    }
+    UINTN slack = (end - i) - qlen;
+    return slack < SCORE_FUZZY ? (UINT32)(SCORE_FUZZY - slack) : 1;
+}
+
+static UINT32
+target_score(const BootTarget *t, const CHAR16 *q, UINTN qlen)
+{
+    if (qlen == 0)
+        return 1;
+
+    UINT32 best = field_score(t->title, TRUE, q, qlen) * WEIGHT_TITLE;
+    UINT32 s = field_score(t->kernel_path, TRUE, q, qlen) * WEIGHT_KERNEL;
+    if (s > best)
+        best = s;
+    s = field_score(t->cmdline, FALSE, q, qlen) * WEIGHT_CMDLINE;
+    return s > best ? s : best;
+}
+
+/* Best score first; equal scores keep menu order. */
+static BOOLEAN
+ranks_before(const TuiMatch *a, const TuiMatch *b)
+{
+    return a->score > b->score ||
+           (a->score == b->score && a->target < b->target);
+}
+
+/* Insertion sort: the list is nearly sorted after every update. */
+static void
+sort_matches(TuiFilter *f)
+{
+    for (UINTN i = 1; i < f->count; i++) {
+        TuiMatch m = f->matches[i];
+        UINTN j = i;
+        while (j > 0 && ranks_before(&m, &f->matches[j - 1])) {
+            f->matches[j] = f->matches[j - 1];
+            j--;
+        }
+        f->matches[j] = m;
+    }
+}
+
+static BOOLEAN
+reserve(TuiFilter *f, UINTN n)
+{
+    if (n <= f->capacity)
+        return TRUE;
+
+    UINTN cap = f->capacity ? f->capacity : 64;
+    while (cap < n)
+        cap *= 2;
+    TuiMatch *m = sb_malloc(SB_MEM_TUI, cap * sizeof(*m));
+    if (!m)
+        return FALSE;
+    if (f->count)
+        sb_memcpy(m, f->matches, f->count * sizeof(*m));
+    sb_free(f->matches);
+    f->matches  = m;
+    f->capacity = cap;
+    return TRUE;
+}
+
+void
+tui_filter_init(TuiFilter *f)
+{
+    SetMem(f, sizeof(*f), 0);
+}
+
+void
+tui_filter_free(TuiFilter *f)
+{
+    sb_free(f->matches);
+    tui_filter_init(f);
+}
+
+/* Test the targets added since the last call. */
+void
+tui_filter_update(TuiFilter *f, const BootTargetList *list)
+{
+    if (f->scanned >= list->count || !reserve(f, list->count))
+        return;
+
+    UINTN before = f->count;
+    for (UINTN i = f->scanned; i < list->count; i++) {
+        UINT32 score = target_score(&list->entries[i], f->query, f->len);
+        if (score) {
+            f->matches[f->count].target = (UINT32)i;
+            f->matches[f->count].score  = score;
+            f->count++;
+        }
+    }
+    f->scanned = list->count;
+    if (f->count != before)
+        sort_matches(f);
+}
+
+/* Append `ch` to the query and drop the matches it rules out. */
+void
+tui_filter_push(TuiFilter *f, const BootTargetList *list, CHAR16 ch)
+{
+    if (f->len >= TUI_FILTER_MAX)
+        return;
+    f->query[f->len++] = fold(ch);
+    f->query[f->len]   = L'\0';
+
+    UINTN n = 0;
+    for (UINTN i = 0; i < f->count; i++) {
+        const BootTarget *t = &list->entries[f->matches[i].target];
+        UINT32 score = target_score(t, f->query, f->len);
+        if (score) {
+            f->matches[n]       = f->matches[i];
+            f->matches[n].score = score;
+            n++;
+        }
+    }
+    f->count = n;
+    sort_matches(f);
+}
+
+/* Remove the last query character; everything is tested again. */
+void
+tui_filter_pop(TuiFilter *f, const BootTargetList *list)
+{
+    if (f->len == 0)
+        return;
+    f->query[--f->len] = L'\0';
+    f->count   = 0;
+    f->scanned = 0;
+    tui_filter_update(f, list);
+}
+
+/* Position of `target` in the ranked list, or (UINTN)-1. */
+UINTN
+tui_filter_find(const TuiFilter *f, UINTN target)
+{
+    for (UINTN i = 0; i < f->count; i++)
+        if (f->matches[i].target == target)
+            return i;
+    return (UINTN)-1;
+}
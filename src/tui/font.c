@@ -0,0 +1,382 @@
+/*
+ * font.c — Built-in 8x16 console font (PSF2)
+ *
+ * Generated by tools/mkfont.py from Source Code Pro Bold
+ * (SIL Open Font License 1.1).  Do not edit.
+ */
+
+#include "tui.h"
+
+const UINT8 tui_font_psf[] = {
+    0x72, 0xb5, 0x4a, 0x86, 0x00, 0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00,
+    0x01, 0x00, 0x00, 0x00, 0xea, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00,
+    0x10, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7e, 0x42,
+    0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x7e, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x18, 0x18, 0x18,
+    0x18, 0x08, 0x1c, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x66, 0x66,
+    0x66, 0x66, 0x66, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x34, 0x34, 0x7e, 0x7e, 0x24, 0x7e, 0x7e, 0x2c, 0x68,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x08, 0x3e, 0x64, 0x70, 0x3c,
+    0x0e, 0x46, 0x7e, 0x3c, 0x08, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x30,
+    0x4b, 0x4a, 0x30, 0x06, 0x15, 0x25, 0x65, 0x06, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x1c, 0x3e, 0x36, 0x3c, 0x38, 0x7d, 0x67, 0x7f, 0x3c,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x18, 0x18, 0x18, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x06,
+    0x0c, 0x0c, 0x18, 0x18, 0x18, 0x18, 0x1c, 0x0c, 0x0e, 0x06, 0x00, 0x00,
+    0x00, 0x00, 0x20, 0x30, 0x18, 0x1c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x18,
+    0x18, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x08, 0x7f, 0x1c,
+    0x1c, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x18, 0x18, 0x18, 0x7e, 0x7e, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x1c, 0x1c,
+    0x0c, 0x18, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7e, 0x7e,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x1c, 0x1c, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x06, 0x06, 0x06, 0x0c, 0x0c, 0x08, 0x18, 0x18, 0x10, 0x30,
+    0x30, 0x20, 0x60, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x3e, 0x63, 0x7b, 0x7b,
+    0x63, 0x63, 0x3e, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x38,
+    0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0x7e, 0x7e, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x3c, 0x7e, 0x06, 0x06, 0x0e, 0x1c, 0x38, 0x7f, 0x7f,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x7e, 0x06, 0x1c, 0x3c,
+    0x0e, 0x06, 0x7e, 0x7c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0e,
+    0x1e, 0x1e, 0x36, 0x26, 0x7f, 0x7f, 0x06, 0x06, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x7e, 0x7e, 0x60, 0x7c, 0x7e, 0x06, 0x06, 0xfc, 0x78,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1e, 0x3e, 0x70, 0x64, 0x7f,
+    0x73, 0x63, 0x3f, 0x1e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7f,
+    0x7f, 0x06, 0x0c, 0x0c, 0x18, 0x18, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x3c, 0x7e, 0x66, 0x34, 0x1c, 0x6e, 0x66, 0x7e, 0x3c,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x7e, 0x63, 0x67, 0x7f,
+    0x13, 0x07, 0x3e, 0x3c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x1c, 0x1c, 0x1c, 0x00, 0x00, 0x1c, 0x1c, 0x1c, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x1c, 0x1c, 0x00, 0x08, 0x1c, 0x1c,
+    0x04, 0x08, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x0e, 0x38, 0x30,
+    0x1c, 0x0e, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x7e, 0x7e, 0x00, 0x7e, 0x7e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x60, 0x38, 0x1c, 0x0e, 0x1c, 0x70, 0x60, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x3e, 0x06, 0x0c, 0x18,
+    0x00, 0x08, 0x1c, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1e,
+    0x33, 0x61, 0x47, 0x5f, 0x59, 0x4f, 0x40, 0x60, 0x30, 0x1e, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x1c, 0x3c, 0x3c, 0x36, 0x26, 0x7e, 0x7f, 0x63, 0xc3,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7c, 0x7e, 0x66, 0x7e, 0x7e,
+    0x63, 0x63, 0x7f, 0x7e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1e,
+    0x3f, 0x70, 0x60, 0x60, 0x60, 0x70, 0x3f, 0x1e, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x7c, 0x7e, 0x67, 0x63, 0x63, 0x63, 0x67, 0x7e, 0x7c,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7e, 0x7e, 0x60, 0x7c, 0x7e,
+    0x60, 0x60, 0x7e, 0x7e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7e,
+    0x7e, 0x60, 0x60, 0x7e, 0x7c, 0x60, 0x60, 0x60, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x1e, 0x3f, 0x70, 0x60, 0x67, 0x67, 0x73, 0x3f, 0x1e,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x63, 0x63, 0x63, 0x7f, 0x7f,
+    0x63, 0x63, 0x63, 0x63, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7e,
+    0x7e, 0x18, 0x18, 0x18, 0x18, 0x18, 0x7e, 0x7e, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x7e, 0x3e, 0x06, 0x06, 0x06, 0x06, 0x06, 0x7e, 0x3c,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x67, 0x66, 0x6c, 0x7c, 0x7c,
+    0x7c, 0x66, 0x67, 0x63, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x60,
+    0x60, 0x60, 0x60, 0x60, 0x60, 0x60, 0x7e, 0x7e, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x77, 0x77, 0x77, 0x7f, 0x7f, 0x6b, 0x6b, 0x63, 0x63,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x73, 0x73, 0x73, 0x7b, 0x6b,
+    0x6f, 0x67, 0x67, 0x67, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1c,
+    0x3e, 0x73, 0x63, 0x63, 0x63, 0x73, 0x3e, 0x1c, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x7e, 0x7f, 0x63, 0x63, 0x7f, 0x7e, 0x60, 0x60, 0x60,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x3e, 0x73, 0x63, 0x63,
+    0x63, 0x63, 0x77, 0x3e, 0x1c, 0x0f, 0x07, 0x00, 0x00, 0x00, 0x00, 0x7e,
+    0x7f, 0x63, 0x67, 0x7e, 0x7e, 0x66, 0x67, 0x63, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x3e, 0x7e, 0x60, 0x78, 0x3e, 0x0f, 0x03, 0x7f, 0x3e,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7f, 0x7f, 0x0c, 0x0c, 0x0c,
+    0x0c, 0x0c, 0x0c, 0x0c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x63,
+    0x63, 0x63, 0x63, 0x63, 0x63, 0x63, 0x3f, 0x1e, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0xe3, 0x63, 0x66, 0x66, 0x36, 0x36, 0x3c, 0x3c, 0x1c,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc3, 0xc3, 0xdb, 0xdb, 0xdb,
+    0xfe, 0x7e, 0x6e, 0x66, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x63,
+    0x76, 0x36, 0x3c, 0x1c, 0x3c, 0x3e, 0x66, 0x63, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0xe3, 0x66, 0x66, 0x3c, 0x3c, 0x18, 0x18, 0x18, 0x18,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3f, 0x3f, 0x06, 0x0e, 0x1c,
+    0x18, 0x38, 0x7f, 0x7f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1f, 0x1e,
+    0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x1f, 0x1e, 0x00,
+    0x00, 0x00, 0x60, 0x20, 0x30, 0x30, 0x10, 0x18, 0x18, 0x08, 0x0c, 0x0c,
+    0x06, 0x06, 0x06, 0x00, 0x00, 0x00, 0x7c, 0x3c, 0x0c, 0x0c, 0x0c, 0x0c,
+    0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x7c, 0x3c, 0x00, 0x00, 0x00, 0x08, 0x18,
+    0x1c, 0x34, 0x26, 0x66, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x7f, 0x7f, 0x00, 0x00, 0x00, 0x30, 0x38, 0x18, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x3e, 0x3f, 0x03, 0x3f, 0x63, 0x7f, 0x3b, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x60, 0x60, 0x60, 0x7e, 0x7f, 0x63, 0x63, 0x63, 0x7e, 0x7e,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1e, 0x3e, 0x60,
+    0x60, 0x60, 0x3e, 0x1e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x03,
+    0x03, 0x3f, 0x3f, 0x63, 0x63, 0x63, 0x7f, 0x3f, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x1e, 0x3f, 0x7f, 0x7f, 0x60, 0x3e, 0x1e,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0f, 0x1e, 0x18, 0x7e, 0x7e, 0x18,
+    0x18, 0x18, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x3f, 0x7f, 0x66, 0x66, 0x3c, 0x7e, 0x3f, 0x63, 0x7f, 0x3e, 0x00,
+    0x00, 0x00, 0x60, 0x60, 0x60, 0x6e, 0x7f, 0x63, 0x63, 0x63, 0x63, 0x63,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x0e, 0x04, 0x00, 0x7c, 0x3c, 0x0c,
+    0x0c, 0x0c, 0x0c, 0x0c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x0e, 0x04,
+    0x00, 0x7c, 0x3c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x7c, 0x78, 0x00,
+    0x00, 0x00, 0x60, 0x60, 0x60, 0x67, 0x6e, 0x7c, 0x7c, 0x7c, 0x66, 0x63,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x78, 0x78, 0x18, 0x18, 0x18, 0x18,
+    0x18, 0x18, 0x1e, 0x0f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x7f, 0x7f, 0x6d, 0x6d, 0x6d, 0x6d, 0x6d, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x6e, 0x7f, 0x63, 0x63, 0x63, 0x63, 0x63,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x3f, 0x63,
+    0x63, 0x63, 0x3f, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x7e, 0x7f, 0x63, 0x63, 0x63, 0x7e, 0x7e, 0x60, 0x60, 0x60, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x3f, 0x3f, 0x63, 0x63, 0x63, 0x7f, 0x3f,
+    0x03, 0x03, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x37, 0x3f, 0x38,
+    0x30, 0x30, 0x30, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x3c, 0x7e, 0x70, 0x3e, 0x06, 0x7e, 0x3c, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x18, 0x18, 0x7f, 0x7f, 0x18, 0x18, 0x18, 0x1f, 0x0f,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x66, 0x66, 0x66,
+    0x66, 0x66, 0x7e, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x63, 0x66, 0x66, 0x36, 0x3c, 0x3c, 0x1c, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0xc3, 0xdb, 0xdb, 0x7f, 0x7f, 0x77, 0x76,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x66, 0x36, 0x3c,
+    0x1c, 0x3c, 0x76, 0x67, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x63, 0x62, 0x66, 0x36, 0x3c, 0x1c, 0x1c, 0x18, 0x78, 0x70, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x7e, 0x7e, 0x1c, 0x18, 0x30, 0x7e, 0x7e,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0e, 0x1e, 0x18, 0x18, 0x18, 0x18,
+    0x70, 0x18, 0x18, 0x18, 0x18, 0x1e, 0x0e, 0x00, 0x00, 0x18, 0x18, 0x18,
+    0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x00,
+    0x00, 0x00, 0x70, 0x78, 0x18, 0x18, 0x18, 0x18, 0x0e, 0x18, 0x18, 0x18,
+    0x18, 0x78, 0x70, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x30, 0x7e,
+    0x4e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x1c, 0x08, 0x00, 0x18, 0x18, 0x18,
+    0x18, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00, 0x08, 0x1c, 0x3c, 0x78, 0x68,
+    0x68, 0x78, 0x3e, 0x1c, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1e,
+    0x3e, 0x30, 0x30, 0x7c, 0x7c, 0x18, 0x3f, 0x7f, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x42, 0x7e, 0x7e, 0x66, 0x66, 0x7e, 0x7e, 0x42,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x63, 0x66, 0x34, 0x3c, 0x7f,
+    0x18, 0x7f, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x18,
+    0x18, 0x18, 0x18, 0x00, 0x00, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x00,
+    0x00, 0x00, 0x1e, 0x3e, 0x30, 0x3c, 0x7f, 0x63, 0x3b, 0x1e, 0x06, 0x3e,
+    0x3c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x12, 0x36, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1e,
+    0x21, 0x6d, 0x50, 0x50, 0x50, 0x6d, 0x21, 0x1e, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x1c, 0x04, 0x1e, 0x36, 0x3e, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x33, 0x66,
+    0x6c, 0x66, 0x32, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x7f, 0x7f, 0x03, 0x03, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7e, 0x7e, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x66, 0x5a, 0x5a, 0x66, 0x3c,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x3c,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x18, 0x24, 0x24, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x7e, 0x7e,
+    0x18, 0x18, 0x7e, 0x7e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x38, 0x2c, 0x04,
+    0x0c, 0x18, 0x3c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x3c, 0x0c, 0x1c, 0x0c, 0x2c, 0x38, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x0c, 0x18, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x66, 0x66, 0x66, 0x66, 0x66, 0x7f, 0x7b, 0x60, 0x60, 0x60, 0x00,
+    0x00, 0x00, 0x00, 0x3b, 0x7b, 0x7b, 0x7b, 0x7b, 0x3b, 0x03, 0x03, 0x03,
+    0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x1c,
+    0x1c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x08, 0x0c, 0x18, 0x00,
+    0x00, 0x08, 0x38, 0x08, 0x08, 0x18, 0x3e, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x3c, 0x24, 0x3c, 0x18, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x64, 0x36, 0x33, 0x36, 0x66, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x71, 0x33, 0x32, 0x30, 0x02, 0x16, 0x75, 0x67, 0x01,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x71, 0x33, 0x32, 0x30, 0x00,
+    0x07, 0x31, 0x63, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x70,
+    0x11, 0x33, 0x12, 0x70, 0x06, 0x35, 0x6f, 0x01, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x38, 0x38, 0x10, 0x00, 0x18, 0x30, 0x70,
+    0x60, 0x7c, 0x38, 0x00, 0x38, 0x08, 0x00, 0x1c, 0x3c, 0x3c, 0x36, 0x26,
+    0x7e, 0x7f, 0x63, 0xc3, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x18, 0x00, 0x1c,
+    0x3c, 0x3c, 0x36, 0x26, 0x7e, 0x7f, 0x63, 0xc3, 0x00, 0x00, 0x00, 0x00,
+    0x1c, 0x24, 0x00, 0x1c, 0x3c, 0x3c, 0x36, 0x26, 0x7e, 0x7f, 0x63, 0xc3,
+    0x00, 0x00, 0x00, 0x00, 0x7c, 0x7c, 0x00, 0x38, 0x38, 0x38, 0x6c, 0x6c,
+    0x7c, 0xfe, 0xc6, 0xc6, 0x00, 0x00, 0x00, 0x00, 0x12, 0x36, 0x00, 0x1c,
+    0x1c, 0x1e, 0x36, 0x36, 0x3f, 0x7f, 0x63, 0x63, 0x00, 0x00, 0x00, 0x00,
+    0x1c, 0x1c, 0x00, 0x1c, 0x1c, 0x1c, 0x36, 0x36, 0x3e, 0x7f, 0x63, 0x63,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3f, 0x3f, 0x3c, 0x6e, 0x6f,
+    0x7c, 0xfc, 0xcf, 0xcf, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1e,
+    0x3f, 0x70, 0x60, 0x60, 0x60, 0x70, 0x3f, 0x1e, 0x0c, 0x04, 0x0c, 0x00,
+    0x18, 0x08, 0x00, 0x7e, 0x7e, 0x60, 0x7c, 0x7e, 0x60, 0x60, 0x7e, 0x7e,
+    0x00, 0x00, 0x00, 0x00, 0x1c, 0x18, 0x00, 0x7e, 0x7e, 0x60, 0x7c, 0x7e,
+    0x60, 0x60, 0x7e, 0x7e, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x24, 0x00, 0x7e,
+    0x7e, 0x60, 0x7c, 0x7e, 0x60, 0x60, 0x7e, 0x7e, 0x00, 0x00, 0x00, 0x00,
+    0x24, 0x36, 0x00, 0x7e, 0x7e, 0x60, 0x7c, 0x7c, 0x60, 0x60, 0x7e, 0x7e,
+    0x00, 0x00, 0x00, 0x00, 0x38, 0x08, 0x00, 0x7e, 0x7e, 0x18, 0x18, 0x18,
+    0x18, 0x18, 0x7e, 0x7e, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x10, 0x00, 0x7e,
+    0x7e, 0x18, 0x18, 0x18, 0x18, 0x18, 0x7e, 0x7e, 0x00, 0x00, 0x00, 0x00,
+    0x3c, 0x24, 0x00, 0x7e, 0x7e, 0x18, 0x18, 0x18, 0x18, 0x18, 0x7e, 0x7e,
+    0x00, 0x00, 0x00, 0x00, 0x24, 0x36, 0x00, 0x7e, 0x7e, 0x18, 0x18, 0x18,
+    0x18, 0x18, 0x7e, 0x7e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7c,
+    0x7e, 0x67, 0xf3, 0xfb, 0x63, 0x67, 0x7e, 0x7c, 0x00, 0x00, 0x00, 0x00,
+    0x3a, 0x3e, 0x00, 0x73, 0x73, 0x73, 0x7b, 0x6b, 0x6f, 0x67, 0x67, 0x67,
+    0x00, 0x00, 0x00, 0x00, 0x18, 0x08, 0x00, 0x1c, 0x3e, 0x73, 0x63, 0x63,
+    0x63, 0x73, 0x3e, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x08, 0x00, 0x1c,
+    0x3e, 0x73, 0x63, 0x63, 0x63, 0x73, 0x3e, 0x1c, 0x00, 0x00, 0x00, 0x00,
+    0x1c, 0x16, 0x00, 0x1c, 0x3e, 0x73, 0x63, 0x63, 0x63, 0x73, 0x3e, 0x1c,
+    0x00, 0x00, 0x00, 0x00, 0x3e, 0x3e, 0x00, 0x1c, 0x3e, 0x73, 0x63, 0x63,
+    0x63, 0x73, 0x3e, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x12, 0x36, 0x00, 0x1c,
+    0x3e, 0x73, 0x63, 0x63, 0x63, 0x73, 0x3e, 0x1c, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x66, 0x3c, 0x1c, 0x3c, 0x66, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1f, 0x3f, 0x77, 0x6f, 0x6b,
+    0x7b, 0x73, 0x7e, 0x7c, 0x00, 0x00, 0x00, 0x00, 0x18, 0x0c, 0x00, 0x63,
+    0x63, 0x63, 0x63, 0x63, 0x63, 0x63, 0x3f, 0x1e, 0x00, 0x00, 0x00, 0x00,
+    0x0c, 0x18, 0x00, 0x63, 0x63, 0x63, 0x63, 0x63, 0x63, 0x63, 0x3f, 0x1e,
+    0x00, 0x00, 0x00, 0x00, 0x1c, 0x36, 0x00, 0x63, 0x63, 0x63, 0x63, 0x63,
+    0x63, 0x63, 0x3f, 0x1e, 0x00, 0x00, 0x00, 0x00, 0x24, 0x36, 0x00, 0x63,
+    0x63, 0x63, 0x63, 0x63, 0x63, 0x63, 0x3f, 0x1e, 0x00, 0x00, 0x00, 0x00,
+    0x1c, 0x10, 0x00, 0xe3, 0x66, 0x66, 0x3c, 0x3c, 0x18, 0x18, 0x18, 0x18,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x60, 0x7c, 0x7e, 0x63, 0x63,
+    0x7f, 0x7e, 0x60, 0x60, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x7e,
+    0x66, 0x66, 0x6c, 0x6e, 0x67, 0x63, 0x6f, 0x6e, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x18, 0x1c, 0x0c, 0x00, 0x3e, 0x3f, 0x03, 0x3f, 0x63, 0x7f, 0x3b,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x06, 0x0e, 0x08, 0x00, 0x3e, 0x3f, 0x03,
+    0x3f, 0x63, 0x7f, 0x3b, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x1e, 0x32,
+    0x00, 0x3e, 0x3f, 0x03, 0x3f, 0x63, 0x7f, 0x3b, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x3a, 0x3e, 0x00, 0x3e, 0x7f, 0x03, 0x3f, 0x63, 0x7f, 0x3b,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x36, 0x12, 0x00, 0x00, 0x3e, 0x3f, 0x03,
+    0x3f, 0x63, 0x7f, 0x3b, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x16, 0x1c,
+    0x00, 0x3e, 0x3f, 0x03, 0x3f, 0x63, 0x7f, 0x3b, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x3b, 0x3f, 0x1f, 0x7f, 0x6c, 0x7f, 0x37,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1e, 0x3e, 0x60,
+    0x60, 0x60, 0x3e, 0x1e, 0x08, 0x0c, 0x18, 0x00, 0x00, 0x10, 0x18, 0x08,
+    0x00, 0x1e, 0x3f, 0x7f, 0x7f, 0x60, 0x3e, 0x1e, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x06, 0x0c, 0x08, 0x00, 0x1e, 0x3f, 0x7f, 0x7f, 0x60, 0x3e, 0x1e,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x1e, 0x22, 0x00, 0x1e, 0x3f, 0x7f,
+    0x7f, 0x60, 0x3e, 0x1e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x36, 0x12, 0x00,
+    0x00, 0x1e, 0x3f, 0x7f, 0x7f, 0x60, 0x3e, 0x1e, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x18, 0x1c, 0x0c, 0x00, 0x7c, 0x7c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x06, 0x0e, 0x08, 0x00, 0x7c, 0x7c, 0x0c,
+    0x0c, 0x0c, 0x0c, 0x0c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x1e, 0x12,
+    0x00, 0x7c, 0x7c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x36, 0x12, 0x00, 0x00, 0x7c, 0x7c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1e, 0x1c, 0x36, 0x1f, 0x3f, 0x73,
+    0x63, 0x63, 0x3e, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3a, 0x3e,
+    0x00, 0x6e, 0x7f, 0x63, 0x63, 0x63, 0x63, 0x63, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x30, 0x18, 0x08, 0x00, 0x1c, 0x3f, 0x63, 0x63, 0x63, 0x3f, 0x1c,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x06, 0x0c, 0x08, 0x00, 0x1c, 0x3f, 0x63,
+    0x63, 0x63, 0x3f, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x1e, 0x22,
+    0x00, 0x1c, 0x3f, 0x63, 0x63, 0x63, 0x3f, 0x1c, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x3e, 0x3e, 0x00, 0x1c, 0x3f, 0x63, 0x63, 0x63, 0x3f, 0x1c,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x36, 0x22, 0x00, 0x00, 0x1c, 0x3f, 0x63,
+    0x63, 0x63, 0x3f, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x18, 0x08, 0x7e, 0x7e, 0x00, 0x08, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x1f, 0x3e, 0x67, 0x6b, 0x73, 0x3f, 0x7c,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x30, 0x38, 0x08, 0x00, 0x66, 0x66, 0x66,
+    0x66, 0x66, 0x7e, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x0c, 0x08,
+    0x00, 0x66, 0x66, 0x66, 0x66, 0x66, 0x7e, 0x36, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x18, 0x3c, 0x24, 0x00, 0x66, 0x66, 0x66, 0x66, 0x66, 0x7e, 0x36,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x36, 0x24, 0x00, 0x00, 0x66, 0x66, 0x66,
+    0x66, 0x66, 0x7e, 0x3e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x0c, 0x08,
+    0x00, 0x63, 0x62, 0x66, 0x36, 0x3c, 0x1c, 0x1c, 0x18, 0x78, 0x70, 0x00,
+    0x00, 0x00, 0x60, 0x60, 0x60, 0x7e, 0x7f, 0x63, 0x63, 0x63, 0x7e, 0x7c,
+    0x60, 0x60, 0x60, 0x00, 0x00, 0x36, 0x12, 0x00, 0x00, 0x63, 0x63, 0x36,
+    0x36, 0x1e, 0x1c, 0x1c, 0x18, 0x38, 0x70, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x7e, 0x7e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x08, 0x18, 0x1c, 0x1c, 0x08,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x38,
+    0x18, 0x08, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x11, 0x22, 0x66, 0x77, 0x77, 0x22, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x26, 0x77, 0x37, 0x11, 0x26, 0x04,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x1c, 0x3e, 0x3e, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xdb, 0xdb, 0xdb,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x30, 0x7f,
+    0xff, 0x70, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x18, 0x3c, 0x7e, 0x5b, 0x18, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x0e, 0x7f, 0xff, 0x06, 0x0c, 0x08,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x18,
+    0x5b, 0x7e, 0x3c, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x08, 0x18, 0x1c, 0x3c, 0x3e, 0x7e, 0x7e, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0xc0, 0xf0, 0xfe, 0xff, 0xfc, 0xe0, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7e, 0x3e, 0x3c, 0x1c,
+    0x18, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x01, 0x0f, 0x7f, 0xff, 0x1f, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+    0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x1f, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf0, 0x10, 0x10, 0x10, 0x10,
+    0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1f,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x10, 0x10, 0x10,
+    0x10, 0x10, 0x10, 0xf0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1f, 0x10, 0x10, 0x10, 0x10,
+    0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0xf0,
+    0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0xff, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+    0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0xff, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0xff,
+    0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0xff, 0x00, 0xff, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28,
+    0x28, 0x28, 0x28, 0x28, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1f, 0x28,
+    0x3f, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0xf0, 0x28, 0xf8, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28,
+    0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x3f, 0x28, 0x1f, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0xf8, 0x28,
+    0xf0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x28, 0x28, 0x28, 0x28,
+    0x28, 0x28, 0x3f, 0x28, 0x3f, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28,
+    0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0xf8, 0x28, 0xf8, 0x28, 0x28, 0x28,
+    0x28, 0x28, 0x28, 0x28, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x28,
+    0xff, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28,
+    0x28, 0x28, 0xff, 0x28, 0xff, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0xff, 0x28, 0xff, 0x28, 0x28, 0x28,
+    0x28, 0x28, 0x28, 0x28, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xaa, 0x00, 0xaa, 0x00,
+    0xaa, 0x00, 0xaa, 0x00, 0xaa, 0x00, 0xaa, 0x00, 0xaa, 0x00, 0xaa, 0x00,
+    0xaa, 0x55, 0xaa, 0x55, 0xaa, 0x55, 0xaa, 0x55, 0xaa, 0x55, 0xaa, 0x55,
+    0xaa, 0x55, 0xaa, 0x55, 0x55, 0xff, 0x55, 0xff, 0x55, 0xff, 0x55, 0xff,
+    0x55, 0xff, 0x55, 0xff, 0x55, 0xff, 0x55, 0xff, 0xff, 0x20, 0xff, 0x21,
+    0xff, 0x22, 0xff, 0x23, 0xff, 0x24, 0xff, 0x25, 0xff, 0x26, 0xff, 0x27,
+    0xff, 0x28, 0xff, 0x29, 0xff, 0x2a, 0xff, 0x2b, 0xff, 0x2c, 0xff, 0x2d,
+    0xff, 0x2e, 0xff, 0x2f, 0xff, 0x30, 0xff, 0x31, 0xff, 0x32, 0xff, 0x33,
+    0xff, 0x34, 0xff, 0x35, 0xff, 0x36, 0xff, 0x37, 0xff, 0x38, 0xff, 0x39,
+    0xff, 0x3a, 0xff, 0x3b, 0xff, 0x3c, 0xff, 0x3d, 0xff, 0x3e, 0xff, 0x3f,
+    0xff, 0x40, 0xff, 0x41, 0xff, 0x42, 0xff, 0x43, 0xff, 0x44, 0xff, 0x45,
+    0xff, 0x46, 0xff, 0x47, 0xff, 0x48, 0xff, 0x49, 0xff, 0x4a, 0xff, 0x4b,
+    0xff, 0x4c, 0xff, 0x4d, 0xff, 0x4e, 0xff, 0x4f, 0xff, 0x50, 0xff, 0x51,
+    0xff, 0x52, 0xff, 0x53, 0xff, 0x54, 0xff, 0x55, 0xff, 0x56, 0xff, 0x57,
+    0xff, 0x58, 0xff, 0x59, 0xff, 0x5a, 0xff, 0x5b, 0xff, 0x5c, 0xff, 0x5d,
+    0xff, 0x5e, 0xff, 0x5f, 0xff, 0x60, 0xff, 0x61, 0xff, 0x62, 0xff, 0x63,
+    0xff, 0x64, 0xff, 0x65, 0xff, 0x66, 0xff, 0x67, 0xff, 0x68, 0xff, 0x69,
+    0xff, 0x6a, 0xff, 0x6b, 0xff, 0x6c, 0xff, 0x6d, 0xff, 0x6e, 0xff, 0x6f,
+    0xff, 0x70, 0xff, 0x71, 0xff, 0x72, 0xff, 0x73, 0xff, 0x74, 0xff, 0x75,
+    0xff, 0x76, 0xff, 0x77, 0xff, 0x78, 0xff, 0x79, 0xff, 0x7a, 0xff, 0x7b,
+    0xff, 0x7c, 0xff, 0x7d, 0xff, 0x7e, 0xff, 0xc2, 0xa0, 0xff, 0xc2, 0xa1,
+    0xff, 0xc2, 0xa2, 0xff, 0xc2, 0xa3, 0xff, 0xc2, 0xa4, 0xff, 0xc2, 0xa5,
+    0xff, 0xc2, 0xa6, 0xff, 0xc2, 0xa7, 0xff, 0xc2, 0xa8, 0xff, 0xc2, 0xa9,
+    0xff, 0xc2, 0xaa, 0xff, 0xc2, 0xab, 0xff, 0xc2, 0xac, 0xff, 0xc2, 0xad,
+    0xff, 0xc2, 0xae, 0xff, 0xc2, 0xaf, 0xff, 0xc2, 0xb0, 0xff, 0xc2, 0xb1,
+    0xff, 0xc2, 0xb2, 0xff, 0xc2, 0xb3, 0xff, 0xc2, 0xb4, 0xff, 0xc2, 0xb5,
+    0xff, 0xc2, 0xb6, 0xff, 0xc2, 0xb7, 0xff, 0xc2, 0xb8, 0xff, 0xc2, 0xb9,
+    0xff, 0xc2, 0xba, 0xff, 0xc2, 0xbb, 0xff, 0xc2, 0xbc, 0xff, 0xc2, 0xbd,
+    0xff, 0xc2, 0xbe, 0xff, 0xc2, 0xbf, 0xff, 0xc3, 0x80, 0xff, 0xc3, 0x81,
+    0xff, 0xc3, 0x82, 0xff, 0xc3, 0x83, 0xff, 0xc3, 0x84, 0xff, 0xc3, 0x85,
+    0xff, 0xc3, 0x86, 0xff, 0xc3, 0x87, 0xff, 0xc3, 0x88, 0xff, 0xc3, 0x89,
+    0xff, 0xc3, 0x8a, 0xff, 0xc3, 0x8b, 0xff, 0xc3, 0x8c, 0xff, 0xc3, 0x8d,
+    0xff, 0xc3, 0x8e, 0xff, 0xc3, 0x8f, 0xff, 0xc3, 0x90, 0xff, 0xc3, 0x91,
+    0xff, 0xc3, 0x92, 0xff, 0xc3, 0x93, 0xff, 0xc3, 0x94, 0xff, 0xc3, 0x95,
+    0xff, 0xc3, 0x96, 0xff, 0xc3, 0x97, 0xff, 0xc3, 0x98, 0xff, 0xc3, 0x99,
+    0xff, 0xc3, 0x9a, 0xff, 0xc3, 0x9b, 0xff, 0xc3, 0x9c, 0xff, 0xc3, 0x9d,
+    0xff, 0xc3, 0x9e, 0xff, 0xc3, 0x9f, 0xff, 0xc3, 0xa0, 0xff, 0xc3, 0xa1,
+    0xff, 0xc3, 0xa2, 0xff, 0xc3, 0xa3, 0xff, 0xc3, 0xa4, 0xff, 0xc3, 0xa5,
+    0xff, 0xc3, 0xa6, 0xff, 0xc3, 0xa7, 0xff, 0xc3, 0xa8, 0xff, 0xc3, 0xa9,
+    0xff, 0xc3, 0xaa, 0xff, 0xc3, 0xab, 0xff, 0xc3, 0xac, 0xff, 0xc3, 0xad,
+    0xff, 0xc3, 0xae, 0xff, 0xc3, 0xaf, 0xff, 0xc3, 0xb0, 0xff, 0xc3, 0xb1,
+    0xff, 0xc3, 0xb2, 0xff, 0xc3, 0xb3, 0xff, 0xc3, 0xb4, 0xff, 0xc3, 0xb5,
+    0xff, 0xc3, 0xb6, 0xff, 0xc3, 0xb7, 0xff, 0xc3, 0xb8, 0xff, 0xc3, 0xb9,
+    0xff, 0xc3, 0xba, 0xff, 0xc3, 0xbb, 0xff, 0xc3, 0xbc, 0xff, 0xc3, 0xbd,
+    0xff, 0xc3, 0xbe, 0xff, 0xc3, 0xbf, 0xff, 0xe2, 0x80, 0x93, 0xff, 0xe2,
+    0x80, 0x94, 0xff, 0xe2, 0x80, 0x98, 0xff, 0xe2, 0x80, 0x99, 0xff, 0xe2,
+    0x80, 0x9c, 0xff, 0xe2, 0x80, 0x9d, 0xff, 0xe2, 0x80, 0xa2, 0xff, 0xe2,
+    0x80, 0xa6, 0xff, 0xe2, 0x86, 0x90, 0xff, 0xe2, 0x86, 0x91, 0xff, 0xe2,
+    0x86, 0x92, 0xff, 0xe2, 0x86, 0x93, 0xff, 0xe2, 0x96, 0xb2, 0xff, 0xe2,
+    0x96, 0xba, 0xff, 0xe2, 0x96, 0xbc, 0xff, 0xe2, 0x97, 0x84, 0xff, 0xe2,
+    0x94, 0x80, 0xff, 0xe2, 0x94, 0x82, 0xff, 0xe2, 0x94, 0x8c, 0xff, 0xe2,
+    0x94, 0x90, 0xff, 0xe2, 0x94, 0x94, 0xff, 0xe2, 0x94, 0x98, 0xff, 0xe2,
+    0x94, 0x9c, 0xff, 0xe2, 0x94, 0xa4, 0xff, 0xe2, 0x94, 0xac, 0xff, 0xe2,
+    0x94, 0xb4, 0xff, 0xe2, 0x94, 0xbc, 0xff, 0xe2, 0x95, 0x90, 0xff, 0xe2,
+    0x95, 0x91, 0xff, 0xe2, 0x95, 0x94, 0xff, 0xe2, 0x95, 0x97, 0xff, 0xe2,
+    0x95, 0x9a, 0xff, 0xe2, 0x95, 0x9d, 0xff, 0xe2, 0x95, 0xa0, 0xff, 0xe2,
+    0x95, 0xa3, 0xff, 0xe2, 0x95, 0xa6, 0xff, 0xe2, 0x95, 0xa9, 0xff, 0xe2,
+    0x95, 0xac, 0xff, 0xe2, 0x96, 0x88, 0xff, 0xe2, 0x96, 0x91, 0xff, 0xe2,
+    0x96, 0x92, 0xff, 0xe2, 0x96, 0x93, 0xff,
+};
+
+const UINTN tui_font_psf_size = sizeof(tui_font_psf);
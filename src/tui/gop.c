@@ -0,0 +1,380 @@
+/*
+ * gop.c — Text rendering straight to the Graphics Output Protocol
+ *
+ * Simple Text Output on most firmware is itself a software renderer
+ * on top of GOP, and usually a slow one: a Blt per character, glyphs
+ * looked up through HII each time.  When GOP is available the shadow
+ * screen (screen.c) renders through here instead:
+ *
+ *   - the built-in PSF2 font (font.c) is parsed once; glyphs are
+ *     scaled by a whole factor so the grid stays near 100x30 cells
+ *   - a glyph atlas per attribute holds glyphs already expanded to
+ *     Blt pixels, each rasterised on first use; drawing a cell is
+ *     then a few row copies
+ *   - cells are drawn into an off-screen buffer covering the grid, and
+ *     tui_gop_present() Blts only the bands of rows that changed
+ *
+ * Without GOP (serial consoles, headless machines) or with the
+ * "textmode" load option, screen.c stays on ConOut.
+ */
+
+#include "tui.h"
+
+/* Smallest grid we scale glyphs down to keep. */
+#define GOP_MIN_COLS   100
+#define GOP_MIN_ROWS   30
+
+#define PSF2_MAGIC     0x864AB572
+#define PSF2_HAS_UNICODE_TABLE  0x01
+
+typedef struct {
+    UINT32 magic;
+    UINT32 version;
+    UINT32 header_size;
+    UINT32 flags;
+    UINT32 length;              /* number of glyphs */
+    UINT32 charsize;            /* bytes per glyph  */
+    UINT32 height;
+    UINT32 width;
+} Psf2Header;
+
+/* Code points above Latin-1 that the font covers. */
+typedef struct {
+    UINT16 cp;
+    UINT16 glyph;
+} GlyphMap;
+
+#define GOP_MAX_EXTRA  128
+
+/* EFI text colours as EDK2's graphics console draws them. */
+static const EFI_GRAPHICS_OUTPUT_BLT_PIXEL palette[16] = {
+    { 0x00, 0x00, 0x00, 0 }, { 0x98, 0x00, 0x00, 0 },
+    { 0x00, 0x98, 0x00, 0 }, { 0x98, 0x98, 0x00, 0 },
+    { 0x00, 0x00, 0x98, 0 }, { 0x98, 0x00, 0x98, 0 },
+    { 0x00, 0x98, 0x98, 0 }, { 0x98, 0x98, 0x98, 0 },
+    { 0x30, 0x30, 0x30, 0 }, { 0xFF, 0x00, 0x00, 0 },
+    { 0x00, 0xFF, 0x00, 0 }, { 0xFF, 0xFF, 0x00, 0 },
+    { 0x00, 0x00, 0xFF, 0 }, { 0xFF, 0x00, 0xFF, 0 },
+    { 0x00, 0xFF, 0xFF, 0 }, { 0xFF, 0xFF, 0xFF, 0 },
+};
+
+static EFI_GRAPHICS_OUTPUT_PROTOCOL *gop;
+
+/* Font. */
+static const UINT8 *glyph_bits;
+static UINT32       glyph_count, glyph_bytes, glyph_stride;
+static UINT32       font_w, font_h;
+static UINT16       map_latin1[256];
+static GlyphMap     map_extra[GOP_MAX_EXTRA];
+static UINTN        map_extra_count;
+
+/* Geometry, in pixels. */
+static UINTN        scale;
+static UINTN        cell_w, cell_h;
+static UINTN        grid_x, grid_y;         /* grid origin on screen  */
+static UINTN        grid_w, grid_h;
+
+/* Off-screen buffer for the grid, and the rows drawn since the last
+ * present (as a band of text rows). */
+static EFI_GRAPHICS_OUTPUT_BLT_PIXEL *fb;
+static UINTN        dirty_lo, dirty_hi;     /* text rows, hi exclusive */
+static UINTN        dirty_col_lo, dirty_col_hi;
+static BOOLEAN      margins_dirty;          /* border round the grid  */
+
+/* Atlases: per attribute, every glyph as cell_w x cell_h pixels. */
+static EFI_GRAPHICS_OUTPUT_BLT_PIXEL *atlas[128];
+static UINT8       *atlas_ready[128];       /* one bit per glyph      */
+
+/* ------------------------------------------------------------------ */
+/*  Font                                                               */
+/* ------------------------------------------------------------------ */
+
+/* Decode one UTF-8 sequence; returns bytes used, 0 on garbage. */
+static UINTN
+utf8_decode(const UINT8 *p, const UINT8 *end, UINT32 *cp)
+{
+    if (p[0] < 0x80) {
+        *cp = p[0];
+        return 1;
+    }
+    if ((p[0] & 0xE0) == 0xC0 && p + 1 < end) {
+        *cp = ((UINT32)(p[0] & 0x1F) << 6) | (p[1] & 0x3F);
+        return 2;
+    }
+    if ((p[0] & 0xF0) == 0xE0 && p + 2 < end) {
+        *cp = ((UINT32)(p[0] & 0x0F) << 12) |
+              ((UINT32)(p[1] & 0x3F) << 6) | (p[2] & 0x3F);
+        return 3;
+    }
+    return 0;
+}
+
+static void
+map_add(UINT32 cp, UINT16 glyph)
+{
+    if (cp < 256) {
+        map_latin1[cp] = glyph;
+        return;
+    }
+    if (cp > 0xFFFF || map_extra_count >= GOP_MAX_EXTRA)
+        return;
+
+    /* Keep map_extra sorted for the binary search. */
+    UINTN i = map_extra_count++;
+    while (i > 0 && map_extra[i - 1].cp > cp) {
+        map_extra[i] = map_extra[i - 1];
+        i--;
+    }
+    map_extra[i].cp    = (UINT16)cp;
+    map_extra[i].glyph = glyph;
+}
+
+static BOOLEAN
+font_load(const UINT8 *psf, UINTN size)
+{
+    const Psf2Header *h = (const Psf2Header *)psf;
+
+    if (size < sizeof(*h) || h->magic != PSF2_MAGIC ||
+        !(h->flags & PSF2_HAS_UNICODE_TABLE) ||
+        h->width == 0 || h->width > 32 || h->height == 0 ||
+        h->charsize != h->height * ((h->width + 7) / 8) ||
+        h->header_size + (UINT64)h->length * h->charsize > size)
+        return FALSE;
+
+    glyph_bits   = psf + h->header_size;
+    glyph_count  = h->length;
+    glyph_bytes  = h->charsize;
+    glyph_stride = (h->width + 7) / 8;
+    font_w       = h->width;
+    font_h       = h->height;
+
+    /* Glyph 0 stands in for anything the table does not list. */
+    sb_memset(map_latin1, 0, sizeof(map_latin1));
+    map_extra_count = 0;
+
+    const UINT8 *p   = glyph_bits + (UINTN)glyph_count * glyph_bytes;
+    const UINT8 *end = psf + size;
+    for (UINT32 g = 0; g < glyph_count && p < end; g++) {
+        while (p < end && *p != 0xFF) {
+            UINT32 cp;
+            UINTN n = (*p == 0xFE) ? 1 : utf8_decode(p, end, &cp);
+            if (n == 0)
+                return FALSE;
+            if (*p != 0xFE)         /* 0xFE starts a sequence: skip */
+                map_add(cp, (UINT16)g);
+            p += n;
+        }
+        p++;
+    }
+    return TRUE;
+}
+
+static UINTN
+glyph_index(CHAR16 ch)
+{
+    if (ch < 256)
+        return map_latin1[ch];
+
+    UINTN lo = 0, hi = map_extra_count;
+    while (lo < hi) {
+        UINTN mid = (lo + hi) / 2;
+        if (map_extra[mid].cp == ch)
+            return map_extra[mid].glyph;
+        if (map_extra[mid].cp < ch)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return 0;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Glyph atlas                                                        */
+/* ------------------------------------------------------------------ */
+
+/* Pixels of glyph `g` in colours `attr`, rasterising it if needed. */
+static const EFI_GRAPHICS_OUTPUT_BLT_PIXEL *
+glyph_pixels(UINTN g, UINT8 attr)
+{
+    attr &= 0x7F;
+    UINTN pixels = cell_w * cell_h;
+
+    if (!atlas[attr]) {
+        atlas[attr] = sb_malloc(SB_MEM_TUI,
+                                glyph_count * pixels * sizeof(*fb));
+        atlas_ready[attr] = sb_zalloc(SB_MEM_TUI, (glyph_count + 7) / 8);
+        if (!atlas[attr] || !atlas_ready[attr]) {
+            sb_free(atlas[attr]);
+            sb_free(atlas_ready[attr]);
+            atlas[attr] = NULL;
+            atlas_ready[attr] = NULL;
+            return NULL;
+        }
+    }
+
+    EFI_GRAPHICS_OUTPUT_BLT_PIXEL *dst = atlas[attr] + g * pixels;
+    if (atlas_ready[attr][g / 8] & (1U << (g % 8)))
+        return dst;
+
+    EFI_GRAPHICS_OUTPUT_BLT_PIXEL fg = palette[attr & 0x0F];
+    EFI_GRAPHICS_OUTPUT_BLT_PIXEL bg = palette[(attr >> 4) & 0x07];
+    const UINT8 *bits = glyph_bits + g * glyph_bytes;
+
+    for (UINTN y = 0; y < font_h; y++) {
+        const UINT8 *row = bits + y * glyph_stride;
+        EFI_GRAPHICS_OUTPUT_BLT_PIXEL *line = dst + y * scale * cell_w;
+        for (UINTN x = 0; x < font_w; x++) {
+            BOOLEAN on = (row[x / 8] >> (7 - x % 8)) & 1;
+            for (UINTN s = 0; s < scale; s++)
+                line[x * scale + s] = on ? fg : bg;
+        }
+        /* Vertical scaling: repeat the finished line. */
+        for (UINTN s = 1; s < scale; s++)
+            sb_memcpy(line + s * cell_w, line, cell_w * sizeof(*line));
+    }
+
+    atlas_ready[attr][g / 8] |= (UINT8)(1U << (g % 8));
+    return dst;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Public API (for screen.c)                                          */
+/* ------------------------------------------------------------------ */
+
+/*
+ * Take over the display if GOP is usable.  Returns FALSE (and changes
+ * nothing) if not, in which case the caller stays on ConOut.
+ */
+BOOLEAN
+tui_gop_init(SuperBootContext *ctx, UINTN *cols, UINTN *rows)
+{
+    if (gop) {
+        *cols = grid_w / cell_w;
+        *rows = grid_h / cell_h;
+        return TRUE;
+    }
+
+    EFI_GRAPHICS_OUTPUT_PROTOCOL *g;
+    if (EFI_ERROR(ctx->boot_services->LocateProtocol(
+                      &gEfiGraphicsOutputProtocolGuid, NULL, (void **)&g)))
+        return FALSE;
+    if (!g->Mode || !g->Mode->Info)
+        return FALSE;
+    if (!font_load(tui_font_psf, tui_font_psf_size))
+        return FALSE;
+
+    UINTN width  = g->Mode->Info->HorizontalResolution;
+    UINTN height = g->Mode->Info->VerticalResolution;
+
+    UINTN sx = width  / (GOP_MIN_COLS * font_w);
+    UINTN sy = height / (GOP_MIN_ROWS * font_h);
+    scale  = sx < sy ? sx : sy;
+    if (scale == 0)
+        scale = 1;
+    cell_w = font_w * scale;
+    cell_h = font_h * scale;
+
+    UINTN c = width / cell_w, r = height / cell_h;
+    if (c > TUI_MAX_COLS)
+        c = TUI_MAX_COLS;
+    if (c == 0 || r == 0)
+        return FALSE;
+
+    grid_w = c * cell_w;
+    grid_h = r * cell_h;
+    grid_x = (width  - grid_w) / 2;
+    grid_y = (height - grid_h) / 2;
+
+    fb = sb_malloc(SB_MEM_TUI, grid_w * grid_h * sizeof(*fb));
+    if (!fb)
+        return FALSE;
+
+    gop = g;
+    tui_gop_invalidate();
+
+    /* No blinking text cursor over the graphics. */
+    ctx->system_table->ConOut->EnableCursor(ctx->system_table->ConOut,
+                                            FALSE);
+
+    SB_DBG(ctx, L"GOP text: %ux%u pixels, %ux%u cells at scale %u",
+           width, height, c, r, scale);
+    *cols = c;
+    *rows = r;
+    return TRUE;
+}
+
+/* Draw `n` cells at (col, row) into the off-screen buffer. */
+void
+tui_gop_draw(UINTN col, UINTN row, const CHAR16 *chars, const UINT8 *attrs,
+             UINTN n)
+{
+    for (UINTN i = 0; i < n; i++) {
+        const EFI_GRAPHICS_OUTPUT_BLT_PIXEL *src =
+            glyph_pixels(glyph_index(chars[i]), attrs[i]);
+        if (!src)
+            return;
+
+        EFI_GRAPHICS_OUTPUT_BLT_PIXEL *dst =
+            fb + row * cell_h * grid_w + (col + i) * cell_w;
+        for (UINTN y = 0; y < cell_h; y++)
+            sb_memcpy(dst + y * grid_w, src + y * cell_w,
+                    cell_w * sizeof(*dst));
+    }
+
+    if (row < dirty_lo)          dirty_lo = row;
+    if (row + 1 > dirty_hi)      dirty_hi = row + 1;
+    if (col < dirty_col_lo)      dirty_col_lo = col;
+    if (col + n > dirty_col_hi)  dirty_col_hi = col + n;
+}
+
+/* Everything must be sent again (something else drew on the screen). */
+void
+tui_gop_invalidate(void)
+{
+    dirty_lo     = 0;
+    dirty_hi     = grid_h / cell_h;
+    dirty_col_lo = 0;
+    dirty_col_hi = grid_w / cell_w;
+    margins_dirty = TRUE;
+}
+
+/* Paint the border round the grid in the colour of its corner. */
+static void
+fill_margins(void)
+{
+    UINTN width  = gop->Mode->Info->HorizontalResolution;
+    UINTN height = gop->Mode->Info->VerticalResolution;
+
+    if (grid_y)
+        gop->Blt(gop, fb, EfiBltVideoFill, 0, 0, 0, 0, width, grid_y, 0);
+    if (height > grid_y + grid_h)
+        gop->Blt(gop, fb, EfiBltVideoFill, 0, 0, 0, grid_y + grid_h,
+                 width, height - grid_y - grid_h, 0);
+    if (grid_x)
+        gop->Blt(gop, fb, EfiBltVideoFill, 0, 0, 0, grid_y,
+                 grid_x, grid_h, 0);
+    if (width > grid_x + grid_w)
+        gop->Blt(gop, fb, EfiBltVideoFill, 0, 0, grid_x + grid_w, grid_y,
+                 width - grid_x - grid_w, grid_h, 0);
+    margins_dirty = FALSE;
+}
+
+/* Blt the band of rows drawn since the last call. */
+void
+tui_gop_present(void)
+{
+    if (margins_dirty)
+        fill_margins();
+    if (dirty_lo >= dirty_hi)
+        return;
+
+    UINTN x = dirty_col_lo * cell_w, y = dirty_lo * cell_h;
+    gop->Blt(gop, fb, EfiBltBufferToVideo, x, y,
+             grid_x + x, grid_y + y,
+             (dirty_col_hi - dirty_col_lo) * cell_w,
+             (dirty_hi - dirty_lo) * cell_h,
+             grid_w * sizeof(*fb));
+
+    dirty_lo = dirty_col_lo = (UINTN)-1;
+    dirty_hi = dirty_col_hi = 0;
+}
@@ -3,31 +3,54 @@
  *
  * Displays the list of discovered BootTargets.  The user can navigate
  * with arrow keys, press Enter to boot, 'e' to edit the command line,
- * 'f' to open the file browser, or 'd' to deploy SuperBoot.
+ * 'f' to open the file browser, or 'd' to deploy SuperBoot.  '/'
+ * starts a search: the list narrows to the matching entries, best
+ * first, as the user types (filter.c).
  *
  * If a timeout is set and no key is pressed, the default entry boots
  * automatically.
+ *
+ * The menu runs as three scheduler tasks (input, countdown, redraw)
+ * alongside the partition scan, so it appears as soon as SuperBoot
+ * starts and fills in while devices are still being read.  The
+ * countdown starts once the scan has finished.
+ *
+ * With the "control" or "script=" load option a fourth task takes
+ * commands from control.c, so a harness can drive the same menu.
  */
 
 #include "tui.h"
 
+/* Footer hints for keys whose feature may be compiled out. */
+#if SB_FEATURE_EXPLORER
+#define HELP_EXPLORER  L"  [f] File browser"
+#else
+#define HELP_EXPLORER  L""
+#endif
+#if SB_FEATURE_DEPLOY
+#define HELP_DEPLOY    L"  [d] Deploy"
+#else
+#define HELP_DEPLOY    L""
+#endif
+
 /* ------------------------------------------------------------------ */
 /*  TUI helpers                                                        */
 /* ------------------------------------------------------------------ */
 
-UINT16
-tui_read_key(EFI_SYSTEM_TABLE *st)
+static UINT16
+translate_key(const EFI_INPUT_KEY *key)
 {
-    EFI_INPUT_KEY key;
-    UINTN index;
-
-    st->BootServices->WaitForEvent(1, &st->ConIn->WaitForKey, &index);
-    st->ConIn->ReadKeyStroke(st->ConIn, &key);
-
-    if (key.ScanCode != 0) {
-        switch (key.ScanCode) {
+    if (key->ScanCode != 0) {
+        switch (key->ScanCode) {
         case 0x01: return TUI_KEY_UP;
         case 0x02: return TUI_KEY_DOWN;
+        case 0x03: return TUI_KEY_RIGHT;
+        case 0x04: return TUI_KEY_LEFT;
+        case 0x05: return TUI_KEY_HOME;
+        case 0x06: return TUI_KEY_END;
+        case 0x08: return TUI_KEY_DELETE;
+        case 0x09: return TUI_KEY_PGUP;
+        case 0x0A: return TUI_KEY_PGDN;
         case 0x17: return TUI_KEY_ESCAPE;
         case 0x0B: return TUI_KEY_F1;
         case 0x0C: return TUI_KEY_F2;
@@ -36,69 +59,82 @@ tui_read_key(EFI_SYSTEM_TABLE *st)
         default:   return 0;
         }
     }
-    return (UINT16)key.UnicodeChar;
+    return (UINT16)key->UnicodeChar;
 }
 
-void
-tui_clear(EFI_SYSTEM_TABLE *st, UINTN attr)
+BOOLEAN
+tui_poll_key(EFI_SYSTEM_TABLE *st, UINT16 *code)
 {
-    st->ConOut->SetAttribute(st->ConOut, attr);
-    st->ConOut->ClearScreen(st->ConOut);
+    EFI_INPUT_KEY key;
+
+    if (EFI_ERROR(st->ConIn->ReadKeyStroke(st->ConIn, &key)))
+        return FALSE;
+    *code = translate_key(&key);
+    return TRUE;
 }
 
-void
-tui_print_centre(EFI_SYSTEM_TABLE *st, UINTN row, const CHAR16 *text)
+UINT16
+tui_read_key(EFI_SYSTEM_TABLE *st)
 {
-    UINTN cols, rows;
-    st->ConOut->QueryMode(st->ConOut, st->ConOut->Mode->Mode, &cols, &rows);
+    UINT16 code;
+    UINTN index;
 
-    UINTN len = StrLen(text);
-    UINTN col = (len < cols) ? (cols - len) / 2 : 0;
+    while (!tui_poll_key(st, &code))
+        st->BootServices->WaitForEvent(1, &st->ConIn->WaitForKey, &index);
+    return code;
+}
 
-    st->ConOut->SetCursorPosition(st->ConOut, col, row);
-    st->ConOut->OutputString(st->ConOut, (CHAR16 *)text);
+void
+tui_clear(EFI_SYSTEM_TABLE *st, UINTN attr)
+{
+    st->ConOut->SetAttribute(st->ConOut, attr);
+    st->ConOut->ClearScreen(st->ConOut);
+    tui_screen_invalidate();
 }
 
 /* ------------------------------------------------------------------ */
 /*  Draw the menu                                                      */
 /* ------------------------------------------------------------------ */
 
+/* `filter` is NULL unless a search is open; the list then shows its
+ * matches instead of every target. */
 static void
-draw_menu(SuperBootContext *ctx, UINTN selected, UINTN timeout_remaining)
+draw_menu(SuperBootContext *ctx, const TuiFilter *filter, UINTN selected,
+          UINTN timeout_remaining)
 {
-    EFI_SYSTEM_TABLE *st = ctx->system_table;
-    UINTN cols, rows;
-    st->ConOut->QueryMode(st->ConOut, st->ConOut->Mode->Mode, &cols, &rows);
+    UINTN cols = tui_screen_cols();
+    UINTN rows = tui_screen_rows();
 
-    tui_clear(st, TUI_ATTR_NORMAL);
+    tui_screen_clear(TUI_ATTR_NORMAL);
 
     /* Header. */
-    st->ConOut->SetAttribute(st->ConOut, TUI_ATTR_HEADER);
-    tui_print_centre(st, 0, L"SuperBoot — Universal Meta-Bootloader");
+    tui_screen_put_centre(0, TUI_ATTR_HEADER,
+                          L"SuperBoot — Universal Meta-Bootloader");
 
     CHAR16 sub[80];
-    SPrint(sub, sizeof(sub), L"%u entries found", ctx->targets.count);
-    tui_print_centre(st, 1, sub);
+    SPrint(sub, sizeof(sub),
+           ctx->scan_done ? L"%u entries found"
+                          : L"Scanning... %u entries found",
+           ctx->targets.count);
+    tui_screen_put_centre(1, TUI_ATTR_HEADER, sub);
 
     /* Entry list. */
     UINTN start_row = 3;
     UINTN visible = (rows > start_row + 4) ? rows - start_row - 4 : 1;
 
+    UINTN count = filter ? filter->count : ctx->targets.count;
+    UINTN pos   = filter ? tui_filter_find(filter, selected) : selected;
+
     /* Scroll window. */
     UINTN scroll_off = 0;
-    if (selected >= visible)
-        scroll_off = selected - visible + 1;
+    if (pos != (UINTN)-1 && pos >= visible)
+        scroll_off = pos - visible + 1;
 
-    for (UINTN i = 0; i < visible && (scroll_off + i) < ctx->targets.count; i++) {
-        UINTN idx = scroll_off + i;
+    for (UINTN i = 0; i < visible && (scroll_off + i) < count; i++) {
+        UINTN idx = filter ? filter->matches[scroll_off + i].target
+                           : scroll_off + i;
         const BootTarget *t = &ctx->targets.entries[idx];
-
-        if (idx == selected)
-            st->ConOut->SetAttribute(st->ConOut, TUI_ATTR_HILITE);
-        else
-            st->ConOut->SetAttribute(st->ConOut, TUI_ATTR_NORMAL);
-
-        st->ConOut->SetCursorPosition(st->ConOut, 2, start_row + i);
+        UINTN attr = (idx == selected) ? TUI_ATTR_HILITE : TUI_ATTR_NORMAL;
 
         /* Source tag. */
         const CHAR16 *tag;
@@ -112,30 +148,37 @@ draw_menu(SuperBootContext *ctx, UINTN selected, UINTN timeout_remaining)
         CHAR16 line[256];
         SPrint(line, sizeof(line), L" %s %s", tag, t->title);
 
-        /* Pad to fill the row. */
-        UINTN llen = StrLen(line);
-        while (llen + 3 < cols && llen + 1 < 256) {
-            line[llen++] = L' ';
-        }
-        line[llen] = L'\0';
-
-        st->ConOut->OutputString(st->ConOut, line);
+        /* The bar spans the row, less the margins. */
+        if (cols > 3)
+            tui_screen_fill(2, start_row + i, attr, cols - 3);
+        tui_screen_put(2, start_row + i, attr, line);
     }
 
+    if (filter && count == 0)
+        tui_screen_put(4, start_row, TUI_ATTR_NORMAL, L"(no matches)");
+
     /* Footer / help. */
-    st->ConOut->SetAttribute(st->ConOut, TUI_ATTR_HEADER);
-    st->ConOut->SetCursorPosition(st->ConOut, 0, rows - 2);
-    st->ConOut->OutputString(
-        st->ConOut,
-        L" [Enter] Boot  [e] Edit cmdline  [f] File browser  [d] Deploy  [Esc] Reboot");
+    if (filter) {
+        CHAR16 qbuf[TUI_FILTER_MAX + 48];
+        tui_screen_put(0, rows - 2, TUI_ATTR_HEADER,
+            L" [Enter] Boot  [Up/Down] Select  [Esc] Close search");
+        SPrint(qbuf, sizeof(qbuf), L" /%s_   %u of %u", filter->query,
+               filter->count, ctx->targets.count);
+        tui_screen_put(0, rows - 1, TUI_ATTR_HEADER, qbuf);
+    } else {
+        tui_screen_put(0, rows - 2, TUI_ATTR_HEADER,
+            L" [Enter] Boot  [e] Edit cmdline" HELP_EXPLORER HELP_DEPLOY
+            L"  [/] Search  [Esc] Reboot");
+    }
 
-    if (timeout_remaining > 0) {
+    if (!filter && timeout_remaining > 0) {
         CHAR16 tbuf[64];
         SPrint(tbuf, sizeof(tbuf),
                L" Auto-boot in %u seconds...", timeout_remaining);
-        st->ConOut->SetCursorPosition(st->ConOut, 0, rows - 1);
-        st->ConOut->OutputString(st->ConOut, tbuf);
+        tui_screen_put(0, rows - 1, TUI_ATTR_HEADER, tbuf);
     }
+
+    tui_screen_flush();
 }
 
 /* ------------------------------------------------------------------ */
@@ -145,135 +188,381 @@ draw_menu(SuperBootContext *ctx, UINTN selected, UINTN timeout_remaining)
 static void
 edit_cmdline(SuperBootContext *ctx, BootTarget *target)
 {
-    EFI_SYSTEM_TABLE *st = ctx->system_table;
+    CHAR8 buf[SB_MAX_CMDLINE];
 
-    tui_clear(st, TUI_ATTR_NORMAL);
-    st->ConOut->SetCursorPosition(st->ConOut, 0, 0);
-    Print(L"Edit kernel command line for: %s\n\n", target->title);
-    Print(L"Current: %a\n\n", target->cmdline);
-    Print(L"Enter new command line (empty = keep current):\n> ");
+    sb_strcpy8(buf, target->cmdline ? target->cmdline : (const CHAR8 *)"",
+               sizeof(buf));
+    if (!tui_edit_line(ctx, target->title, buf, sizeof(buf)))
+        return;     /* cancelled */
 
-    /* Simple line input. */
-    CHAR8  buf[SB_MAX_CMDLINE];
-    UINTN  pos = 0;
+    const CHAR8 *s = sb_intern8(&ctx->targets.strings, buf);
+    if (s)
+        target->cmdline = s;
+}
 
-    for (;;) {
-        UINT16 key = tui_read_key(st);
+/* ------------------------------------------------------------------ */
+/*  Menu tasks                                                         */
+/* ------------------------------------------------------------------ */
 
-        if (key == TUI_KEY_ESCAPE)
-            return; /* Cancel. */
+/* How often the redraw and countdown tasks look at scan progress. */
+#define MENU_SCAN_POLL_US   100000
+
+/* How often the control task looks for a command. */
+#define MENU_CONTROL_POLL_US  10000
+
+typedef struct {
+    SuperBootContext *ctx;
+    UINTN       selected;
+    BOOLEAN     user_moved;     /* stop tracking the default entry  */
+    BOOLEAN     searching;
+    TuiFilter   filter;
+    UINTN       timeout;        /* seconds left; 0 = no auto-boot   */
+    BOOLEAN     counting;
+    BOOLEAN     done;
+    EFI_STATUS  result;
+
+    /* What the screen currently shows. */
+    BOOLEAN     dirty;
+    BOOLEAN     drawn;          /* at least one frame shown         */
+    UINTN       drawn_count;
+    BOOLEAN     drawn_scan_done;
+
+    SbTask      input;
+    SbTask      countdown;
+    SbTask      redraw;
+    SbTask      control;
+} Menu;
 
-        if (key == TUI_KEY_ENTER || key == '\r' || key == '\n') {
-            buf[pos] = '\0';
-            if (pos > 0)
-                CopyMem(target->cmdline, buf, pos + 1);
-            return;
-        }
+static void
+menu_finish(Menu *m, EFI_STATUS result)
+{
+    if (result == EFI_SUCCESS)
+        m->ctx->selected = m->selected;
+    m->result = result;
+    m->done   = TRUE;
+}
 
-        if (key == 0x08 /* backspace */) {
-            if (pos > 0) {
-                pos--;
-                Print(L"\b \b");
-            }
-            continue;
+static void
+menu_invalidate(Menu *m)
+{
+    m->dirty = TRUE;
+    sb_sched_wake(&m->redraw);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Search mode                                                        */
+/* ------------------------------------------------------------------ */
+
+/* Keep the selection on a match: the best one if it fell out. */
+static void
+search_select_best(Menu *m)
+{
+    if (m->filter.count > 0 &&
+        tui_filter_find(&m->filter, m->selected) == (UINTN)-1)
+        m->selected = m->filter.matches[0].target;
+}
+
+static void
+search_close(Menu *m)
+{
+    tui_filter_free(&m->filter);
+    m->searching = FALSE;
+}
+
+/* Keys while the search is open. */
+static SbTaskStatus
+search_key(Menu *m, UINT16 key)
+{
+    SuperBootContext *ctx = m->ctx;
+    TuiFilter *f = &m->filter;
+    UINTN pos = tui_filter_find(f, m->selected);
+
+    switch (key) {
+    case TUI_KEY_UP:
+        if (pos != (UINTN)-1 && pos > 0)
+            m->selected = f->matches[pos - 1].target;
+        break;
+
+    case TUI_KEY_DOWN:
+        if (pos != (UINTN)-1 && pos + 1 < f->count)
+            m->selected = f->matches[pos + 1].target;
+        break;
+
+    case TUI_KEY_ENTER:
+        if (pos != (UINTN)-1) {
+            search_close(m);
+            menu_finish(m, EFI_SUCCESS);
+            return SB_TASK_DONE;
         }
+        break;
+
+    case TUI_KEY_ESCAPE:
+        /* Back to the full list, still on the entry selected. */
+        search_close(m);
+        break;
 
-        if (key >= 0x20 && key < 0x7F && pos + 1 < SB_MAX_CMDLINE) {
-            buf[pos++] = (CHAR8)key;
-            CHAR16 ch[2] = { (CHAR16)key, 0 };
-            st->ConOut->OutputString(st->ConOut, ch);
+    case 0x08:  /* backspace */
+        if (f->len == 0) {
+            search_close(m);
+            break;
+        }
+        tui_filter_pop(f, &ctx->targets);
+        search_select_best(m);
+        break;
+
+    default:
+        if (key >= 0x20 && key < 0x7F) {
+            tui_filter_push(f, &ctx->targets, key);
+            search_select_best(m);
         }
+        break;
     }
+
+    menu_invalidate(m);
+    return SB_TASK_BLOCK;
 }
 
 /* ------------------------------------------------------------------ */
-/*  Main menu loop                                                     */
+/*  Task steps                                                         */
 /* ------------------------------------------------------------------ */
 
-EFI_STATUS
-sb_tui_run_menu(SuperBootContext *ctx)
+static SbTaskStatus
+redraw_step(SbTask *t)
 {
-    if (ctx->targets.count == 0)
-        return EFI_NOT_FOUND;
-
-    /* Find the default entry. */
-    UINTN selected = 0;
-    for (UINTN i = 0; i < ctx->targets.count; i++) {
-        if (ctx->targets.entries[i].is_default) {
-            selected = i;
-            break;
+    Menu *m = t->data;
+    SuperBootContext *ctx = m->ctx;
+
+    /* Until the user moves, follow the default entry as it appears. */
+    if (!m->user_moved) {
+        for (UINTN i = 0; i < ctx->targets.count; i++) {
+            if (ctx->targets.entries[i].is_default) {
+                m->selected = i;
+                break;
+            }
         }
     }
 
-    UINTN timeout = ctx->timeout_sec;
-
-    for (;;) {
-        draw_menu(ctx, selected, timeout);
-
-        /* Wait for key with 1-second timeout for countdown. */
-        if (timeout > 0) {
-            EFI_EVENT timer;
-            ctx->boot_services->CreateEvent(
-                EVT_TIMER, 0, NULL, NULL, &timer);
-            ctx->boot_services->SetTimer(
-                timer, TimerRelative, 10000000); /* 1 second */
-
-            EFI_EVENT events[2] = {
-                ctx->system_table->ConIn->WaitForKey,
-                timer
-            };
-            UINTN index;
-            ctx->boot_services->WaitForEvent(2, events, &index);
-            ctx->boot_services->CloseEvent(timer);
-
-            if (index == 1) {
-                /* Timer fired, no key pressed. */
-                timeout--;
-                if (timeout == 0) {
-                    ctx->selected = selected;
-                    return EFI_SUCCESS;
-                }
-                continue;
-            }
-            /* Key was pressed — cancel timeout. */
-            timeout = 0;
+    if (m->searching && m->drawn_count != ctx->targets.count) {
+        tui_filter_update(&m->filter, &ctx->targets);
+        search_select_best(m);
+    }
+
+    if (m->dirty || m->drawn_count != ctx->targets.count ||
+        m->drawn_scan_done != ctx->scan_done) {
+        draw_menu(ctx, m->searching ? &m->filter : NULL, m->selected,
+                  m->counting ? m->timeout : 0);
+        m->dirty           = FALSE;
+        m->drawn_count     = ctx->targets.count;
+        m->drawn_scan_done = ctx->scan_done;
+        if (!m->drawn) {
+            m->drawn = TRUE;
+            sb_control_mark(L"menu");
         }
+    }
 
-        UINT16 key = tui_read_key(ctx->system_table);
+    /* Poll for new entries while the scan runs; afterwards only other
+     * tasks wake us. */
+    if (!ctx->scan_done)
+        t->wake_us = sb_time_us() + MENU_SCAN_POLL_US;
+    return SB_TASK_BLOCK;
+}
 
-        switch (key) {
-        case TUI_KEY_UP:
-            if (selected > 0) selected--;
-            break;
+static SbTaskStatus
+countdown_step(SbTask *t)
+{
+    Menu *m = t->data;
+    SuperBootContext *ctx = m->ctx;
 
-        case TUI_KEY_DOWN:
-            if (selected + 1 < ctx->targets.count) selected++;
-            break;
+    if (!ctx->scan_done) {
+        t->wake_us = sb_time_us() + MENU_SCAN_POLL_US;
+        return SB_TASK_BLOCK;
+    }
 
-        case TUI_KEY_ENTER:
-            ctx->selected = selected;
-            return EFI_SUCCESS;
+    if (ctx->targets.count == 0) {
+        menu_finish(m, EFI_NOT_FOUND);
+        return SB_TASK_DONE;
+    }
 
-        case 'e':
-        case 'E':
-            edit_cmdline(ctx, &ctx->targets.entries[selected]);
-            break;
+    if (m->timeout == 0)
+        return SB_TASK_DONE;        /* cancelled, or no timeout set */
 
-        case 'f':
-        case 'F':
-            sb_tui_file_browser(ctx);
-            break;
+    if (!m->counting) {
+        m->counting = TRUE;         /* scan finished: start counting */
+    } else if (--m->timeout == 0) {
+        menu_finish(m, EFI_SUCCESS);
+        return SB_TASK_DONE;
+    }
 
-        case 'd':
-        case 'D':
-            sb_deploy_to_esp(ctx);
-            break;
+    menu_invalidate(m);
+    t->wake_us = sb_time_us() + 1000000;
+    return SB_TASK_BLOCK;
+}
 
-        case TUI_KEY_ESCAPE:
-            /* Reboot. */
-            ctx->runtime_services->ResetSystem(
-                EfiResetCold, EFI_SUCCESS, 0, NULL);
-            break;
+static SbTaskStatus
+input_step(SbTask *t)
+{
+    Menu *m = t->data;
+    SuperBootContext *ctx = m->ctx;
+    UINT16 key;
+
+    t->wait = ctx->system_table->ConIn->WaitForKey;
+    if (!tui_poll_key(ctx->system_table, &key))
+        return SB_TASK_BLOCK;
+
+    /* Any key cancels the countdown. */
+    m->timeout  = 0;
+    m->counting = FALSE;
+
+    if (m->searching)
+        return search_key(m, key);
+
+    switch (key) {
+    case TUI_KEY_UP:
+        if (m->selected > 0) m->selected--;
+        m->user_moved = TRUE;
+        break;
+
+    case TUI_KEY_DOWN:
+        if (m->selected + 1 < ctx->targets.count) m->selected++;
+        m->user_moved = TRUE;
+        break;
+
+    case TUI_KEY_ENTER:
+        if (ctx->targets.count > 0) {
+            menu_finish(m, EFI_SUCCESS);
+            return SB_TASK_DONE;
         }
+        break;
+
+    /* The modal screens below block in tui_read_key(); background
+     * tasks pause until they return. */
+    case 'e':
+    case 'E':
+        if (ctx->targets.count > 0)
+            edit_cmdline(ctx, &ctx->targets.entries[m->selected]);
+        break;
+
+#if SB_FEATURE_EXPLORER
+    case 'f':
+    case 'F':
+        sb_tui_file_browser(ctx);
+        tui_screen_invalidate();
+        break;
+#endif
+
+#if SB_FEATURE_DEPLOY
+    case 'd':
+    case 'D':
+        sb_deploy_to_esp(ctx);
+        tui_screen_invalidate();
+        break;
+#endif
+
+    case '/':
+        tui_filter_init(&m->filter);
+        tui_filter_update(&m->filter, &ctx->targets);
+        m->searching  = TRUE;
+        m->user_moved = TRUE;
+        break;
+
+    case TUI_KEY_ESCAPE:
+        /* Reboot. */
+        ctx->runtime_services->ResetSystem(
+            EfiResetCold, EFI_SUCCESS, 0, NULL);
+        break;
+    }
+
+    menu_invalidate(m);
+    return SB_TASK_BLOCK;
+}
+
+static SbTaskStatus
+control_step(SbTask *t)
+{
+    Menu *m = t->data;
+    SuperBootContext *ctx = m->ctx;
+
+    ctx->selected = m->selected;
+    SbControlAction act = sb_control_poll(ctx);
+    if (act == SB_CONTROL_IDLE) {
+        t->wake_us = sb_time_us() + MENU_CONTROL_POLL_US;
+        return SB_TASK_BLOCK;
+    }
+
+    /* A command counts as a key press. */
+    m->timeout    = 0;
+    m->counting   = FALSE;
+    m->user_moved = TRUE;
+    m->selected   = ctx->selected;
+    if (m->searching)
+        search_close(m);
+
+    if (act == SB_CONTROL_BOOT) {
+        menu_finish(m, EFI_SUCCESS);
+        return SB_TASK_DONE;
     }
+
+    menu_invalidate(m);
+    return SB_TASK_YIELD;       /* the next command may be waiting */
+}
+
+/* ------------------------------------------------------------------ */
+/*  Main menu loop                                                     */
+/* ------------------------------------------------------------------ */
+
+/*
+ * Run the menu (and, meanwhile, any background tasks such as the
+ * scan).  Returns EFI_SUCCESS with ctx->selected set, or EFI_NOT_FOUND
+ * if the scan finished without finding anything bootable.
+ */
+EFI_STATUS
+sb_tui_run_menu(SuperBootContext *ctx)
+{
+    Menu m;
+    SetMem(&m, sizeof(m), 0);
+    m.ctx     = ctx;
+    m.timeout = ctx->timeout_sec;
+    m.dirty   = TRUE;
+
+    tui_screen_init(ctx);
+    tui_screen_invalidate();
+
+    m.input.name      = L"menu-input";
+    m.input.prio      = SB_PRIO_INPUT;
+    m.input.step      = input_step;
+    m.input.data      = &m;
+
+    m.countdown.name  = L"menu-countdown";
+    m.countdown.prio  = SB_PRIO_UI;
+    m.countdown.step  = countdown_step;
+    m.countdown.data  = &m;
+
+    m.redraw.name     = L"menu-redraw";
+    m.redraw.prio     = SB_PRIO_UI;
+    m.redraw.step     = redraw_step;
+    m.redraw.data     = &m;
+
+    m.control.name    = L"menu-control";
+    m.control.prio    = SB_PRIO_INPUT;
+    m.control.step    = control_step;
+    m.control.data    = &m;
+
+    sb_sched_add(&m.redraw);
+    sb_sched_add(&m.countdown);
+    sb_sched_add(&m.input);
+    if (sb_control_active())
+        sb_sched_add(&m.control);
+
+    ctx->tui_active = TRUE;
+    sb_sched_run(&m.done);
+    ctx->tui_active = FALSE;
+
+    /* The tasks live on this stack frame. */
+    sb_sched_cancel(&m.control);
+    sb_sched_cancel(&m.input);
+    sb_sched_cancel(&m.countdown);
+    sb_sched_cancel(&m.redraw);
+    tui_filter_free(&m.filter);
+
+    return m.done ? m.result : EFI_ABORTED;
 }
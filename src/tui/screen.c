@@ -0,0 +1,250 @@
+/*
+ * screen.c — Shadow screen for flicker-free redraws
+ *
+ * Screens are drawn into a back buffer of (character, attribute)
+ * cells, and tui_screen_flush() sends the console only the cells that
+ * differ from what it already shows.  Moving the selection repaints
+ * two rows; a countdown tick repaints a few characters.  That matters
+ * on serial consoles, where every ClearScreen is a flood of escape
+ * codes, and on firmware whose text renderer redraws glyphs slowly.
+ *
+ * The console geometry is queried once, in tui_screen_init().  Anyone
+ * who writes to ConOut directly (Print, the modal screens) must call
+ * tui_screen_invalidate() afterwards: the next flush then clears the
+ * console once and repaints the whole frame.
+ *
+ * Where GOP is available the changed cells are rendered by gop.c
+ * instead of ConOut, and ConOut is never written by the flush.
+ */
+
+#include "tui.h"
+
+/* Unchanged cells bridged inside a run rather than moving the cursor
+ * past them: a SetCursorPosition costs more than a few characters. */
+#define TUI_RUN_BRIDGE  4
+
+typedef struct {
+    CHAR16 ch;
+    UINT8  attr;
+} TuiCell;
+
+static SIMPLE_TEXT_OUTPUT_INTERFACE *out;
+static UINTN    cols, rows;
+static TuiCell *front;          /* what the console shows          */
+static TuiCell *back;           /* the frame being drawn           */
+static BOOLEAN  front_valid;
+static UINTN    clear_attr;     /* attribute of the last clear     */
+static BOOLEAN  use_gop;        /* cells are rendered by gop.c     */
+
+/* Console state as we left it, to skip redundant calls. */
+static UINTN    cur_attr = (UINTN)-1;
+static UINTN    cur_col  = (UINTN)-1;
+static UINTN    cur_row  = (UINTN)-1;
+
+void
+tui_screen_init(SuperBootContext *ctx)
+{
+    if (back)
+        return;
+
+    out = ctx->system_table->ConOut;
+    use_gop = !ctx->textmode && tui_gop_init(ctx, &cols, &rows);
+    if (!use_gop &&
+        (EFI_ERROR(out->QueryMode(out, out->Mode->Mode, &cols, &rows)) ||
+         cols == 0 || rows == 0)) {
+        cols = 80;
+        rows = 25;
+    }
+    if (cols > TUI_MAX_COLS)
+        cols = TUI_MAX_COLS;
+
+    front = sb_malloc(SB_MEM_TUI, cols * rows * sizeof(TuiCell));
+    back  = sb_malloc(SB_MEM_TUI, cols * rows * sizeof(TuiCell));
+    if (!front || !back) {
+        sb_free(front);
+        sb_free(back);
+        front = back = NULL;
+        return;
+    }
+    front_valid = FALSE;
+    tui_screen_clear(TUI_ATTR_NORMAL);
+
+    /* The GOP buffer starts out undefined: make every cell differ so
+     * the first flush renders all of them. */
+    for (UINTN i = 0; use_gop && i < cols * rows; i++) {
+        front[i].ch   = L'\0';
+        front[i].attr = 0xFF;
+    }
+}
+
+UINTN
+tui_screen_cols(void)
+{
+    return cols;
+}
+
+UINTN
+tui_screen_rows(void)
+{
+    return rows;
+}
+
+void
+tui_screen_invalidate(void)
+{
+    front_valid = FALSE;
+    cur_attr = cur_col = cur_row = (UINTN)-1;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Drawing into the back buffer                                       */
+/* ------------------------------------------------------------------ */
+
+void
+tui_screen_clear(UINTN attr)
+{
+    if (!back)
+        return;
+    clear_attr = attr;
+    for (UINTN i = 0; i < cols * rows; i++) {
+        back[i].ch   = L' ';
+        back[i].attr = (UINT8)attr;
+    }
+}
+
+/* Write `text` at (col, row), clipped to the row. */
+void
+tui_screen_put(UINTN col, UINTN row, UINTN attr, const CHAR16 *text)
+{
+    if (!back || row >= rows)
+        return;
+    TuiCell *c = back + row * cols;
+    for (; *text && col < cols; text++, col++) {
+        c[col].ch   = *text;
+        c[col].attr = (UINT8)attr;
+    }
+}
+
+/* Set the attribute of `width` cells from (col, row), e.g. to extend
+ * a highlight bar past the end of its text. */
+void
+tui_screen_fill(UINTN col, UINTN row, UINTN attr, UINTN width)
+{
+    if (!back || row >= rows)
+        return;
+    TuiCell *c = back + row * cols;
+    for (UINTN end = col + width; col < end && col < cols; col++) {
+        c[col].ch   = L' ';
+        c[col].attr = (UINT8)attr;
+    }
+}
+
+void
+tui_screen_put_centre(UINTN row, UINTN attr, const CHAR16 *text)
+{
+    UINTN len = StrLen(text);
+    tui_screen_put(len < cols ? (cols - len) / 2 : 0, row, attr, text);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Flush                                                              */
+/* ------------------------------------------------------------------ */
+
+static BOOLEAN
+cell_differs(UINTN i)
+{
+    return front[i].ch != back[i].ch || front[i].attr != back[i].attr;
+}
+
+/* Send cells [from, to) of `row`, all with one attribute. */
+static void
+emit_run(UINTN row, UINTN from, UINTN to)
+{
+    CHAR16 buf[TUI_MAX_COLS + 1];
+    TuiCell *c = back + row * cols;
+    UINTN n = 0;
+
+    if (use_gop) {
+        UINT8 attrs[TUI_MAX_COLS];
+        for (UINTN i = from; i < to; i++) {
+            buf[n]     = c[i].ch;
+            attrs[n++] = c[i].attr;
+        }
+        tui_gop_draw(from, row, buf, attrs, n);
+        return;
+    }
+
+    for (UINTN i = from; i < to; i++)
+        buf[n++] = c[i].ch;
+    buf[n] = L'\0';
+
+    if (cur_row != row || cur_col != from)
+        out->SetCursorPosition(out, from, row);
+    if (cur_attr != c[from].attr) {
+        out->SetAttribute(out, c[from].attr);
+        cur_attr = c[from].attr;
+    }
+    out->OutputString(out, buf);
+    cur_row = row;
+    cur_col = to;
+}
+
+void
+tui_screen_flush(void)
+{
+    if (!back)
+        return;
+
+    if (!front_valid && use_gop) {
+        /* The off-screen buffer still holds the last frame: diff
+         * against that, then send all of it over whatever was drawn
+         * on the display meanwhile. */
+        tui_gop_invalidate();
+        front_valid = TRUE;
+    } else if (!front_valid) {
+        /* Unknown console contents: one clear, then a full diff
+         * against the blank screen it leaves. */
+        out->SetAttribute(out, clear_attr);
+        out->ClearScreen(out);
+        cur_attr = clear_attr;
+        cur_col  = cur_row = (UINTN)-1;
+        for (UINTN i = 0; i < cols * rows; i++) {
+            front[i].ch   = L' ';
+            front[i].attr = (UINT8)clear_attr;
+        }
+        front_valid = TRUE;
+    }
+
+    for (UINTN row = 0; row < rows; row++) {
+        UINTN base = row * cols;
+        /* Writing the bottom-right cell scrolls some consoles. */
+        UINTN width = row + 1 == rows && !use_gop ? cols - 1 : cols;
+        UINTN col = 0;
+
+        while (col < width) {
+            if (!cell_differs(base + col)) {
+                col++;
+                continue;
+            }
+
+            /* Extend the run over same-attribute cells while changes
+             * keep coming within TUI_RUN_BRIDGE cells. */
+            UINT8 attr = back[base + col].attr;
+            UINTN end  = col + 1;
+            UINTN scan = end;
+            while (scan < width && back[base + scan].attr == attr &&
+                   scan - end < TUI_RUN_BRIDGE) {
+                if (cell_differs(base + scan))
+                    end = scan + 1;
+                scan++;
+            }
+
+            emit_run(row, col, end);
+            col = end;
+        }
+    }
+
+    sb_memcpy(front, back, cols * rows * sizeof(TuiCell));
+    if (use_gop)
+        tui_gop_present();
+}
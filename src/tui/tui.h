@@ -1,19 +1,27 @@
 /*
  * tui.h — Text User Interface
  *
- * Uses UEFI Simple Text Output Protocol (and optionally Graphics
- * Output Protocol for box-drawing) to render the boot menu and
- * file browser.
+ * Renders the boot menu and file browser through a shadow screen of
+ * text cells, drawn with the Graphics Output Protocol where present
+ * and with Simple Text Output otherwise.
  */
 
 #ifndef SUPERBOOT_TUI_H
 #define SUPERBOOT_TUI_H
 
 #include "../superboot.h"
+#include "sb_features.h"
 
 /* Key codes beyond simple ASCII. */
 #define TUI_KEY_UP      0x0001
 #define TUI_KEY_DOWN    0x0002
+#define TUI_KEY_RIGHT   0x0003
+#define TUI_KEY_LEFT    0x0004
+#define TUI_KEY_HOME    0x0005
+#define TUI_KEY_END     0x0006
+#define TUI_KEY_DELETE  0x007F
+#define TUI_KEY_PGUP    0x0019
+#define TUI_KEY_PGDN    0x001A
 #define TUI_KEY_ENTER   0x000D
 #define TUI_KEY_ESCAPE  0x0017
 #define TUI_KEY_TAB     0x0009
@@ -36,10 +44,91 @@
 /* Read a single keystroke, translating scan codes. */
 UINT16 tui_read_key(EFI_SYSTEM_TABLE *st);
 
-/* Clear screen and set attribute. */
+/* Non-blocking variant: FALSE if no key is waiting. */
+BOOLEAN tui_poll_key(EFI_SYSTEM_TABLE *st, UINT16 *code);
+
+/* Clear screen and set attribute (for screens that draw with Print). */
 void tui_clear(EFI_SYSTEM_TABLE *st, UINTN attr);
 
-/* Print a centred string on a given row. */
-void tui_print_centre(EFI_SYSTEM_TABLE *st, UINTN row, const CHAR16 *text);
+/* ------------------------------------------------------------------ */
+/*  Shadow screen (screen.c)                                           */
+/*                                                                     */
+/*  Draw a frame with tui_screen_clear() and tui_screen_put*(), then   */
+/*  tui_screen_flush() sends only the cells that changed.              */
+/* ------------------------------------------------------------------ */
+
+#define TUI_MAX_COLS    256
+
+void  tui_screen_init(SuperBootContext *ctx);
+UINTN tui_screen_cols(void);
+UINTN tui_screen_rows(void);
+void  tui_screen_clear(UINTN attr);
+void  tui_screen_put(UINTN col, UINTN row, UINTN attr, const CHAR16 *text);
+void  tui_screen_put_centre(UINTN row, UINTN attr, const CHAR16 *text);
+void  tui_screen_fill(UINTN col, UINTN row, UINTN attr, UINTN width);
+void  tui_screen_flush(void);
+
+/* The console was written behind the shadow screen's back. */
+void  tui_screen_invalidate(void);
+
+/* ------------------------------------------------------------------ */
+/*  Line editor (editor.c)                                             */
+/* ------------------------------------------------------------------ */
+
+BOOLEAN tui_edit_line(SuperBootContext *ctx, const CHAR16 *title,
+                      CHAR8 *line, UINTN max);
+
+/* ------------------------------------------------------------------ */
+/*  Type-to-filter search (filter.c)                                   */
+/* ------------------------------------------------------------------ */
+
+#define TUI_FILTER_MAX  64
+
+typedef struct {
+    UINT32  target;             /* index into targets.entries       */
+    UINT32  score;
+} TuiMatch;
+
+typedef struct {
+    CHAR16    query[TUI_FILTER_MAX + 1];    /* folded to lower case */
+    UINTN     len;
+    TuiMatch *matches;          /* best first                       */
+    UINTN     count;
+    UINTN     capacity;
+    UINTN     scanned;          /* targets tested so far            */
+} TuiFilter;
+
+void  tui_filter_init(TuiFilter *f);
+void  tui_filter_free(TuiFilter *f);
+void  tui_filter_update(TuiFilter *f, const BootTargetList *list);
+void  tui_filter_push(TuiFilter *f, const BootTargetList *list, CHAR16 ch);
+void  tui_filter_pop(TuiFilter *f, const BootTargetList *list);
+UINTN tui_filter_find(const TuiFilter *f, UINTN target);
+
+/* ------------------------------------------------------------------ */
+/*  GOP text renderer (gop.c, font.c) — used by screen.c only          */
+/* ------------------------------------------------------------------ */
+
+#if SB_FEATURE_GOP
+extern const UINT8 tui_font_psf[];
+extern const UINTN tui_font_psf_size;
+
+BOOLEAN tui_gop_init(SuperBootContext *ctx, UINTN *cols, UINTN *rows);
+void    tui_gop_draw(UINTN col, UINTN row, const CHAR16 *chars,
+                     const UINT8 *attrs, UINTN n);
+void    tui_gop_invalidate(void);
+void    tui_gop_present(void);
+#else
+/* Built without "gop": the screen always stays in text mode. */
+static inline BOOLEAN
+tui_gop_init(SuperBootContext *ctx, UINTN *cols, UINTN *rows)
+{
+    return FALSE;
+}
+static inline void tui_gop_draw(UINTN col, UINTN row, const CHAR16 *chars,
+                                const UINT8 *attrs, UINTN n) {}
+static inline void tui_gop_invalidate(void) {}
+static inline void tui_gop_present(void) {}
+#endif
 
 #endif /* SUPERBOOT_TUI_H */
@@ -0,0 +1,396 @@
+/*
+ * bench.c — Built-in CPU benchmark ("bench" load option)
+ *
+ * Measures the CPU-bound kernels SuperBoot runs during a boot, first
+ * on the BSP alone and then spread over the worker pool, and prints
+ * throughput and speedup.  Run it on an SMP QEMU guest (-smp N) or on
+ * real hardware to see what the APs buy us.
+ *
+ * Each job works on its own 1 MiB slice of a shared buffer, as the
+ * loader would when hashing several initrds at once.  Two kernels are
+ * timed: SHA-256 over the whole buffer, and gunzip of 16 MiB.  There
+ * is no compressor in the tree, so the gzip input is synthesised: a
+ * fixed-Huffman deflate stream of random literals and back-references,
+ * written alongside the output it must decode to.
+ *
+ * Bulk copy and fill (sb_memcpy/sb_memset against gnu-efi's
+ * CopyMem/SetMem) are measured first, on the BSP, over the two halves
+ * of the same buffer.
+ */
+
+#include "util.h"
+#include "../boot/decompress.h"
+
+#define BENCH_BYTES   (64 * 1024 * 1024)
+#define BENCH_SLICE   (1024 * 1024)
+#define BENCH_JOBS    (BENCH_BYTES / BENCH_SLICE)
+
+/* gunzip: expected output in the first quarter of the buffer, decoded
+ * output in the third.  Fixed-Huffman symbols never exceed 9 bits per
+ * output byte, which bounds the compressed size. */
+#define GZ_JOBS       16
+#define GZ_EXPECT     0
+#define GZ_OUTPUT     (BENCH_BYTES / 2)
+#define GZ_MAX        (BENCH_SLICE + BENCH_SLICE / 8 + 64)
+
+typedef struct {
+    const UINT8 *data;
+    UINTN        len;
+    UINT8        digest[SB_SHA256_SIZE];
+} HashJob;
+
+static void
+hash_job(void *arg)
+{
+    HashJob *j = arg;
+    SbSha256 h;
+    sb_sha256_init(&h);
+    sb_sha256_update(&h, j->data, j->len);
+    sb_sha256_final(&h, j->digest);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Synthetic gzip input                                               */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    UINT8  *p;
+    UINT64  acc;
+    UINT32  n;
+} BitOut;
+
+static void
+put_bits(BitOut *o, UINT32 v, UINT32 n)
+{
+    o->acc |= (UINT64)v << o->n;
+    for (o->n += n; o->n >= 8; o->n -= 8) {
+        *o->p++ = (UINT8)o->acc;
+        o->acc >>= 8;
+    }
+}
+
+/* Huffman codes go out most significant bit first. */
+static void
+put_code(BitOut *o, UINT32 code, UINT32 n)
+{
+    UINT32 r = 0;
+    for (UINT32 i = 0; i < n; i++)
+        r |= ((code >> i) & 1) << (n - 1 - i);
+    put_bits(o, r, n);
+}
+
+/* Literal/length symbol in the fixed code (RFC 1951, 3.2.6). */
+static void
+put_symbol(BitOut *o, UINT32 sym)
+{
+    if (sym < 144)
+        put_code(o, 0x30 + sym, 8);
+    else if (sym < 256)
+        put_code(o, 0x190 + sym - 144, 9);
+    else if (sym < 280)
+        put_code(o, sym - 256, 7);
+    else
+        put_code(o, 0xC0 + sym - 280, 8);
+}
+
+static const UINT16 len_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const UINT8 len_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const UINT16 dist_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+    8193, 12289, 16385, 24577
+};
+static const UINT8 dist_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+static UINT32
+xorshift(UINT32 *x)
+{
+    *x ^= *x << 13; *x ^= *x >> 17; *x ^= *x << 5;
+    return *x;
+}
+
+/*
+ * Write a one-member gzip stream decoding to `len` bytes, which are
+ * also stored at `out`.  Half the symbols are letters, the rest
+ * 3..32-byte copies from up to 32 KiB back: about 4.4:1, near what a
+ * kernel compresses to.  Returns the stream length.
+ */
+static UINTN
+make_gzip(UINT8 *gz, UINT8 *out, UINTN len, UINT32 seed)
+{
+    static const UINT8 header[10] = { 0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 3 };
+    BitOut o = { gz + sizeof(header), 0, 0 };
+    UINTN pos = 0;
+
+    sb_memcpy(gz, header, sizeof(header));
+    put_bits(&o, 1, 1);                     /* BFINAL */
+    put_bits(&o, 1, 2);                     /* fixed Huffman */
+
+    while (pos < len) {
+        UINT32 r = xorshift(&seed);
+        UINTN  n = 3 + (r >> 8) % 30;
+
+        if (pos < 3 || (r & 1) == 0 || n > len - pos) {
+            out[pos] = (UINT8)('a' + (r >> 8) % 26);
+            put_symbol(&o, out[pos++]);
+            continue;
+        }
+
+        UINTN back = pos < 32768 ? pos : 32768;
+        UINTN dist = 1 + (r >> 16) % back;
+        for (UINTN i = 0; i < n; i++, pos++)
+            out[pos] = out[pos - dist];
+
+        UINT32 c = 0;
+        while (c < 28 && len_base[c + 1] <= n) c++;
+        put_symbol(&o, 257 + c);
+        put_bits(&o, (UINT32)(n - len_base[c]), len_extra[c]);
+
+        c = 0;
+        while (c < 29 && dist_base[c + 1] <= dist) c++;
+        put_code(&o, c, 5);
+        put_bits(&o, (UINT32)(dist - dist_base[c]), dist_extra[c]);
+    }
+    put_symbol(&o, 256);
+    if (o.n)
+        put_bits(&o, 0, 8 - o.n);
+
+    /* Trailer: CRC-32 and length, little-endian. */
+    UINT32 crc = 0;
+    gBS->CalculateCrc32(out, len, &crc);
+    put_bits(&o, crc, 32);
+    put_bits(&o, (UINT32)len, 32);
+    return (UINTN)(o.p - gz);
+}
+
+typedef struct {
+    SbInStream   in;
+    const UINT8 *gz;
+    UINTN        gz_len;
+    UINT8       *out;
+    void        *work;
+    EFI_STATUS   status;
+} GunzipJob;
+
+/* The whole stream is in memory from the start. */
+static BOOLEAN
+no_refill(SbInStream *in)
+{
+    return FALSE;
+}
+
+static void
+gunzip_job(void *arg)
+{
+    GunzipJob *j = arg;
+    UINTN n;
+
+    j->in.next   = j->gz;
+    j->in.end    = j->gz + j->gz_len;
+    j->in.refill = no_refill;
+    j->status = sb_gunzip(j->work, &j->in, j->out, BENCH_SLICE, &n);
+    if (!EFI_ERROR(j->status) && n != BENCH_SLICE)
+        j->status = EFI_END_OF_FILE;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Harness                                                            */
+/* ------------------------------------------------------------------ */
+
+static UINT64
+run_pass(SbJob *jobs, UINTN count)
+{
+    UINT64 t0 = sb_time_us();
+    sb_workers_run(jobs, count);
+    UINT64 us = sb_time_us() - t0;
+    return us ? us : 1;
+}
+
+static UINTN
+mib_per_s(UINT64 bytes, UINT64 us)
+{
+    return (UINTN)(bytes * 1000000 / us / (1024 * 1024));
+}
+
+/* Copy one half of `buf` over the other, then fill it, both ways. */
+static void
+bench_memops(UINT8 *buf)
+{
+    const UINTN half = BENCH_BYTES / 2;
+    UINT8 *src = buf, *dst = buf + half;
+    UINT64 t0, us_copy, us_sbcopy, us_set, us_sbset;
+
+    /* Fresh pages: fault both halves in before timing either side. */
+    sb_memcpy(dst, src, half);
+
+    t0 = sb_time_us();
+    CopyMem(dst, src, half);
+    us_copy = sb_time_us() - t0;
+
+    t0 = sb_time_us();
+    sb_memcpy(dst, src, half);
+    us_sbcopy = sb_time_us() - t0;
+
+    BOOLEAN same = CompareMem(dst, src, half) == 0;
+
+    t0 = sb_time_us();
+    SetMem(dst, half, 0);
+    us_set = sb_time_us() - t0;
+
+    t0 = sb_time_us();
+    sb_memset(dst, 0, half);
+    us_sbset = sb_time_us() - t0;
+
+    SB_LOG(L"bench: copy %u MiB  CopyMem %5u MiB/s  sb_memcpy %5u MiB/s%s",
+           half / (1024 * 1024), mib_per_s(half, us_copy ? us_copy : 1),
+           mib_per_s(half, us_sbcopy ? us_sbcopy : 1),
+           same ? L"" : L"  MISMATCH");
+    SB_LOG(L"bench: fill %u MiB  SetMem  %5u MiB/s  sb_memset %5u MiB/s",
+           half / (1024 * 1024), mib_per_s(half, us_set ? us_set : 1),
+           mib_per_s(half, us_sbset ? us_sbset : 1));
+}
+
+/*
+ * Time `jobs` on the BSP, then across the pool.  Callers run them once
+ * first, to warm caches and page tables.  Returns the CPU count of the
+ * second run; *tn is 0 if there are no APs to run it on.
+ */
+static UINTN
+time_jobs(SbJob *jobs, UINTN count, UINT64 *t1, UINT64 *tn)
+{
+    *t1 = run_pass(jobs, count);
+    *tn = 0;
+    if (EFI_ERROR(sb_workers_start()))
+        return 1;
+
+    UINTN cpus = sb_workers_count();
+    *tn = run_pass(jobs, count);
+    sb_workers_stop();
+    return cpus;
+}
+
+static void
+report(const CHAR16 *what, UINT64 bytes, UINT64 t1, UINT64 tn, UINTN cpus,
+       BOOLEAN same)
+{
+    const CHAR16 *check = same ? L"" : L"  MISMATCH";
+
+    if (!tn) {
+        SB_LOG(L"bench: %-8s  1 CPU %5u MiB/s  (no APs)%s",
+               what, mib_per_s(bytes, t1), check);
+        return;
+    }
+    SB_LOG(L"bench: %-8s  1 CPU %5u MiB/s  %u CPUs %5u MiB/s  (x%u.%02u)%s",
+           what, mib_per_s(bytes, t1), cpus, mib_per_s(bytes, tn),
+           (UINTN)(t1 / tn), (UINTN)(t1 * 100 / tn % 100), check);
+}
+
+EFI_STATUS
+sb_bench_run(SuperBootContext *ctx)
+{
+    EFI_PHYSICAL_ADDRESS addr;
+    UINTN pages = BENCH_BYTES / 4096;
+    EFI_STATUS status = sb_page_alloc(SB_MEM_CORE, AllocateAnyPages,
+                                      pages, &addr);
+    if (EFI_ERROR(status)) {
+        SB_LOG(L"bench: cannot allocate %u MiB: %r",
+               BENCH_BYTES / (1024 * 1024), status);
+        return status;
+    }
+
+    UINT8 *buf = (UINT8 *)(UINTN)addr;
+    bench_memops(buf);
+
+    UINT32 x = 0x12345678;
+    for (UINTN i = 0; i < BENCH_BYTES; i += 4)
+        *(UINT32 *)(buf + i) = xorshift(&x);
+
+    UINTN work_size = sb_gunzip_workspace();
+    HashJob   *hj    = sb_zalloc(SB_MEM_CORE, BENCH_JOBS * sizeof(*hj));
+    SbJob     *jobs  = sb_zalloc(SB_MEM_CORE, BENCH_JOBS * sizeof(*jobs));
+    UINT8     *ref   = sb_malloc(SB_MEM_CORE, BENCH_JOBS * SB_SHA256_SIZE);
+    GunzipJob *gj    = sb_zalloc(SB_MEM_CORE, GZ_JOBS * sizeof(*gj));
+    SbJob     *gjobs = sb_zalloc(SB_MEM_CORE, GZ_JOBS * sizeof(*gjobs));
+    UINT8     *gz    = sb_malloc(SB_MEM_CORE, GZ_JOBS * GZ_MAX);
+    UINT8     *work  = sb_malloc(SB_MEM_CORE, GZ_JOBS * work_size);
+    if (!hj || !jobs || !ref || !gj || !gjobs || !gz || !work) {
+        status = EFI_OUT_OF_RESOURCES;
+        goto out;
+    }
+
+    /* ---- SHA-256 ---------------------------------------------------- */
+    for (UINTN i = 0; i < BENCH_JOBS; i++) {
+        hj[i].data   = buf + i * BENCH_SLICE;
+        hj[i].len    = BENCH_SLICE;
+        jobs[i].run  = hash_job;
+        jobs[i].arg  = &hj[i];
+    }
+
+    SbSha256 probe;
+    sb_sha256_init(&probe);
+    SB_LOG(L"bench: SHA-256 (%s), %u x %u KiB",
+           sb_sha256_impl(&probe), BENCH_JOBS, BENCH_SLICE / 1024);
+
+    run_pass(jobs, BENCH_JOBS);
+    for (UINTN i = 0; i < BENCH_JOBS; i++)
+        CopyMem(ref + i * SB_SHA256_SIZE, hj[i].digest, SB_SHA256_SIZE);
+
+    UINT64 t1, tn;
+    UINTN cpus = time_jobs(jobs, BENCH_JOBS, &t1, &tn);
+
+    BOOLEAN same = TRUE;
+    for (UINTN i = 0; i < BENCH_JOBS; i++) {
+        if (CompareMem(ref + i * SB_SHA256_SIZE, hj[i].digest,
+                       SB_SHA256_SIZE) != 0)
+            same = FALSE;
+    }
+    report(L"SHA-256", BENCH_BYTES, t1, tn, cpus, same);
+
+    /* ---- gunzip ----------------------------------------------------- */
+    UINTN gz_total = 0;
+    for (UINTN i = 0; i < GZ_JOBS; i++) {
+        gj[i].gz     = gz + i * GZ_MAX;
+        gj[i].gz_len = make_gzip(gz + i * GZ_MAX,
+                                 buf + GZ_EXPECT + i * BENCH_SLICE,
+                                 BENCH_SLICE, 0x9E3779B9 + (UINT32)i);
+        gj[i].out    = buf + GZ_OUTPUT + i * BENCH_SLICE;
+        gj[i].work   = work + i * work_size;
+        gjobs[i].run = gunzip_job;
+        gjobs[i].arg = &gj[i];
+        gz_total    += gj[i].gz_len;
+    }
+    SB_LOG(L"bench: gunzip, %u x %u KiB from %u KiB",
+           GZ_JOBS, BENCH_SLICE / 1024, gz_total / 1024);
+
+    run_pass(gjobs, GZ_JOBS);
+    SetMem(buf + GZ_OUTPUT, GZ_JOBS * BENCH_SLICE, 0);
+    cpus = time_jobs(gjobs, GZ_JOBS, &t1, &tn);
+
+    same = CompareMem(buf + GZ_EXPECT, buf + GZ_OUTPUT,
+                      GZ_JOBS * BENCH_SLICE) == 0;
+    for (UINTN i = 0; i < GZ_JOBS; i++) {
+        if (EFI_ERROR(gj[i].status))
+            same = FALSE;
+    }
+    report(L"gunzip", (UINT64)GZ_JOBS * BENCH_SLICE, t1, tn, cpus, same);
+
+out:
+    sb_free(work);
+    sb_free(gz);
+    sb_free(gjobs);
+    sb_free(gj);
+    sb_free(ref);
+    sb_free(jobs);
+    sb_free(hj);
+    sb_page_free(addr, pages);
+    return status;
+}
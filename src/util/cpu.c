@@ -0,0 +1,61 @@
+/*
+ * cpu.c — CPU feature detection
+ *
+ * Hot paths (hashing, bulk copies) pick an implementation at run time
+ * from what CPUID reports.  The build targets baseline x86_64, so any
+ * code using newer instructions lives in functions compiled with
+ * __attribute__((target(...))) and is only called after checking
+ * sb_cpu_has().
+ */
+
+#include "util.h"
+#include <cpuid.h>
+
+static UINT32  cpu_features;
+static BOOLEAN cpu_detected;
+
+/* AVX state is only usable if the firmware enabled it in XCR0. */
+static BOOLEAN
+avx_state_enabled(UINT32 ecx1)
+{
+    if (!(ecx1 & bit_OSXSAVE))
+        return FALSE;
+
+    UINT32 lo, hi;
+    __asm__ volatile ("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return (lo & 0x6) == 0x6;          /* XMM and YMM state */
+}
+
+static void
+detect(void)
+{
+    UINT32 eax, ebx, ecx, edx;
+    UINT32 ecx1 = 0;
+    UINT32 max_leaf = __get_cpuid_max(0, NULL);
+
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        if (edx & bit_SSE2)   cpu_features |= SB_CPU_SSE2;
+        if (ecx & bit_SSSE3)  cpu_features |= SB_CPU_SSSE3;
+        if (ecx & bit_SSE4_1) cpu_features |= SB_CPU_SSE41;
+        ecx1 = ecx;
+    }
+
+    if (max_leaf >= 7) {
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        if ((ebx & bit_AVX2) && avx_state_enabled(ecx1))
+            cpu_features |= SB_CPU_AVX2;
+        if (ebx & bit_SHA)     cpu_features |= SB_CPU_SHA;
+        if (ebx & (1U << 9))   cpu_features |= SB_CPU_ERMS;
+        if (edx & (1U << 4))   cpu_features |= SB_CPU_FSRM;
+    }
+
+    cpu_detected = TRUE;
+}
+
+BOOLEAN
+sb_cpu_has(UINT32 features)
+{
+    if (!cpu_detected)
+        detect();
+    return (cpu_features & features) == features;
+}
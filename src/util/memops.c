@@ -0,0 +1,190 @@
+/*
+ * memops.c — Bulk memory copy and fill
+ *
+ * gnu-efi's CopyMem/SetMem move a byte (at best a word) per iteration,
+ * which is fine for headers and far too slow for the tens to hundreds
+ * of MiB a boot moves around: kernel relocation, initrd
+ * concatenation, zeroing large allocations.
+ *
+ * Strategy, by size:
+ *   - below SB_MEMOPS_NT_THRESHOLD: `rep movsb` / `rep stosb`, which
+ *     microcode turns into full cache-line moves on CPUs with ERMS
+ *     (Ivy Bridge and later, Zen); `rep movsq` without ERMS
+ *   - at or above it: non-temporal stores (AVX when the firmware has
+ *     YMM state enabled, SSE2 otherwise).  The destination will not be
+ *     read again before it leaves the cache, so writing around the
+ *     cache avoids both the read-for-ownership and evicting everything
+ *     else
+ *
+ * sb_memcpy() does not handle overlapping buffers; use CopyMem for
+ * that.
+ */
+
+#include "util.h"
+#include <immintrin.h>
+
+/* Larger than a typical per-core L2 and a good share of the LLC. */
+#define SB_MEMOPS_NT_THRESHOLD  (2 * 1024 * 1024)
+
+/* ------------------------------------------------------------------ */
+/*  String instructions                                                */
+/* ------------------------------------------------------------------ */
+
+static inline void
+rep_movsb(void *dst, const void *src, UINTN n)
+{
+    __asm__ volatile ("rep movsb"
+                      : "+D"(dst), "+S"(src), "+c"(n) : : "memory");
+}
+
+static inline void
+rep_movsq(void *dst, const void *src, UINTN n)
+{
+    __asm__ volatile ("rep movsq"
+                      : "+D"(dst), "+S"(src), "+c"(n) : : "memory");
+}
+
+static inline void
+rep_stosb(void *dst, UINT8 v, UINTN n)
+{
+    __asm__ volatile ("rep stosb"
+                      : "+D"(dst), "+c"(n) : "a"(v) : "memory");
+}
+
+static inline void
+rep_stosq(void *dst, UINT64 v, UINTN n)
+{
+    __asm__ volatile ("rep stosq"
+                      : "+D"(dst), "+c"(n) : "a"(v) : "memory");
+}
+
+static void
+copy_rep(UINT8 *d, const UINT8 *s, UINTN n)
+{
+    if (sb_cpu_has(SB_CPU_ERMS) || n < 64) {
+        rep_movsb(d, s, n);
+        return;
+    }
+    rep_movsq(d, s, n / 8);
+    rep_movsb(d + (n & ~(UINTN)7), s + (n & ~(UINTN)7), n & 7);
+}
+
+static void
+fill_rep(UINT8 *d, UINT8 v, UINTN n)
+{
+    if (sb_cpu_has(SB_CPU_ERMS) || n < 64) {
+        rep_stosb(d, v, n);
+        return;
+    }
+    rep_stosq(d, v * 0x0101010101010101ULL, n / 8);
+    rep_stosb(d + (n & ~(UINTN)7), v, n & 7);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Non-temporal loops                                                 */
+/*                                                                     */
+/*  `d` is 64-byte aligned and `n` a multiple of 64 on entry; callers  */
+/*  handle head and tail with the string instructions.                 */
+/* ------------------------------------------------------------------ */
+
+static void
+copy_nt_sse2(UINT8 *d, const UINT8 *s, UINTN n)
+{
+    for (; n; n -= 64, d += 64, s += 64) {
+        _mm_prefetch((const char *)s + 512, _MM_HINT_NTA);
+        __m128i a = _mm_loadu_si128((const __m128i *)(s + 0));
+        __m128i b = _mm_loadu_si128((const __m128i *)(s + 16));
+        __m128i c = _mm_loadu_si128((const __m128i *)(s + 32));
+        __m128i e = _mm_loadu_si128((const __m128i *)(s + 48));
+        _mm_stream_si128((__m128i *)(d + 0),  a);
+        _mm_stream_si128((__m128i *)(d + 16), b);
+        _mm_stream_si128((__m128i *)(d + 32), c);
+        _mm_stream_si128((__m128i *)(d + 48), e);
+    }
+    _mm_sfence();
+}
+
+__attribute__((target("avx")))
+static void
+copy_nt_avx(UINT8 *d, const UINT8 *s, UINTN n)
+{
+    for (; n; n -= 64, d += 64, s += 64) {
+        _mm_prefetch((const char *)s + 512, _MM_HINT_NTA);
+        __m256i a = _mm256_loadu_si256((const __m256i *)(s + 0));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(s + 32));
+        _mm256_stream_si256((__m256i *)(d + 0),  a);
+        _mm256_stream_si256((__m256i *)(d + 32), b);
+    }
+    _mm_sfence();
+    _mm256_zeroupper();
+}
+
+static void
+fill_nt_sse2(UINT8 *d, UINT8 v, UINTN n)
+{
+    __m128i x = _mm_set1_epi8((char)v);
+    for (; n; n -= 64, d += 64) {
+        _mm_stream_si128((__m128i *)(d + 0),  x);
+        _mm_stream_si128((__m128i *)(d + 16), x);
+        _mm_stream_si128((__m128i *)(d + 32), x);
+        _mm_stream_si128((__m128i *)(d + 48), x);
+    }
+    _mm_sfence();
+}
+
+/* Bytes to copy/fill before `p` reaches a 64-byte boundary. */
+static inline UINTN
+head_len(const void *p)
+{
+    return (64 - ((UINTN)p & 63)) & 63;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Public API                                                         */
+/* ------------------------------------------------------------------ */
+
+void *
+sb_memcpy(void *dst, const void *src, UINTN n)
+{
+    UINT8 *d = dst;
+    const UINT8 *s = src;
+
+    if (n < SB_MEMOPS_NT_THRESHOLD || !sb_cpu_has(SB_CPU_SSE2)) {
+        copy_rep(d, s, n);
+        return dst;
+    }
+
+    UINTN head = head_len(d);
+    copy_rep(d, s, head);
+    d += head; s += head; n -= head;
+
+    UINTN body = n & ~(UINTN)63;
+    if (sb_cpu_has(SB_CPU_AVX2))
+        copy_nt_avx(d, s, body);
+    else
+        copy_nt_sse2(d, s, body);
+
+    copy_rep(d + body, s + body, n - body);
+    return dst;
+}
+
+void *
+sb_memset(void *dst, UINT8 value, UINTN n)
+{
+    UINT8 *d = dst;
+
+    if (n < SB_MEMOPS_NT_THRESHOLD || !sb_cpu_has(SB_CPU_SSE2)) {
+        fill_rep(d, value, n);
+        return dst;
+    }
+
+    UINTN head = head_len(d);
+    fill_rep(d, value, head);
+    d += head; n -= head;
+
+    UINTN body = n & ~(UINTN)63;
+    fill_nt_sse2(d, value, body);
+
+    fill_rep(d + body, value, n - body);
+    return dst;
+}
@@ -1,49 +1,453 @@
 /*
- * memory.c — Memory allocation wrappers
+ * memory.c — Memory allocation: tagged pool/page allocations and arenas
+ *
+ * All SuperBoot allocations go through sb_malloc()/sb_page_alloc() so
+ * that live and peak usage is known per subsystem — low-memory VMs
+ * need a budget, not a guess.  Memory handed out by firmware or
+ * gnu-efi helpers (LocateHandleBuffer, DevicePathToStr, PoolPrint,
+ * FileDevicePath...) is still released with FreePool().
  */
 
 #include "util.h"
 
+/* ------------------------------------------------------------------ */
+/*  Accounting                                                         */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    UINTN   live;               /* bytes currently allocated           */
+    UINTN   peak;
+    UINTN   allocs;             /* pool + page allocations, lifetime   */
+} SbMemStat;
+
+static SbMemStat mem_stats[SB_MEM_TAG_COUNT];
+static UINTN     mem_live;
+static UINTN     mem_peak;
+
+static const CHAR16 *mem_tag_names[SB_MEM_TAG_COUNT] = {
+    [SB_MEM_CORE]   = L"core",
+    [SB_MEM_SCAN]   = L"scan",
+    [SB_MEM_CONFIG] = L"config",
+    [SB_MEM_VFS]    = L"vfs",
+    [SB_MEM_FILE]   = L"file",
+    [SB_MEM_BOOT]   = L"boot",
+    [SB_MEM_TUI]    = L"tui",
+    [SB_MEM_DEPLOY] = L"deploy",
+    [SB_MEM_TRACE]  = L"trace",
+};
+
+static void
+mem_charge(SbMemTag tag, UINTN bytes)
+{
+    SbMemStat *st = &mem_stats[tag];
+    st->live += bytes;
+    st->allocs++;
+    if (st->live > st->peak)
+        st->peak = st->live;
+
+    mem_live += bytes;
+    if (mem_live > mem_peak)
+        mem_peak = mem_live;
+}
+
+static void
+mem_credit(SbMemTag tag, UINTN bytes)
+{
+    mem_stats[tag].live -= bytes;
+    mem_live -= bytes;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Pool allocations                                                   */
+/*                                                                     */
+/*  Each block carries a small header with its size and tag so that    */
+/*  sb_free() can credit the right subsystem.  Debug builds also link  */
+/*  live blocks into a list together with their call site.            */
+/* ------------------------------------------------------------------ */
+
+#define SB_ALLOC_MAGIC  0x53424D41   /* "SBMA" */
+
+typedef struct SbAllocHdr {
+    UINT64               size;
+    UINT32               tag;
+    UINT32               magic;
+#ifdef SB_DEBUG_ALLOC
+    struct SbAllocHdr   *prev;
+    struct SbAllocHdr   *next;
+    const char          *file;
+    UINT64               line;
+#endif
+} SbAllocHdr;
+
+_Static_assert(sizeof(SbAllocHdr) % 16 == 0, "allocation header alignment");
+
+#ifdef SB_DEBUG_ALLOC
+static SbAllocHdr *mem_live_list;
+#endif
+
 void *
-sb_alloc(EFI_BOOT_SERVICES *bs, UINTN size)
+sb_mem_alloc(SbMemTag tag, UINTN size, BOOLEAN zero,
+             const char *file, UINT32 line)
 {
-    void *ptr = NULL;
-    EFI_STATUS s = bs->AllocatePool(EfiLoaderData, size, &ptr);
-    if (EFI_ERROR(s))
+    SbAllocHdr *h = NULL;
+    if (EFI_ERROR(gBS->AllocatePool(EfiLoaderData, sizeof(*h) + size,
+                                    (void **)&h)))
         return NULL;
-    SetMem(ptr, size, 0);
-    return ptr;
+
+    h->size  = size;
+    h->tag   = tag;
+    h->magic = SB_ALLOC_MAGIC;
+#ifdef SB_DEBUG_ALLOC
+    h->file = file;
+    h->line = line;
+    h->prev = NULL;
+    h->next = mem_live_list;
+    if (mem_live_list)
+        mem_live_list->prev = h;
+    mem_live_list = h;
+#else
+    (void)file; (void)line;
+#endif
+
+    mem_charge(tag, size);
+
+    if (zero)
+        sb_memset(h + 1, 0, size);
+    return h + 1;
 }
 
-void *
-sb_alloc_pages(EFI_BOOT_SERVICES *bs, UINTN pages,
-               EFI_PHYSICAL_ADDRESS preferred)
+void
+sb_free(void *p)
 {
-    EFI_PHYSICAL_ADDRESS addr = preferred;
-    EFI_STATUS s;
+    if (!p)
+        return;
 
-    if (preferred != 0) {
-        s = bs->AllocatePages(AllocateAddress, EfiLoaderData, pages, &addr);
-        if (!EFI_ERROR(s))
-            return (void *)(UINTN)addr;
+    SbAllocHdr *h = (SbAllocHdr *)p - 1;
+    if (h->magic != SB_ALLOC_MAGIC) {
+        /* Not ours (or already freed): leaking beats corrupting. */
+        SB_LOG(L"WARN: sb_free(%p): not an sb_malloc block", p);
+        return;
     }
+    h->magic = 0;
 
-    s = bs->AllocatePages(AllocateAnyPages, EfiLoaderData, pages, &addr);
-    if (EFI_ERROR(s))
+#ifdef SB_DEBUG_ALLOC
+    if (h->prev)
+        h->prev->next = h->next;
+    else
+        mem_live_list = h->next;
+    if (h->next)
+        h->next->prev = h->prev;
+#endif
+
+    mem_credit((SbMemTag)h->tag, (UINTN)h->size);
+    gBS->FreePool(h);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Page allocations                                                   */
+/*                                                                     */
+/*  Page ranges are few and large (kernel, initrd, arena blocks), so   */
+/*  they are remembered in a table keyed by address.  It starts in     */
+/*  static storage and doubles from pool memory when full; a range    */
+/*  that cannot be recorded is not handed out at all, since it would   */
+/*  never be credited when freed.                                      */
+/* ------------------------------------------------------------------ */
+
+#define SB_MEM_PAGE_RECORDS  128
+
+typedef struct {
+    EFI_PHYSICAL_ADDRESS addr;
+    UINTN                pages;
+    SbMemTag             tag;
+#ifdef SB_DEBUG_ALLOC
+    const char          *file;
+    UINT32               line;
+#endif
+} SbPageRecord;
+
+static SbPageRecord  page_records_static[SB_MEM_PAGE_RECORDS];
+static SbPageRecord *page_records = page_records_static;
+static UINTN         page_record_count = SB_MEM_PAGE_RECORDS;
+
+static SbPageRecord *
+page_record_slot(void)
+{
+    for (UINTN i = 0; i < page_record_count; i++) {
+        if (page_records[i].pages == 0)
+            return &page_records[i];
+    }
+
+    /* Straight from the firmware: the table is not charged to a tag. */
+    UINTN count = page_record_count * 2;
+    SbPageRecord *table = NULL;
+    if (EFI_ERROR(gBS->AllocatePool(EfiLoaderData,
+                                    count * sizeof(*table),
+                                    (void **)&table)))
         return NULL;
-    return (void *)(UINTN)addr;
+
+    sb_memcpy(table, page_records, page_record_count * sizeof(*table));
+    sb_memset(table + page_record_count, 0,
+              (count - page_record_count) * sizeof(*table));
+    if (page_records != page_records_static)
+        gBS->FreePool(page_records);
+
+    SbPageRecord *r = &table[page_record_count];
+    page_records      = table;
+    page_record_count = count;
+    return r;
+}
+
+EFI_STATUS
+sb_mem_alloc_pages(SbMemTag tag, EFI_ALLOCATE_TYPE type, UINTN pages,
+                   EFI_PHYSICAL_ADDRESS *addr, const char *file, UINT32 line)
+{
+    EFI_STATUS s = gBS->AllocatePages(type, EfiLoaderData, pages, addr);
+    if (EFI_ERROR(s))
+        return s;
+
+    SbPageRecord *r = page_record_slot();
+    if (!r) {
+        SB_LOG(L"WARN: no room to record %u pages for %s",
+               pages, mem_tag_names[tag]);
+        gBS->FreePages(*addr, pages);
+        return EFI_OUT_OF_RESOURCES;
+    }
+
+    r->addr  = *addr;
+    r->pages = pages;
+    r->tag   = tag;
+#ifdef SB_DEBUG_ALLOC
+    r->file  = file;
+    r->line  = line;
+#endif
+    (void)file; (void)line;
+
+    mem_charge(tag, pages * 4096);
+    return EFI_SUCCESS;
 }
 
 void
-sb_free(EFI_BOOT_SERVICES *bs, void *p, UINTN size)
+sb_page_free(EFI_PHYSICAL_ADDRESS addr, UINTN pages)
 {
-    (void)size;
+    for (UINTN i = 0; i < page_record_count; i++) {
+        SbPageRecord *r = &page_records[i];
+        if (r->pages != 0 && r->addr == addr) {
+            mem_credit(r->tag, r->pages * 4096);
+            r->pages = 0;
+            break;
+        }
+    }
+    gBS->FreePages(addr, pages);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Reporting                                                          */
+/* ------------------------------------------------------------------ */
+
+void
+sb_mem_summary(void)
+{
+    SB_LOG(L"Memory: %u KiB live, %u KiB peak",
+           mem_live / 1024, mem_peak / 1024);
+    for (UINTN t = 0; t < SB_MEM_TAG_COUNT; t++) {
+        SbMemStat *st = &mem_stats[t];
+        if (st->allocs == 0)
+            continue;
+        SB_LOG(L"  %-7s %8u KiB live %8u KiB peak %6u allocations",
+               mem_tag_names[t], st->live / 1024, st->peak / 1024,
+               st->allocs);
+    }
+}
+
+/*
+ * Counters for tag number `tag`, then for all tags together at
+ * SB_MEM_TAG_COUNT (as "total").  Returns the name, or NULL past the
+ * end, so callers can simply count up until NULL.
+ */
+const CHAR16 *
+sb_mem_usage(UINTN tag, UINTN *live, UINTN *peak, UINTN *allocs)
+{
+    if (tag < SB_MEM_TAG_COUNT) {
+        *live   = mem_stats[tag].live;
+        *peak   = mem_stats[tag].peak;
+        *allocs = mem_stats[tag].allocs;
+        return mem_tag_names[tag];
+    }
+    if (tag == SB_MEM_TAG_COUNT) {
+        *live   = mem_live;
+        *peak   = mem_peak;
+        *allocs = 0;
+        for (UINTN t = 0; t < SB_MEM_TAG_COUNT; t++)
+            *allocs += mem_stats[t].allocs;
+        return L"total";
+    }
+    return NULL;
+}
+
+/*
+ * Report allocations still live under any tag in `tag_mask`.  Debug
+ * builds list each one with its call site.  Returns the leaked bytes.
+ */
+UINTN
+sb_mem_check_leaks(UINT32 tag_mask)
+{
+    UINTN leaked = 0;
+
+    for (UINTN t = 0; t < SB_MEM_TAG_COUNT; t++) {
+        if (!(tag_mask & (1U << t)) || mem_stats[t].live == 0)
+            continue;
+        SB_LOG(L"WARN: leak: %u bytes still allocated by %s",
+               mem_stats[t].live, mem_tag_names[t]);
+        leaked += mem_stats[t].live;
+    }
+
+#ifdef SB_DEBUG_ALLOC
+    for (SbAllocHdr *h = mem_live_list; h; h = h->next) {
+        if (tag_mask & (1U << h->tag))
+            SB_LOG(L"  %s: %u bytes from %a:%u", mem_tag_names[h->tag],
+                   (UINTN)h->size, h->file, (UINTN)h->line);
+    }
+    for (UINTN i = 0; i < page_record_count; i++) {
+        SbPageRecord *r = &page_records[i];
+        if (r->pages && (tag_mask & (1U << r->tag)))
+            SB_LOG(L"  %s: %u pages from %a:%u", mem_tag_names[r->tag],
+                   r->pages, r->file, r->line);
+    }
+#endif
+
+    return leaked;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Region (arena) allocator                                           */
+/*                                                                     */
+/*  Short-lived buffers — config files, directory blocks, bounce       */
+/*  buffers — are carved from large page allocations instead of going  */
+/*  to AllocatePool one by one.  Callers take a mark before a unit of  */
+/*  work (one partition, one config file) and reset to it afterwards;  */
+/*  blocks freed by a reset are kept for reuse, so a whole scan costs  */
+/*  a handful of AllocatePages calls.  sb_arena_release() returns      */
+/*  everything to the firmware.                                        */
+/* ------------------------------------------------------------------ */
+
+#define ARENA_ALIGN  16
+
+struct SbArenaBlock {
+    struct SbArenaBlock *next;
+    UINTN                pages;
+    UINTN                size;      /* usable bytes after the header */
+    UINTN                used;
+};
+
+#define ARENA_HDR_SIZE \
+    ((sizeof(SbArenaBlock) + ARENA_ALIGN - 1) & ~(UINTN)(ARENA_ALIGN - 1))
+
+/* Scan/parse-lifetime scratch space shared by the scanner, the config
+ * parsers and the filesystem drivers. */
+SbArena sb_scratch = { .block_size = SB_SCRATCH_BLOCK_SIZE,
+                       .tag        = SB_MEM_SCAN };
+
+void
+sb_arena_init(SbArena *a, UINTN block_size, SbMemTag tag)
+{
+    SetMem(a, sizeof(*a), 0);
+    a->block_size = block_size;
+    a->tag        = tag;
+}
+
+static SbArenaBlock *
+arena_new_block(SbArena *a, UINTN size)
+{
+    /* Reuse a spare block if one is large enough. */
+    for (SbArenaBlock **pp = &a->spare; *pp; pp = &(*pp)->next) {
+        SbArenaBlock *b = *pp;
+        if (b->size >= size) {
+            *pp = b->next;
+            b->used = 0;
+            return b;
+        }
+    }
+
+    UINTN want  = (size > a->block_size) ? size : a->block_size;
+    UINTN pages = (want + ARENA_HDR_SIZE + 4095) / 4096;
+    EFI_PHYSICAL_ADDRESS addr = 0;
+    if (EFI_ERROR(sb_page_alloc(a->tag, AllocateAnyPages, pages, &addr)))
+        return NULL;
+
+    SbArenaBlock *b = (SbArenaBlock *)(UINTN)addr;
+    b->pages = pages;
+    b->size  = pages * 4096 - ARENA_HDR_SIZE;
+    b->used  = 0;
+    a->pages += pages;
+    a->block_allocs++;
+    return b;
+}
+
+void *
+sb_arena_alloc(SbArena *a, UINTN size)
+{
+    size = (size + ARENA_ALIGN - 1) & ~(UINTN)(ARENA_ALIGN - 1);
+
+    SbArenaBlock *b = a->blocks;
+    if (!b || b->size - b->used < size) {
+        b = arena_new_block(a, size);
+        if (!b)
+            return NULL;
+        b->next   = a->blocks;
+        a->blocks = b;
+    }
+
+    void *p = (UINT8 *)b + ARENA_HDR_SIZE + b->used;
+    b->used += size;
+    a->allocs++;
+    return p;
+}
+
+void *
+sb_arena_zalloc(SbArena *a, UINTN size)
+{
+    void *p = sb_arena_alloc(a, size);
     if (p)
-        bs->FreePool(p);
+        sb_memset(p, 0, size);
+    return p;
+}
+
+SbArenaMark
+sb_arena_mark(SbArena *a)
+{
+    SbArenaMark m = { a->blocks, a->blocks ? a->blocks->used : 0 };
+    return m;
+}
+
+void
+sb_arena_reset(SbArena *a, SbArenaMark m)
+{
+    while (a->blocks && a->blocks != m.block) {
+        SbArenaBlock *b = a->blocks;
+        a->blocks = b->next;
+        b->next  = a->spare;
+        a->spare = b;
+    }
+    if (a->blocks)
+        a->blocks->used = m.used;
+}
+
+static void
+arena_free_list(SbArenaBlock *b)
+{
+    while (b) {
+        SbArenaBlock *next = b->next;
+        sb_page_free((EFI_PHYSICAL_ADDRESS)(UINTN)b, b->pages);
+        b = next;
+    }
 }
 
 void
-sb_free_pages(EFI_BOOT_SERVICES *bs, EFI_PHYSICAL_ADDRESS addr, UINTN pages)
+sb_arena_release(SbArena *a)
 {
-    bs->FreePages(addr, pages);
+    arena_free_list(a->blocks);
+    arena_free_list(a->spare);
+    a->blocks = NULL;
+    a->spare  = NULL;
+    a->pages  = 0;
 }
@@ -0,0 +1,223 @@
+/*
+ * sched.c — Cooperative task scheduler
+ *
+ * UEFI gives us one thread and a set of events.  A task here is an
+ * explicit state machine: its step() does one bounded slice of work
+ * (scan one partition, handle one key, redraw once) and says what it
+ * wants next:
+ *
+ *   SB_TASK_YIELD   run me again when my turn comes
+ *   SB_TASK_BLOCK   sleep until t->wait is signalled, t->wake_us has
+ *                   passed, or another task calls sb_sched_wake(t)
+ *   SB_TASK_DONE    remove me
+ *
+ * The ready task with the highest priority runs first, round-robin
+ * within a priority, so key handling (SB_PRIO_INPUT) is never queued
+ * behind a partition scan (SB_PRIO_BACKGROUND).  When nothing is
+ * ready the scheduler sleeps in WaitForEvent() on every task's wait
+ * event plus one persistent periodic tick, which bounds timer
+ * latency for wake_us sleepers.
+ *
+ * Only the top-level loop in sb_sched_run() runs tasks.  Modal screens
+ * (file browser, deploy, cmdline editor) still block in tui_read_key():
+ * they hold pointers into state that background tasks modify, so the
+ * background simply pauses while they are open.
+ */
+
+#include "util.h"
+
+/* Tick for wake_us sleepers. */
+#define SB_SCHED_TICK_US   10000
+
+/* Enough for every task's event plus the tick. */
+#define SB_SCHED_MAX_WAIT  16
+
+static SuperBootContext *sched_ctx;
+static EFI_EVENT         tick;
+static SbTask           *tasks;
+static SbTask           *last_run[SB_PRIO_COUNT];
+
+EFI_STATUS
+sb_sched_init(SuperBootContext *ctx)
+{
+    sched_ctx = ctx;
+    if (tick)
+        return EFI_SUCCESS;
+
+    EFI_STATUS status = ctx->boot_services->CreateEvent(
+                            EVT_TIMER, 0, NULL, NULL, &tick);
+    if (EFI_ERROR(status))
+        return status;
+
+    /* SetTimer takes 100 ns units. */
+    status = ctx->boot_services->SetTimer(tick, TimerPeriodic,
+                                          SB_SCHED_TICK_US * 10);
+    if (EFI_ERROR(status)) {
+        ctx->boot_services->CloseEvent(tick);
+        tick = NULL;
+    }
+    return status;
+}
+
+void
+sb_sched_add(SbTask *t)
+{
+    t->ready   = TRUE;
+    t->next    = tasks;
+    tasks      = t;
+}
+
+static void
+unlink_task(SbTask *t)
+{
+    for (SbTask **pp = &tasks; *pp; pp = &(*pp)->next) {
+        if (*pp == t) {
+            *pp = t->next;
+            break;
+        }
+    }
+    for (UINTN p = 0; p < SB_PRIO_COUNT; p++) {
+        if (last_run[p] == t)
+            last_run[p] = NULL;
+    }
+    t->next = NULL;
+}
+
+void
+sb_sched_cancel(SbTask *t)
+{
+    for (SbTask *i = tasks; i; i = i->next) {
+        if (i == t) {
+            unlink_task(t);
+            if (t->cancel)
+                t->cancel(t);
+            return;
+        }
+    }
+}
+
+void
+sb_sched_wake(SbTask *t)
+{
+    t->ready = TRUE;
+}
+
+void
+sb_sched_shutdown(void)
+{
+    while (tasks)
+        sb_sched_cancel(tasks);
+
+    if (tick) {
+        sched_ctx->boot_services->SetTimer(tick, TimerCancel, 0);
+        sched_ctx->boot_services->CloseEvent(tick);
+        tick = NULL;
+    }
+}
+
+/* ------------------------------------------------------------------ */
+/*  Main loop                                                          */
+/* ------------------------------------------------------------------ */
+
+/* Mark blocked tasks whose event fired or whose time has come. */
+static void
+poll_blocked(void)
+{
+    UINT64 now = sb_time_us();
+
+    for (SbTask *t = tasks; t; t = t->next) {
+        if (t->ready)
+            continue;
+        if (t->wake_us && now >= t->wake_us)
+            t->ready = TRUE;
+        else if (t->wait &&
+                 sched_ctx->boot_services->CheckEvent(t->wait) ==
+                 EFI_SUCCESS)
+            t->ready = TRUE;
+    }
+}
+
+/* Highest-priority ready task, round-robin after the last one run. */
+static SbTask *
+pick(void)
+{
+    for (UINTN p = 0; p < SB_PRIO_COUNT; p++) {
+        SbTask *start = last_run[p] ? last_run[p]->next : NULL;
+        SbTask *first = NULL;
+
+        for (SbTask *t = start; t; t = t->next) {
+            if (t->prio == p && t->ready) {
+                first = t;
+                break;
+            }
+        }
+        for (SbTask *t = tasks; !first && t; t = t->next) {
+            if (t->prio == p && t->ready)
+                first = t;
+        }
+        if (first)
+            return first;
+    }
+    return NULL;
+}
+
+static void
+sleep_until_event(void)
+{
+    EFI_EVENT events[SB_SCHED_MAX_WAIT];
+    UINTN n = 0;
+
+    if (tick)
+        events[n++] = tick;
+    for (SbTask *t = tasks; t && n < SB_SCHED_MAX_WAIT; t = t->next) {
+        if (!t->ready && t->wait)
+            events[n++] = t->wait;
+    }
+    if (n == 0)
+        return;
+
+    UINTN index;
+    if (EFI_ERROR(sched_ctx->boot_services->WaitForEvent(n, events,
+                                                         &index)))
+        return;
+
+    /* WaitForEvent consumed the signal; hand it to its owner. */
+    for (SbTask *t = tasks; t; t = t->next) {
+        if (t->wait == events[index])
+            t->ready = TRUE;
+    }
+}
+
+/*
+ * Run tasks until *stop becomes TRUE or no tasks are left.  Tasks set
+ * the flag (directly or through their own state) to end the loop.
+ */
+void
+sb_sched_run(const BOOLEAN *stop)
+{
+    while (!*stop && tasks) {
+        poll_blocked();
+
+        SbTask *t = pick();
+        if (!t) {
+            sleep_until_event();
+            continue;
+        }
+
+        t->ready   = FALSE;
+        t->wake_us = 0;
+        SbTaskStatus st = t->step(t);
+        last_run[t->prio] = t;
+
+        switch (st) {
+        case SB_TASK_YIELD:
+            t->ready = TRUE;
+            break;
+        case SB_TASK_BLOCK:
+            break;
+        case SB_TASK_DONE:
+            unlink_task(t);
+            break;
+        }
+    }
+}
@@ -0,0 +1,230 @@
+/*
+ * sha256.c — Streaming SHA-256 (FIPS 180-4)
+ *
+ * Used to measure boot images into the TPM.  Data is fed in whatever
+ * pieces the file reader produces, so a kernel is hashed chunk by
+ * chunk while it is still hot in cache rather than in a second pass
+ * over the finished buffer.
+ *
+ * Two block functions: one using the SHA extensions (SHA-NI, present
+ * on Intel since Goldmont/Ice Lake and on every AMD Zen), and a
+ * portable one for everything else.  The choice is made once per
+ * context from sb_cpu_has().
+ */
+
+#include "util.h"
+#include <immintrin.h>
+
+static const UINT32 K[64] __attribute__((aligned(16))) = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+/* ------------------------------------------------------------------ */
+/*  Portable block function                                            */
+/* ------------------------------------------------------------------ */
+
+#define ROR(x, n)   (((x) >> (n)) | ((x) << (32 - (n))))
+#define CH(e, f, g) (((e) & (f)) ^ (~(e) & (g)))
+#define MAJ(a, b, c) (((a) & (b)) ^ ((a) & (c)) ^ ((b) & (c)))
+#define S0(a)       (ROR(a, 2) ^ ROR(a, 13) ^ ROR(a, 22))
+#define S1(e)       (ROR(e, 6) ^ ROR(e, 11) ^ ROR(e, 25))
+#define s0(w)       (ROR(w, 7) ^ ROR(w, 18) ^ ((w) >> 3))
+#define s1(w)       (ROR(w, 17) ^ ROR(w, 19) ^ ((w) >> 10))
+
+static void
+blocks_generic(UINT32 state[8], const UINT8 *p, UINTN blocks)
+{
+    UINT32 w[64];
+
+    while (blocks--) {
+        for (int i = 0; i < 16; i++, p += 4)
+            w[i] = (UINT32)p[0] << 24 | (UINT32)p[1] << 16 |
+                   (UINT32)p[2] << 8  | p[3];
+        for (int i = 16; i < 64; i++)
+            w[i] = s1(w[i - 2]) + w[i - 7] + s0(w[i - 15]) + w[i - 16];
+
+        UINT32 a = state[0], b = state[1], c = state[2], d = state[3];
+        UINT32 e = state[4], f = state[5], g = state[6], h = state[7];
+
+        for (int i = 0; i < 64; i++) {
+            UINT32 t1 = h + S1(e) + CH(e, f, g) + K[i] + w[i];
+            UINT32 t2 = S0(a) + MAJ(a, b, c);
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+    }
+}
+
+/* ------------------------------------------------------------------ */
+/*  SHA-NI block function                                              */
+/*                                                                     */
+/*  The SHA256RNDS2 instruction wants the state split as ABEF/CDGH and */
+/*  performs two rounds per issue; SHA256MSG1/MSG2 compute the message */
+/*  schedule four words at a time.                                     */
+/* ------------------------------------------------------------------ */
+
+__attribute__((target("sha,sse4.1")))
+static void
+blocks_shani(UINT32 state[8], const UINT8 *p, UINTN blocks)
+{
+    const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL,
+                                         0x0405060700010203ULL);
+
+    __m128i tmp    = _mm_loadu_si128((const __m128i *)&state[0]);
+    __m128i state1 = _mm_loadu_si128((const __m128i *)&state[4]);
+    tmp    = _mm_shuffle_epi32(tmp, 0xB1);                 /* CDAB */
+    state1 = _mm_shuffle_epi32(state1, 0x1B);              /* EFGH */
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);      /* ABEF */
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);           /* CDGH */
+
+    while (blocks--) {
+        __m128i abef = state0, cdgh = state1;
+        __m128i msg[4];
+
+        for (int i = 0; i < 4; i++)
+            msg[i] = _mm_shuffle_epi8(
+                _mm_loadu_si128((const __m128i *)(p + 16 * i)), bswap);
+
+#pragma GCC unroll 16
+        for (int j = 0; j < 16; j++) {
+            if (j >= 4) {
+                /* W[j] from W[j-4..j-1], held in msg[] mod 4. */
+                __m128i m = _mm_sha256msg1_epu32(msg[j & 3],
+                                                 msg[(j + 1) & 3]);
+                m = _mm_add_epi32(m, _mm_alignr_epi8(msg[(j + 3) & 3],
+                                                     msg[(j + 2) & 3], 4));
+                msg[j & 3] = _mm_sha256msg2_epu32(m, msg[(j + 3) & 3]);
+            }
+
+            __m128i wk = _mm_add_epi32(
+                msg[j & 3], _mm_load_si128((const __m128i *)&K[4 * j]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, wk);
+            wk     = _mm_shuffle_epi32(wk, 0x0E);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, wk);
+        }
+
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+        p += 64;
+    }
+
+    tmp    = _mm_shuffle_epi32(state0, 0x1B);              /* FEBA */
+    state1 = _mm_shuffle_epi32(state1, 0xB1);              /* DCHG */
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);           /* DCBA */
+    state1 = _mm_alignr_epi8(state1, tmp, 8);              /* HGFE */
+
+    _mm_storeu_si128((__m128i *)&state[0], state0);
+    _mm_storeu_si128((__m128i *)&state[4], state1);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Public API                                                         */
+/* ------------------------------------------------------------------ */
+
+static void
+run_blocks(SbSha256 *ctx, const UINT8 *p, UINTN blocks)
+{
+    if (ctx->use_shani)
+        blocks_shani(ctx->state, p, blocks);
+    else
+        blocks_generic(ctx->state, p, blocks);
+}
+
+void
+sb_sha256_init(SbSha256 *ctx)
+{
+    static const UINT32 iv[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+
+    SetMem(ctx, sizeof(*ctx), 0);
+    CopyMem(ctx->state, (void *)iv, sizeof(iv));
+    ctx->use_shani = sb_cpu_has(SB_CPU_SHA | SB_CPU_SSE41);
+}
+
+void
+sb_sha256_update(SbSha256 *ctx, const void *data, UINTN len)
+{
+    const UINT8 *p = data;
+    UINT64 t0 = sb_time_us();
+
+    ctx->length += len;
+
+    if (ctx->buf_len) {
+        UINTN n = 64 - ctx->buf_len;
+        if (n > len)
+            n = len;
+        CopyMem(ctx->buf + ctx->buf_len, (void *)p, n);
+        ctx->buf_len += n;
+        p   += n;
+        len -= n;
+        if (ctx->buf_len < 64)
+            goto out;
+        run_blocks(ctx, ctx->buf, 1);
+        ctx->buf_len = 0;
+    }
+
+    if (len >= 64) {
+        run_blocks(ctx, p, len / 64);
+        p   += len & ~(UINTN)63;
+        len &= 63;
+    }
+
+    if (len) {
+        CopyMem(ctx->buf, (void *)p, len);
+        ctx->buf_len = len;
+    }
+
+out:
+    ctx->busy_us += sb_time_us() - t0;
+}
+
+void
+sb_sha256_final(SbSha256 *ctx, UINT8 digest[SB_SHA256_SIZE])
+{
+    UINT64 bits = ctx->length * 8;
+    UINTN  n    = ctx->buf_len;
+
+    ctx->buf[n++] = 0x80;
+    if (n > 56) {
+        SetMem(ctx->buf + n, 64 - n, 0);
+        run_blocks(ctx, ctx->buf, 1);
+        n = 0;
+    }
+    SetMem(ctx->buf + n, 56 - n, 0);
+    for (int i = 0; i < 8; i++)
+        ctx->buf[56 + i] = (UINT8)(bits >> (56 - 8 * i));
+    run_blocks(ctx, ctx->buf, 1);
+
+    for (int i = 0; i < 8; i++) {
+        digest[4 * i + 0] = (UINT8)(ctx->state[i] >> 24);
+        digest[4 * i + 1] = (UINT8)(ctx->state[i] >> 16);
+        digest[4 * i + 2] = (UINT8)(ctx->state[i] >> 8);
+        digest[4 * i + 3] = (UINT8)(ctx->state[i]);
+    }
+}
+
+const CHAR16 *
+sb_sha256_impl(const SbSha256 *ctx)
+{
+    return ctx->use_shani ? L"SHA-NI" : L"generic";
+}
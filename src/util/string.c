@@ -1,12 +1,106 @@
 /*
- * string.c — ASCII (CHAR8) string utilities
+ * string.c — CHAR8 string utilities
  *
  * UEFI's standard library provides wide-string (CHAR16) helpers, but
  * bootloader configs and kernel command lines are ASCII.  These
  * functions fill the gap.
+ *
+ * Every config parser runs its whole input through the scanning
+ * helpers here, so length, character search and substring search look
+ * at 16 bytes per step with SSE2.  SSE2 is part of x86-64 and UEFI
+ * hands over with it enabled, so unlike memops.c there is no CPUID
+ * check.  Scans only ever load 16-byte-aligned blocks until they know
+ * where the string ends: such a block never crosses a page boundary,
+ * so reading past the NUL cannot fault.
+ *
+ * Conversions between CHAR8 and CHAR16 treat the 8-bit side as UTF-8
+ * and the 16-bit side as UTF-16, with a 16-bytes-at-a-time path for
+ * runs of ASCII.  Bytes that are not valid UTF-8 are taken as
+ * Latin-1, which is what the old byte-widening conversion did.
  */
 
 #include "util.h"
+#include <emmintrin.h>
+
+/* ------------------------------------------------------------------ */
+/*  SSE2 scanning primitives                                           */
+/* ------------------------------------------------------------------ */
+
+static inline UINT32
+ctz32(UINT32 x)
+{
+    return (UINT32)__builtin_ctz(x);
+}
+
+static BOOLEAN
+bytes_equal(const CHAR8 *a, const CHAR8 *b, UINTN n)
+{
+    for (UINTN i = 0; i < n; i++)
+        if (a[i] != b[i])
+            return FALSE;
+    return TRUE;
+}
+
+/* Bitmask of the bytes of `v` that are NUL or equal to the byte in `c`. */
+static inline UINT32
+stop_mask(__m128i v, __m128i c)
+{
+    __m128i z = _mm_cmpeq_epi8(v, _mm_setzero_si128());
+    return (UINT32)_mm_movemask_epi8(_mm_or_si128(z, _mm_cmpeq_epi8(v, c)));
+}
+
+/* First byte of `s` equal to `c`, or the terminating NUL. */
+static const CHAR8 *
+find_byte_or_nul(const CHAR8 *s, CHAR8 c)
+{
+    __m128i cv = _mm_set1_epi8((char)c);
+    UINTN   off = (UINTN)s & 15;
+    const __m128i *p = (const __m128i *)(s - off);
+
+    /* First block: ignore the bytes before `s`. */
+    UINT32 mask = stop_mask(_mm_load_si128(p), cv) >> off;
+    if (mask)
+        return s + ctz32(mask);
+
+    for (;;) {
+        mask = stop_mask(_mm_load_si128(++p), cv);
+        if (mask)
+            return (const CHAR8 *)p + ctz32(mask);
+    }
+}
+
+/*
+ * Length of `s`, having already seen `from` bytes without a NUL, but
+ * looking no further than about `limit` bytes: returns `limit` if the
+ * string is at least that long.
+ */
+static UINTN
+scan_len(const CHAR8 *s, UINTN from, UINTN limit)
+{
+    const CHAR8 *q = s + from;
+    UINTN off = (UINTN)q & 15;
+    const __m128i *p = (const __m128i *)(q - off);
+    __m128i z = _mm_setzero_si128();
+
+    UINT32 mask = (UINT32)_mm_movemask_epi8(
+                      _mm_cmpeq_epi8(_mm_load_si128(p), z)) >> off;
+    if (mask)
+        return from + ctz32(mask);
+
+    UINTN len = from + 16 - off;
+    while (len < limit) {
+        mask = (UINT32)_mm_movemask_epi8(
+                   _mm_cmpeq_epi8(_mm_load_si128(++p), z));
+        if (mask)
+            return len + ctz32(mask);
+        len += 16;
+    }
+    return limit;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Comparison, length, search                                         */
+/* ------------------------------------------------------------------ */
 
 INTN
 sb_strcmp8(const CHAR8 *a, const CHAR8 *b)
@@ -28,20 +122,70 @@ sb_strncmp8(const CHAR8 *a, const CHAR8 *b, UINTN n)
 UINTN
 sb_strlen8(const CHAR8 *a)
 {
-    UINTN len = 0;
-    while (a[len]) len++;
-    return len;
+    return scan_len(a, 0, (UINTN)-1);
 }
 
+CHAR8 *
+sb_strchr8(const CHAR8 *s, CHAR8 c)
+{
+    const CHAR8 *p = find_byte_or_nul(s, c);
+    return *p == c ? (CHAR8 *)p : NULL;
+}
+
+/*
+ * Substring search by first/last-byte filtering: each step compares 16
+ * haystack positions at once against the needle's first byte and, at
+ * the matching offset, its last byte.  Only positions where both agree
+ * are compared in full, which for text is rarely more than the true
+ * match.  The haystack's length is discovered as the scan goes, so a
+ * hit early in a large buffer costs no more than the bytes before it.
+ */
 CHAR8 *
 sb_strstr8(const CHAR8 *haystack, const CHAR8 *needle)
 {
-    if (!*needle) return (CHAR8 *)haystack;
-    UINTN nlen = sb_strlen8(needle);
+    if (!needle[0])
+        return (CHAR8 *)haystack;
+    if (!needle[1])
+        return sb_strchr8(haystack, needle[0]);
 
-    for (; *haystack; haystack++) {
-        if (sb_strncmp8(haystack, needle, nlen) == 0)
-            return (CHAR8 *)haystack;
+    UINTN k = sb_strlen8(needle);
+    __m128i first = _mm_set1_epi8((char)needle[0]);
+    __m128i last  = _mm_set1_epi8((char)needle[k - 1]);
+
+    UINTN   known = 0;              /* bytes known to precede the NUL */
+    BOOLEAN ended = FALSE;          /* ...and known == length         */
+    UINTN   i = 0;
+
+    for (;;) {
+        /* This step reads bytes [i, i + k + 15). */
+        UINTN want = i + k + 15;
+        if (!ended && known < want) {
+            UINTN limit = want + 256;
+            known = scan_len(haystack, known, limit);
+            ended = known < limit;
+        }
+        if (known < want)
+            break;
+
+        __m128i a = _mm_loadu_si128((const __m128i *)(haystack + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(haystack + i + k - 1));
+        UINT32 mask = (UINT32)_mm_movemask_epi8(
+                          _mm_and_si128(_mm_cmpeq_epi8(a, first),
+                                        _mm_cmpeq_epi8(b, last)));
+        while (mask) {
+            UINTN at = i + ctz32(mask);
+            if (bytes_equal(haystack + at + 1, needle + 1, k - 2))
+                return (CHAR8 *)haystack + at;
+            mask &= mask - 1;
+        }
+        i += 16;
+    }
+
+    /* Fewer than 16 candidate positions left. */
+    for (; i + k <= known; i++) {
+        if (haystack[i] == needle[0] &&
+            bytes_equal(haystack + i + 1, needle + 1, k - 1))
+            return (CHAR8 *)haystack + i;
     }
     return NULL;
 }
@@ -55,35 +199,210 @@ sb_strcpy8(CHAR8 *dst, const CHAR8 *src, UINTN max)
     dst[i] = '\0';
 }
 
+/* ------------------------------------------------------------------ */
+/*  UTF-8 <-> UTF-16                                                   */
+/* ------------------------------------------------------------------ */
+
+/*
+ * Decode the sequence at `s` (s[0] >= 0x80).  Overlong forms,
+ * surrogates, truncated sequences and stray bytes decode as the single
+ * Latin-1 byte s[0].  A NUL is never a continuation byte, so this
+ * cannot read past the end of the string.
+ */
+static UINT32
+utf8_decode(const UINT8 *s, UINTN *len)
+{
+    UINT32 c = s[0], min;
+    UINTN  n;
+
+    if (c >= 0xC2 && c <= 0xDF)      { n = 2; c &= 0x1F; min = 0x80; }
+    else if (c >= 0xE0 && c <= 0xEF) { n = 3; c &= 0x0F; min = 0x800; }
+    else if (c >= 0xF0 && c <= 0xF4) { n = 4; c &= 0x07; min = 0x10000; }
+    else                             goto latin1;
+
+    for (UINTN i = 1; i < n; i++) {
+        if ((s[i] & 0xC0) != 0x80)
+            goto latin1;
+        c = (c << 6) | (s[i] & 0x3F);
+    }
+    if (c < min || c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF))
+        goto latin1;
+
+    *len = n;
+    return c;
+
+latin1:
+    *len = 1;
+    return s[0];
+}
+
+/*
+ * UTF-8 to UTF-16.  `max` counts CHAR16s including the NUL; a
+ * character that does not fit whole is dropped with everything after
+ * it.  Characters beyond the BMP become surrogate pairs: the console
+ * cannot draw them, but file names survive a round trip.
+ */
 void
 sb_str8to16(CHAR16 *dst, const CHAR8 *src, UINTN max)
 {
-    UINTN i;
-    for (i = 0; i + 1 < max && src[i]; i++)
-        dst[i] = (CHAR16)(UINT8)src[i];
+    const UINT8 *s = (const UINT8 *)src;
+    __m128i z = _mm_setzero_si128();
+    UINTN i = 0;
+
+    if (max == 0)
+        return;
+
+    while (i + 1 < max) {
+        /* 16 ASCII bytes at a time, from aligned blocks only. */
+        if (((UINTN)s & 15) == 0 && i + 16 < max) {
+            __m128i v = _mm_load_si128((const __m128i *)s);
+            if (_mm_movemask_epi8(v) == 0 &&
+                _mm_movemask_epi8(_mm_cmpeq_epi8(v, z)) == 0) {
+                _mm_storeu_si128((__m128i *)(dst + i),
+                                 _mm_unpacklo_epi8(v, z));
+                _mm_storeu_si128((__m128i *)(dst + i + 8),
+                                 _mm_unpackhi_epi8(v, z));
+                i += 16;
+                s += 16;
+                continue;
+            }
+        }
+
+        UINT32 c = *s;
+        if (c == 0)
+            break;
+        if (c < 0x80) {
+            dst[i++] = (CHAR16)c;
+            s++;
+            continue;
+        }
+
+        UINTN len;
+        c = utf8_decode(s, &len);
+        if (c > 0xFFFF) {
+            if (i + 2 >= max)
+                break;
+            c -= 0x10000;
+            dst[i++] = (CHAR16)(0xD800 + (c >> 10));
+            dst[i++] = (CHAR16)(0xDC00 + (c & 0x3FF));
+        } else {
+            dst[i++] = (CHAR16)c;
+        }
+        s += len;
+    }
     dst[i] = L'\0';
 }
 
+/*
+ * UTF-16 to UTF-8.  `max` counts bytes including the NUL; a character
+ * is written whole or not at all.  Unpaired surrogates become '?'.
+ */
 void
 sb_str16to8(CHAR8 *dst, const CHAR16 *src, UINTN max)
 {
-    UINTN i;
-    for (i = 0; i + 1 < max && src[i]; i++)
-        dst[i] = (src[i] < 0x80) ? (CHAR8)src[i] : '?';
+    const __m128i high = _mm_set1_epi16((short)0xFF80);
+    __m128i z = _mm_setzero_si128();
+    UINTN i = 0;
+
+    if (max == 0)
+        return;
+
+    while (i + 1 < max) {
+        /* 8 ASCII characters at a time, from aligned blocks only. */
+        if (((UINTN)src & 15) == 0 && i + 8 < max) {
+            __m128i v = _mm_load_si128((const __m128i *)src);
+            UINT32 nul   = (UINT32)_mm_movemask_epi8(_mm_cmpeq_epi16(v, z));
+            UINT32 ascii = (UINT32)_mm_movemask_epi8(
+                               _mm_cmpeq_epi16(_mm_and_si128(v, high), z));
+            if (nul == 0 && ascii == 0xFFFF) {
+                _mm_storel_epi64((__m128i *)(dst + i),
+                                 _mm_packus_epi16(v, v));
+                i   += 8;
+                src += 8;
+                continue;
+            }
+        }
+
+        UINT32 c = *src;
+        if (c == 0)
+            break;
+
+        UINTN n = 1;
+        if (c >= 0xD800 && c <= 0xDBFF &&
+            src[1] >= 0xDC00 && src[1] <= 0xDFFF) {
+            c = 0x10000 + ((c - 0xD800) << 10) + (src[1] - 0xDC00);
+            n = 2;
+        } else if (c >= 0xD800 && c <= 0xDFFF) {
+            c = '?';
+        }
+
+        UINTN len = c < 0x80 ? 1 : c < 0x800 ? 2 : c < 0x10000 ? 3 : 4;
+        if (i + len >= max)
+            break;
+        switch (len) {
+        case 1:
+            dst[i++] = (CHAR8)c;
+            break;
+        case 2:
+            dst[i++] = (CHAR8)(0xC0 | (c >> 6));
+            dst[i++] = (CHAR8)(0x80 | (c & 0x3F));
+            break;
+        case 3:
+            dst[i++] = (CHAR8)(0xE0 | (c >> 12));
+            dst[i++] = (CHAR8)(0x80 | ((c >> 6) & 0x3F));
+            dst[i++] = (CHAR8)(0x80 | (c & 0x3F));
+            break;
+        default:
+            dst[i++] = (CHAR8)(0xF0 | (c >> 18));
+            dst[i++] = (CHAR8)(0x80 | ((c >> 12) & 0x3F));
+            dst[i++] = (CHAR8)(0x80 | ((c >> 6) & 0x3F));
+            dst[i++] = (CHAR8)(0x80 | (c & 0x3F));
+            break;
+        }
+        src += n;
+    }
     dst[i] = '\0';
 }
 
+/* ------------------------------------------------------------------ */
+/*  Line scanning                                                      */
+/* ------------------------------------------------------------------ */
+
+/* Indentation is usually a few bytes: test those before going wide. */
 CHAR8 *
 sb_skip_whitespace(CHAR8 *p)
 {
-    while (*p == ' ' || *p == '\t') p++;
-    return p;
+    for (UINTN i = 0; i < 4; i++, p++)
+        if (*p != ' ' && *p != '\t')
+            return p;
+
+    __m128i sp = _mm_set1_epi8(' ');
+    __m128i tab = _mm_set1_epi8('\t');
+    UINTN off = (UINTN)p & 15;
+    const __m128i *q = (const __m128i *)(p - off);
+
+    /* Bits set for bytes that are not blanks; the NUL is one of them. */
+    __m128i v = _mm_load_si128(q);
+    UINT32 mask = (~(UINT32)_mm_movemask_epi8(
+                       _mm_or_si128(_mm_cmpeq_epi8(v, sp),
+                                    _mm_cmpeq_epi8(v, tab))) & 0xFFFF) >> off;
+    if (mask)
+        return p + ctz32(mask);
+
+    for (;;) {
+        v = _mm_load_si128(++q);
+        mask = ~(UINT32)_mm_movemask_epi8(
+                   _mm_or_si128(_mm_cmpeq_epi8(v, sp),
+                                _mm_cmpeq_epi8(v, tab))) & 0xFFFF;
+        if (mask)
+            return (CHAR8 *)q + ctz32(mask);
+    }
 }
 
 CHAR8 *
 sb_next_line(CHAR8 *p)
 {
-    while (*p && *p != '\n') p++;
+    p = (CHAR8 *)find_byte_or_nul(p, '\n');
     if (*p == '\n') p++;
     return p;
 }
@@ -0,0 +1,162 @@
+/*
+ * strpool.c — Interned, immutable string storage
+ *
+ * BootTargets refer to their strings by pointer.  Every string is
+ * stored once per pool: the same kernel path, config path or command
+ * line repeated across dozens of GRUB entries costs one copy, and two
+ * interned strings are equal exactly when their pointers are.
+ *
+ * Storage is an SbArena owned by the pool; nothing is freed
+ * individually.  Lookups go through an open-addressed hash set of
+ * pointers to the stored strings.  CHAR8 and CHAR16 strings share the
+ * pool: a CHAR16 string's terminator makes its byte image distinct
+ * from any CHAR8 string.
+ */
+
+#include "util.h"
+
+#define STRPOOL_BLOCK_SIZE   (16 * 1024)
+#define STRPOOL_MIN_SLOTS    256
+
+/* Header stored in front of every interned string. */
+typedef struct SbStrHdr {
+    UINT32  hash;
+    UINT32  size;          /* bytes, including the terminator */
+} SbStrHdr;
+
+/* ------------------------------------------------------------------ */
+/*  Raw storage                                                        */
+/* ------------------------------------------------------------------ */
+
+void *
+sb_strpool_alloc(SbStrPool *pool, UINTN size)
+{
+    void *p = sb_arena_alloc(&pool->arena, size);
+    if (p)
+        pool->bytes += size;
+    return p;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Hash set                                                           */
+/* ------------------------------------------------------------------ */
+
+static UINT32
+hash_bytes(const UINT8 *p, UINTN n)
+{
+    UINT32 h = 2166136261u;           /* FNV-1a */
+    for (UINTN i = 0; i < n; i++) {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static BOOLEAN
+grow_slots(SbStrPool *pool)
+{
+    UINTN new_count = pool->slot_count ? pool->slot_count * 2
+                                       : STRPOOL_MIN_SLOTS;
+    SbStrHdr **slots = sb_zalloc(SB_MEM_CORE, new_count * sizeof(*slots));
+    if (!slots)
+        return FALSE;
+
+    for (UINTN i = 0; i < pool->slot_count; i++) {
+        SbStrHdr *h = pool->slots[i];
+        if (!h)
+            continue;
+        UINTN j = h->hash & (new_count - 1);
+        while (slots[j])
+            j = (j + 1) & (new_count - 1);
+        slots[j] = h;
+    }
+
+    sb_free(pool->slots);
+    pool->slots = slots;
+    pool->slot_count = new_count;
+    return TRUE;
+}
+
+static const void *
+intern_bytes(SbStrPool *pool, const void *data, UINTN size)
+{
+    pool->lookups++;
+
+    /* Keep the load factor under 3/4. */
+    if ((pool->count + 1) * 4 > pool->slot_count * 3 && !grow_slots(pool))
+        return NULL;
+
+    UINT32 hash = hash_bytes(data, size);
+    UINTN  mask = pool->slot_count - 1;
+    UINTN  i    = hash & mask;
+
+    for (SbStrHdr *h; (h = pool->slots[i]) != NULL; i = (i + 1) & mask) {
+        if (h->hash == hash && h->size == size &&
+            CompareMem(h + 1, data, size) == 0)
+            return h + 1;
+    }
+
+    SbStrHdr *h = sb_strpool_alloc(pool, sizeof(SbStrHdr) + size);
+    if (!h)
+        return NULL;
+    h->hash = hash;
+    h->size = (UINT32)size;
+    CopyMem(h + 1, (void *)data, size);
+
+    pool->slots[i] = h;
+    pool->count++;
+    return h + 1;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Public API                                                         */
+/* ------------------------------------------------------------------ */
+
+void
+sb_strpool_init(SbStrPool *pool)
+{
+    SetMem(pool, sizeof(*pool), 0);
+    sb_arena_init(&pool->arena, STRPOOL_BLOCK_SIZE, SB_MEM_CORE);
+}
+
+void
+sb_strpool_free(SbStrPool *pool)
+{
+    sb_arena_release(&pool->arena);
+    sb_free(pool->slots);
+    SetMem(pool, sizeof(*pool), 0);
+}
+
+const CHAR8 *
+sb_intern8(SbStrPool *pool, const CHAR8 *s)
+{
+    return intern_bytes(pool, s, sb_strlen8(s) + 1);
+}
+
+const CHAR16 *
+sb_intern16(SbStrPool *pool, const CHAR16 *s)
+{
+    return intern_bytes(pool, s, (StrLen(s) + 1) * sizeof(CHAR16));
+}
+
+/*
+ * UTF-8 never takes fewer bytes than UTF-16 takes units, so the input
+ * length bounds the conversion.  Short strings convert on the stack;
+ * longer ones through a heap buffer, never truncated.
+ */
+const CHAR16 *
+sb_intern8to16(SbStrPool *pool, const CHAR8 *s)
+{
+    CHAR16 small[SB_MAX_PATH];
+    UINTN  max = sb_strlen8(s) + 1;
+    CHAR16 *wide = max <= SB_MAX_PATH
+                   ? small : sb_malloc(SB_MEM_CORE, max * sizeof(CHAR16));
+    if (!wide)
+        return NULL;
+
+    sb_str8to16(wide, s, max);
+    const CHAR16 *r = sb_intern16(pool, wide);
+    if (wide != small)
+        sb_free(wide);
+    return r;
+}
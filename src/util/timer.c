@@ -0,0 +1,46 @@
+/*
+ * timer.c — Monotonic microsecond clock
+ *
+ * UEFI has no cheap "what time is it" call: GetTime() is an RTC read
+ * with one-second resolution on many boards.  Instead we calibrate the
+ * TSC against BootServices->Stall() once at startup and derive
+ * microseconds from it.  Every x86_64 CPU that runs UEFI firmware has
+ * a constant-rate TSC, and reading it stays valid after
+ * ExitBootServices.
+ */
+
+#include "util.h"
+
+/* Calibration window.  Long enough to swamp Stall() entry overhead,
+ * short enough not to show up in time-to-menu. */
+#define SB_TIMER_CALIBRATE_US  2000
+
+static UINT64 tsc_base;
+static UINT64 tsc_per_us;
+
+static inline UINT64
+read_tsc(void)
+{
+    return __builtin_ia32_rdtsc();
+}
+
+void
+sb_timer_init(EFI_BOOT_SERVICES *bs)
+{
+    UINT64 t0 = read_tsc();
+    bs->Stall(SB_TIMER_CALIBRATE_US);
+    UINT64 t1 = read_tsc();
+
+    tsc_per_us = (t1 - t0) / SB_TIMER_CALIBRATE_US;
+    if (tsc_per_us == 0)
+        tsc_per_us = 1;
+    tsc_base = t0;
+}
+
+UINT64
+sb_time_us(void)
+{
+    if (tsc_per_us == 0)
+        return 0; /* Not calibrated yet. */
+    return (read_tsc() - tsc_base) / tsc_per_us;
+}
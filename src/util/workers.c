@@ -0,0 +1,254 @@
+/*
+ * workers.c — CPU worker pool on the application processors
+ *
+ * Everything in SuperBoot runs on the boot processor (BSP).  For work
+ * that is pure computation over memory — hashing, decompression,
+ * checksums, parsing buffers already read — the other cores can help.
+ * EFI_MP_SERVICES_PROTOCOL lets us run a procedure on every enabled
+ * application processor (AP); we start each AP once in a loop that
+ * pulls jobs from a shared queue, and stop them again before hand-off.
+ *
+ * Rules for job functions, since they may run on an AP:
+ *   - no firmware calls of any kind (no Print, no allocation, no I/O,
+ *     no protocol use); gather inputs on the BSP first
+ *   - no sb_malloc / sb_free (the allocator is not thread-safe)
+ *   - modest stack use: firmware AP stacks are typically 32 KiB
+ *   - touch only the job's own buffers
+ *
+ * Firmware-calling work stays on the BSP: sb_workers_submit() returns
+ * immediately, the BSP can read the next file while the APs compute,
+ * and sb_workers_wait() has the BSP help drain the queue.
+ *
+ * Without MP Services (or with a single CPU) every job simply runs on
+ * the BSP inside sb_workers_wait().
+ */
+
+#include "util.h"
+
+/* ------------------------------------------------------------------ */
+/*  EFI_MP_SERVICES_PROTOCOL (PI spec vol. 2, 13.4)                    */
+/*                                                                     */
+/*  Declared locally: not all gnu-efi releases carry it.               */
+/* ------------------------------------------------------------------ */
+
+#define SB_MP_SERVICES_PROTOCOL_GUID \
+    { 0x3fdda605, 0xa76e, 0x4f46, \
+      { 0xad, 0x29, 0x12, 0xf4, 0x53, 0x1b, 0x3d, 0x08 } }
+
+typedef VOID (EFIAPI *SB_AP_PROCEDURE)(VOID *Buffer);
+
+typedef struct _SB_MP_SERVICES_PROTOCOL SB_MP_SERVICES_PROTOCOL;
+
+struct _SB_MP_SERVICES_PROTOCOL {
+    EFI_STATUS (EFIAPI *GetNumberOfProcessors)(
+        SB_MP_SERVICES_PROTOCOL *This,
+        UINTN *NumberOfProcessors, UINTN *NumberOfEnabledProcessors);
+    EFI_STATUS (EFIAPI *GetProcessorInfo)(
+        SB_MP_SERVICES_PROTOCOL *This, UINTN ProcessorNumber,
+        VOID *ProcessorInfoBuffer);
+    EFI_STATUS (EFIAPI *StartupAllAPs)(
+        SB_MP_SERVICES_PROTOCOL *This, SB_AP_PROCEDURE Procedure,
+        BOOLEAN SingleThread, EFI_EVENT WaitEvent,
+        UINTN TimeoutInMicroSeconds, VOID *ProcedureArgument,
+        UINTN **FailedCpuList);
+    EFI_STATUS (EFIAPI *StartupThisAP)(
+        SB_MP_SERVICES_PROTOCOL *This, SB_AP_PROCEDURE Procedure,
+        UINTN ProcessorNumber, EFI_EVENT WaitEvent,
+        UINTN TimeoutInMicroseconds, VOID *ProcedureArgument,
+        BOOLEAN *Finished);
+    EFI_STATUS (EFIAPI *SwitchBSP)(
+        SB_MP_SERVICES_PROTOCOL *This, UINTN ProcessorNumber,
+        BOOLEAN EnableOldBSP);
+    EFI_STATUS (EFIAPI *EnableDisableAP)(
+        SB_MP_SERVICES_PROTOCOL *This, UINTN ProcessorNumber,
+        BOOLEAN EnableAP, UINT32 *HealthFlag);
+    EFI_STATUS (EFIAPI *WhoAmI)(
+        SB_MP_SERVICES_PROTOCOL *This, UINTN *ProcessorNumber);
+};
+
+static EFI_GUID MpServicesProtocolGuid = SB_MP_SERVICES_PROTOCOL_GUID;
+
+/* How long sb_workers_stop() waits for the firmware to report the APs
+ * idle.  EDK2 polls AP state every 100 ms. */
+#define WORKERS_STOP_TIMEOUT_MS  1000
+
+/* ------------------------------------------------------------------ */
+/*  Pool state                                                         */
+/*                                                                     */
+/*  A batch is published by storing `count` last.  A worker announces  */
+/*  itself in `busy` before it looks at the batch, so once the BSP has */
+/*  cleared `count` and seen `busy` drop to zero no AP can still hold  */
+/*  an index into the old job array.                                   */
+/* ------------------------------------------------------------------ */
+
+static SuperBootContext        *pool_ctx;
+static SB_MP_SERVICES_PROTOCOL *mp;
+static UINTN                    ap_count;
+static EFI_EVENT                ap_done_event;
+static BOOLEAN                  running;
+
+static struct {
+    SbJob          *jobs;
+    volatile UINTN  count;
+    volatile UINTN  next;
+    volatile UINTN  done;
+    volatile UINTN  busy;
+    volatile UINTN  quit;
+} batch;
+
+static inline void
+cpu_relax(void)
+{
+    __builtin_ia32_pause();
+}
+
+/* Claim and run one job.  Returns FALSE if there was nothing to do. */
+static BOOLEAN
+run_one(void)
+{
+    BOOLEAN ran = FALSE;
+
+    __atomic_fetch_add(&batch.busy, 1, __ATOMIC_SEQ_CST);
+    UINTN count = __atomic_load_n(&batch.count, __ATOMIC_SEQ_CST);
+    if (count) {
+        UINTN i = __atomic_fetch_add(&batch.next, 1, __ATOMIC_SEQ_CST);
+        if (i < count) {
+            batch.jobs[i].run(batch.jobs[i].arg);
+            __atomic_fetch_add(&batch.done, 1, __ATOMIC_SEQ_CST);
+            ran = TRUE;
+        }
+    }
+    __atomic_fetch_sub(&batch.busy, 1, __ATOMIC_SEQ_CST);
+    return ran;
+}
+
+static VOID EFIAPI
+ap_main(VOID *arg)
+{
+    (void)arg;
+    while (!__atomic_load_n(&batch.quit, __ATOMIC_SEQ_CST)) {
+        if (!run_one())
+            cpu_relax();
+    }
+}
+
+/* ------------------------------------------------------------------ */
+/*  Public API                                                         */
+/* ------------------------------------------------------------------ */
+
+UINTN
+sb_workers_init(SuperBootContext *ctx)
+{
+    pool_ctx = ctx;
+
+    SB_MP_SERVICES_PROTOCOL *p;
+    EFI_STATUS status = ctx->boot_services->LocateProtocol(
+                            &MpServicesProtocolGuid, NULL, (void **)&p);
+    if (EFI_ERROR(status)) {
+        SB_DBG(ctx, L"No MP Services; worker jobs run on the BSP");
+        return 1;
+    }
+
+    UINTN total = 0, enabled = 0;
+    status = p->GetNumberOfProcessors(p, &total, &enabled);
+    if (EFI_ERROR(status) || enabled < 2)
+        return 1;
+
+    status = ctx->boot_services->CreateEvent(0, 0, NULL, NULL,
+                                             &ap_done_event);
+    if (EFI_ERROR(status))
+        return 1;
+
+    mp       = p;
+    ap_count = enabled - 1;
+    SB_DBG(ctx, L"MP Services: %u of %u processors enabled",
+           enabled, total);
+    return enabled;
+}
+
+/*
+ * Put the APs to work.  Until sb_workers_stop() they spin on the job
+ * queue, so start the pool only around a stretch of parallel work.
+ */
+EFI_STATUS
+sb_workers_start(void)
+{
+    if (!mp)
+        return EFI_UNSUPPORTED;
+    if (running)
+        return EFI_SUCCESS;
+
+    batch.count = 0;
+    batch.quit  = 0;
+
+    EFI_STATUS status = mp->StartupAllAPs(mp, ap_main, FALSE,
+                                          ap_done_event, 0, NULL, NULL);
+    if (EFI_ERROR(status)) {
+        SB_DBG(pool_ctx, L"StartupAllAPs: %r", status);
+        return status;
+    }
+    running = TRUE;
+    return EFI_SUCCESS;
+}
+
+void
+sb_workers_stop(void)
+{
+    if (!running)
+        return;
+
+    __atomic_store_n(&batch.quit, 1, __ATOMIC_SEQ_CST);
+
+    /* The APs return at once; wait for the firmware to notice, so the
+     * next StartupAllAPs (or the OS) finds them idle. */
+    for (UINTN ms = 0; ms < WORKERS_STOP_TIMEOUT_MS; ms++) {
+        if (pool_ctx->boot_services->CheckEvent(ap_done_event) ==
+            EFI_SUCCESS)
+            break;
+        pool_ctx->boot_services->Stall(1000);
+    }
+    running = FALSE;
+}
+
+/* Number of CPUs that will run jobs right now, BSP included. */
+UINTN
+sb_workers_count(void)
+{
+    return running ? ap_count + 1 : 1;
+}
+
+/*
+ * Hand `count` jobs to the APs and return immediately.  The job array
+ * must stay valid until sb_workers_wait().  One batch at a time.
+ */
+void
+sb_workers_submit(SbJob *jobs, UINTN count)
+{
+    batch.jobs = jobs;
+    batch.next = 0;
+    batch.done = 0;
+    __atomic_store_n(&batch.count, count, __ATOMIC_SEQ_CST);
+}
+
+/* Help finish the current batch on the BSP and wait for the rest. */
+void
+sb_workers_wait(void)
+{
+    UINTN count = __atomic_load_n(&batch.count, __ATOMIC_SEQ_CST);
+
+    while (run_one())
+        ;
+    while (__atomic_load_n(&batch.done, __ATOMIC_SEQ_CST) < count)
+        cpu_relax();
+
+    __atomic_store_n(&batch.count, 0, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&batch.busy, __ATOMIC_SEQ_CST))
+        cpu_relax();
+}
+
+void
+sb_workers_run(SbJob *jobs, UINTN count)
+{
+    sb_workers_submit(jobs, count);
+    sb_workers_wait();
+}
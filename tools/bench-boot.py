@@ -0,0 +1,221 @@
+#!/usr/bin/env python3
+#
+# bench-boot.py — Time SuperBoot under QEMU/OVMF and summarise as CSV
+#
+# Usage:
+#   ./tools/bench-boot.py [options] IMAGE...
+#   ./tools/bench-boot.py --compare OLD.csv NEW.csv
+#
+# Boots each disk image (see tools/bench-images.sh) headless RUNS times
+# and drives it over the automation port (src/tui/control.c): wait for
+# the scan, boot the first entry, stop QEMU at the "handoff" mark.  The
+# times come from the "@sb mark" lines SuperBoot sends, in µs since it
+# started, plus the host's clock for the firmware's share:
+#
+#   firmware    QEMU start to SuperBoot's "ready" line (host clock)
+#   menu        SuperBoot start to the first menu frame
+#   scan        scan-start to scan-done
+#   load        "boot" command to kernel entry (kernel, initrds, checks)
+#   kernel      SuperBoot start to kernel entry
+#
+# One CSV row per image and metric, in milliseconds, with the commit
+# being measured so files from different commits can be concatenated
+# or compared (--compare prints the change in each median).
+#
+# Only the Python standard library is required.
+
+import argparse
+import csv
+import os
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from sbctl import Control  # noqa: E402
+
+METRICS = ("firmware", "menu", "scan", "load", "kernel")
+FIELDS = ("commit", "image", "metric", "runs", "median_ms", "mean_ms",
+          "variance", "stdev_ms", "min_ms", "max_ms")
+
+
+def commit_id():
+    try:
+        rev = subprocess.run(["git", "describe", "--always", "--dirty"],
+                             capture_output=True, text=True, check=True)
+        return rev.stdout.strip()
+    except (OSError, subprocess.CalledProcessError):
+        return "unknown"
+
+
+def boot_once(args, image, workdir):
+    """Boot `image` once; return {metric: ms} or raise on failure."""
+    sock = os.path.join(workdir, "control.sock")
+    log = os.path.splitext(image)[0] + ".console.log"   # last run's
+    if os.path.exists(sock):
+        os.unlink(sock)
+
+    cmd = [args.qemu,
+           "-bios", args.ovmf,
+           "-drive", "file=%s,format=raw,snapshot=on" % image,
+           "-net", "none",
+           "-m", args.memory,
+           "-smp", str(args.smp),
+           "-display", "none",
+           "-serial", "file:%s" % log,
+           "-serial", "unix:%s,server=on,wait=on" % sock]
+    if args.kvm:
+        cmd += ["-enable-kvm", "-cpu", "host"]
+
+    start = time.monotonic()
+    qemu = subprocess.Popen(cmd, stdin=subprocess.DEVNULL,
+                            stdout=subprocess.DEVNULL,
+                            stderr=subprocess.PIPE)
+    try:
+        # With wait=on the guest does not start until we are connected,
+        # so nothing SuperBoot sends is missed.
+        deadline = start + 10
+        while not os.path.exists(sock):
+            if qemu.poll() is not None or time.monotonic() > deadline:
+                raise RuntimeError("QEMU did not start: %s" %
+                                   qemu.stderr.read().decode().strip())
+            time.sleep(0.01)
+
+        marks = {}
+
+        def on_line(kind, fields, raw):
+            if kind == "mark":
+                marks[fields["name"]] = fields["t"] / 1000.0
+
+        ctl = Control(sock, timeout=args.timeout, on_line=on_line)
+        start = time.monotonic()
+        ctl.wait_for("ready", timeout=args.timeout)
+        firmware = (time.monotonic() - start) * 1000.0
+
+        ok, _ = ctl.command("wait", timeout=args.timeout)
+        if ok:
+            ok, _ = ctl.command("boot 0", timeout=args.timeout)
+        if not ok:
+            raise RuntimeError("SuperBoot refused to boot (see %s)" % log)
+        if "handoff" not in marks:
+            ctl.wait_for("mark", timeout=args.timeout, name="handoff")
+    finally:
+        qemu.kill()
+        qemu.wait()
+
+    return {
+        "firmware": firmware,
+        "menu":     marks["menu"],
+        "scan":     marks["scan-done"] - marks["scan-start"],
+        "load":     marks["handoff"] - marks["boot"],
+        "kernel":   marks["handoff"],
+    }
+
+
+def summarise(commit, image, samples):
+    rows = []
+    for metric in METRICS:
+        values = [s[metric] for s in samples if metric in s]
+        if not values:
+            continue
+        rows.append({
+            "commit":    commit,
+            "image":     image,
+            "metric":    metric,
+            "runs":      len(values),
+            "median_ms": "%.2f" % statistics.median(values),
+            "mean_ms":   "%.2f" % statistics.mean(values),
+            "variance":  "%.3f" % (statistics.variance(values)
+                                   if len(values) > 1 else 0.0),
+            "stdev_ms":  "%.2f" % (statistics.stdev(values)
+                                   if len(values) > 1 else 0.0),
+            "min_ms":    "%.2f" % min(values),
+            "max_ms":    "%.2f" % max(values),
+        })
+    return rows
+
+
+def compare(old_path, new_path):
+    def load(path):
+        with open(path, newline="") as f:
+            return {(r["image"], r["metric"]): r for r in csv.DictReader(f)}
+
+    old, new = load(old_path), load(new_path)
+    print("%-16s %-9s %11s %11s %8s" %
+          ("image", "metric", "old ms", "new ms", "change"))
+    for key in sorted(new):
+        if key not in old:
+            continue
+        a = float(old[key]["median_ms"])
+        b = float(new[key]["median_ms"])
+        change = "%+7.1f%%" % ((b - a) * 100.0 / a) if a else "      -"
+        print("%-16s %-9s %11.2f %11.2f %8s" % (key[0], key[1], a, b, change))
+    return 0
+
+
+def find_ovmf():
+    for path in ("/usr/share/edk2/x64/OVMF.fd",
+                 "/usr/share/OVMF/OVMF_CODE.fd",
+                 "/usr/share/ovmf/OVMF.fd"):
+        if os.path.exists(path):
+            return path
+    return None
+
+
+def main():
+    ap = argparse.ArgumentParser(
+        description="Time SuperBoot under QEMU/OVMF and write a CSV.")
+    ap.add_argument("images", nargs="*", help="disk images to boot")
+    ap.add_argument("--runs", type=int, default=5)
+    ap.add_argument("--out", help="CSV file (default: stdout)")
+    ap.add_argument("--ovmf", default=find_ovmf())
+    ap.add_argument("--qemu", default="qemu-system-x86_64")
+    ap.add_argument("--memory", default="1G")
+    ap.add_argument("--smp", type=int, default=4)
+    ap.add_argument("--kvm", action="store_true",
+                    help="use KVM (less noise, but not comparable "
+                         "with TCG results)")
+    ap.add_argument("--timeout", type=float, default=120.0,
+                    help="seconds to wait for each step")
+    ap.add_argument("--compare", nargs=2, metavar=("OLD", "NEW"),
+                    help="print the change in median between two CSVs")
+    args = ap.parse_args()
+
+    if args.compare:
+        return compare(*args.compare)
+    if not args.images:
+        ap.error("no images given")
+    if not args.ovmf:
+        ap.error("OVMF not found; pass --ovmf")
+
+    commit = commit_id()
+    rows, failed = [], False
+    with tempfile.TemporaryDirectory(prefix="bench-boot.") as workdir:
+        for image in args.images:
+            name = os.path.splitext(os.path.basename(image))[0]
+            samples = []
+            for run in range(args.runs):
+                try:
+                    samples.append(boot_once(args, image, workdir))
+                except (RuntimeError, OSError, EOFError, KeyError) as e:
+                    print("%s run %d: %s" % (name, run, e), file=sys.stderr)
+                    failed = True
+                    continue
+                print("%s run %d: kernel entry at %.1f ms" %
+                      (name, run, samples[-1]["kernel"]), file=sys.stderr)
+            rows += summarise(commit, name, samples)
+
+    out = open(args.out, "w", newline="") if args.out else sys.stdout
+    writer = csv.DictWriter(out, fieldnames=FIELDS)
+    writer.writeheader()
+    writer.writerows(rows)
+    if args.out:
+        out.close()
+        print("==> %s" % args.out, file=sys.stderr)
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
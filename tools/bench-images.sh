@@ -0,0 +1,293 @@
+#!/usr/bin/env bash
+#
+# bench-images.sh — Build the disk images `make bench-boot` times
+#
+# Usage:
+#   ./tools/bench-images.sh [superboot.efi] [OUTDIR] [KERNEL]
+#
+# Writes one GPT disk image per layout to OUTDIR (default build/bench),
+# each with a FAT32 ESP holding SuperBoot and options.txt ("control"),
+# plus:
+#
+#   ext4-grub       ext4 /boot with grub.cfg
+#   btrfs-sdboot    btrfs /boot with loader.conf and loader/entries
+#   xfs-limine      xfs /boot with limine.cfg
+#   many-parts      32 empty ext4 partitions before the one with grub.cfg
+#   large-initrd    ext4-grub with a $LARGE_INITRD_MB MiB initrd
+#   fragmented      ext4-grub with the kernel and initrd scattered
+#                   across the free space left by deleted files
+#
+# KERNEL must be a bzImage with an EFI handover entry (default: the
+# first readable /boot/vmlinuz*); the initrds are random data, as the
+# benchmark stops at kernel entry.  Layouts whose mkfs is missing are
+# skipped with a warning.
+#
+# No root needed: each partition is made as a file and copied into the
+# disk image at its offset.  The partition images other than the ESP
+# are kept in OUTDIR/parts and reused; remove OUTDIR to rebuild them.
+#
+# Requires: sfdisk, mkfs.fat, mtools, mkfs.ext4 and debugfs (e2fsprogs);
+# mkfs.btrfs and mkfs.xfs for their layouts.
+
+set -euo pipefail
+
+EFI_BINARY="${1:-build/superboot.efi}"
+OUTDIR="${2:-build/bench}"
+KERNEL="${3:-}"
+INITRD_MB="${INITRD_MB:-32}"
+LARGE_INITRD_MB="${LARGE_INITRD_MB:-384}"
+MANY_PARTS="${MANY_PARTS:-32}"
+
+if [ ! -f "$EFI_BINARY" ]; then
+    echo "Error: $EFI_BINARY not found. Run 'make' first."
+    exit 1
+fi
+
+if [ -z "$KERNEL" ]; then
+    for k in /boot/vmlinuz*; do
+        if [ -r "$k" ] && [ -f "$k" ]; then
+            KERNEL="$k"
+            break
+        fi
+    done
+fi
+if [ -z "$KERNEL" ] || [ ! -r "$KERNEL" ]; then
+    echo "Error: no readable kernel; pass one, e.g. BENCH_KERNEL=path/to/bzImage."
+    exit 1
+fi
+
+PARTS="$OUTDIR/parts"
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+mkdir -p "$PARTS"
+
+have() { command -v "$1" >/dev/null 2>&1; }
+
+# ---- /boot contents ----------------------------------------------------
+
+CMDLINE="console=ttyS0 panic=-1"
+
+# populate DIR CONFIG INITRD_MB: kernel, initrd and one bootloader config.
+populate() {
+    local dir="$1" config="$2" initrd_mb="$3"
+    mkdir -p "$dir"
+    cp "$KERNEL" "$dir/vmlinuz-bench"
+    head -c "$((initrd_mb * 1024 * 1024))" /dev/urandom > "$dir/initrd-bench.img"
+
+    case "$config" in
+    grub)
+        mkdir -p "$dir/grub"
+        {
+            echo "set default=0"
+            echo "set timeout=30"
+            for i in 0 1 2; do
+                echo "menuentry 'Bench Linux $i' --class gnu-linux {"
+                echo "    linux /vmlinuz-bench $CMDLINE bench.entry=$i"
+                echo "    initrd /initrd-bench.img"
+                echo "}"
+            done
+        } > "$dir/grub/grub.cfg"
+        ;;
+    sdboot)
+        mkdir -p "$dir/loader/entries"
+        printf 'default bench-0.conf\ntimeout 30\n' > "$dir/loader/loader.conf"
+        for i in 0 1 2; do
+            {
+                echo "title   Bench Linux $i"
+                echo "version 6.$i.0"
+                echo "linux   /vmlinuz-bench"
+                echo "initrd  /initrd-bench.img"
+                echo "options $CMDLINE bench.entry=$i"
+            } > "$dir/loader/entries/bench-$i.conf"
+        done
+        ;;
+    limine)
+        {
+            echo "timeout: 30"
+            for i in 0 1 2; do
+                echo "/Bench Linux $i"
+                echo "    protocol: linux"
+                echo "    kernel_path: boot():/vmlinuz-bench"
+                echo "    kernel_cmdline: $CMDLINE bench.entry=$i"
+                echo "    module_path: boot():/initrd-bench.img"
+            done
+        } > "$dir/limine.cfg"
+        ;;
+    esac
+}
+
+# ---- Partition images ----------------------------------------------------
+
+# Size in MiB for a filesystem holding DIR, with room to spare.
+size_for() {
+    local mb
+    mb=$(du -sm "$1" | cut -f1)
+    echo $((mb + mb / 4 + 64))
+}
+
+make_esp() {
+    local out="$1"
+    rm -f "$out"
+    truncate -s 64M "$out"
+    mkfs.fat -F 32 -n SUPERBOOT "$out" >/dev/null
+    mmd -i "$out" ::/EFI ::/EFI/BOOT ::/EFI/superboot
+    mcopy -i "$out" "$EFI_BINARY" ::/EFI/BOOT/BOOTX64.EFI
+    echo "control" > "$WORK/options.txt"
+    mcopy -i "$out" "$WORK/options.txt" ::/EFI/superboot/options.txt
+}
+
+make_ext4() {
+    local out="$1" dir="$2" mb="${3:-}"
+    mkfs.ext4 -q -F -L bench-boot -d "$dir" "$out" "${mb:-$(size_for "$dir")}M" >/dev/null
+}
+
+make_btrfs() {
+    local out="$1" dir="$2" mb
+    mb=$(size_for "$dir")
+    [ "$mb" -ge 128 ] || mb=128
+    rm -f "$out"
+    truncate -s "${mb}M" "$out"
+    mkfs.btrfs -q -f -L bench-boot --rootdir "$dir" "$out" >/dev/null
+}
+
+# mkfs.xfs only populates from a prototype file: one line per entry,
+# directories closed by "$".
+xfs_proto() {
+    local dir="$1" name
+    for path in "$dir"/*; do
+        name=$(basename "$path")
+        if [ -d "$path" ]; then
+            echo "$name d--755 0 0"
+            xfs_proto "$path"
+            echo "\$"
+        else
+            echo "$name ---644 0 0 $path"
+        fi
+    done
+}
+
+make_xfs() {
+    local out="$1" dir="$2" mb
+    mb=$(size_for "$dir")
+    [ "$mb" -ge 320 ] || mb=320     # mkfs.xfs refuses anything smaller
+    {
+        echo "/dev/null"
+        echo "0 0"
+        echo "d--755 0 0"
+        xfs_proto "$dir"
+        echo "\$"
+    } > "$WORK/xfs.proto"
+    rm -f "$out"
+    truncate -s "${mb}M" "$out"
+    mkfs.xfs -q -f -L bench-boot -p "$WORK/xfs.proto" "$out"
+}
+
+# An ext4 /boot whose kernel and initrd land in the holes between
+# surviving filler files: fill the filesystem with small files, delete
+# every other one, then write the two files with debugfs.
+make_fragmented() {
+    local out="$1" dir="$2" fill="$WORK/filler" n i
+    local kernel_kb initrd_kb
+    kernel_kb=$(( $(stat -c%s "$dir/vmlinuz-bench") / 1024 ))
+    initrd_kb=$(( $(stat -c%s "$dir/initrd-bench.img") / 1024 ))
+    n=$(( (kernel_kb + initrd_kb) / 64 + 64 ))
+
+    mkdir -p "$fill/fill"
+    cp -r "$dir/grub" "$fill/"
+    head -c 65536 /dev/urandom > "$WORK/block"     # zeroes would be sparse
+    for i in $(seq 0 $((2 * n - 1))); do
+        cp "$WORK/block" "$fill/fill/$i"
+    done
+    make_ext4 "$out" "$fill" $(( (2 * n * 64 + kernel_kb + initrd_kb) / 1024 + 64 ))
+
+    {
+        for i in $(seq 0 2 $((2 * n - 1))); do
+            echo "rm /fill/$i"
+        done
+        echo "write $dir/vmlinuz-bench vmlinuz-bench"
+        echo "write $dir/initrd-bench.img initrd-bench.img"
+    } > "$WORK/frag.cmd"
+    debugfs -w -f "$WORK/frag.cmd" "$out" >/dev/null 2>&1
+    echo "    initrd extents: $(debugfs -R 'ex /initrd-bench.img' "$out" 2>/dev/null | grep -c '^ *[0-9]/')" >&2
+}
+
+# part NAME BUILDER CONFIG INITRD_MB: a cached /boot partition image.
+part() {
+    local name="$1" builder="$2" config="$3" initrd_mb="$4"
+    local out="$PARTS/$name.img"
+    if [ ! -f "$out" ]; then
+        echo "==> Building $name" >&2
+        rm -rf "$WORK/$name"
+        populate "$WORK/$name" "$config" "$initrd_mb"
+        "$builder" "$out.tmp" "$WORK/$name"
+        mv "$out.tmp" "$out"
+    fi
+    echo "$out"
+}
+
+# ---- Disk images -------------------------------------------------------
+
+# disk OUTPUT PART...: a GPT disk with the ESP first, then each PART
+# (or "empty:MiB" for a blank ext4 partition) as a Linux partition.
+disk() {
+    local output="$1"
+    shift
+    local files=("$PARTS/esp.img") off=1 total table="$WORK/table"
+
+    for p in "$@"; do
+        case "$p" in
+        empty:*)
+            local e="$PARTS/empty-${p#empty:}.img"
+            [ -f "$e" ] || mkfs.ext4 -q -F -L empty "$e" "${p#empty:}M" >/dev/null
+            files+=("$e")
+            ;;
+        *)  files+=("$p") ;;
+        esac
+    done
+
+    echo "label: gpt" > "$table"
+    for f in "${files[@]}"; do
+        local mb=$(( ($(stat -c%s "$f") + 1048575) / 1048576 ))
+        local type=L
+        [ "$f" = "$PARTS/esp.img" ] && type=U
+        echo "start=${off}MiB, size=${mb}MiB, type=$type" >> "$table"
+        off=$((off + mb))
+    done
+    total=$((off + 1))
+
+    rm -f "$output"
+    truncate -s "${total}M" "$output"
+    sfdisk -q "$output" < "$table"
+
+    off=1
+    for f in "${files[@]}"; do
+        dd if="$f" of="$output" bs=1M seek="$off" conv=notrunc,sparse status=none
+        off=$((off + ($(stat -c%s "$f") + 1048575) / 1048576))
+    done
+    echo "==> $output"
+}
+
+make_esp "$PARTS/esp.img"
+
+disk "$OUTDIR/ext4-grub.img" "$(part ext4-grub make_ext4 grub "$INITRD_MB")"
+
+if have mkfs.btrfs; then
+    disk "$OUTDIR/btrfs-sdboot.img" "$(part btrfs-sdboot make_btrfs sdboot "$INITRD_MB")"
+else
+    echo "warning: mkfs.btrfs not found, skipping btrfs-sdboot"
+fi
+
+if have mkfs.xfs; then
+    disk "$OUTDIR/xfs-limine.img" "$(part xfs-limine make_xfs limine "$INITRD_MB")"
+else
+    echo "warning: mkfs.xfs not found, skipping xfs-limine"
+fi
+
+empties=()
+for _ in $(seq 1 "$MANY_PARTS"); do
+    empties+=("empty:8")
+done
+disk "$OUTDIR/many-parts.img" "${empties[@]}" "$(part ext4-grub make_ext4 grub "$INITRD_MB")"
+
+disk "$OUTDIR/large-initrd.img" "$(part large-initrd make_ext4 grub "$LARGE_INITRD_MB")"
+disk "$OUTDIR/fragmented.img" "$(part fragmented make_fragmented grub "$INITRD_MB")"
@@ -0,0 +1,153 @@
+/*
+ * decomp-bench.c — Host benchmark for the kernel decompressors
+ *
+ * Usage:
+ *   make bench-decomp
+ *   ./build/decomp-bench FILE [REFERENCE] [ITERATIONS]
+ *
+ * FILE is a gzip or zstd stream (e.g. vmlinux.bin.gz, or a zboot
+ * payload cut out with dd).  It is fed to the decoder in 256 KiB
+ * pieces, as sb_kernel_read() does, and the best of ITERATIONS runs
+ * (default 5) is reported in MiB/s of output.  With REFERENCE the
+ * output is also compared against it byte for byte.
+ *
+ * The decoders are the same sources the firmware build uses
+ * (src/boot/inflate.c, src/boot/unzstd.c); they need nothing from
+ * the firmware, so they build against the host C library here.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "boot/decompress.h"
+
+#define CHUNK  (256 * 1024)
+
+typedef struct {
+    SbInStream     in;
+    const UINT8   *data;
+    size_t         size;
+    size_t         pos;
+} HostStream;
+
+static BOOLEAN
+host_refill(SbInStream *in)
+{
+    HostStream *h = (HostStream *)in;
+    if (h->pos >= h->size)
+        return FALSE;
+    size_t n = h->size - h->pos < CHUNK ? h->size - h->pos : CHUNK;
+    in->next = h->data + h->pos;
+    in->end  = in->next + n;
+    h->pos  += n;
+    return TRUE;
+}
+
+static UINT8 *
+read_all(const char *path, size_t *size)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    *size = (size_t)ftell(f);
+    rewind(f);
+    UINT8 *buf = malloc(*size ? *size : 1);
+    if (buf && fread(buf, 1, *size, f) != *size) {
+        perror(path);
+        free(buf);
+        buf = NULL;
+    }
+    fclose(f);
+    return buf;
+}
+
+static double
+now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+int
+main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s FILE [REFERENCE] [ITERATIONS]\n",
+                argv[0]);
+        return 2;
+    }
+
+    size_t in_size, ref_size = 0;
+    UINT8 *in = read_all(argv[1], &in_size);
+    UINT8 *ref = argc > 2 ? read_all(argv[2], &ref_size) : NULL;
+    int iterations = argc > 3 ? atoi(argv[3]) : 5;
+    if (!in || (argc > 2 && !ref))
+        return 1;
+
+    BOOLEAN gzip = in_size >= 2 && in[0] == 0x1F && in[1] == 0x8B;
+    BOOLEAN zstd = in_size >= 4 && in[0] == 0x28 && in[1] == 0xB5 &&
+                   in[2] == 0x2F && in[3] == 0xFD;
+    if (!gzip && !zstd) {
+        fprintf(stderr, "%s: not a gzip or zstd stream\n", argv[1]);
+        return 1;
+    }
+
+    /* Output size as sb_kernel_read() would find it. */
+    size_t cap;
+    if (ref)
+        cap = ref_size;
+    else if (gzip)
+        cap = in_size >= 4 ? (size_t)in[in_size - 4] |
+                             (size_t)in[in_size - 3] << 8 |
+                             (size_t)in[in_size - 2] << 16 |
+                             (size_t)in[in_size - 1] << 24 : 0;
+    else
+        cap = (size_t)sb_unzstd_content_size(in, in_size);
+    if (cap == 0)
+        cap = in_size * 8;
+
+    void  *work = malloc(gzip ? sb_gunzip_workspace()
+                              : sb_unzstd_workspace());
+    UINT8 *out  = malloc(cap ? cap : 1);
+    if (!work || !out)
+        return 1;
+
+    double best = 0;
+    UINTN out_len = 0;
+    for (int i = 0; i < iterations; i++) {
+        HostStream h = { { NULL, NULL, host_refill }, in, in_size, 0 };
+
+        double t0 = now_s();
+        EFI_STATUS s = gzip ? sb_gunzip(work, &h.in, out, cap, &out_len)
+                            : sb_unzstd(work, &h.in, out, cap, &out_len);
+        double t = now_s() - t0;
+
+        if (EFI_ERROR(s)) {
+            fprintf(stderr, "%s: decoder status 0x%llx\n", argv[1],
+                    (unsigned long long)s);
+            return 1;
+        }
+        if (i == 0 || t < best)
+            best = t;
+    }
+
+    printf("%s: %s %zu -> %llu bytes, %.1f MiB/s (best of %d)\n",
+           argv[1], gzip ? "gzip" : "zstd", in_size,
+           (unsigned long long)out_len,
+           (double)out_len / (1024.0 * 1024.0) / best, iterations);
+
+    if (ref) {
+        if (out_len != ref_size || memcmp(out, ref, ref_size) != 0) {
+            printf("%s: output differs from %s\n", argv[1], argv[2]);
+            return 1;
+        }
+        printf("%s: matches %s\n", argv[1], argv[2]);
+    }
+    return 0;
+}
@@ -0,0 +1,973 @@
+/*
+ * iotrace-replay.c — Replay a boot I/O trace through the real drivers
+ *
+ * Usage:
+ *   make iotrace-replay
+ *   ./build/iotrace-replay [-e ENTRY] [-o OUT] [-v] TRACE DEV=IMAGE...
+ *
+ * TRACE is a trace recorded with the "iotrace" load option, and each
+ * IMAGE the metadata image `tools/iotrace.py capture` made of trace
+ * device DEV.  iotrace.py replays the recorded requests as they were;
+ * this runs the scan, then the kernel and initrd reads of the entry
+ * the menu would boot (or ENTRY), through vfs.c, sfs.c, the selected
+ * filesystem drivers and config parsers and the kernel reader, all
+ * built for the host unchanged.  A change to any of them shows up as
+ * a different request stream and a different device time.
+ *
+ * A stand-in firmware serves each image through Block I/O, and Disk
+ * I/O where the trace shows the firmware had it.  Every request costs
+ * the latency fitted to that device's recorded requests, a + b * length,
+ * on a simulated clock; CPU time is not modelled.  -o writes the
+ * replayed requests as a trace, for `iotrace.py dump` or its cache and
+ * merge models; -v lists them.
+ *
+ * An unchanged build reproduces the recorded stream, which the output
+ * confirms, CRCs included.  Reads outside the captured ranges see
+ * zeros: a change that reads metadata SuperBoot never read before
+ * needs a capture taken with it.  Files on filesystems the firmware
+ * reads itself (the ESP) are not in the trace and are not replayed.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "superboot.h"
+#include "fs/vfs.h"
+#include "fs/iotrace.h"
+#include "fs/nvme.h"
+#include "boot/decompress.h"
+
+/* ------------------------------------------------------------------ */
+/*  The library calls the sources make                                 */
+/* ------------------------------------------------------------------ */
+
+EFI_GUID gEfiBlockIoProtocolGuid =
+    { 0x964e5b21, 0x6459, 0x11d2, { 0x8e, 0x39, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } };
+EFI_GUID gEfiDiskIoProtocolGuid =
+    { 0xce345171, 0xba0b, 0x11d2, { 0x8e, 0x4f, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } };
+EFI_GUID gEfiSimpleFileSystemProtocolGuid =
+    { 0x964e5b22, 0x6459, 0x11d2, { 0x8e, 0x39, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } };
+EFI_GUID gEfiLoadedImageProtocolGuid =
+    { 0x5b1b31a1, 0x9562, 0x11d2, { 0x8e, 0x3f, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } };
+EFI_GUID gEfiFileInfoGuid =
+    { 0x09576e92, 0x6d3f, 0x11d2, { 0x8e, 0x39, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } };
+EFI_GUID gEfiFileSystemInfoGuid =
+    { 0x09576e93, 0x6d3f, 0x11d2, { 0x8e, 0x39, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } };
+EFI_GUID gEfiFileSystemVolumeLabelInfoIdGuid =
+    { 0xdb47d7d3, 0xfe81, 0x11d3, { 0x9a, 0x35, 0x00, 0x90, 0x27, 0x3f, 0xc1, 0x4d } };
+
+INTN
+CompareGuid(EFI_GUID *a, EFI_GUID *b)
+{
+    return memcmp(a, b, sizeof(EFI_GUID));
+}
+
+VOID SetMem(VOID *b, UINTN n, UINT8 v)            { memset(b, v, n); }
+VOID CopyMem(VOID *d, VOID *s, UINTN n)           { memmove(d, s, n); }
+VOID FreePool(VOID *p)                            { free(p); }
+INTN CompareMem(const VOID *a, const VOID *b, UINTN n)
+{
+    return memcmp(a, b, n);
+}
+
+EFI_DEVICE_PATH *
+FileDevicePath(EFI_HANDLE device, CHAR16 *name)
+{
+    return NULL;            /* only for loading .efi drivers: unused */
+}
+
+UINTN
+StrLen(const CHAR16 *s)
+{
+    UINTN n = 0;
+    while (s[n]) n++;
+    return n;
+}
+
+VOID
+StrCpy(CHAR16 *d, const CHAR16 *s)
+{
+    while ((*d++ = *s++))
+        ;
+}
+
+INTN
+StrCmp(const CHAR16 *a, const CHAR16 *b)
+{
+    while (*a && *a == *b) a++, b++;
+    return (INTN)*a - (INTN)*b;
+}
+
+INTN
+StrnCmp(const CHAR16 *a, const CHAR16 *b, UINTN n)
+{
+    for (; n > 0; n--, a++, b++)
+        if (*a != *b || !*a)
+            return (INTN)*a - (INTN)*b;
+    return 0;
+}
+
+INTN
+StriCmp(const CHAR16 *a, const CHAR16 *b)
+{
+    for (;; a++, b++) {
+        CHAR16 x = (*a >= 'A' && *a <= 'Z') ? *a + 32 : *a;
+        CHAR16 y = (*b >= 'A' && *b <= 'Z') ? *b + 32 : *b;
+        if (x != y || !x)
+            return (INTN)x - (INTN)y;
+    }
+}
+
+/* Print()/SPrint() as gnu-efi does them, for what the sources use:
+ * %s %a %c %d %u %x %X %r %p, with "-", "0", a width and "l". */
+typedef struct {
+    CHAR16 *out;
+    UINTN   len;
+    UINTN   max;
+} FmtBuf;
+
+static void
+fmt_put(FmtBuf *b, CHAR16 c)
+{
+    if (b->len + 1 < b->max)
+        b->out[b->len] = c;
+    b->len++;
+}
+
+static const char *
+status_name(EFI_STATUS s)
+{
+    static const char *errors[] = {
+        "Success", "Load Error", "Invalid Parameter", "Unsupported",
+        "Bad Buffer Size", "Buffer Too Small", "Not Ready",
+        "Device Error", "Write Protected", "Out of Resources",
+        "Volume Corrupt", "Volume Full", "No Media", "Media changed",
+        "Not Found", "Access Denied", "No Response", "No mapping",
+        "Time out", "Not started", "Already started", "Aborted",
+    };
+    UINTN code = (UINTN)s & ~((UINTN)1 << 63);
+    if (s == EFI_SUCCESS || (EFI_ERROR(s) &&
+                             code < sizeof(errors) / sizeof(errors[0])))
+        return errors[code];
+    return NULL;
+}
+
+static void
+fmt_vformat(FmtBuf *b, const CHAR16 *fmt, va_list ap)
+{
+    for (; *fmt; fmt++) {
+        if (*fmt != '%') {
+            fmt_put(b, *fmt);
+            continue;
+        }
+
+        BOOLEAN left = FALSE, is_long = FALSE;
+        CHAR16  pad = ' ';
+        UINTN   width = 0;
+        for (fmt++; *fmt == '-' || *fmt == '0'; fmt++) {
+            if (*fmt == '-') left = TRUE;
+            else pad = '0';
+        }
+        for (; *fmt >= '0' && *fmt <= '9'; fmt++)
+            width = width * 10 + (*fmt - '0');
+        if (*fmt == 'l') {
+            is_long = TRUE;
+            fmt++;
+        }
+
+        char  field[64];
+        const CHAR16 *wide = NULL;
+        const char   *narrow = field;
+        UINT64 v;
+
+        switch (*fmt) {
+        case 's':
+            wide = va_arg(ap, const CHAR16 *);
+            if (!wide) {
+                wide = NULL;
+                narrow = "(null)";
+            }
+            break;
+        case 'a':
+            narrow = va_arg(ap, const char *);
+            if (!narrow)
+                narrow = "(null)";
+            break;
+        case 'c':
+            field[0] = (char)va_arg(ap, int);
+            field[1] = '\0';
+            break;
+        case 'd':
+            if (is_long)
+                snprintf(field, sizeof(field), "%lld",
+                         (long long)va_arg(ap, INT64));
+            else
+                snprintf(field, sizeof(field), "%d", (int)va_arg(ap, INT32));
+            break;
+        case 'u':
+            v = is_long ? va_arg(ap, UINT64) : va_arg(ap, UINT32);
+            snprintf(field, sizeof(field), "%llu", (unsigned long long)v);
+            break;
+        case 'x':
+        case 'X':
+            v = is_long ? va_arg(ap, UINT64) : va_arg(ap, UINT32);
+            snprintf(field, sizeof(field), *fmt == 'x' ? "%llx" : "%llX",
+                     (unsigned long long)v);
+            break;
+        case 'p':
+            snprintf(field, sizeof(field), "%p", va_arg(ap, void *));
+            break;
+        case 'r': {
+            EFI_STATUS s = va_arg(ap, EFI_STATUS);
+            const char *name = status_name(s);
+            if (name)
+                narrow = name;
+            else
+                snprintf(field, sizeof(field), "%llx", (unsigned long long)s);
+            break;
+        }
+        case '%':
+            narrow = "%";
+            break;
+        default:
+            return;
+        }
+
+        UINTN n = wide ? StrLen(wide) : strlen(narrow);
+        if (!left)
+            for (UINTN i = n; i < width; i++)
+                fmt_put(b, pad);
+        for (UINTN i = 0; i < n; i++)
+            fmt_put(b, wide ? wide[i] : (CHAR16)(UINT8)narrow[i]);
+        if (left)
+            for (UINTN i = n; i < width; i++)
+                fmt_put(b, ' ');
+    }
+}
+
+UINTN
+SPrint(CHAR16 *out, UINTN size, const CHAR16 *fmt, ...)
+{
+    FmtBuf b = { out, 0, size / sizeof(CHAR16) };
+    va_list ap;
+    va_start(ap, fmt);
+    fmt_vformat(&b, fmt, ap);
+    va_end(ap);
+    if (b.max)
+        out[b.len < b.max ? b.len : b.max - 1] = 0;
+    return b.len;
+}
+
+/* The log goes to stdout, UTF-8 encoded. */
+UINTN
+Print(const CHAR16 *fmt, ...)
+{
+    CHAR16 text[1024];
+    FmtBuf b = { text, 0, 1024 };
+    va_list ap;
+    va_start(ap, fmt);
+    fmt_vformat(&b, fmt, ap);
+    va_end(ap);
+    if (b.len >= b.max)
+        b.len = b.max - 1;
+
+    for (UINTN i = 0; i < b.len; i++) {
+        CHAR16 c = text[i];
+        if (c < 0x80) {
+            putchar(c);
+        } else if (c < 0x800) {
+            putchar(0xc0 | (c >> 6));
+            putchar(0x80 | (c & 0x3f));
+        } else {
+            putchar(0xe0 | (c >> 12));
+            putchar(0x80 | ((c >> 6) & 0x3f));
+            putchar(0x80 | (c & 0x3f));
+        }
+    }
+    return b.len;
+}
+
+/* ------------------------------------------------------------------ */
+/*  The recorded trace                                                 */
+/* ------------------------------------------------------------------ */
+
+static IoTraceHeader *trace;
+static IoTraceDevice *trace_devices;
+static IoTraceRecord *trace_records;
+
+static void
+load_trace(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        exit(1);
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    UINT8 *data = malloc(size);
+    if (fread(data, 1, size, f) != (size_t)size) {
+        fprintf(stderr, "%s: short read\n", path);
+        exit(1);
+    }
+    fclose(f);
+
+    trace = (IoTraceHeader *)data;
+    if ((size_t)size < sizeof(*trace) ||
+        memcmp(trace->magic, SB_IOTRACE_MAGIC, 8) != 0) {
+        fprintf(stderr, "%s: not a SuperBoot I/O trace\n", path);
+        exit(1);
+    }
+    if (trace->version != SB_IOTRACE_VERSION) {
+        fprintf(stderr, "%s: trace version %u, expected %u\n", path,
+                trace->version, SB_IOTRACE_VERSION);
+        exit(1);
+    }
+    if ((size_t)size < sizeof(*trace) +
+                       trace->device_count * sizeof(IoTraceDevice) +
+                       trace->record_count * sizeof(IoTraceRecord)) {
+        fprintf(stderr, "%s: truncated\n", path);
+        exit(1);
+    }
+    trace_devices = (IoTraceDevice *)(trace + 1);
+    trace_records = (IoTraceRecord *)(trace_devices + trace->device_count);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Devices: one captured image each                                   */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    UINT64 start, end;
+} Range;
+
+typedef struct {
+    EFI_BLOCK_IO_PROTOCOL  block_io;    /* keep first                  */
+    EFI_DISK_IO_PROTOCOL   disk_io;
+    EFI_BLOCK_IO_MEDIA     media;
+    BOOLEAN                has_disk_io;
+    void                  *sfs;         /* installed by sfs.c          */
+    UINT16                 index;       /* in the trace's device table */
+    int                    fd;
+    double                 a, b;        /* latency: a us + b us/byte   */
+    Range                 *captured;    /* sorted, merged              */
+    UINTN                  captured_count;
+    UINT64                 uncaptured;  /* bytes read outside them     */
+} ReplayDevice;
+
+#define MAX_DEVICES SB_IOTRACE_MAX_DEVICES
+
+static ReplayDevice *devices[MAX_DEVICES];
+static UINTN         device_count;
+
+typedef struct {
+    UINT64 requests;
+    UINT64 bytes;
+    double device_us;
+} Totals;
+
+static Totals totals;
+static double clock_us;
+
+static ReplayDevice *
+find_device(EFI_HANDLE handle)
+{
+    for (UINTN i = 0; i < device_count; i++)
+        if ((EFI_HANDLE)devices[i] == handle)
+            return devices[i];
+    return NULL;
+}
+
+static int
+range_cmp(const void *a, const void *b)
+{
+    const Range *x = a, *y = b;
+    return x->start < y->start ? -1 : x->start > y->start;
+}
+
+/* Least-squares fit of latency = a + b * length, as iotrace.py does,
+ * and the byte ranges the capture holds. */
+static void
+study_trace(ReplayDevice *d)
+{
+    double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+
+    d->captured = malloc((trace->record_count + 1) * sizeof(Range));
+    for (UINT32 i = 0; i < trace->record_count; i++) {
+        IoTraceRecord *r = &trace_records[i];
+        if (r->device != d->index || r->status != 0)
+            continue;
+        n++;
+        sx  += r->length;
+        sy  += r->latency_us;
+        sxx += (double)r->length * r->length;
+        sxy += (double)r->length * r->latency_us;
+        if (r->flags & IOTRACE_F_DISK_IO)
+            d->has_disk_io = TRUE;
+        d->captured[d->captured_count].start = r->offset;
+        d->captured[d->captured_count].end   = r->offset + r->length;
+        d->captured_count++;
+    }
+
+    double den = n * sxx - sx * sx;
+    d->b = den != 0 ? (n * sxy - sx * sy) / den : 0;
+    d->a = n ? (sy - d->b * sx) / n : 0;
+    if (d->a < 0) d->a = 0;
+    if (d->b < 0) d->b = 0;
+
+    qsort(d->captured, d->captured_count, sizeof(Range), range_cmp);
+    UINTN m = 0;
+    for (UINTN i = 0; i < d->captured_count; i++) {
+        if (m && d->captured[i].start <= d->captured[m - 1].end) {
+            if (d->captured[i].end > d->captured[m - 1].end)
+                d->captured[m - 1].end = d->captured[i].end;
+        } else {
+            d->captured[m++] = d->captured[i];
+        }
+    }
+    d->captured_count = m;
+}
+
+static UINT64
+captured_bytes(ReplayDevice *d, UINT64 start, UINT64 end)
+{
+    UINT64 covered = 0;
+    for (UINTN i = 0; i < d->captured_count; i++) {
+        Range *r = &d->captured[i];
+        if (r->start >= end)
+            break;
+        UINT64 s = r->start > start ? r->start : start;
+        UINT64 e = r->end < end ? r->end : end;
+        if (s < e)
+            covered += e - s;
+    }
+    return covered;
+}
+
+static EFI_STATUS
+device_read(ReplayDevice *d, UINT64 offset, UINTN size, void *buf)
+{
+    UINTN done = 0;
+    while (done < size) {
+        ssize_t n = pread(d->fd, (UINT8 *)buf + done, size - done,
+                          (off_t)(offset + done));
+        if (n < 0)
+            return EFI_DEVICE_ERROR;
+        if (n == 0)
+            break;
+        done += (UINTN)n;
+    }
+    memset((UINT8 *)buf + done, 0, size - done);    /* past the end */
+
+    clock_us += d->a + d->b * size;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+fake_read_blocks(EFI_BLOCK_IO_PROTOCOL *this, UINT32 media_id,
+                 EFI_LBA lba, UINTN size, VOID *buf)
+{
+    ReplayDevice *d = (ReplayDevice *)this;
+    UINT32 bs = d->media.BlockSize;
+
+    if (media_id != d->media.MediaId)
+        return EFI_MEDIA_CHANGED;
+    if (size % bs != 0)
+        return EFI_BAD_BUFFER_SIZE;
+    if (lba + size / bs > d->media.LastBlock + 1)
+        return EFI_INVALID_PARAMETER;
+    return device_read(d, lba * bs, size, buf);
+}
+
+static EFI_STATUS EFIAPI
+fake_read_disk(EFI_DISK_IO_PROTOCOL *this, UINT32 media_id,
+               UINT64 offset, UINTN size, VOID *buf)
+{
+    ReplayDevice *d = (ReplayDevice *)
+                      ((UINT8 *)this - offsetof(ReplayDevice, disk_io));
+
+    if (media_id != d->media.MediaId)
+        return EFI_MEDIA_CHANGED;
+    if (offset + size > (d->media.LastBlock + 1) * d->media.BlockSize)
+        return EFI_INVALID_PARAMETER;
+    return device_read(d, offset, size, buf);
+}
+
+static void
+add_device(UINT16 index, const char *image)
+{
+    if (index >= trace->device_count) {
+        fprintf(stderr, "trace has no device %u\n", index);
+        exit(1);
+    }
+    if (device_count == MAX_DEVICES)
+        return;
+
+    ReplayDevice *d = calloc(1, sizeof(*d));
+    d->fd = open(image, O_RDONLY);
+    if (d->fd < 0) {
+        perror(image);
+        exit(1);
+    }
+
+    IoTraceDevice *td = &trace_devices[index];
+    d->index                  = index;
+    d->media.MediaId          = td->media_id;
+    d->media.MediaPresent     = TRUE;
+    d->media.LogicalPartition = TRUE;
+    d->media.ReadOnly         = TRUE;
+    d->media.BlockSize        = td->block_size;
+    d->media.LastBlock        = td->last_block;
+    d->block_io.Media         = &d->media;
+    d->block_io.ReadBlocks    = fake_read_blocks;
+    d->disk_io.ReadDisk       = fake_read_disk;
+
+    study_trace(d);
+    devices[device_count++] = d;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Boot services                                                      */
+/* ------------------------------------------------------------------ */
+
+static EFI_STATUS EFIAPI
+fake_handle_protocol(EFI_HANDLE handle, EFI_GUID *guid, VOID **iface)
+{
+    ReplayDevice *d = find_device(handle);
+    if (!d)
+        return EFI_UNSUPPORTED;
+
+    if (guid == &gEfiBlockIoProtocolGuid)
+        *iface = &d->block_io;
+    else if (guid == &gEfiDiskIoProtocolGuid && d->has_disk_io)
+        *iface = &d->disk_io;
+    else if (guid == &gEfiSimpleFileSystemProtocolGuid && d->sfs)
+        *iface = d->sfs;
+    else
+        return EFI_UNSUPPORTED;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+fake_locate_handle_buffer(EFI_LOCATE_SEARCH_TYPE type, EFI_GUID *guid,
+                          VOID *key, UINTN *count, EFI_HANDLE **handles)
+{
+    if (guid != &gEfiBlockIoProtocolGuid || device_count == 0)
+        return EFI_NOT_FOUND;
+
+    *handles = malloc(device_count * sizeof(EFI_HANDLE));
+    for (UINTN i = 0; i < device_count; i++)
+        (*handles)[i] = (EFI_HANDLE)devices[i];
+    *count = device_count;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+fake_install_protocol(EFI_HANDLE *handle, EFI_GUID *guid,
+                      EFI_INTERFACE_TYPE type, VOID *iface)
+{
+    ReplayDevice *d = find_device(*handle);
+    if (!d || guid != &gEfiSimpleFileSystemProtocolGuid || d->sfs)
+        return EFI_INVALID_PARAMETER;
+    d->sfs = iface;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+fake_uninstall_protocol(EFI_HANDLE handle, EFI_GUID *guid, VOID *iface)
+{
+    ReplayDevice *d = find_device(handle);
+    if (!d || guid != &gEfiSimpleFileSystemProtocolGuid || d->sfs != iface)
+        return EFI_NOT_FOUND;
+    d->sfs = NULL;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+fake_allocate_pool(EFI_MEMORY_TYPE type, UINTN size, VOID **out)
+{
+    *out = malloc(size);
+    return *out ? EFI_SUCCESS : EFI_OUT_OF_RESOURCES;
+}
+
+static EFI_STATUS EFIAPI
+fake_free_pool(VOID *p)
+{
+    free(p);
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+fake_allocate_pages(EFI_ALLOCATE_TYPE type, EFI_MEMORY_TYPE mem,
+                    UINTN pages, EFI_PHYSICAL_ADDRESS *addr)
+{
+    void *p = aligned_alloc(4096, pages * 4096);
+    if (!p)
+        return EFI_OUT_OF_RESOURCES;
+    *addr = (EFI_PHYSICAL_ADDRESS)(UINTN)p;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+fake_free_pages(EFI_PHYSICAL_ADDRESS addr, UINTN pages)
+{
+    free((void *)(UINTN)addr);
+    return EFI_SUCCESS;
+}
+
+static EFI_BOOT_SERVICES fake_bs = {
+    .HandleProtocol             = fake_handle_protocol,
+    .LocateHandleBuffer         = fake_locate_handle_buffer,
+    .InstallProtocolInterface   = fake_install_protocol,
+    .UninstallProtocolInterface = fake_uninstall_protocol,
+    .AllocatePool               = fake_allocate_pool,
+    .FreePool                   = fake_free_pool,
+    .AllocatePages              = fake_allocate_pages,
+    .FreePages                  = fake_free_pages,
+};
+
+EFI_BOOT_SERVICES *BS = &fake_bs;
+
+/* ------------------------------------------------------------------ */
+/*  Scheduler, workers, timer, NVMe: the single-CPU, no-frills kind     */
+/* ------------------------------------------------------------------ */
+
+/* The scan is the only task: run it to completion. */
+void
+sb_sched_add(SbTask *t)
+{
+    while (t->step(t) != SB_TASK_DONE)
+        ;
+}
+
+void sb_control_mark(const CHAR16 *name)          { }
+
+/* No APs: the kernel reader decodes on the BSP. */
+EFI_STATUS sb_workers_start(void)                 { return EFI_UNSUPPORTED; }
+void       sb_workers_stop(void)                  { }
+UINTN      sb_workers_count(void)                 { return 0; }
+void       sb_workers_submit(SbJob *jobs, UINTN count) { }
+void       sb_workers_wait(void)                  { }
+
+/* The simulated device clock. */
+UINT64
+sb_time_us(void)
+{
+    return (UINT64)clock_us;
+}
+
+void
+sb_nvme_add_device(EFI_HANDLE device, EFI_BLOCK_IO_PROTOCOL *block_io)
+{
+}
+
+EFI_STATUS
+sb_nvme_read(EFI_BLOCK_IO_PROTOCOL *block_io, UINT64 offset, UINTN size,
+             void *buf)
+{
+    return EFI_UNSUPPORTED;
+}
+
+void sb_nvme_shutdown(void)                       { }
+
+/* ------------------------------------------------------------------ */
+/*  The recorder: collect the replayed stream, check it against the    */
+/*  recorded one                                                       */
+/* ------------------------------------------------------------------ */
+
+static IoTraceRecord *replayed;
+static UINT32         replayed_count;
+static UINT32         replayed_cap;
+static UINT32         diverged = (UINT32)-1;   /* first differing request */
+static UINT32         crc_mismatches;
+static BOOLEAN        list_requests;
+
+static UINT32
+crc32(const void *data, UINTN len)
+{
+    static UINT32 table[256];
+    if (!table[1]) {
+        for (UINT32 i = 0; i < 256; i++) {
+            UINT32 c = i;
+            for (int k = 0; k < 8; k++)
+                c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+    }
+
+    const UINT8 *p = data;
+    UINT32 c = 0xffffffff;
+    while (len--)
+        c = table[(c ^ *p++) & 0xff] ^ (c >> 8);
+    return c ^ 0xffffffff;
+}
+
+BOOLEAN sb_iotrace_active(void)                   { return TRUE; }
+EFI_STATUS sb_iotrace_flush(void)                 { return EFI_SUCCESS; }
+
+void
+sb_iotrace_add_device(EFI_HANDLE device, EFI_BLOCK_IO_PROTOCOL *block_io)
+{
+}
+
+void
+sb_iotrace_record(EFI_BLOCK_IO_PROTOCOL *block_io, UINT64 offset,
+                  UINTN size, const void *buf, UINT64 start_us,
+                  UINT8 flags, EFI_STATUS status)
+{
+    ReplayDevice *d = (ReplayDevice *)block_io;
+
+    if (replayed_count == replayed_cap) {
+        replayed_cap = replayed_cap ? replayed_cap * 2 : 1024;
+        replayed = realloc(replayed, replayed_cap * sizeof(*replayed));
+    }
+    IoTraceRecord *r = &replayed[replayed_count];
+    r->start_us   = start_us;
+    r->offset     = offset;
+    r->length     = (UINT32)size;
+    r->latency_us = (UINT32)(sb_time_us() - start_us);
+    r->crc32      = EFI_ERROR(status) ? 0 : crc32(buf, size);
+    r->device     = d->index;
+    r->flags      = flags;
+    r->status     = (UINT8)status;
+
+    /* Counted per request, as in the trace: the block rounding around
+     * a request is neither recorded nor captured. */
+    totals.requests++;
+    totals.bytes += size;
+    totals.device_us += r->latency_us;
+    if (!EFI_ERROR(status))
+        d->uncaptured += size - captured_bytes(d, offset, offset + size);
+
+    if (diverged == (UINT32)-1) {
+        IoTraceRecord *t = replayed_count < trace->record_count
+                           ? &trace_records[replayed_count] : NULL;
+        if (!t || t->device != r->device || t->offset != r->offset ||
+            t->length != r->length)
+            diverged = replayed_count;
+        else if (t->status == 0 && r->status == 0 && t->crc32 != r->crc32)
+            crc_mismatches++;
+    }
+
+    if (list_requests)
+        printf("  %10llu %3u %12llu %8u %7u\n",
+               (unsigned long long)r->start_us, r->device,
+               (unsigned long long)r->offset, r->length, r->latency_us);
+    replayed_count++;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Replay                                                             */
+/* ------------------------------------------------------------------ */
+
+static void
+report(const char *what, Totals before, const char *note)
+{
+    printf("%-11s %llu requests, %.1f KiB, %.2f ms%s%s\n", what,
+           (unsigned long long)(totals.requests - before.requests),
+           (double)(totals.bytes - before.bytes) / 1024.0,
+           (totals.device_us - before.device_us) / 1000.0,
+           note ? "  " : "", note ? note : "");
+}
+
+static void
+to_utf8(char *out, UINTN max, const CHAR16 *s)
+{
+    sb_str16to8((CHAR8 *)out, s ? s : L"?", max);
+}
+
+/* What the boot reads: the kernel through the streaming reader, then
+ * each initrd whole, as linux.c does; or the loader for a chain-load. */
+static void
+boot_reads(SuperBootContext *ctx, const BootTarget *t)
+{
+    char path[SB_MAX_PATH * 3];
+    EFI_STATUS s;
+
+    if (t->is_chainload) {
+        void *buf;
+        UINTN size;
+        s = sb_vfs_read_file(t->device_handle, t->efi_path, &buf, &size);
+        if (!EFI_ERROR(s))
+            sb_free(buf);
+        to_utf8(path, sizeof(path), t->efi_path);
+        printf("  loader %s: %s\n", path, status_name(s) ? status_name(s) : "error");
+        return;
+    }
+
+    SbKernelImage img;
+    s = sb_kernel_read(ctx, t->device_handle, t->kernel_path, NULL, &img);
+    if (!EFI_ERROR(s))
+        sb_kernel_free(&img);
+    to_utf8(path, sizeof(path), t->kernel_path);
+    printf("  kernel %s: %s\n", path, status_name(s) ? status_name(s) : "error");
+
+    for (UINT32 i = 0; i < t->initrd_count; i++) {
+        void *buf;
+        UINTN size;
+        s = sb_vfs_read_file(t->device_handle, t->initrd_paths[i],
+                             &buf, &size);
+        if (!EFI_ERROR(s))
+            sb_free(buf);
+        to_utf8(path, sizeof(path), t->initrd_paths[i]);
+        printf("  initrd %s: %s\n", path,
+               status_name(s) ? status_name(s) : "error");
+    }
+}
+
+static void
+write_trace(const char *path)
+{
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        perror(path);
+        exit(1);
+    }
+    IoTraceHeader h = *trace;
+    h.record_count = replayed_count;
+    h.dropped      = 0;
+    fwrite(&h, sizeof(h), 1, f);
+    fwrite(trace_devices, sizeof(IoTraceDevice), h.device_count, f);
+    fwrite(replayed, sizeof(IoTraceRecord), replayed_count, f);
+    fclose(f);
+}
+
+static void
+usage(void)
+{
+    fprintf(stderr, "usage: iotrace-replay [-e ENTRY] [-o OUT] [-v] "
+                    "TRACE DEV=IMAGE...\n");
+    exit(2);
+}
+
+int
+main(int argc, char **argv)
+{
+    long entry = -1;
+    const char *out = NULL;
+    int c;
+
+    while ((c = getopt(argc, argv, "e:o:v")) != -1) {
+        switch (c) {
+        case 'e': entry = atol(optarg); break;
+        case 'o': out = optarg; break;
+        case 'v': list_requests = TRUE; break;
+        default:  usage();
+        }
+    }
+    if (argc - optind < 2)
+        usage();
+
+    load_trace(argv[optind++]);
+    for (; optind < argc; optind++) {
+        char *eq = strchr(argv[optind], '=');
+        if (!eq || eq == argv[optind])
+            usage();
+        *eq = '\0';
+        add_device((UINT16)atoi(argv[optind]), eq + 1);
+    }
+
+    double recorded_us = 0;
+    UINT64 recorded_bytes = 0;
+    for (UINT32 i = 0; i < trace->record_count; i++) {
+        recorded_us += trace_records[i].latency_us;
+        recorded_bytes += trace_records[i].length;
+    }
+    printf("trace:      %u requests, %.1f KiB, %.2f ms of device time\n",
+           trace->record_count, (double)recorded_bytes / 1024.0,
+           recorded_us / 1000.0);
+    for (UINTN i = 0; i < device_count; i++) {
+        ReplayDevice *d = devices[i];
+        printf("  dev %u model: %.1f us + %.4f us/byte (~%.0f MiB/s)%s  %s\n",
+               d->index, d->a, d->b, d->b ? 1 / d->b / 1.048576 : 0,
+               d->has_disk_io ? ", Disk I/O" : "",
+               trace_devices[d->index].path);
+    }
+    if (list_requests)
+        printf("  %10s %3s %12s %8s %7s\n",
+               "start_us", "dev", "offset", "length", "lat_us");
+
+    SuperBootContext ctx;
+    SetMem(&ctx, sizeof(ctx), 0);
+    ctx.boot_services = &fake_bs;
+    sb_targets_init(&ctx.targets);
+
+    Totals before = totals;
+    sb_scan_start(&ctx);
+    char note[SB_MAX_PATH * 3 + 32];
+    snprintf(note, sizeof(note), "(%u entries)", (unsigned)ctx.targets.count);
+    report("scan:", before, note);
+
+    if (ctx.targets.count > 0) {
+        UINTN pick = 0;
+        for (UINTN i = 0; i < ctx.targets.count; i++) {
+            if (ctx.targets.entries[i].is_default) {
+                pick = i;
+                break;
+            }
+        }
+        if (entry >= 0)
+            pick = (UINTN)entry < ctx.targets.count ? (UINTN)entry : 0;
+
+        const BootTarget *t = &ctx.targets.entries[pick];
+        char title[SB_MAX_PATH * 3];
+        to_utf8(title, sizeof(title), t->title);
+
+        before = totals;
+        boot_reads(&ctx, t);
+        snprintf(note, sizeof(note), "(entry %u: %s)", (unsigned)pick, title);
+        report("boot:", before, note);
+    }
+
+    Totals none = { 0, 0, 0 };
+    report("replayed:", none, NULL);
+
+    if (diverged == (UINT32)-1 && replayed_count == trace->record_count)
+        printf("stream:     %s the trace\n",
+               crc_mismatches ? "the same requests as" : "identical to");
+    else if (diverged == (UINT32)-1)
+        printf("stream:     the trace's first %u requests, then %d more\n",
+               replayed_count < trace->record_count ? replayed_count
+                                                    : trace->record_count,
+               (int)replayed_count - (int)trace->record_count);
+    else if (diverged < trace->record_count) {
+        IoTraceRecord *t = &trace_records[diverged];
+        IoTraceRecord *r = &replayed[diverged];
+        printf("stream:     differs from request %u: trace dev %u @%llu +%u, "
+               "replay dev %u @%llu +%u\n", diverged,
+               t->device, (unsigned long long)t->offset, t->length,
+               r->device, (unsigned long long)r->offset, r->length);
+    } else {
+        printf("stream:     the trace's %u requests, then %u more\n",
+               trace->record_count, replayed_count - trace->record_count);
+    }
+
+    int rc = 0;
+    if (crc_mismatches) {
+        printf("WARNING: %u reads did not match the recorded CRC; the image "
+               "is not the one the trace was taken from\n", crc_mismatches);
+        rc = 1;
+    }
+    for (UINTN i = 0; i < device_count; i++) {
+        if (devices[i]->uncaptured)
+            printf("WARNING: dev %u: %llu bytes read outside the captured "
+                   "ranges (seen as zeros)\n", devices[i]->index,
+                   (unsigned long long)devices[i]->uncaptured);
+    }
+
+    if (out)
+        write_trace(out);
+
+    /* As on the way back to the firmware: the leak check covers the
+     * drivers too. */
+    sb_targets_free(&ctx.targets);
+    sb_vfs_unpublish_all();
+    sb_vfs_shutdown();
+    return rc;
+}
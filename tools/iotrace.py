@@ -0,0 +1,326 @@
+#!/usr/bin/env python3
+#
+# iotrace.py — Inspect, capture and replay SuperBoot block I/O traces
+#
+# Usage:
+#   ./tools/iotrace.py dump    TRACE
+#   ./tools/iotrace.py capture TRACE DEV=SOURCE [...] -o PREFIX
+#   ./tools/iotrace.py replay  TRACE DEV=IMAGE  [...] [options]
+#
+# A trace is recorded by booting SuperBoot with the "iotrace" load
+# option; it lands on the SuperBoot ESP as \EFI\superboot\iotrace.bin
+# (format: src/fs/iotrace.h).
+#
+#   dump     Print the device table, per-device totals and every
+#            request.
+#
+#   capture  Copy exactly the byte ranges a trace touched from the
+#            customer's partition (block device or image) into a
+#            sparse "metadata image" PREFIX.DEV.img, checking each
+#            range against the CRC recorded at boot.  The result holds
+#            only filesystem metadata and the files SuperBoot read, so
+#            it is small and safe to ship.
+#
+#   replay   Re-issue the recorded reads, in order, against captured
+#            images and report the simulated boot I/O time.  Latency
+#            per request is either the recorded one (--latency=recorded,
+#            the default) or a per-device linear model fitted to the
+#            trace (--latency=model), which is what you want when
+#            evaluating changes that alter the request stream:
+#              --cache-kib N   LRU block cache of N KiB in front of the
+#                              device (hits cost nothing)
+#              --merge         coalesce adjacent/overlapping requests
+#              --realtime      actually sleep for the simulated latency
+#            The requests are the recorded ones, so this measures
+#            caching and merging, not a change to the drivers: for
+#            that, build the changed tree's `make iotrace-replay` and
+#            run the scan and boot reads through it against the same
+#            images.
+#
+# Only the Python standard library is required.
+
+import argparse
+import collections
+import struct
+import sys
+import time
+import zlib
+
+MAGIC = b"SBIOTRC\0"
+VERSION = 1
+
+HEADER = struct.Struct("<8sIIII")
+DEVICE = struct.Struct("<IIQ112s")
+RECORD = struct.Struct("<QQIIIHBB")
+
+F_DISK_IO = 0x01
+F_BLOCK_IO = 0x02
+F_BOUNCE = 0x04
+F_NVME = 0x08
+
+CACHE_BLOCK = 4096
+
+Device = collections.namedtuple("Device", "media_id block_size last_block path")
+Record = collections.namedtuple(
+    "Record", "start_us offset length latency_us crc32 device flags status")
+
+
+def load(path):
+    with open(path, "rb") as f:
+        data = f.read()
+
+    magic, version, ndev, nrec, dropped = HEADER.unpack_from(data, 0)
+    if magic != MAGIC:
+        sys.exit(f"{path}: not a SuperBoot I/O trace")
+    if version != VERSION:
+        sys.exit(f"{path}: trace version {version}, expected {VERSION}")
+
+    off = HEADER.size
+    devices = []
+    for _ in range(ndev):
+        media_id, bs, last, p = DEVICE.unpack_from(data, off)
+        devices.append(Device(media_id, bs, last,
+                              p.split(b"\0", 1)[0].decode(errors="replace")))
+        off += DEVICE.size
+
+    records = []
+    for _ in range(nrec):
+        records.append(Record(*RECORD.unpack_from(data, off)))
+        off += RECORD.size
+
+    return devices, records, dropped
+
+
+def flag_str(flags):
+    if flags & F_NVME:
+        return "nvme"
+    if flags & F_DISK_IO:
+        return "disk"
+    if flags & F_BOUNCE:
+        return "bounce"
+    return "block"
+
+
+def parse_mapping(items):
+    mapping = {}
+    for item in items:
+        dev, _, path = item.partition("=")
+        if not path or not dev.isdigit():
+            sys.exit(f"bad device mapping '{item}', expected DEV=PATH")
+        mapping[int(dev)] = path
+    return mapping
+
+
+# ---------------------------------------------------------------------
+#  dump
+# ---------------------------------------------------------------------
+
+def cmd_dump(args):
+    devices, records, dropped = load(args.trace)
+
+    print(f"{len(records)} requests on {len(devices)} devices"
+          + (f" ({dropped} dropped: buffer full)" if dropped else ""))
+    for i, d in enumerate(devices):
+        reqs = [r for r in records if r.device == i]
+        nbytes = sum(r.length for r in reqs)
+        busy = sum(r.latency_us for r in reqs)
+        print(f"  dev {i}: media {d.media_id}, {d.block_size}-byte blocks, "
+              f"{(d.last_block + 1) * d.block_size >> 20} MiB  {d.path}")
+        print(f"         {len(reqs)} requests, {nbytes} bytes, "
+              f"{busy / 1000:.1f} ms busy")
+
+    print()
+    print(f"{'start_us':>10} {'dev':>3} {'offset':>12} {'length':>8} "
+          f"{'lat_us':>7} {'path':>6}  status")
+    for r in records:
+        print(f"{r.start_us:>10} {r.device:>3} {r.offset:>12} {r.length:>8} "
+              f"{r.latency_us:>7} {flag_str(r.flags):>6}  "
+              f"{'ok' if r.status == 0 else hex(r.status)}")
+
+
+# ---------------------------------------------------------------------
+#  capture
+# ---------------------------------------------------------------------
+
+def cmd_capture(args):
+    devices, records, _ = load(args.trace)
+    sources = parse_mapping(args.sources)
+
+    for dev, src in sorted(sources.items()):
+        if dev >= len(devices):
+            sys.exit(f"trace has no device {dev}")
+
+        size = (devices[dev].last_block + 1) * devices[dev].block_size
+        out = f"{args.output}.{dev}.img"
+        bad = 0
+        with open(src, "rb") as fin, open(out, "wb") as fout:
+            fout.truncate(size)  # sparse: untouched ranges stay holes
+            for r in records:
+                if r.device != dev or r.status != 0:
+                    continue
+                fin.seek(r.offset)
+                buf = fin.read(r.length)
+                if zlib.crc32(buf) != r.crc32:
+                    bad += 1
+                fout.seek(r.offset)
+                fout.write(buf)
+
+        print(f"dev {dev}: {src} -> {out}"
+              + (f"  WARNING: {bad} ranges differ from the trace" if bad else ""))
+
+
+# ---------------------------------------------------------------------
+#  replay
+# ---------------------------------------------------------------------
+
+def fit_model(records):
+    """Least-squares fit of latency = a + b * length, per device."""
+    model = {}
+    by_dev = collections.defaultdict(list)
+    for r in records:
+        if r.status == 0:
+            by_dev[r.device].append(r)
+
+    for dev, reqs in by_dev.items():
+        n = len(reqs)
+        sx = sum(r.length for r in reqs)
+        sy = sum(r.latency_us for r in reqs)
+        sxx = sum(r.length * r.length for r in reqs)
+        sxy = sum(r.length * r.latency_us for r in reqs)
+        den = n * sxx - sx * sx
+        b = (n * sxy - sx * sy) / den if den else 0.0
+        a = (sy - b * sx) / n
+        model[dev] = (max(a, 0.0), max(b, 0.0))
+    return model
+
+
+def merge_requests(records):
+    out = []
+    for r in records:
+        if out:
+            p = out[-1]
+            if (p.device == r.device and p.status == 0 and r.status == 0
+                    and p.offset <= r.offset <= p.offset + p.length):
+                end = max(p.offset + p.length, r.offset + r.length)
+                out[-1] = p._replace(length=end - p.offset,
+                                     latency_us=p.latency_us + r.latency_us)
+                continue
+        out.append(r)
+    return out
+
+
+class LruCache:
+    def __init__(self, kib):
+        self.capacity = kib * 1024 // CACHE_BLOCK
+        self.blocks = collections.OrderedDict()
+
+    def access(self, dev, offset, length):
+        """Return True if every block of the range was cached."""
+        if self.capacity == 0:
+            return False
+        hit = True
+        first = offset // CACHE_BLOCK
+        last = (offset + max(length, 1) - 1) // CACHE_BLOCK
+        for blk in range(first, last + 1):
+            key = (dev, blk)
+            if key in self.blocks:
+                self.blocks.move_to_end(key)
+            else:
+                hit = False
+                self.blocks[key] = True
+                if len(self.blocks) > self.capacity:
+                    self.blocks.popitem(last=False)
+        return hit
+
+
+def cmd_replay(args):
+    devices, records, _ = load(args.trace)
+    images = parse_mapping(args.images)
+    model = fit_model(records) if args.latency == "model" else None
+
+    stream = sorted(records, key=lambda r: r.start_us)
+    if args.merge:
+        stream = merge_requests(stream)
+
+    files = {dev: open(path, "rb") for dev, path in images.items()}
+    cache = LruCache(args.cache_kib)
+
+    sim_us = 0.0
+    hits = mismatches = skipped = 0
+    for r in stream:
+        f = files.get(r.device)
+        if f is None or r.status != 0:
+            skipped += 1
+            continue
+
+        f.seek(r.offset)
+        buf = f.read(r.length)
+        if not args.merge and zlib.crc32(buf) != r.crc32:
+            mismatches += 1
+
+        if cache.access(r.device, r.offset, r.length):
+            hits += 1
+            continue
+
+        if model:
+            a, b = model[r.device]
+            cost = a + b * r.length
+        else:
+            cost = r.latency_us
+        sim_us += cost
+        if args.realtime:
+            time.sleep(cost / 1e6)
+
+    for f in files.values():
+        f.close()
+
+    recorded = sum(r.latency_us for r in records if r.status == 0)
+    replayed = len(stream) - skipped
+    print(f"requests:   {replayed} replayed, {skipped} skipped"
+          + (f" (merged from {len(records)})" if args.merge else ""))
+    if args.cache_kib:
+        print(f"cache:      {hits} hits ({100.0 * hits / max(replayed, 1):.1f}%)"
+              f" with {args.cache_kib} KiB")
+    print(f"recorded:   {recorded / 1000:.2f} ms of device time")
+    print(f"simulated:  {sim_us / 1000:.2f} ms ({args.latency} latency)")
+    if model:
+        for dev, (a, b) in sorted(model.items()):
+            print(f"  dev {dev} model: {a:.1f} us + {b:.4f} us/byte"
+                  f" (~{1 / b / 1.048576 if b else 0:.0f} MiB/s)")
+    if mismatches:
+        print(f"WARNING: {mismatches} reads did not match the recorded CRC; "
+              "the image is not the one the trace was taken from")
+        return 1
+    return 0
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__)
+    sub = ap.add_subparsers(dest="cmd", required=True)
+
+    p = sub.add_parser("dump", help="print a trace")
+    p.add_argument("trace")
+    p.set_defaults(func=cmd_dump)
+
+    p = sub.add_parser("capture", help="build metadata images from a disk")
+    p.add_argument("trace")
+    p.add_argument("sources", nargs="+", metavar="DEV=SOURCE")
+    p.add_argument("-o", "--output", required=True, metavar="PREFIX")
+    p.set_defaults(func=cmd_capture)
+
+    p = sub.add_parser("replay", help="replay a trace against images")
+    p.add_argument("trace")
+    p.add_argument("images", nargs="+", metavar="DEV=IMAGE")
+    p.add_argument("--latency", choices=("recorded", "model"),
+                   default="recorded")
+    p.add_argument("--cache-kib", type=int, default=0)
+    p.add_argument("--merge", action="store_true")
+    p.add_argument("--realtime", action="store_true")
+    p.set_defaults(func=cmd_replay)
+
+    args = ap.parse_args()
+    return args.func(args) or 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,154 @@
+#!/usr/bin/env python3
+#
+# mkfont.py — Generate the built-in 8x16 console font (src/tui/font.c)
+#
+# Usage:
+#   ./tools/mkfont.py FONT.ttf > src/tui/font.c
+#
+# Rasterises the printable ASCII and Latin-1 ranges, dashes, arrows and
+# shading from a monospaced TrueType font into 8x16 cells, draws the box
+# characters UEFI's text protocol uses (BOXDRAW_*, BLOCKELEMENT_*)
+# geometrically so they join cell to cell, and writes the result as a
+# PSF2 font with a Unicode table, embedded as a C array.
+#
+# The shipped font.c was generated from Source Code Pro Bold at 14 px
+# (SIL Open Font License 1.1); its bitmaps fall under the same licence.
+#
+# Requires: Pillow
+
+import struct
+import sys
+
+from PIL import Image, ImageDraw, ImageFont
+
+WIDTH, HEIGHT = 8, 16
+SIZE = 14           # pixel size giving an 8-pixel advance
+BASELINE = 12       # row of the baseline within the cell
+THRESHOLD = 120     # coverage (0-255) at which a pixel is set
+
+TEXT = (list(range(0x20, 0x7F)) + list(range(0xA0, 0x100)) +
+        [0x2013, 0x2014, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2026,
+         0x2190, 0x2191, 0x2192, 0x2193, 0x25B2, 0x25BA, 0x25BC, 0x25C4])
+
+# Box drawing: (up, down, left, right) line weights, 1 = single, 2 = double.
+BOX = {
+    0x2500: (0, 0, 1, 1), 0x2502: (1, 1, 0, 0),
+    0x250C: (0, 1, 0, 1), 0x2510: (0, 1, 1, 0),
+    0x2514: (1, 0, 0, 1), 0x2518: (1, 0, 1, 0),
+    0x251C: (1, 1, 0, 1), 0x2524: (1, 1, 1, 0),
+    0x252C: (0, 1, 1, 1), 0x2534: (1, 0, 1, 1),
+    0x253C: (1, 1, 1, 1),
+    0x2550: (0, 0, 2, 2), 0x2551: (2, 2, 0, 0),
+    0x2554: (0, 2, 0, 2), 0x2557: (0, 2, 2, 0),
+    0x255A: (2, 0, 0, 2), 0x255D: (2, 0, 2, 0),
+    0x2560: (2, 2, 0, 2), 0x2563: (2, 2, 2, 0),
+    0x2566: (0, 2, 2, 2), 0x2569: (2, 0, 2, 2),
+    0x256C: (2, 2, 2, 2),
+}
+
+SHADES = {0x2588: None, 0x2591: 1, 0x2592: 2, 0x2593: 3}
+
+
+def blank():
+    return [[0] * WIDTH for _ in range(HEIGHT)]
+
+
+def render_text(font, cp):
+    im = Image.new('L', (WIDTH, HEIGHT), 0)
+    ImageDraw.Draw(im).text((0, BASELINE), chr(cp), font=font, fill=255,
+                            anchor='ls')
+    return [[1 if im.getpixel((x, y)) >= THRESHOLD else 0
+             for x in range(WIDTH)] for y in range(HEIGHT)]
+
+
+def render_box(up, down, left, right):
+    g = blank()
+    cx, cy = WIDTH // 2 - 1, HEIGHT // 2 - 1
+
+    def hline(y, x0, x1):
+        for x in range(x0, x1):
+            g[y][x] = 1
+
+    def vline(x, y0, y1):
+        for y in range(y0, y1):
+            g[y][x] = 1
+
+    # Single lines run through (cx, cy); double lines one pixel either
+    # side of it.  Each arm runs from the centre to the cell edge.
+    for weight, horiz, lo, hi in ((left, True, 0, cx + 1),
+                                  (right, True, cx, WIDTH),
+                                  (up, False, 0, cy + 1),
+                                  (down, False, cy, HEIGHT)):
+        if not weight:
+            continue
+        offsets = (0,) if weight == 1 else (-1, 1)
+        for o in offsets:
+            if horiz:
+                hline(cy + o, lo, hi)
+            else:
+                vline(cx + o, lo, hi)
+    return g
+
+
+def render_shade(level):
+    g = blank()
+    for y in range(HEIGHT):
+        for x in range(WIDTH):
+            if level is None:
+                g[y][x] = 1
+            elif level == 1:
+                g[y][x] = 1 if (x % 2 == 0 and y % 2 == 0) else 0
+            elif level == 2:
+                g[y][x] = 1 if (x + y) % 2 == 0 else 0
+            else:
+                g[y][x] = 0 if (x % 2 == 0 and y % 2 == 0) else 1
+    return g
+
+
+def render_missing():
+    g = blank()
+    for y in range(2, 14):
+        for x in range(1, 7):
+            if y in (2, 13) or x in (1, 6):
+                g[y][x] = 1
+    return g
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit('usage: mkfont.py FONT.ttf > src/tui/font.c')
+    font = ImageFont.truetype(sys.argv[1], SIZE)
+
+    glyphs = [(None, render_missing())]
+    glyphs += [(cp, render_text(font, cp)) for cp in TEXT]
+    glyphs += [(cp, render_box(*w)) for cp, w in sorted(BOX.items())]
+    glyphs += [(cp, render_shade(l)) for cp, l in sorted(SHADES.items())]
+
+    data = bytearray(struct.pack('<8I', 0x864AB572, 0, 32, 1,
+                                 len(glyphs), HEIGHT, HEIGHT, WIDTH))
+    for _, g in glyphs:
+        for row in g:
+            data.append(sum(bit << (7 - x) for x, bit in enumerate(row)))
+    for cp, _ in glyphs:
+        if cp is not None:
+            data += chr(cp).encode('utf-8')
+        data.append(0xFF)
+
+    out = sys.stdout
+    out.write('/*\n'
+              ' * font.c — Built-in 8x16 console font (PSF2)\n'
+              ' *\n'
+              ' * Generated by tools/mkfont.py from Source Code Pro Bold\n'
+              ' * (SIL Open Font License 1.1).  Do not edit.\n'
+              ' */\n\n'
+              '#include "tui.h"\n\n'
+              'const UINT8 tui_font_psf[] = {\n')
+    for i in range(0, len(data), 12):
+        out.write('    ' + ' '.join('0x%02x,' % b for b in data[i:i + 12])
+                  + '\n')
+    out.write('};\n\n'
+              'const UINTN tui_font_psf_size = sizeof(tui_font_psf);\n')
+
+
+if __name__ == '__main__':
+    main()
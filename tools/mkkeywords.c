@@ -0,0 +1,239 @@
+/*
+ * mkkeywords.c — Generate the config parsers' keyword lookups
+ *
+ * Usage:
+ *   mkkeywords src/config/keywords.def > build/gen/sb_keywords.h
+ *
+ * For each grammar in the definition file (see its header for the
+ * format) this writes an enum of the grammar's tokens and a lookup
+ * function built on a perfect hash: three bytes of the word and its
+ * length, weighted and masked to the table size,
+ *
+ *   slot = (s[0]*A + s[len/2]*B + s[len-1]*C + len) & (SIZE - 1)
+ *
+ * The generator tries weights until no two keywords share a slot,
+ * doubling the table when none work, so a lookup is a length check,
+ * one hash and at most one string comparison.
+ *
+ * Run on the build host by the Makefile; plain C99.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#define MAX_KEYWORDS  64
+#define MAX_GRAMMARS  16
+#define MAX_WORD      32
+#define MAX_SIZE      256        /* largest table tried                */
+#define MAX_WEIGHT    31
+
+typedef struct {
+    char word[MAX_WORD];
+    char token[MAX_WORD];
+} Keyword;
+
+typedef struct {
+    char    name[MAX_WORD];
+    Keyword kw[MAX_KEYWORDS];
+    int     count;
+    char    tokens[MAX_KEYWORDS][MAX_WORD];   /* distinct, in order   */
+    int     ntokens;
+    /* The hash found. */
+    unsigned a, b, c, size;
+} Grammar;
+
+static Grammar grammars[MAX_GRAMMARS];
+static int     ngrammars;
+
+static unsigned
+hash(const char *s, unsigned a, unsigned b, unsigned c, unsigned size)
+{
+    size_t len = strlen(s);
+    return ((unsigned char)s[0] * a + (unsigned char)s[len / 2] * b +
+            (unsigned char)s[len - 1] * c + (unsigned)len) & (size - 1);
+}
+
+static int
+perfect(Grammar *g, unsigned a, unsigned b, unsigned c, unsigned size)
+{
+    unsigned char used[MAX_SIZE] = { 0 };
+    for (int i = 0; i < g->count; i++) {
+        unsigned h = hash(g->kw[i].word, a, b, c, size);
+        if (used[h])
+            return 0;
+        used[h] = 1;
+    }
+    return 1;
+}
+
+/* Smallest table, then smallest weights, that separate every keyword. */
+static int
+find_hash(Grammar *g)
+{
+    unsigned size = 1;
+    while (size < (unsigned)g->count)
+        size *= 2;
+
+    for (; size <= MAX_SIZE; size *= 2)
+        for (unsigned a = 1; a <= MAX_WEIGHT; a++)
+            for (unsigned b = 0; b <= MAX_WEIGHT; b++)
+                for (unsigned c = 0; c <= MAX_WEIGHT; c++)
+                    if (perfect(g, a, b, c, size)) {
+                        g->a = a; g->b = b; g->c = c; g->size = size;
+                        return 1;
+                    }
+    return 0;
+}
+
+static Grammar *
+grammar(const char *name)
+{
+    for (int i = 0; i < ngrammars; i++)
+        if (strcmp(grammars[i].name, name) == 0)
+            return &grammars[i];
+    if (ngrammars == MAX_GRAMMARS)
+        return NULL;
+    Grammar *g = &grammars[ngrammars++];
+    snprintf(g->name, sizeof(g->name), "%s", name);
+    return g;
+}
+
+static void
+upper(char *dst, const char *src)
+{
+    while (*src)
+        *dst++ = (char)toupper((unsigned char)*src++);
+    *dst = '\0';
+}
+
+static int
+load(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return 0;
+    }
+
+    char line[256];
+    int lineno = 0;
+    while (fgets(line, sizeof(line), f)) {
+        char gname[MAX_WORD], word[MAX_WORD], token[MAX_WORD], extra;
+        lineno++;
+
+        char *p = line;
+        while (isspace((unsigned char)*p)) p++;
+        if (*p == '#' || *p == '\0')
+            continue;
+
+        if (sscanf(p, "%31s %31s %31s %c", gname, word, token, &extra) != 3) {
+            fprintf(stderr, "%s:%d: expected GRAMMAR KEYWORD TOKEN\n",
+                    path, lineno);
+            goto fail;
+        }
+
+        Grammar *g = grammar(gname);
+        if (!g || g->count == MAX_KEYWORDS) {
+            fprintf(stderr, "%s:%d: too many keywords\n", path, lineno);
+            goto fail;
+        }
+        for (int i = 0; i < g->count; i++)
+            if (strcmp(g->kw[i].word, word) == 0) {
+                fprintf(stderr, "%s:%d: duplicate keyword '%s'\n",
+                        path, lineno, word);
+                goto fail;
+            }
+
+        Keyword *k = &g->kw[g->count++];
+        snprintf(k->word, sizeof(k->word), "%s", word);
+        snprintf(k->token, sizeof(k->token), "%s", token);
+
+        int known = 0;
+        for (int i = 0; i < g->ntokens; i++)
+            known |= strcmp(g->tokens[i], token) == 0;
+        if (!known)
+            snprintf(g->tokens[g->ntokens++], MAX_WORD, "%s", token);
+    }
+    fclose(f);
+    return 1;
+
+fail:
+    fclose(f);
+    return 0;
+}
+
+static void
+emit(const Grammar *g)
+{
+    char G[MAX_WORD];
+    upper(G, g->name);
+
+    size_t min = MAX_WORD, max = 0;
+    for (int i = 0; i < g->count; i++) {
+        size_t len = strlen(g->kw[i].word);
+        if (len < min) min = len;
+        if (len > max) max = len;
+    }
+
+    printf("/* ---- %s ---- */\n\n", g->name);
+    printf("enum {\n    SB_KW_%s_NONE = 0,\n", G);
+    for (int i = 0; i < g->ntokens; i++)
+        printf("    SB_KW_%s_%s,\n", G, g->tokens[i]);
+    printf("};\n\n");
+
+    printf("static inline UINTN\nsb_kw_%s(const CHAR8 *s, UINTN len)\n{\n",
+           g->name);
+    printf("    static const struct {\n"
+           "        const CHAR8 *word;\n"
+           "        UINT8        len;\n"
+           "        UINT8        token;\n"
+           "    } slots[%u] = {\n", g->size);
+    for (unsigned h = 0; h < g->size; h++)
+        for (int i = 0; i < g->count; i++)
+            if (hash(g->kw[i].word, g->a, g->b, g->c, g->size) == h)
+                printf("        [%2u] = { (const CHAR8 *)\"%s\", %zu, "
+                       "SB_KW_%s_%s },\n", h, g->kw[i].word,
+                       strlen(g->kw[i].word), G, g->kw[i].token);
+    printf("    };\n\n");
+
+    printf("    if (len < %zu || len > %zu)\n"
+           "        return SB_KW_%s_NONE;\n", min, max, G);
+    printf("    UINTN h = ((UINTN)(UINT8)s[0] * %u", g->a);
+    if (g->b)
+        printf(" + (UINTN)(UINT8)s[len / 2] * %u", g->b);
+    if (g->c)
+        printf(" +\n               (UINTN)(UINT8)s[len - 1] * %u", g->c);
+    printf(" + len) & %u;\n", g->size - 1);
+    printf("    if (slots[h].len != len ||\n"
+           "        sb_strncmp8(s, slots[h].word, len) != 0)\n"
+           "        return SB_KW_%s_NONE;\n"
+           "    return slots[h].token;\n}\n\n", G);
+}
+
+int
+main(int argc, char **argv)
+{
+    if (argc != 2) {
+        fprintf(stderr, "usage: mkkeywords KEYWORDS.def\n");
+        return 2;
+    }
+    if (!load(argv[1]))
+        return 1;
+
+    for (int i = 0; i < ngrammars; i++) {
+        if (!find_hash(&grammars[i])) {
+            fprintf(stderr, "%s: no perfect hash for grammar '%s' "
+                    "within %d slots\n", argv[1], grammars[i].name, MAX_SIZE);
+            return 1;
+        }
+    }
+
+    printf("/* Generated from %s by tools/mkkeywords.c; do not edit. */\n\n"
+           "#ifndef SB_KEYWORDS_H\n#define SB_KEYWORDS_H\n\n", argv[1]);
+    for (int i = 0; i < ngrammars; i++)
+        emit(&grammars[i]);
+    printf("#endif /* SB_KEYWORDS_H */\n");
+    return 0;
+}
@@ -0,0 +1,627 @@
+/*
+ * parse-bench.c — Host benchmark for the config parsers
+ *
+ * Usage:
+ *   make bench-parse
+ *   ./build/parse-bench [ENTRIES] [ITERATIONS]
+ *
+ * Feeds the GRUB, systemd-boot and Limine parsers, compiled from
+ * src/config unchanged, generated configs of ENTRIES boot entries
+ * each (default 100; a grub.cfg in the shape grub-mkconfig writes)
+ * and prints the best of ITERATIONS runs (default 1000) in MiB/s and
+ * lines/s.  The digest covers every target produced, so two builds
+ * can be checked for identical output as well as compared for speed.
+ *
+ * systemd-boot reads its entry files through SimpleFileSystem, and
+ * GRUB's blscfg the same files through the VFS; small in-memory
+ * stand-ins serve both here.  "grub (bls)" is a RHEL-style grub.cfg
+ * whose menu comes from them.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "config/config.h"
+#include "fs/vfs.h"
+
+/* ------------------------------------------------------------------ */
+/*  The firmware and library calls the parsers make                    */
+/* ------------------------------------------------------------------ */
+
+EFI_GUID gEfiSimpleFileSystemProtocolGuid;   /* the fake ignores it */
+
+void *
+sb_mem_alloc(SbMemTag tag, UINTN size, BOOLEAN zero,
+             const char *file, UINT32 line)
+{
+    return zero ? calloc(1, size) : malloc(size);
+}
+
+void
+sb_free(void *p)
+{
+    free(p);
+}
+
+struct SbArenaBlock {
+    struct SbArenaBlock *next;
+    UINTN                size;
+    UINTN                used;
+    UINT8                data[];
+};
+
+SbArena sb_scratch;
+
+void
+sb_arena_init(SbArena *a, UINTN block_size, SbMemTag tag)
+{
+    memset(a, 0, sizeof(*a));
+    a->block_size = block_size;
+    a->tag = tag;
+}
+
+void *
+sb_arena_alloc(SbArena *a, UINTN size)
+{
+    size = (size + 15) & ~(UINTN)15;
+    SbArenaBlock *b = a->blocks;
+    if (!b || b->size - b->used < size) {
+        UINTN bs = a->block_size ? a->block_size : SB_SCRATCH_BLOCK_SIZE;
+        if (bs < size)
+            bs = size;
+        b = malloc(sizeof(*b) + bs);
+        b->next = a->blocks;
+        b->size = bs;
+        b->used = 0;
+        a->blocks = b;
+    }
+    void *p = b->data + b->used;
+    b->used += size;
+    a->allocs++;
+    return p;
+}
+
+void *
+sb_arena_zalloc(SbArena *a, UINTN size)
+{
+    void *p = sb_arena_alloc(a, size);
+    memset(p, 0, size);
+    return p;
+}
+
+SbArenaMark
+sb_arena_mark(SbArena *a)
+{
+    SbArenaMark m = { a->blocks, a->blocks ? a->blocks->used : 0 };
+    return m;
+}
+
+void
+sb_arena_reset(SbArena *a, SbArenaMark m)
+{
+    while (a->blocks && a->blocks != m.block) {
+        SbArenaBlock *next = a->blocks->next;
+        free(a->blocks);
+        a->blocks = next;
+    }
+    if (a->blocks)
+        a->blocks->used = m.used;
+}
+
+void
+sb_arena_release(SbArena *a)
+{
+    SbArenaMark none = { NULL, 0 };
+    sb_arena_reset(a, none);
+}
+
+VOID SetMem(VOID *b, UINTN n, UINT8 v)            { memset(b, v, n); }
+VOID CopyMem(VOID *d, VOID *s, UINTN n)           { memmove(d, s, n); }
+INTN CompareMem(const VOID *a, const VOID *b, UINTN n)
+{
+    return memcmp(a, b, n);
+}
+
+UINTN
+StrLen(const CHAR16 *s)
+{
+    UINTN n = 0;
+    while (s[n]) n++;
+    return n;
+}
+
+INTN
+StrCmp(const CHAR16 *a, const CHAR16 *b)
+{
+    while (*a && *a == *b) a++, b++;
+    return (INTN)*a - (INTN)*b;
+}
+
+INTN
+StrnCmp(const CHAR16 *a, const CHAR16 *b, UINTN n)
+{
+    for (; n > 0; n--, a++, b++)
+        if (*a != *b || !*a)
+            return (INTN)*a - (INTN)*b;
+    return 0;
+}
+
+INTN
+StriCmp(const CHAR16 *a, const CHAR16 *b)
+{
+    for (;; a++, b++) {
+        CHAR16 x = (*a >= 'A' && *a <= 'Z') ? *a + 32 : *a;
+        CHAR16 y = (*b >= 'A' && *b <= 'Z') ? *b + 32 : *b;
+        if (x != y || !x)
+            return (INTN)x - (INTN)y;
+    }
+}
+
+/* Enough of SPrint for the parsers: %s only. */
+UINTN
+SPrint(CHAR16 *out, UINTN size, const CHAR16 *fmt, ...)
+{
+    __builtin_va_list ap;
+    __builtin_va_start(ap, fmt);
+    UINTN n = 0, max = size / sizeof(CHAR16);
+    for (; *fmt && n + 1 < max; fmt++) {
+        if (fmt[0] == '%' && fmt[1] == 's') {
+            const CHAR16 *s = __builtin_va_arg(ap, const CHAR16 *);
+            while (*s && n + 1 < max) out[n++] = *s++;
+            fmt++;
+        } else {
+            out[n++] = *fmt;
+        }
+    }
+    out[n] = 0;
+    __builtin_va_end(ap);
+    return n;
+}
+
+/* ------------------------------------------------------------------ */
+/*  In-memory \loader\entries for systemd-boot                         */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    EFI_FILE_PROTOCOL  file;
+    const char        *data;        /* NULL: the entries directory   */
+    UINTN              pos;
+} FakeFile;
+
+static char  **entry_names;
+static char  **entry_data;
+static UINTN   entry_count;
+
+static EFI_STATUS EFIAPI fake_open(EFI_FILE_PROTOCOL *, EFI_FILE_PROTOCOL **,
+                                   CHAR16 *, UINT64, UINT64);
+static EFI_STATUS EFIAPI fake_close(EFI_FILE_PROTOCOL *);
+static EFI_STATUS EFIAPI fake_read(EFI_FILE_PROTOCOL *, UINTN *, VOID *);
+
+static FakeFile *
+fake_new(const char *data)
+{
+    FakeFile *f = calloc(1, sizeof(*f));
+    f->file.Open  = fake_open;
+    f->file.Close = fake_close;
+    f->file.Read  = fake_read;
+    f->data = data;
+    return f;
+}
+
+static EFI_STATUS EFIAPI
+fake_open(EFI_FILE_PROTOCOL *this, EFI_FILE_PROTOCOL **out,
+          CHAR16 *name, UINT64 mode, UINT64 attr)
+{
+    char name8[256];
+    sb_str16to8((CHAR8 *)name8, name, sizeof(name8));
+    if (strcmp(name8, "\\loader\\entries") == 0) {
+        *out = &fake_new(NULL)->file;
+        return EFI_SUCCESS;
+    }
+    for (UINTN i = 0; i < entry_count; i++) {
+        if (strcmp(name8, entry_names[i]) == 0) {
+            *out = &fake_new(entry_data[i])->file;
+            return EFI_SUCCESS;
+        }
+    }
+    return EFI_NOT_FOUND;
+}
+
+static EFI_STATUS EFIAPI
+fake_close(EFI_FILE_PROTOCOL *this)
+{
+    free(this);
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+fake_read(EFI_FILE_PROTOCOL *this, UINTN *len, VOID *buf)
+{
+    FakeFile *f = (FakeFile *)this;
+
+    if (f->data) {
+        UINTN left = strlen(f->data) - f->pos;
+        if (*len > left)
+            *len = left;
+        memcpy(buf, f->data + f->pos, *len);
+        f->pos += *len;
+        return EFI_SUCCESS;
+    }
+
+    if (f->pos >= entry_count) {
+        *len = 0;
+        return EFI_SUCCESS;
+    }
+    EFI_FILE_INFO *info = buf;
+    const char *name = entry_names[f->pos];
+    memset(info, 0, sizeof(*info));
+    info->FileSize = strlen(entry_data[f->pos]);
+    for (UINTN i = 0; ; i++) {
+        info->FileName[i] = (CHAR16)name[i];
+        if (!name[i])
+            break;
+    }
+    info->Size = SIZE_OF_EFI_FILE_INFO + (strlen(name) + 1) * 2;
+    *len = info->Size;
+    f->pos++;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI
+fake_open_volume(EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *this,
+                 EFI_FILE_PROTOCOL **root)
+{
+    *root = &fake_new("")->file;
+    return EFI_SUCCESS;
+}
+
+static EFI_SIMPLE_FILE_SYSTEM_PROTOCOL fake_sfs = {
+    .OpenVolume = fake_open_volume,
+};
+
+static EFI_STATUS EFIAPI
+fake_handle_protocol(EFI_HANDLE h, EFI_GUID *guid, VOID **iface)
+{
+    *iface = &fake_sfs;
+    return EFI_SUCCESS;
+}
+
+static EFI_BOOT_SERVICES fake_bs = {
+    .HandleProtocol = fake_handle_protocol,
+};
+
+EFI_BOOT_SERVICES *BS = &fake_bs;
+
+/* The same entries through the VFS, for blscfg, beside a grubenv. */
+static const char grubenv[] =
+    "# GRUB Environment Block\n"
+    "saved_entry=arch-7\n"
+    "boot_success=1\n"
+    "####################################################################\n";
+
+/* Scribble over everything allocated from `a` since `m`, so a caller
+ * holding on to it reads garbage rather than stale-but-intact bytes. */
+static void
+poison_since(SbArena *a, SbArenaMark m)
+{
+    for (SbArenaBlock *b = a->blocks; b; b = b->next) {
+        UINTN from = b == m.block ? m.used : 0;
+        memset(b->data + from, 0xa5, b->used - from);
+        if (b == m.block)
+            break;
+    }
+}
+
+/* Like ext4_read_dir(): the directory is read into sb_scratch, which
+ * is reset once the callbacks have run. */
+EFI_STATUS
+sb_vfs_read_dir(EFI_HANDLE device, const CHAR16 *path,
+                SbVfsDirFn fn, void *data)
+{
+    char path8[256];
+    sb_str16to8((CHAR8 *)path8, path, sizeof(path8));
+    if (strcmp(path8, "\\loader\\entries") != 0)
+        return EFI_NOT_FOUND;
+
+    SbArenaMark mark = sb_arena_mark(&sb_scratch);
+    sb_arena_alloc(&sb_scratch, 4096);
+
+    for (UINTN i = 0; i < entry_count; i++) {
+        CHAR16 name[64];
+        sb_str8to16(name, (const CHAR8 *)entry_names[i], 64);
+        if (!fn(data, name, FALSE, strlen(entry_data[i])))
+            break;
+    }
+
+    poison_since(&sb_scratch, mark);
+    sb_arena_reset(&sb_scratch, mark);
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS
+sb_vfs_read_file_arena(EFI_HANDLE device, const CHAR16 *path,
+                       SbArena *arena, void **out, UINTN *size)
+{
+    static const char dir[] = "\\loader\\entries\\";
+    char path8[256];
+    const char *text = NULL;
+
+    sb_str16to8((CHAR8 *)path8, path, sizeof(path8));
+    if (strcmp(path8, "\\boot\\grub\\grubenv") == 0)
+        text = grubenv;
+    for (UINTN i = 0; !text && i < entry_count; i++)
+        if (strncmp(path8, dir, sizeof(dir) - 1) == 0 &&
+            strcmp(path8 + sizeof(dir) - 1, entry_names[i]) == 0)
+            text = entry_data[i];
+    if (!text)
+        return EFI_NOT_FOUND;
+
+    *size = strlen(text);
+    *out = sb_arena_alloc(arena, *size + 1);
+    memcpy(*out, text, *size + 1);
+    return EFI_SUCCESS;
+}
+
+EFI_HANDLE
+sb_vfs_find_uuid(const CHAR8 *uuid)
+{
+    return NULL;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Generated configs                                                  */
+/* ------------------------------------------------------------------ */
+
+static char *
+append(char *buf, size_t *len, size_t *cap, const char *s)
+{
+    size_t n = strlen(s);
+    if (*len + n + 1 > *cap) {
+        *cap = (*cap + n + 1) * 2;
+        buf = realloc(buf, *cap);
+    }
+    memcpy(buf + *len, s, n + 1);
+    *len += n;
+    return buf;
+}
+
+static const char grub_header[] =
+    "#\n# DO NOT EDIT THIS FILE\n#\n"
+    "### BEGIN /etc/grub.d/00_header ###\n"
+    "insmod part_gpt\ninsmod part_msdos\n"
+    "if [ -s $prefix/grubenv ]; then\n  load_env\nfi\n"
+    "if [ \"${next_entry}\" ] ; then\n   set default=\"${next_entry}\"\n"
+    "   set next_entry=\n   save_env next_entry\n   set boot_once=true\n"
+    "else\n   set default=\"0\"\nfi\n\n"
+    "function load_video {\n  if [ x$feature_all_video_module = xy ]; then\n"
+    "    insmod all_video\n  else\n    insmod efi_gop\n    insmod efi_uga\n"
+    "  fi\n}\n\n"
+    "set menu_color_normal=cyan/blue\nset menu_color_highlight=white/blue\n"
+    "terminal_input console\nterminal_output gfxterm\n"
+    "set timeout_style=menu\nset timeout=5\n"
+    "### END /etc/grub.d/00_header ###\n\n";
+
+static char *
+make_grub(UINTN entries)
+{
+    size_t len = 0, cap = 0;
+    char *buf = append(NULL, &len, &cap, grub_header);
+    char line[512];
+
+    for (UINTN i = 0; i < entries; i++) {
+        snprintf(line, sizeof(line),
+            "menuentry 'Arch Linux, with Linux linux-%u' --class arch "
+            "--class gnu-linux --class gnu --class os $menuentry_id_option "
+            "'gnulinux-linux-%u-advanced-0f3c' {\n"
+            "\tload_video\n"
+            "\tset gfxpayload=keep\n"
+            "\tinsmod gzio\n"
+            "\tinsmod part_gpt\n"
+            "\tinsmod ext2\n"
+            "\tsearch --no-floppy --fs-uuid --set=root 0f3c8a5e-1b2d\n"
+            "\techo\t'Loading Linux linux-%u ...'\n"
+            "\tlinux\t/boot/vmlinuz-linux-%u root=UUID=0f3c8a5e-1b2d rw "
+            "loglevel=3 quiet\n"
+            "\techo\t'Loading initial ramdisk ...'\n"
+            "\tinitrd\t/boot/intel-ucode.img /boot/initramfs-linux-%u.img\n"
+            "}\n",
+            (unsigned)i, (unsigned)i, (unsigned)i, (unsigned)i, (unsigned)i);
+        buf = append(buf, &len, &cap, line);
+    }
+    return buf;
+}
+
+static char *
+make_limine(UINTN entries)
+{
+    size_t len = 0, cap = 0;
+    char *buf = append(NULL, &len, &cap,
+                       "# Limine config\ntimeout: 5\nverbose: yes\n\n");
+    char line[512];
+
+    for (UINTN i = 0; i < entries; i++) {
+        snprintf(line, sizeof(line),
+            "/Arch Linux %u\n"
+            "    protocol: linux\n"
+            "    kernel_path: boot():/vmlinuz-linux-%u\n"
+            "    kernel_cmdline: root=UUID=0f3c8a5e-1b2d rw loglevel=3 quiet\n"
+            "    module_path: boot():/intel-ucode.img\n"
+            "    module_path: boot():/initramfs-linux-%u.img\n"
+            "\n",
+            (unsigned)i, (unsigned)i, (unsigned)i);
+        buf = append(buf, &len, &cap, line);
+    }
+    return buf;
+}
+
+/* The head of grub.cfg as RHEL 8 and Fedora write it. */
+static char *
+make_grub_bls(void)
+{
+    return strdup(
+        "#\n# DO NOT EDIT THIS FILE\n#\n"
+        "### BEGIN /etc/grub.d/00_header ###\n"
+        "set pager=1\n\n"
+        "if [ -f ${config_directory}/grubenv ]; then\n"
+        "  load_env -f ${config_directory}/grubenv\n"
+        "elif [ -s $prefix/grubenv ]; then\n  load_env\nfi\n"
+        "if [ \"${next_entry}\" ] ; then\n"
+        "   set default=\"${next_entry}\"\n   set next_entry=\n"
+        "   save_env next_entry\n   set boot_once=true\n"
+        "else\n   set default=\"${saved_entry}\"\nfi\n\n"
+        "set timeout_style=menu\nset timeout=5\n"
+        "### END /etc/grub.d/00_header ###\n\n"
+        "### BEGIN /etc/grub.d/10_linux ###\n"
+        "insmod part_gpt\ninsmod xfs\nset root='hd0,gpt2'\n"
+        "if [ -z \"${kernelopts}\" ]; then\n"
+        "  set kernelopts=\"root=/dev/mapper/rhel-root ro "
+        "crashkernel=auto resume=/dev/mapper/rhel-swap rhgb quiet \"\n"
+        "fi\n\n"
+        "insmod blscfg\nblscfg\n"
+        "### END /etc/grub.d/10_linux ###\n");
+}
+
+/* The entry files; returns loader.conf. */
+static char *
+make_sdboot(UINTN entries, size_t *total)
+{
+    char line[512];
+
+    entry_names = calloc(entries, sizeof(*entry_names));
+    entry_data  = calloc(entries, sizeof(*entry_data));
+    entry_count = entries;
+    *total = 0;
+
+    for (UINTN i = 0; i < entries; i++) {
+        snprintf(line, sizeof(line), "arch-%u.conf", (unsigned)i);
+        entry_names[i] = strdup(line);
+        snprintf(line, sizeof(line),
+            "# Generated entry\n"
+            "title      Arch Linux %u\n"
+            "version    6.%u.0-arch1-1\n"
+            "machine-id 0f3c8a5e1b2d4e6f\n"
+            "linux      /vmlinuz-linux-%u\n"
+            "initrd     /intel-ucode.img\n"
+            "initrd     /initramfs-linux-%u.img\n"
+            "options    root=UUID=0f3c8a5e-1b2d rw loglevel=3 quiet\n",
+            (unsigned)i, (unsigned)i, (unsigned)i, (unsigned)i);
+        entry_data[i] = strdup(line);
+        *total += strlen(line);
+    }
+    return strdup("timeout 5\nconsole-mode max\ndefault arch-0.conf\n");
+}
+
+/* ------------------------------------------------------------------ */
+/*  Harness                                                            */
+/* ------------------------------------------------------------------ */
+
+static double
+now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static UINT64
+fnv(UINT64 h, const void *p, size_t n)
+{
+    const UINT8 *b = p;
+    for (size_t i = 0; i < n; i++)
+        h = (h ^ b[i]) * 0x100000001b3ULL;
+    return h;
+}
+
+static UINT64
+fnv16(UINT64 h, const CHAR16 *s)
+{
+    return s ? fnv(h, s, (StrLen(s) + 1) * sizeof(CHAR16)) : fnv(h, "-", 1);
+}
+
+static UINT64
+digest(const BootTargetList *list)
+{
+    UINT64 h = 0xcbf29ce484222325ULL;
+    for (UINTN i = 0; i < list->count; i++) {
+        const BootTarget *t = &list->entries[i];
+        h = fnv16(h, t->title);
+        h = fnv16(h, t->kernel_path);
+        h = fnv16(h, t->efi_path);
+        h = t->cmdline ? fnv(h, t->cmdline, strlen((const char *)t->cmdline))
+                       : fnv(h, "-", 1);
+        for (UINT32 j = 0; j < t->initrd_count; j++)
+            h = fnv16(h, t->initrd_paths[j]);
+        h = fnv(h, &t->is_default, sizeof(t->is_default));
+    }
+    return h;
+}
+
+static size_t
+count_lines(const char *s)
+{
+    size_t n = 0;
+    for (; *s; s++)
+        n += *s == '\n';
+    return n;
+}
+
+static void
+bench(const char *name, const ConfigParser *parser, const char *text,
+      size_t bytes, size_t lines, int iterations)
+{
+    double best = 0;
+    UINTN  count = 0;
+    UINT64 h = 0;
+
+    for (int i = 0; i < iterations; i++) {
+        BootTargetList list;
+        sb_targets_init(&list);
+
+        double t0 = now_s();
+        parser->parse((const CHAR8 *)text, strlen(text), (EFI_HANDLE)1,
+                      parser->config_paths[0], &list, &count);
+        double t = now_s() - t0;
+
+        if (i == 0 || t < best)
+            best = t;
+        h = digest(&list);
+        sb_targets_free(&list);
+    }
+
+    printf("%-14s %8zu %10.1f %12.0f %10u  %016llx\n", name, lines,
+           (double)bytes / (1024.0 * 1024.0) / best, (double)lines / best,
+           (unsigned)count, (unsigned long long)h);
+}
+
+int
+main(int argc, char **argv)
+{
+    UINTN entries  = argc > 1 ? (UINTN)atoi(argv[1]) : 100;
+    int iterations = argc > 2 ? atoi(argv[2]) : 1000;
+
+    sb_arena_init(&sb_scratch, SB_SCRATCH_BLOCK_SIZE, SB_MEM_SCAN);
+
+    char *grub   = make_grub(entries);
+    char *grub_bls = make_grub_bls();
+    char *limine = make_limine(entries);
+    size_t sd_bytes;
+    char *loader = make_sdboot(entries, &sd_bytes);
+    size_t sd_lines = 0;
+    for (UINTN i = 0; i < entry_count; i++)
+        sd_lines += count_lines(entry_data[i]);
+
+    printf("%-14s %8s %10s %12s %10s  %s\n",
+           "parser", "lines", "MiB/s", "lines/s", "entries", "digest");
+    bench("grub", &sb_parser_grub, grub, strlen(grub), count_lines(grub),
+          iterations);
+    bench("grub (bls)", &sb_parser_grub, grub_bls,
+          sd_bytes + strlen(grub_bls), sd_lines + count_lines(grub_bls),
+          iterations);
+    bench("systemd-boot", &sb_parser_systemd_boot, loader, sd_bytes,
+          sd_lines, iterations);
+    bench("limine", &sb_parser_limine, limine, strlen(limine),
+          count_lines(limine), iterations);
+    return 0;
+}
@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+#
+# sbctl.py — Drive SuperBoot through its serial automation protocol
+#
+# Usage:
+#   ./tools/sbctl.py SOCKET [COMMAND ...]
+#
+# SOCKET is the control port: a Unix socket QEMU serves for the second
+# serial port (`make qemu-control` creates build/control.sock), or a
+# host:port TCP address.  Each COMMAND is sent in turn and the "@sb"
+# lines of its reply are printed; with no COMMAND, commands are read
+# from stdin, one per line.  Marks SuperBoot announces in between
+# ("@sb mark ...") are printed as they arrive.  Exit status is 1 if a
+# command was answered with "err".
+#
+#   ./tools/sbctl.py build/control.sock wait list "boot 0"
+#
+# The protocol is described in src/tui/control.c.  Other tools can
+# import this module and use Control directly: each reply line comes
+# back as (kind, {key: value}).
+#
+# Only the Python standard library is required.
+
+import shlex
+import socket
+import sys
+import time
+
+
+def parse(line):
+    """Split an "@sb" line into its kind and key=value fields."""
+    words = shlex.split(line[len("@sb "):])
+    kind, fields, rest = words[0], {}, []
+    for w in words[1:]:
+        key, eq, value = w.partition("=")
+        if eq:
+            fields[key] = int(value) if value.isdigit() else value
+        else:
+            rest.append(w)
+    if rest:
+        fields["args"] = rest
+    return kind, fields
+
+
+class Control:
+    def __init__(self, address, timeout=60.0, on_line=None):
+        if ":" in address and not address.startswith("/"):
+            host, _, port = address.rpartition(":")
+            self.sock = socket.create_connection((host, int(port)), timeout)
+        else:
+            self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+            self.sock.settimeout(timeout)
+            self.sock.connect(address)
+        self.buf = b""
+        self.on_line = on_line or (lambda kind, fields, raw: None)
+
+    def _line(self, deadline):
+        while b"\n" not in self.buf:
+            if time.monotonic() > deadline:
+                raise TimeoutError("no reply from SuperBoot")
+            chunk = self.sock.recv(4096)
+            if not chunk:
+                raise EOFError("control port closed")
+            self.buf += chunk
+        line, _, self.buf = self.buf.partition(b"\n")
+        return line.decode("utf-8", errors="replace").strip()
+
+    def wait_for(self, kind, timeout=60.0, name=None):
+        """Read until a line of `kind` (and mark `name`) arrives."""
+        deadline = time.monotonic() + timeout
+        while True:
+            raw = self._line(deadline)
+            if not raw.startswith("@sb "):
+                continue
+            k, fields = parse(raw)
+            self.on_line(k, fields, raw)
+            if k == kind and (name is None or fields.get("name") == name):
+                return fields
+
+    def command(self, cmd, timeout=60.0):
+        """Send one command; return (ok, [reply lines])."""
+        self.sock.sendall(cmd.encode() + b"\n")
+        verb = cmd.split()[0]
+        deadline = time.monotonic() + timeout
+        lines = []
+        while True:
+            raw = self._line(deadline)
+            if not raw.startswith("@sb "):
+                continue
+            kind, fields = parse(raw)
+            self.on_line(kind, fields, raw)
+            lines.append((kind, fields))
+            args = fields.get("args", [])
+            if kind in ("ok", "err") and args and args[0] == verb:
+                return kind == "ok", lines
+
+
+def main():
+    if len(sys.argv) < 2:
+        sys.exit("usage: sbctl.py SOCKET [COMMAND ...]")
+
+    ctl = Control(sys.argv[1], on_line=lambda k, f, raw: print(raw))
+    commands = sys.argv[2:] or (l.strip() for l in sys.stdin)
+    failed = False
+    for cmd in commands:
+        if not cmd:
+            continue
+        ok, _ = ctl.command(cmd)
+        failed |= not ok
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,296 @@
+/*
+ * str-bench.c — Host benchmark for the CHAR8 string helpers
+ *
+ * Usage:
+ *   make bench-str
+ *   ./build/str-bench [FILE] [ITERATIONS]
+ *
+ * Runs the scans the config parsers do over FILE (a grub.cfg or other
+ * config; a generated one when omitted) with both src/util/string.c
+ * and the byte-at-a-time versions it replaced, checks that the two
+ * agree, and prints the best of ITERATIONS runs (default 20) of each
+ * in MiB/s.  The UTF-8 conversions are checked against known strings
+ * before anything is timed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "superboot.h"
+
+/* ------------------------------------------------------------------ */
+/*  The previous implementations                                       */
+/* ------------------------------------------------------------------ */
+
+static UINTN
+old_strlen8(const CHAR8 *a)
+{
+    UINTN len = 0;
+    while (a[len]) len++;
+    return len;
+}
+
+static INTN
+old_strncmp8(const CHAR8 *a, const CHAR8 *b, UINTN n)
+{
+    for (UINTN i = 0; i < n; i++) {
+        if (a[i] != b[i] || a[i] == '\0')
+            return (INTN)a[i] - (INTN)b[i];
+    }
+    return 0;
+}
+
+static CHAR8 *
+old_strstr8(const CHAR8 *haystack, const CHAR8 *needle)
+{
+    if (!*needle) return (CHAR8 *)haystack;
+    UINTN nlen = old_strlen8(needle);
+
+    for (; *haystack; haystack++) {
+        if (old_strncmp8(haystack, needle, nlen) == 0)
+            return (CHAR8 *)haystack;
+    }
+    return NULL;
+}
+
+static CHAR8 *
+old_skip_whitespace(CHAR8 *p)
+{
+    while (*p == ' ' || *p == '\t') p++;
+    return p;
+}
+
+static CHAR8 *
+old_next_line(CHAR8 *p)
+{
+    while (*p && *p != '\n') p++;
+    if (*p == '\n') p++;
+    return p;
+}
+
+static void
+old_str8to16(CHAR16 *dst, const CHAR8 *src, UINTN max)
+{
+    UINTN i;
+    for (i = 0; i + 1 < max && src[i]; i++)
+        dst[i] = (CHAR16)(UINT8)src[i];
+    dst[i] = L'\0';
+}
+
+/* ------------------------------------------------------------------ */
+/*  Harness                                                            */
+/* ------------------------------------------------------------------ */
+
+static double
+now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static CHAR8 *
+read_all(const char *path, size_t *size)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    *size = (size_t)ftell(f);
+    rewind(f);
+    CHAR8 *buf = malloc(*size + 1);
+    if (buf && fread(buf, 1, *size, f) != *size) {
+        perror(path);
+        free(buf);
+        buf = NULL;
+    }
+    fclose(f);
+    if (buf)
+        buf[*size] = '\0';
+    return buf;
+}
+
+/* A grub.cfg-shaped text of about `size` bytes. */
+static CHAR8 *
+make_config(size_t size)
+{
+    static const char *entry =
+        "menuentry 'Arch Linux, with Linux linux-lts' --class arch "
+        "--class gnu-linux --class gnu --class os $menuentry_id_option "
+        "'gnulinux-linux-lts-advanced-0f3c' {\n"
+        "\tload_video\n"
+        "\tset gfxpayload=keep\n"
+        "\tinsmod gzio\n"
+        "\tinsmod part_gpt\n"
+        "\tinsmod ext2\n"
+        "\tsearch --no-floppy --fs-uuid --set=root 0f3c8a5e-1b2d\n"
+        "\techo\t'Loading Linux linux-lts ...'\n"
+        "\tlinux\t/boot/vmlinuz-linux-lts root=UUID=0f3c8a5e-1b2d rw "
+        "loglevel=3 quiet\n"
+        "\techo\t'Loading initial ramdisk ...'\n"
+        "\tinitrd\t/boot/intel-ucode.img /boot/initramfs-linux-lts.img\n"
+        "}\n";
+    size_t n = strlen(entry);
+    CHAR8 *buf = malloc(size + n + 1);
+    size_t len = 0;
+    while (len < size) {
+        memcpy(buf + len, entry, n);
+        len += n;
+    }
+    buf[len] = '\0';
+    return buf;
+}
+
+typedef struct {
+    const char *name;
+    UINTN (*run)(CHAR8 *text, BOOLEAN use_new);
+} Bench;
+
+static const char *needles[] = { "initrd", "):", "gnulinux-linux-lts",
+                                  "no such needle" };
+
+/* Each run returns a checksum so old and new can be compared. */
+static UINTN
+run_strlen(CHAR8 *text, BOOLEAN use_new)
+{
+    return use_new ? sb_strlen8(text) : old_strlen8(text);
+}
+
+static UINTN
+run_lines(CHAR8 *text, BOOLEAN use_new)
+{
+    UINTN sum = 0;
+    CHAR8 *p = text;
+    while (*p) {
+        CHAR8 *q = use_new ? sb_skip_whitespace(p) : old_skip_whitespace(p);
+        sum += (UINTN)(q - text);
+        p = use_new ? sb_next_line(q) : old_next_line(q);
+    }
+    return sum;
+}
+
+static UINTN
+run_strstr(CHAR8 *text, BOOLEAN use_new)
+{
+    UINTN sum = 0;
+    for (UINTN i = 0; i < sizeof(needles) / sizeof(needles[0]); i++) {
+        const CHAR8 *n = (const CHAR8 *)needles[i];
+        CHAR8 *p = text;
+        for (;;) {
+            CHAR8 *hit = use_new ? sb_strstr8(p, n) : old_strstr8(p, n);
+            if (!hit)
+                break;
+            sum += (UINTN)(hit - text);
+            p = hit + 1;
+        }
+    }
+    return sum;
+}
+
+static UINTN
+run_widen(CHAR8 *text, BOOLEAN use_new)
+{
+    static CHAR16 wide[SB_MAX_CMDLINE];
+    UINTN sum = 0;
+    for (CHAR8 *p = text; *p; p = sb_next_line(p)) {
+        if (use_new)
+            sb_str8to16(wide, p, 512);
+        else
+            old_str8to16(wide, p, 512);
+        sum += wide[0];
+    }
+    return sum;
+}
+
+static const Bench benches[] = {
+    { "strlen8",                run_strlen },
+    { "skip_whitespace+lines",  run_lines  },
+    { "strstr8 (4 needles)",    run_strstr },
+    { "str8to16 per line",      run_widen  },
+};
+
+/* ------------------------------------------------------------------ */
+/*  UTF-8 checks                                                       */
+/* ------------------------------------------------------------------ */
+
+static int
+check_utf8(void)
+{
+    static const struct {
+        const char    *utf8;
+        const CHAR16   wide[8];
+        const char    *back;            /* NULL: same as utf8 */
+    } cases[] = {
+        { "Caf\xC3\xA9",          { 'C', 'a', 'f', 0xE9 },        NULL },
+        { "\xE2\x82\xAC""5",      { 0x20AC, '5' },                NULL },
+        { "\xF0\x9F\x90\xA7",     { 0xD83D, 0xDC27 },             NULL },
+        { "x\xE9y",               { 'x', 0xE9, 'y' },  "x\xC3\xA9y" },
+        { "\xC0\xAF",             { 0xC0, 0xAF },  "\xC3\x80\xC2\xAF" },
+        { "\xED\xA0\x80",         { 0xED, 0xA0, 0x80 },
+                                  "\xC3\xAD\xC2\xA0\xC2\x80" },
+    };
+    int bad = 0;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        CHAR16 wide[16];
+        CHAR8  back[32];
+        sb_str8to16(wide, (const CHAR8 *)cases[i].utf8, 16);
+        sb_str16to8(back, wide, 32);
+        const char *want = cases[i].back ? cases[i].back : cases[i].utf8;
+        size_t n = 0;
+        while (cases[i].wide[n]) n++;
+        if (memcmp(wide, cases[i].wide, (n + 1) * sizeof(CHAR16)) != 0 ||
+            strcmp((char *)back, want) != 0) {
+            printf("UTF-8 case %zu: mismatch\n", i);
+            bad = 1;
+        }
+    }
+
+    /* A character that does not fit is dropped whole. */
+    CHAR8 small[3];
+    CHAR16 euro[] = { 'a', 0x20AC, 0 };
+    sb_str16to8(small, euro, sizeof(small));
+    if (strcmp((char *)small, "a") != 0) {
+        printf("UTF-8: partial character written\n");
+        bad = 1;
+    }
+    return bad;
+}
+
+int
+main(int argc, char **argv)
+{
+    size_t size = 4 * 1024 * 1024;
+    CHAR8 *text = argc > 1 ? read_all(argv[1], &size) : make_config(size);
+    int iterations = argc > 2 ? atoi(argv[2]) : 20;
+    if (!text)
+        return 1;
+    size = strlen((char *)text);
+
+    int bad = check_utf8();
+
+    printf("%-24s %12s %12s %8s\n", "", "old MiB/s", "new MiB/s", "speedup");
+    for (size_t b = 0; b < sizeof(benches) / sizeof(benches[0]); b++) {
+        double best[2] = { 0, 0 };
+        UINTN  sum[2]  = { 0, 0 };
+        for (int v = 0; v < 2; v++) {
+            for (int i = 0; i < iterations; i++) {
+                double t0 = now_s();
+                sum[v] = benches[b].run(text, v == 1);
+                double t = now_s() - t0;
+                if (i == 0 || t < best[v])
+                    best[v] = t;
+            }
+        }
+        double mib = (double)size / (1024.0 * 1024.0);
+        printf("%-24s %12.1f %12.1f %7.2fx%s\n", benches[b].name,
+               mib / best[0], mib / best[1], best[0] / best[1],
+               sum[0] == sum[1] ? "" : "  MISMATCH");
+        if (sum[0] != sum[1])
+            bad = 1;
+    }
+    return bad;
+}